@@ -0,0 +1,202 @@
+/**
+@file BenchBatchScript.c
+@author Rob Thomas
+@brief Measures the startup time of a BatchSession and the cost of each script
+in a batch. Runs many small script files through one session and through a
+fresh session per script, and runs empty scripts to isolate the overhead per
+script. Also compares printing a Matrix through an OutputBuffer with printing
+it through fprintf. Output goes to /dev/null. Writes the results to
+build/results/bench_batchscript.csv.
+*/
+
+/*** INCLUDES: ***/
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "BatchScript.h"
+#include "Benchmark.h"
+#include "Matrix.h"
+#include "OutputBuffer.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define BENCH_NUM_SCRIPTS 2000
+#define BENCH_NUM_STARTUPS 1000
+#define BENCH_PRINT_SIZE 200
+#define BENCH_PATH_LENGTH 64
+
+/*** GLOBALS: ***/
+static const char benchScript[] =
+	"# A small script of the kind run from a pipeline.\n"
+	"a = [1 2 3; 4 5 6; 7 8 10]\n"
+	"b = 1/2\n"
+	"c = b * a * a - 2 * a\n"
+	"print c\n"
+	"print b\n";
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn writeScripts
+@brief Writes a script to many files in a directory.
+@param directory The directory to write to.
+@param prefix The start of each file's name.
+@param text The script.
+@param paths The list of BENCH_NUM_SCRIPTS paths to fill in.
+@return An error code. 0 if no problems were encountered.
+*/
+static int writeScripts (const char *directory, const char *prefix,
+	const char *text, char **paths)
+{
+	for (unsigned int i = 0; i < BENCH_NUM_SCRIPTS; i++)
+	{
+		paths[i] = (char *)malloc(BENCH_PATH_LENGTH);
+		snprintf(paths[i], BENCH_PATH_LENGTH, "%s/%s%u", directory, prefix, i);
+		FILE *file = fopen(paths[i], "w");
+		if ( !file )
+		{
+			return 1;
+		}
+		fputs(text, file);
+		fclose(file);
+	}
+	return 0;
+}
+
+/**
+@fn removeScripts
+@brief Deletes the files written by writeScripts and frees their paths.
+@param paths The list of BENCH_NUM_SCRIPTS paths.
+*/
+static void removeScripts (char **paths)
+{
+	for (unsigned int i = 0; i < BENCH_NUM_SCRIPTS; i++)
+	{
+		unlink(paths[i]);
+		free(paths[i]);
+	}
+}
+
+/**
+@fn benchBatch
+@brief Times a batch of scripts through one session, then through a fresh
+session per script.
+@param label The label of the scripts, used in the result names.
+@param paths The list of BENCH_NUM_SCRIPTS paths.
+@param devNull A file descriptor open on /dev/null.
+*/
+static void benchBatch (const char *label, char **paths, int devNull)
+{
+	char name[64];
+	BatchSession *session = BS_new(0, devNull);
+	unsigned int numFailed;
+	double start = BENCH_now();
+	BS_runBatch(session, paths, BENCH_NUM_SCRIPTS, &numFailed);
+	snprintf(name, sizeof(name), "BS_runBatch %s", label);
+	BENCH_record(name, BENCH_NUM_SCRIPTS, BENCH_now() - start, 0);
+	BS_free(session);
+	if ( numFailed )
+	{
+		fprintf(stderr, "%u %s scripts failed\n", numFailed, label);
+	}
+	start = BENCH_now();
+	for (unsigned int i = 0; i < BENCH_NUM_SCRIPTS; i++)
+	{
+		session = BS_new(0, devNull);
+		BS_runFile(session, paths[i]);
+		BS_free(session);
+	}
+	snprintf(name, sizeof(name), "fresh session per script %s", label);
+	BENCH_record(name, BENCH_NUM_SCRIPTS, BENCH_now() - start, 0);
+}
+
+/**
+@fn benchPrint
+@brief Times printing a Matrix of fractions through an OutputBuffer and
+through fprintf.
+@param devNull A file descriptor open on /dev/null.
+*/
+static void benchPrint (int devNull)
+{
+	unsigned int n = BENCH_PRINT_SIZE;
+	uint64_t numElements = (uint64_t)n * n;
+	Matrix *m = M_new(n, n);
+	for (size_t i = 0; i < numElements; i++)
+	{
+		R_reduce64(&m->elements[i], random() % 20001 - 10000, random() % 99 + 1);
+	}
+	M_rehash(m);
+	OutputBuffer out;
+	OB_init(&out, devNull, OB_DEFAULT_CAPACITY);
+	double start = BENCH_now();
+	OB_writeMatrix(&out, m);
+	OB_flush(&out);
+	BENCH_record("OB_writeMatrix", numElements, BENCH_now() - start, 0);
+	OB_close(&out);
+	FILE *file = fdopen(dup(devNull), "w");
+	start = BENCH_now();
+	for (unsigned int i = 0; i < n; i++)
+	{
+		for (unsigned int j = 0; j < n; j++)
+		{
+			Rational r = M_AT(m, i, j);
+			if ( r.bottom == 1 )
+			{
+				fprintf(file, "%d", r.top);
+			}
+			else
+			{
+				fprintf(file, "%d/%d", r.top, r.bottom);
+			}
+			fputc(j + 1 < n ? ' ' : '\n', file);
+		}
+	}
+	fflush(file);
+	BENCH_record("fprintf", numElements, BENCH_now() - start, 0);
+	fclose(file);
+	M_free(m);
+}
+
+int main ()
+{
+	srandom(1);
+	int devNull = open("/dev/null", O_WRONLY);
+	char directory[] = "/tmp/bench_batchscript_XXXXXX";
+	if ( devNull < 0 || !mkdtemp(directory) )
+	{
+		fprintf(stderr, "Could not set up the scripts\n");
+		return 1;
+	}
+	/* Startup: everything a session allocates before its first script. */
+	double start = BENCH_now();
+	for (unsigned int i = 0; i < BENCH_NUM_STARTUPS; i++)
+	{
+		BS_free(BS_new(0, devNull));
+	}
+	BENCH_record("BS_new + BS_free", BENCH_NUM_STARTUPS, BENCH_now() - start, 0);
+	char **paths = (char **)malloc(sizeof(char *) * BENCH_NUM_SCRIPTS);
+	int error = writeScripts(directory, "empty", "", paths);
+	if ( !error )
+	{
+		benchBatch("empty", paths, devNull);
+	}
+	removeScripts(paths);
+	error = error ? error : writeScripts(directory, "small", benchScript, paths);
+	if ( !error )
+	{
+		benchBatch("small", paths, devNull);
+	}
+	removeScripts(paths);
+	free(paths);
+	rmdir(directory);
+	if ( error )
+	{
+		fprintf(stderr, "Could not write the scripts\n");
+		return 1;
+	}
+	benchPrint(devNull);
+	close(devNull);
+	return BENCH_writeResults("bench_batchscript");
+}
\ No newline at end of file
@@ -0,0 +1,148 @@
+/**
+@file BenchBufferPool.c
+@author Rob Thomas
+@brief Measures creating and dropping same-sized temporaries through the
+buffer pool against malloc and free, and summing large matrices with and
+without huge pages, then writes the results to
+build/results/bench_bufferpool.csv.
+*/
+
+/*** INCLUDES: ***/
+#include <stdio.h>
+
+#include "Benchmark.h"
+#include "BufferPool.h"
+#include "Matrix.h"
+#include "MatrixExpr.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define BENCH_TEMPORARY_ELEMENTS (1 << 25)
+#define BENCH_LARGE_SIZE 1024
+#define BENCH_LARGE_REPEATS 10
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn fillMatrix
+@brief Fills a matrix with small random integers.
+@param m Pointer to the Matrix to fill.
+*/
+static void fillMatrix (Matrix *m)
+{
+	for (size_t i = 0; i < (size_t)m->numRows * m->numCols; i++)
+	{
+		m->elements[i].top = random() % 21 - 10;
+	}
+	M_rehash(m);
+}
+
+/**
+@fn clearTemporary
+@brief Sets every element of a new temporary to 0/1, as M_new does.
+@param elements The temporary's element buffer.
+@param numElements The number of elements in the buffer.
+@return The last element's bottom, so the writes are kept.
+*/
+static int32_t clearTemporary (Rational *elements, size_t numElements)
+{
+	for (size_t i = 0; i < numElements; i++)
+	{
+		elements[i].top = 0;
+		elements[i].bottom = 1;
+	}
+	return elements[numElements - 1].bottom;
+}
+
+/**
+@fn benchTemporaries
+@brief Times a loop which allocates an nxn temporary, clears it and drops it,
+once with malloc and free and once with the buffer pool.
+@param n The size of the matrices.
+*/
+static void benchTemporaries (unsigned int n)
+{
+	char name[64];
+	size_t numElements = (size_t)n * n;
+	size_t bytes = sizeof(Rational) * numElements;
+	unsigned int numTemporaries = BENCH_TEMPORARY_ELEMENTS / numElements;
+	double start = BENCH_now();
+	for (unsigned int i = 0; i < numTemporaries; i++)
+	{
+		Rational *elements = (Rational *)malloc(bytes);
+		BENCH_KEEP(clearTemporary(elements, numElements));
+		free(elements);
+	}
+	snprintf(name, sizeof(name), "malloc temporaries %ux%u", n, n);
+	BENCH_record(name, numTemporaries, BENCH_now() - start, 0);
+	BP_resetStats();
+	start = BENCH_now();
+	for (unsigned int i = 0; i < numTemporaries; i++)
+	{
+		Rational *elements = (Rational *)BP_alloc(bytes);
+		BENCH_KEEP(clearTemporary(elements, numElements));
+		BP_release(elements);
+	}
+	snprintf(name, sizeof(name), "BP_alloc temporaries %ux%u", n, n);
+	BENCH_record(name, numTemporaries, BENCH_now() - start, 0);
+	BP_Stats stats;
+	BP_getStats(&stats);
+	printf("%ux%u: %.2f%% of allocations reused, peak footprint %lld bytes\n",
+		n, n, 100.0 * stats.reuses / stats.allocations,
+		(long long)stats.peakFootprint);
+}
+
+/**
+@fn benchLarge
+@brief Times repeated sums c = a + b of large matrices whose buffers come from
+the pool, so that huge pages can be compared with ordinary pages.
+@param name The name to record the result under.
+*/
+static void benchLarge (const char *name)
+{
+	/* Start from an empty pool so that every buffer is mapped in this mode. */
+	BP_trim();
+	Matrix *a = M_new(BENCH_LARGE_SIZE, BENCH_LARGE_SIZE);
+	Matrix *b = M_new(BENCH_LARGE_SIZE, BENCH_LARGE_SIZE);
+	Matrix *c = M_new(BENCH_LARGE_SIZE, BENCH_LARGE_SIZE);
+	fillMatrix(a);
+	fillMatrix(b);
+	Rational one = {1, 1};
+	MatrixTerm terms[2];
+	terms[0] = ME_element(one, a);
+	terms[1] = ME_element(one, b);
+	double start = BENCH_now();
+	for (int r = 0; r < BENCH_LARGE_REPEATS; r++)
+	{
+		ME_evaluate(c, terms, 2);
+		BENCH_KEEP(c->contentHash);
+	}
+	BENCH_record(name, (uint64_t)BENCH_LARGE_REPEATS * BENCH_LARGE_SIZE *
+		BENCH_LARGE_SIZE, BENCH_now() - start,
+		(uint64_t)BENCH_LARGE_REPEATS * 3 * sizeof(Rational) *
+		BENCH_LARGE_SIZE * BENCH_LARGE_SIZE);
+	M_free(a);
+	M_free(b);
+	M_free(c);
+}
+
+int main ()
+{
+	srandom(1);
+	unsigned int sizes[] = {4, 16, 64, 256};
+	for (unsigned int s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+	{
+		benchTemporaries(sizes[s]);
+	}
+	benchLarge("large sum");
+	BP_setHugePages(true);
+	BP_resetStats();
+	benchLarge("large sum huge pages");
+	BP_Stats stats;
+	BP_getStats(&stats);
+	printf("huge pages: %llu buffers mapped\n",
+		(unsigned long long)stats.hugePageBuffers);
+	BP_setHugePages(false);
+	BP_trim();
+	return BENCH_writeResults("bench_bufferpool");
+}
\ No newline at end of file
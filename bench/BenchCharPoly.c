@@ -0,0 +1,164 @@
+/**
+@file BenchCharPoly.c
+@author Rob Thomas
+@brief Measures CP_charPoly, CP_tracePowers and CP_minPoly on matrices of
+several sizes up to 300x300, on one thread and on several. Each matrix is a
+triangular Matrix with a known diagonal, disguised by integer similarity
+transforms, so its characteristic polynomial is known and is checked. Writes
+the results to build/results/bench_charpoly.csv.
+*/
+
+/*** INCLUDES: ***/
+#include <stdio.h>
+#include <string.h>
+
+#include "Benchmark.h"
+#include "CharPoly.h"
+#include "Matrix.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define BENCH_NUM_THREADS 4
+#define BENCH_NUM_NONZERO_DIAGONAL 8
+#define BENCH_NUM_TRACES 32
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn buildMatrix
+@brief Builds an upper triangular Matrix with small random entries whose
+diagonal is 0 apart from a few entries of 1 and -1, then applies random shears
+(add one row to another and subtract the matching column) and halves it, none
+of which changes its eigenvalues beyond the halving.
+@param n The size of the Matrix.
+@param diagonal The buffer of n integers the diagonal, before halving, is
+written to.
+@return A pointer to the new Matrix.
+*/
+static Matrix *buildMatrix (unsigned int n, int *diagonal)
+{
+	int64_t *entries = (int64_t *)calloc((size_t)n * n, sizeof(int64_t));
+	for (unsigned int i = 0; i < n; i++)
+	{
+		diagonal[i] = i < BENCH_NUM_NONZERO_DIAGONAL ? (i % 2 ? -1 : 1) : 0;
+		entries[(size_t)i * n + i] = diagonal[i];
+		for (unsigned int j = i + 1; j < n; j++)
+		{
+			entries[(size_t)i * n + j] = random() % 3 - 1;
+		}
+	}
+	/* S A S^-1 with S = I + E_ij adds row j to row i, then subtracts column i
+	   from column j. */
+	for (unsigned int s = 0; s < n; s++)
+	{
+		unsigned int i = random() % n, j = random() % n;
+		if ( i == j )
+		{
+			continue;
+		}
+		for (unsigned int k = 0; k < n; k++)
+		{
+			entries[(size_t)i * n + k] += entries[(size_t)j * n + k];
+		}
+		for (unsigned int k = 0; k < n; k++)
+		{
+			entries[(size_t)k * n + j] -= entries[(size_t)k * n + i];
+		}
+	}
+	Matrix *a = M_new(n, n);
+	for (size_t i = 0; i < (size_t)n * n; i++)
+	{
+		R_reduce64(&a->elements[i], entries[i], 2);
+	}
+	M_rehash(a);
+	free(entries);
+	return a;
+}
+
+/**
+@fn benchSize
+@brief Times the characteristic polynomial of an n x n Matrix on one thread
+and on BENCH_NUM_THREADS, checks it, then times the traces of its powers and
+its minimal polynomial. Only the first BENCH_NUM_TRACES traces are taken, as
+the bottoms of later ones (powers of 2) no longer fit in a Rational.
+@param n The size of the Matrix.
+@return An error code. 0 if every result was correct.
+*/
+static int benchSize (unsigned int n)
+{
+	int *diagonal = (int *)malloc(sizeof(int) * n);
+	Matrix *a = buildMatrix(n, diagonal);
+	Rational *coefficients = (Rational *)malloc(sizeof(Rational) * (n + 1));
+	Rational *expected = (Rational *)malloc(sizeof(Rational) * (n + 1));
+	/* The expected polynomial is the product of x - d/2 over the diagonal. */
+	expected[0].top = expected[0].bottom = 1;
+	for (unsigned int i = 0; i < n; i++)
+	{
+		Rational root = {-diagonal[i], 2};
+		R_reduce64(&root, root.top, root.bottom);
+		expected[i + 1].top = 0;
+		expected[i + 1].bottom = 1;
+		for (unsigned int k = i + 1; k > 0; k--)
+		{
+			Rational term = expected[k - 1];
+			R_multR(&term, root);
+			R_addR(&expected[k], term);
+		}
+	}
+	char name[64];
+	int error = 0;
+	unsigned int threadCounts[2] = {1, BENCH_NUM_THREADS};
+	for (int t = 0; t < 2 && !error; t++)
+	{
+		double start = BENCH_now();
+		error = CP_charPoly(a, threadCounts[t], coefficients);
+		snprintf(name, sizeof(name), "CP_charPoly %ux%u %u threads", n, n,
+			threadCounts[t]);
+		BENCH_record(name, 1, BENCH_now() - start, 0);
+		for (unsigned int k = 0; k <= n && !error; k++)
+		{
+			if ( R_compare(coefficients[k], expected[k]) != 0 )
+			{
+				error = ERR_CHARPOLY_OVERFLOW;
+			}
+		}
+	}
+	if ( !error )
+	{
+		double start = BENCH_now();
+		error = CP_tracePowers(a, BENCH_NUM_TRACES, BENCH_NUM_THREADS,
+			coefficients);
+		snprintf(name, sizeof(name), "CP_tracePowers %ux%u", n, n);
+		BENCH_record(name, 1, BENCH_now() - start, 0);
+	}
+	if ( !error )
+	{
+		unsigned int degree;
+		double start = BENCH_now();
+		error = CP_minPoly(a, BENCH_NUM_THREADS, coefficients, &degree);
+		snprintf(name, sizeof(name), "CP_minPoly %ux%u", n, n);
+		BENCH_record(name, 1, BENCH_now() - start, 0);
+	}
+	free(diagonal);
+	free(coefficients);
+	free(expected);
+	M_free(a);
+	return error;
+}
+
+int main ()
+{
+	srandom(1);
+	unsigned int sizes[] = {50, 100, 200, 300};
+	for (unsigned int s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+	{
+		int error = benchSize(sizes[s]);
+		if ( error )
+		{
+			fprintf(stderr, "Characteristic polynomial of %ux%u failed (%d)\n",
+				sizes[s], sizes[s], error);
+			return 1;
+		}
+	}
+	return BENCH_writeResults("bench_charpoly");
+}
\ No newline at end of file
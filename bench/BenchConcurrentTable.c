@@ -0,0 +1,147 @@
+/**
+@file BenchConcurrentTable.c
+@author Rob Thomas
+@brief Measures how lookups in a ConcurrentTable scale with the number of
+reading threads, with and without a thread overwriting variables at the same
+time, and writes the results to build/results/bench_concurrenttable.csv.
+*/
+
+/*** INCLUDES: ***/
+#include <stdio.h>
+#include <pthread.h>
+
+#include "Benchmark.h"
+#include "ConcurrentTable.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define BENCH_KEYS 4096
+#define BENCH_READS_PER_THREAD 2000000
+
+/*** STRUCTS: ***/
+
+/**
+@def ReaderArgs
+@brief A struct representing the arguments of one reading thread.
+@var table Pointer to the shared ConcurrentTable.
+@var seed The seed of the thread's key sequence.
+@var sum The sum of the numerators read, kept so reads are not optimized out.
+*/
+typedef struct
+{
+	ConcurrentTable *table;
+	unsigned int seed;
+	int64_t sum;
+} ReaderArgs;
+
+/*** GLOBALS: ***/
+static char keys[BENCH_KEYS][16];
+static atomic_bool stopWriting;
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn readKeys
+@brief Looks up pseudo-random keys in the shared table.
+@param arg Pointer to the thread's ReaderArgs.
+@return NULL.
+*/
+static void *readKeys (void *arg)
+{
+	ReaderArgs *args = (ReaderArgs *)arg;
+	int reader = CT_registerReader(args->table);
+	unsigned int state = args->seed;
+	for (int i = 0; i < BENCH_READS_PER_THREAD; i++)
+	{
+		state = state * 1103515245u + 12345u;
+		Rational r;
+		if ( CT_get(args->table, reader, keys[(state >> 8) % BENCH_KEYS], &r, NULL) )
+		{
+			args->sum += r.top;
+		}
+	}
+	CT_unregisterReader(args->table, reader);
+	return NULL;
+}
+
+/**
+@fn writeKeys
+@brief Overwrites keys in the shared table until told to stop.
+@param arg Pointer to the shared ConcurrentTable.
+@return NULL.
+*/
+static void *writeKeys (void *arg)
+{
+	ConcurrentTable *table = (ConcurrentTable *)arg;
+	for (unsigned int i = 0; !atomic_load(&stopWriting); i++)
+	{
+		Rational r = {i, 1};
+		CT_put(table, keys[i % BENCH_KEYS], &r, VT_RATIONAL);
+	}
+	return NULL;
+}
+
+/**
+@fn benchReads
+@brief Times a number of threads reading the table concurrently.
+@param table Pointer to the shared ConcurrentTable.
+@param numThreads The number of reading threads.
+@param withWriter Whether a writing thread runs at the same time.
+*/
+static void benchReads (ConcurrentTable *table, unsigned int numThreads,
+	bool withWriter)
+{
+	pthread_t threads[8];
+	ReaderArgs args[8];
+	pthread_t writer;
+	atomic_store(&stopWriting, false);
+	if ( withWriter )
+	{
+		pthread_create(&writer, NULL, writeKeys, table);
+	}
+	double start = BENCH_now();
+	for (unsigned int t = 0; t < numThreads; t++)
+	{
+		args[t].table = table;
+		args[t].seed = t + 1;
+		args[t].sum = 0;
+		pthread_create(&threads[t], NULL, readKeys, &args[t]);
+	}
+	for (unsigned int t = 0; t < numThreads; t++)
+	{
+		pthread_join(threads[t], NULL);
+		BENCH_KEEP(args[t].sum);
+	}
+	double elapsed = BENCH_now() - start;
+	if ( withWriter )
+	{
+		atomic_store(&stopWriting, true);
+		pthread_join(writer, NULL);
+	}
+	char name[64];
+	snprintf(name, sizeof(name), "CT_get %u threads%s", numThreads,
+		withWriter ? " with writer" : "");
+	BENCH_record(name, (uint64_t)numThreads * BENCH_READS_PER_THREAD, elapsed, 0);
+}
+
+int main ()
+{
+	ConcurrentTable *table = CT_new(BENCH_KEYS * 2);
+	for (int i = 0; i < BENCH_KEYS; i++)
+	{
+		snprintf(keys[i], sizeof(keys[i]), "var%d", i);
+		Rational r = {i, 1};
+		CT_put(table, keys[i], &r, VT_RATIONAL);
+	}
+	unsigned int threadCounts[] = {1, 2, 4, 8};
+	for (unsigned int t = 0; t < sizeof(threadCounts) / sizeof(threadCounts[0]); t++)
+	{
+		benchReads(table, threadCounts[t], false);
+	}
+	for (unsigned int t = 0; t < sizeof(threadCounts) / sizeof(threadCounts[0]); t++)
+	{
+		benchReads(table, threadCounts[t], true);
+	}
+	CT_free(table);
+	return BENCH_writeResults("bench_concurrenttable") ? 1 : 0;
+}
\ No newline at end of file
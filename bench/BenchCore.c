@@ -0,0 +1,309 @@
+/**
+@file BenchCore.c
+@author Rob Thomas
+@brief Benchmarks the core operations of Rational.c, HashTable.c and Random.c
+and writes the results to build/results/bench_core.csv.
+*/
+
+/*** INCLUDES: ***/
+#include <stdio.h>
+#include <string.h>
+
+#include "Benchmark.h"
+#include "HashTable.h"
+#include "Random.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define NUM_OPERANDS (1 << 16)
+#define OPERAND_MASK (NUM_OPERANDS - 1)
+#define NUM_ITERATIONS (1 << 22)
+#define TABLE_SIZE (1 << 16)
+#define KEY_LENGTH 16
+#define PIVOT_SIZE 256
+
+/**
+@def BENCH_RATIONAL_OP
+@brief Times a Rational operation which takes a Rational pointer and a second
+operand, applied across the operand arrays.
+@param name The name to record the result under.
+@param op The operation, for example R_addR.
+@param operands The array the second operand is taken from.
+*/
+#define BENCH_RATIONAL_OP(name, op, operands) \
+	do \
+	{ \
+		double start = BENCH_now(); \
+		for (uint32_t i = 0; i < NUM_ITERATIONS; i++) \
+		{ \
+			Rational r = left[i & OPERAND_MASK]; \
+			op(&r, operands[(i * 7) & OPERAND_MASK]); \
+			BENCH_KEEP(r.top); \
+		} \
+		BENCH_record(name, NUM_ITERATIONS, BENCH_now() - start, 0); \
+	} while ( 0 )
+
+/*** GLOBALS: ***/
+static Rational left[NUM_OPERANDS];
+static Rational right[NUM_OPERANDS];
+static int32_t integers[NUM_OPERANDS];
+static int64_t tops[NUM_OPERANDS];
+static int64_t bottoms[NUM_OPERANDS];
+static char keys[TABLE_SIZE][KEY_LENGTH];
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn fillOperands
+@brief Fills the operand arrays with random values small enough that none of
+the benchmarked operations overflow.
+*/
+static void fillOperands ()
+{
+	int errorCode = 0;
+	for (int i = 0; i < NUM_OPERANDS; i++)
+	{
+		R_reduce64(&left[i], Random_in_range(-30000, 30000, &errorCode),
+			Random_in_range(1, 30000, &errorCode));
+		R_reduce64(&right[i], Random_in_range(-30000, 30000, &errorCode),
+			Random_in_range(1, 30000, &errorCode));
+		/* Division by zero is not what is being measured. */
+		if ( right[i].top == 0 )
+		{
+			right[i].top = 1;
+		}
+		integers[i] = Random_in_range(1, 30000, &errorCode);
+		tops[i] = (int64_t)Random_in_range(0, INT32_MAX, &errorCode) *
+			Random_in_range(1, 1 << 20, &errorCode);
+		bottoms[i] = (int64_t)Random_in_range(1, INT32_MAX, &errorCode) *
+			Random_in_range(1, 1 << 20, &errorCode);
+	}
+	for (int i = 0; i < TABLE_SIZE; i++)
+	{
+		snprintf(keys[i], KEY_LENGTH, "var%d", i);
+	}
+}
+
+/**
+@fn benchRational
+@brief Benchmarks R_GCD, R_reduce64 and each arithmetic operation of Rational.c.
+*/
+static void benchRational ()
+{
+	double start = BENCH_now();
+	for (uint32_t i = 0; i < NUM_ITERATIONS; i++)
+	{
+		BENCH_KEEP(R_GCD(tops[i & OPERAND_MASK], bottoms[i & OPERAND_MASK]));
+	}
+	BENCH_record("R_GCD", NUM_ITERATIONS, BENCH_now() - start, 0);
+
+	start = BENCH_now();
+	for (uint32_t i = 0; i < NUM_ITERATIONS; i++)
+	{
+		Rational r;
+		R_reduce64(&r, tops[i & OPERAND_MASK], bottoms[i & OPERAND_MASK]);
+		BENCH_KEEP(r.top);
+	}
+	BENCH_record("R_reduce64", NUM_ITERATIONS, BENCH_now() - start, 0);
+
+	BENCH_RATIONAL_OP("R_add", R_add, integers);
+	BENCH_RATIONAL_OP("R_addR", R_addR, right);
+	BENCH_RATIONAL_OP("R_subtract", R_subtract, integers);
+	BENCH_RATIONAL_OP("R_subtractR", R_subtractR, right);
+	BENCH_RATIONAL_OP("R_mult", R_mult, integers);
+	BENCH_RATIONAL_OP("R_multR", R_multR, right);
+	BENCH_RATIONAL_OP("R_div", R_div, integers);
+	BENCH_RATIONAL_OP("R_divR", R_divR, right);
+}
+
+/**
+@fn benchRowDivision
+@brief Benchmarks dividing rows of Rationals by a common pivot, with R_divR in
+a loop and with R_divRowPrepared.
+*/
+static void benchRowDivision ()
+{
+	static Rational row[NUM_OPERANDS];
+	uint32_t numRows = NUM_ITERATIONS / NUM_OPERANDS;
+	double start = BENCH_now();
+	for (uint32_t r = 0; r < numRows; r++)
+	{
+		Rational pivot = right[r];
+		memcpy(row, left, sizeof(row));
+		for (uint32_t i = 0; i < NUM_OPERANDS; i++)
+		{
+			R_divR(&row[i], pivot);
+		}
+		BENCH_KEEP(row[r].top);
+	}
+	BENCH_record("row R_divR loop", NUM_ITERATIONS, BENCH_now() - start, 0);
+
+	start = BENCH_now();
+	for (uint32_t r = 0; r < numRows; r++)
+	{
+		RationalDivisor pivot;
+		R_prepareDivisor(&pivot, right[r]);
+		memcpy(row, left, sizeof(row));
+		R_divRowPrepared(row, NUM_OPERANDS, &pivot);
+		BENCH_KEEP(row[r].top);
+	}
+	BENCH_record("row R_divRowPrepared", NUM_ITERATIONS, BENCH_now() - start, 0);
+}
+
+/**
+@fn benchComparison
+@brief Benchmarks ordering Rationals with R_compare against taking the sign of
+a difference from R_subtractR, both for single comparisons and for finding the
+pivot of each column of a square matrix.
+*/
+static void benchComparison ()
+{
+	double start = BENCH_now();
+	for (uint32_t i = 0; i < NUM_ITERATIONS; i++)
+	{
+		BENCH_KEEP(R_compare(left[i & OPERAND_MASK],
+			right[(i * 7) & OPERAND_MASK]));
+	}
+	BENCH_record("R_compare", NUM_ITERATIONS, BENCH_now() - start, 0);
+
+	start = BENCH_now();
+	for (uint32_t i = 0; i < NUM_ITERATIONS; i++)
+	{
+		Rational difference = left[i & OPERAND_MASK];
+		R_subtractR(&difference, right[(i * 7) & OPERAND_MASK]);
+		BENCH_KEEP(difference.top > 0);
+	}
+	BENCH_record("compare by R_subtractR", NUM_ITERATIONS, BENCH_now() - start, 0);
+
+	/* Treat the left operands as a PIVOT_SIZE x PIVOT_SIZE matrix and search
+	   each of its columns, as partial pivoting does. */
+	uint32_t numSearches = NUM_ITERATIONS / NUM_OPERANDS;
+	start = BENCH_now();
+	for (uint32_t s = 0; s < numSearches; s++)
+	{
+		for (uint32_t col = 0; col < PIVOT_SIZE; col++)
+		{
+			BENCH_KEEP(R_argmaxAbs(&left[col], PIVOT_SIZE, PIVOT_SIZE));
+		}
+	}
+	BENCH_record("pivot search R_argmaxAbs", NUM_ITERATIONS, BENCH_now() - start, 0);
+
+	start = BENCH_now();
+	for (uint32_t s = 0; s < numSearches; s++)
+	{
+		for (uint32_t col = 0; col < PIVOT_SIZE; col++)
+		{
+			uint32_t best = 0;
+			Rational bestValue = R_abs(left[col]);
+			for (uint32_t row = 1; row < PIVOT_SIZE; row++)
+			{
+				Rational difference = R_abs(left[row * PIVOT_SIZE + col]);
+				R_subtractR(&difference, bestValue);
+				if ( difference.top > 0 )
+				{
+					best = row;
+					bestValue = R_abs(left[row * PIVOT_SIZE + col]);
+				}
+			}
+			BENCH_KEEP(best);
+		}
+	}
+	BENCH_record("pivot search R_subtractR", NUM_ITERATIONS, BENCH_now() - start, 0);
+}
+
+/**
+@fn benchHashTable
+@brief Benchmarks HT_add when filling a table up to several load factors, and
+when overwriting existing keys in a table at each of those load factors.
+*/
+static void benchHashTable ()
+{
+	const double loadFactors[] = {0.25, 0.5, 0.75, 0.95};
+	Rational value = {1, 1};
+	char name[64];
+	for (unsigned int l = 0; l < sizeof(loadFactors) / sizeof(loadFactors[0]); l++)
+	{
+		unsigned int numKeys = (unsigned int)(TABLE_SIZE * loadFactors[l]);
+		HashTable *table = HT_newTable(TABLE_SIZE);
+		double start = BENCH_now();
+		for (unsigned int i = 0; i < numKeys; i++)
+		{
+			BENCH_KEEP(HT_add(table, keys[i], &value, VT_RATIONAL));
+		}
+		snprintf(name, sizeof(name), "HT_add fill to %.2f", loadFactors[l]);
+		BENCH_record(name, numKeys, BENCH_now() - start, 0);
+
+		/* Overwriting walks each key's chain, so it reflects lookup cost. */
+		unsigned int numOps = numKeys * 8;
+		start = BENCH_now();
+		for (unsigned int i = 0; i < numOps; i++)
+		{
+			BENCH_KEEP(HT_add(table, keys[(i * 2654435761u) % numKeys], &value,
+				VT_RATIONAL));
+		}
+		snprintf(name, sizeof(name), "HT_add overwrite at %.2f", loadFactors[l]);
+		BENCH_record(name, numOps, BENCH_now() - start, 0);
+		HT_freeTable(table);
+	}
+}
+
+/**
+@fn benchHash
+@brief Benchmarks jenkins_one_at_a_time_hash_value on short and long keys.
+*/
+static void benchHash ()
+{
+	const int lengths[] = {8, 64, 1024};
+	char buffer[1024];
+	char name[64];
+	memset(buffer, 'x', sizeof(buffer));
+	for (unsigned int l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++)
+	{
+		uint32_t numOps = NUM_ITERATIONS / lengths[l];
+		double start = BENCH_now();
+		for (uint32_t i = 0; i < numOps; i++)
+		{
+			buffer[0] = (char)i;
+			BENCH_KEEP(jenkins_one_at_a_time_hash_value(buffer, lengths[l]));
+		}
+		snprintf(name, sizeof(name), "jenkins_one_at_a_time %d bytes",
+			lengths[l]);
+		BENCH_record(name, numOps, BENCH_now() - start,
+			(uint64_t)numOps * lengths[l]);
+	}
+}
+
+/**
+@fn benchRandom
+@brief Benchmarks Random_in_range over a small and a full 32-bit range.
+*/
+static void benchRandom ()
+{
+	int errorCode = 0;
+	double start = BENCH_now();
+	for (uint32_t i = 0; i < NUM_ITERATIONS; i++)
+	{
+		BENCH_KEEP(Random_in_range(-1000, 1000, &errorCode));
+	}
+	BENCH_record("Random_in_range small", NUM_ITERATIONS, BENCH_now() - start, 0);
+
+	start = BENCH_now();
+	for (uint32_t i = 0; i < NUM_ITERATIONS; i++)
+	{
+		BENCH_KEEP(Random_in_range(INT32_MIN, INT32_MAX, &errorCode));
+	}
+	BENCH_record("Random_in_range full", NUM_ITERATIONS, BENCH_now() - start, 0);
+}
+
+int main ()
+{
+	srandom(1);
+	fillOperands();
+	benchRational();
+	benchRowDivision();
+	benchComparison();
+	benchHashTable();
+	benchHash();
+	benchRandom();
+	return BENCH_writeResults("bench_core");
+}
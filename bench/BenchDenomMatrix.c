@@ -0,0 +1,100 @@
+/**
+@file BenchDenomMatrix.c
+@author Rob Thomas
+@brief Compares elimination-style row updates (dest += factor * src) on rows of
+Rationals against the same updates on a DenomMatrix, and writes the results to
+build/results/bench_denommatrix.csv.
+*/
+
+/*** INCLUDES: ***/
+#include <stdio.h>
+#include <string.h>
+
+#include "Benchmark.h"
+#include "DenomMatrix.h"
+#include "Matrix.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define BENCH_ROWS 64
+#define BENCH_COLS 1024
+#define BENCH_UPDATES 4096
+
+/*** FUNCTION DEFINITIONS: ***/
+
+int main ()
+{
+	srandom(1);
+	/* Fill a matrix with small fractions and keep a second copy to restore
+	   the updated row from, so values never grow large enough to overflow.
+	   As in elimination, the top half of the rows are updated using the
+	   bottom half as pivot rows. */
+	Matrix *m = M_new(BENCH_ROWS, BENCH_COLS);
+	for (size_t i = 0; i < (size_t)BENCH_ROWS * BENCH_COLS; i++)
+	{
+		R_reduce64(&m->elements[i], random() % 201 - 100, random() % 12 + 1);
+	}
+	M_rehash(m);
+	Matrix *original = M_copy(m);
+	DenomMatrix *dm;
+	if ( DM_fromMatrix(m, &dm) )
+	{
+		fprintf(stderr, "DM_fromMatrix failed\n");
+		return 1;
+	}
+	DenomMatrix *dmOriginal;
+	DM_fromMatrix(m, &dmOriginal);
+	Rational factors[16];
+	for (int f = 0; f < 16; f++)
+	{
+		R_reduce64(&factors[f], random() % 19 - 9 + (f == 0), random() % 6 + 1);
+	}
+
+	double start = BENCH_now();
+	for (unsigned int u = 0; u < BENCH_UPDATES; u++)
+	{
+		unsigned int dest = u % (BENCH_ROWS / 2);
+		unsigned int src = BENCH_ROWS / 2 + (u * 7) % (BENCH_ROWS / 2);
+		Rational *destRow = &M_AT(m, dest, 0);
+		Rational *srcRow = &M_AT(m, src, 0);
+		memcpy(destRow, &M_AT(original, dest, 0), sizeof(Rational) * BENCH_COLS);
+		for (unsigned int j = 0; j < BENCH_COLS; j++)
+		{
+			Rational product = srcRow[j];
+			R_multR(&product, factors[u % 16]);
+			R_addR(&destRow[j], product);
+		}
+		BENCH_KEEP(destRow[0].top);
+	}
+	BENCH_record("row update Rational", (uint64_t)BENCH_UPDATES * BENCH_COLS,
+		BENCH_now() - start, 0);
+
+	start = BENCH_now();
+	for (unsigned int u = 0; u < BENCH_UPDATES; u++)
+	{
+		unsigned int dest = u % (BENCH_ROWS / 2);
+		unsigned int src = BENCH_ROWS / 2 + (u * 7) % (BENCH_ROWS / 2);
+		memcpy(&DM_NUMERATOR(dm, dest, 0), &DM_NUMERATOR(dmOriginal, dest, 0),
+			sizeof(int64_t) * BENCH_COLS);
+		dm->denominators[dest] = dmOriginal->denominators[dest];
+		BENCH_KEEP(DM_addScaledRow(dm, dest, src, factors[u % 16]));
+		BENCH_KEEP(dm->denominators[dest]);
+	}
+	BENCH_record("row update DenomMatrix", (uint64_t)BENCH_UPDATES * BENCH_COLS,
+		BENCH_now() - start, 0);
+
+	/* Check both agree on the last state of every row. */
+	M_rehash(m);
+	Matrix *check = M_new(BENCH_ROWS, BENCH_COLS);
+	if ( DM_toMatrix(dm, check) || check->contentHash != m->contentHash )
+	{
+		fprintf(stderr, "Results differ\n");
+		return 1;
+	}
+	M_free(check);
+	M_free(m);
+	M_free(original);
+	DM_free(dm);
+	DM_free(dmOriginal);
+	return BENCH_writeResults("bench_denommatrix");
+}
\ No newline at end of file
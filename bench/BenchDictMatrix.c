@@ -0,0 +1,125 @@
+/**
+@file BenchDictMatrix.c
+@author Rob Thomas
+@brief Measures products of dictionary-encoded matrices against ME_evaluate on
+the same matrices, for an integer incidence pattern and for a Toeplitz matrix
+of a few fractions, and writes the results to
+build/results/bench_dictmatrix.csv.
+*/
+
+/*** INCLUDES: ***/
+#include <stdio.h>
+
+#include "Benchmark.h"
+#include "DictMatrix.h"
+#include "Matrix.h"
+#include "MatrixExpr.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define BENCH_INTEGER_SIZE 400
+#define BENCH_FRACTION_SIZE 200
+#define BENCH_NUM_DIAGONAL_VALUES 5
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn fillIncidence
+@brief Fills a matrix with entries of -1, 0 and 1, mostly 0, like the incidence
+matrix of a directed graph.
+@param m Pointer to the Matrix to fill.
+*/
+static void fillIncidence (Matrix *m)
+{
+	for (size_t i = 0; i < (size_t)m->numRows * m->numCols; i++)
+	{
+		int r = random() % 8;
+		m->elements[i].top = r == 0 ? -1 : r == 1 ? 1 : 0;
+		m->elements[i].bottom = 1;
+	}
+	M_rehash(m);
+}
+
+/**
+@fn fillToeplitz
+@brief Fills a matrix whose diagonals each hold one of a few fractions.
+@param m Pointer to the Matrix to fill.
+*/
+static void fillToeplitz (Matrix *m)
+{
+	const Rational diagonals[BENCH_NUM_DIAGONAL_VALUES] =
+		{{1, 2}, {-1, 3}, {0, 1}, {2, 5}, {1, 1}};
+	for (unsigned int i = 0; i < m->numRows; i++)
+	{
+		for (unsigned int j = 0; j < m->numCols; j++)
+		{
+			unsigned int diagonal = i + m->numCols - j;
+			M_AT(m, i, j) = diagonals[diagonal % BENCH_NUM_DIAGONAL_VALUES];
+		}
+	}
+	M_rehash(m);
+}
+
+/**
+@fn benchProduct
+@brief Times A*B with ME_evaluate and with DX_multiply, checks that they
+agree, and prints how much smaller the encoded operands are.
+@param label The label of the pattern, used in the result names.
+@param a Pointer to A.
+@param b Pointer to B.
+*/
+static void benchProduct (const char *label, Matrix *a, Matrix *b)
+{
+	char name[64];
+	unsigned int n = a->numRows;
+	uint64_t numOps = (uint64_t)n * n * n;
+	Matrix *expected = M_new(n, n);
+	Matrix *dest = M_new(n, n);
+	Rational one = {1, 1};
+	MatrixTerm term = ME_product(one, a, b);
+	double start = BENCH_now();
+	ME_evaluate(expected, &term, 1);
+	snprintf(name, sizeof(name), "ME_evaluate %s %ux%u", label, n, n);
+	BENCH_record(name, numOps, BENCH_now() - start, 0);
+
+	DictMatrix *da, *db;
+	start = BENCH_now();
+	if ( DX_fromMatrix(a, &da) || DX_fromMatrix(b, &db) )
+	{
+		fprintf(stderr, "%s: encoding failed\n", label);
+		return;
+	}
+	snprintf(name, sizeof(name), "DX_fromMatrix %s %ux%u", label, n, n);
+	BENCH_record(name, 2 * (uint64_t)n * n, BENCH_now() - start, 0);
+	start = BENCH_now();
+	DX_multiply(dest, da, db);
+	snprintf(name, sizeof(name), "DX_multiply %s %ux%u", label, n, n);
+	BENCH_record(name, numOps, BENCH_now() - start, 0);
+	if ( dest->contentHash != expected->contentHash )
+	{
+		fprintf(stderr, "%s: results differ\n", label);
+	}
+	printf("%s: %zu bytes dense, %zu bytes encoded (%u values)\n", label,
+		sizeof(Rational) * n * n, DX_storageSize(da), da->numValues);
+	DX_free(da);
+	DX_free(db);
+	M_free(expected);
+	M_free(dest);
+}
+
+int main ()
+{
+	srandom(1);
+	Matrix *a = M_new(BENCH_INTEGER_SIZE, BENCH_INTEGER_SIZE);
+	Matrix *b = M_new(BENCH_INTEGER_SIZE, BENCH_INTEGER_SIZE);
+	fillIncidence(a);
+	fillIncidence(b);
+	benchProduct("incidence", a, b);
+	M_free(a);
+	M_free(b);
+	a = M_new(BENCH_FRACTION_SIZE, BENCH_FRACTION_SIZE);
+	fillToeplitz(a);
+	benchProduct("toeplitz", a, a);
+	M_free(a);
+	return BENCH_writeResults("bench_dictmatrix");
+}
\ No newline at end of file
@@ -0,0 +1,185 @@
+/**
+@file BenchLinearSolve.c
+@author Rob Thomas
+@brief Measures LS_factor and LS_solve on random integer systems of several
+sizes with known small rational solutions, solving one and then many
+right-hand sides against each factorization. Also compares solving repeatedly
+with a Matrix variable through MF_solve, which reuses the factorization cached
+in the HashTable, against calling LS_solveSystem each time. Writes the results
+to build/results/bench_linearsolve.csv.
+*/
+
+/*** INCLUDES: ***/
+#include <stdio.h>
+
+#include "Benchmark.h"
+#include "HashTable.h"
+#include "LinearSolve.h"
+#include "Matrix.h"
+#include "MatrixExpr.h"
+#include "MatrixFactor.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define BENCH_NUM_RHS 16
+#define BENCH_NUM_REPEATS 8
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn benchSize
+@brief Builds a random n x n system with a known solution, then times
+factoring it and solving it for one and for BENCH_NUM_RHS right-hand sides.
+@param n The size of the system.
+@return An error code. 0 if every solution matched.
+*/
+static int benchSize (unsigned int n)
+{
+	Matrix *a = M_new(n, n);
+	Matrix *expected = M_new(n, BENCH_NUM_RHS);
+	Matrix *b = M_new(n, BENCH_NUM_RHS);
+	Matrix *x = M_new(n, BENCH_NUM_RHS);
+	for (size_t i = 0; i < (size_t)n * n; i++)
+	{
+		a->elements[i].top = random() % 201 - 100;
+		a->elements[i].bottom = 1;
+	}
+	for (size_t i = 0; i < (size_t)n * BENCH_NUM_RHS; i++)
+	{
+		R_reduce64(&expected->elements[i], random() % 2001 - 1000,
+			1 << (random() % 4));
+	}
+	M_rehash(a);
+	M_rehash(expected);
+	Rational one = {1, 1};
+	MatrixTerm term = ME_product(one, a, expected);
+	ME_evaluate(b, &term, 1);
+
+	char name[64];
+	LS_Factorization *f;
+	double start = BENCH_now();
+	int error = LS_factor(a, &f);
+	snprintf(name, sizeof(name), "LS_factor %ux%u", n, n);
+	BENCH_record(name, 1, BENCH_now() - start, 0);
+	if ( error )
+	{
+		return error;
+	}
+	/* Solve each right-hand side on its own. */
+	Matrix *column = M_new(n, 1);
+	Matrix *solution = M_new(n, 1);
+	start = BENCH_now();
+	for (unsigned int c = 0; c < BENCH_NUM_RHS && !error; c++)
+	{
+		for (unsigned int i = 0; i < n; i++)
+		{
+			M_AT(column, i, 0) = M_AT(b, i, c);
+		}
+		M_rehash(column);
+		error = LS_solve(f, column, solution);
+	}
+	snprintf(name, sizeof(name), "LS_solve %ux%u one rhs at a time", n, n);
+	BENCH_record(name, BENCH_NUM_RHS, BENCH_now() - start, 0);
+	/* Solve them all in one batch. */
+	start = BENCH_now();
+	if ( !error )
+	{
+		error = LS_solve(f, b, x);
+	}
+	snprintf(name, sizeof(name), "LS_solve %ux%u %d rhs", n, n, BENCH_NUM_RHS);
+	BENCH_record(name, BENCH_NUM_RHS, BENCH_now() - start, 0);
+	if ( !error && x->contentHash != expected->contentHash )
+	{
+		error = ERR_SOLVE_OVERFLOW;
+	}
+	LS_free(f);
+	M_free(a);
+	M_free(expected);
+	M_free(b);
+	M_free(x);
+	M_free(column);
+	M_free(solution);
+	return error;
+}
+
+/**
+@fn benchCached
+@brief Times solving a random n x n system BENCH_NUM_REPEATS times, first by
+factoring on every call and then through a cached factorization.
+@param n The size of the system.
+@return An error code. 0 if no problems were encountered.
+*/
+static int benchCached (unsigned int n)
+{
+	Matrix *a = M_new(n, n);
+	Matrix *b = M_new(n, 1);
+	Matrix *x = M_new(n, 1);
+	for (size_t i = 0; i < (size_t)n * n; i++)
+	{
+		a->elements[i].top = random() % 201 - 100;
+	}
+	for (unsigned int i = 0; i < n; i++)
+	{
+		M_AT(b, i, 0).top = random() % 201 - 100;
+	}
+	M_rehash(a);
+	M_rehash(b);
+	HashTable *table = HT_newTable(16);
+	HT_add(table, "A", a, VT_MATRIX);
+	/* Solutions of random systems rarely fit in a Rational, so only the time
+	   taken matters here, not whether it overflowed. */
+	char name[64];
+	double start = BENCH_now();
+	for (int r = 0; r < BENCH_NUM_REPEATS; r++)
+	{
+		int error = LS_solveSystem(a, b, x);
+		if ( error && error != ERR_SOLVE_OVERFLOW )
+		{
+			return error;
+		}
+	}
+	snprintf(name, sizeof(name), "LS_solveSystem %ux%u uncached", n, n);
+	BENCH_record(name, BENCH_NUM_REPEATS, BENCH_now() - start, 0);
+	start = BENCH_now();
+	for (int r = 0; r < BENCH_NUM_REPEATS; r++)
+	{
+		int error = MF_solve(table, "A", b, x);
+		if ( error && error != ERR_SOLVE_OVERFLOW )
+		{
+			return error;
+		}
+	}
+	snprintf(name, sizeof(name), "MF_solve %ux%u cached", n, n);
+	BENCH_record(name, BENCH_NUM_REPEATS, BENCH_now() - start, 0);
+	/* The Matrix struct was copied into the table, which now owns the
+	   elements. */
+	free(a);
+	HT_freeTable(table);
+	M_free(b);
+	M_free(x);
+	return 0;
+}
+
+int main ()
+{
+	srandom(1);
+	unsigned int sizes[] = {50, 100, 200, 400};
+	for (unsigned int s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+	{
+		int error = benchSize(sizes[s]);
+		if ( error )
+		{
+			fprintf(stderr, "Solving %ux%u failed (%d)\n", sizes[s], sizes[s],
+				error);
+			return 1;
+		}
+		error = benchCached(sizes[s]);
+		if ( error )
+		{
+			fprintf(stderr, "Cached solving %ux%u failed (%d)\n", sizes[s],
+				sizes[s], error);
+			return 1;
+		}
+	}
+	return BENCH_writeResults("bench_linearsolve");
+}
\ No newline at end of file
@@ -0,0 +1,160 @@
+/**
+@file BenchMatrixExpr.c
+@author Rob Thomas
+@brief Measures ME_evaluate on the expression A*B + C for integer matrices,
+both through the 64-bit integer kernels and through the general Rational
+kernels, and for matrices of fractions. Also measures the chain A*B*C*v
+evaluated from left to right and in the order chosen by MC_plan. Writes the
+results to build/results/bench_matrixexpr.csv.
+*/
+
+/*** INCLUDES: ***/
+#include <stdio.h>
+
+#include "Benchmark.h"
+#include "Matrix.h"
+#include "MatrixChain.h"
+#include "MatrixExpr.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define BENCH_SIZE 200
+#define BENCH_CHAIN_LENGTH 4
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn fillMatrix
+@brief Fills a matrix with small random values.
+@param m Pointer to the Matrix to fill.
+@param maxBottom The largest bottom to generate. 1 fills m with integers.
+*/
+static void fillMatrix (Matrix *m, int maxBottom)
+{
+	for (size_t i = 0; i < (size_t)m->numRows * m->numCols; i++)
+	{
+		R_reduce64(&m->elements[i], random() % 201 - 100,
+			random() % maxBottom + 1);
+	}
+	M_rehash(m);
+}
+
+/**
+@fn benchExpression
+@brief Times one evaluation of dest = A*B + C.
+@param name The name to record the result under.
+@param a Pointer to A.
+@param b Pointer to B.
+@param c Pointer to C.
+@param dest Pointer to the destination Matrix.
+*/
+static void benchExpression (const char *name, Matrix *a, Matrix *b, Matrix *c,
+	Matrix *dest)
+{
+	Rational one = {1, 1};
+	MatrixTerm terms[2];
+	terms[0] = ME_product(one, a, b);
+	terms[1] = ME_element(one, c);
+	double start = BENCH_now();
+	if ( ME_evaluate(dest, terms, 2) )
+	{
+		fprintf(stderr, "%s failed\n", name);
+		return;
+	}
+	/* Count one operation per multiply-add. */
+	BENCH_record(name, (uint64_t)BENCH_SIZE * BENCH_SIZE * BENCH_SIZE,
+		BENCH_now() - start, 0);
+	BENCH_KEEP(dest->contentHash);
+}
+
+/**
+@fn benchChain
+@brief Times dest = A*B*C*v for BENCH_SIZE x BENCH_SIZE matrices A, B and C and
+a column v, from left to right and in the order chosen by MC_plan, and prints
+the plan.
+@param chain The matrices A, B, C and v.
+@param dest Pointer to the BENCH_SIZE x 1 destination Matrix.
+*/
+static void benchChain (Matrix **chain, Matrix *dest)
+{
+	Rational one = {1, 1};
+	Matrix *running = M_new(BENCH_SIZE, BENCH_SIZE);
+	Matrix *next = M_new(BENCH_SIZE, BENCH_SIZE);
+	double start = BENCH_now();
+	MatrixTerm term = ME_product(one, chain[0], chain[1]);
+	ME_evaluate(running, &term, 1);
+	term = ME_product(one, running, chain[2]);
+	ME_evaluate(next, &term, 1);
+	term = ME_product(one, next, chain[3]);
+	ME_evaluate(dest, &term, 1);
+	BENCH_record("chain left to right", 1, BENCH_now() - start, 0);
+	uint64_t expected = dest->contentHash;
+	M_free(running);
+	M_free(next);
+
+	char *names[BENCH_CHAIN_LENGTH] = {"A", "B", "C", "v"};
+	MC_Shape shapes[BENCH_CHAIN_LENGTH];
+	MC_CostModel model = {true, true, MC_DEFAULT_FRACTION_WEIGHT};
+	MC_Plan *plan;
+	start = BENCH_now();
+	for (int i = 0; i < BENCH_CHAIN_LENGTH; i++)
+	{
+		MC_shapeOf(chain[i], true, &shapes[i]);
+	}
+	if ( MC_plan(shapes, BENCH_CHAIN_LENGTH, &model, &plan) ||
+		MC_evaluate(plan, chain, one, dest) )
+	{
+		fprintf(stderr, "chain planned failed\n");
+		return;
+	}
+	BENCH_record("chain planned", 1, BENCH_now() - start, 0);
+	if ( dest->contentHash != expected )
+	{
+		fprintf(stderr, "chain planned: results differ\n");
+	}
+	MC_explain(plan, names, stdout);
+	MC_freePlan(plan);
+}
+
+int main ()
+{
+	srandom(1);
+	Matrix *a = M_new(BENCH_SIZE, BENCH_SIZE);
+	Matrix *b = M_new(BENCH_SIZE, BENCH_SIZE);
+	Matrix *c = M_new(BENCH_SIZE, BENCH_SIZE);
+	Matrix *dest = M_new(BENCH_SIZE, BENCH_SIZE);
+	fillMatrix(a, 1);
+	fillMatrix(b, 1);
+	fillMatrix(c, 1);
+	benchExpression("ME_evaluate integer", a, b, c, dest);
+	/* Hide the flag so the same integers take the Rational kernels. */
+	a->isInteger = false;
+	benchExpression("ME_evaluate integer as Rational", a, b, c, dest);
+	fillMatrix(a, 10);
+	fillMatrix(b, 10);
+	fillMatrix(c, 10);
+	benchExpression("ME_evaluate fractions", a, b, c, dest);
+	/* Entries of -1, 0 and 1 keep every order of the chain from overflowing,
+	   so both orders give the same result. */
+	Matrix *v = M_new(BENCH_SIZE, 1);
+	Matrix *column = M_new(BENCH_SIZE, 1);
+	Matrix *chain[BENCH_CHAIN_LENGTH] = {a, b, c, v};
+	for (int i = 0; i < BENCH_CHAIN_LENGTH; i++)
+	{
+		Matrix *m = chain[i];
+		for (size_t e = 0; e < (size_t)m->numRows * m->numCols; e++)
+		{
+			m->elements[e].top = random() % 3 - 1;
+			m->elements[e].bottom = 1;
+		}
+		M_rehash(m);
+	}
+	benchChain(chain, column);
+	M_free(v);
+	M_free(column);
+	M_free(a);
+	M_free(b);
+	M_free(c);
+	M_free(dest);
+	return BENCH_writeResults("bench_matrixexpr");
+}
\ No newline at end of file
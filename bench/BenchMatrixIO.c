@@ -0,0 +1,85 @@
+/**
+@file BenchMatrixIO.c
+@author Rob Thomas
+@brief Measures the throughput of MatrixIO.c in MB/s when reading and writing
+a large matrix of random Rationals, and writes the results to
+build/results/bench_matrixio.csv.
+*/
+
+/*** INCLUDES: ***/
+#include <stdio.h>
+#include <sys/stat.h>
+
+#include "Benchmark.h"
+#include "Matrix.h"
+#include "MatrixIO.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define BENCH_PATH BENCH_RESULTS_DIR "/bench_matrixio.txt"
+#define BENCH_ROWS 2000
+#define BENCH_COLS 1000
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn fileBytes
+@brief Returns the size of a file in bytes.
+@param path The path of the file.
+@return The size of the file in bytes.
+*/
+static uint64_t fileBytes (const char *path)
+{
+	struct stat info;
+	if ( stat(path, &info) )
+	{
+		return 0;
+	}
+	return info.st_size;
+}
+
+int main ()
+{
+	/* Fill a matrix with reduced random fractions. */
+	Matrix *m = M_new(BENCH_ROWS, BENCH_COLS);
+	srandom(1);
+	for (size_t i = 0; i < (size_t)BENCH_ROWS * BENCH_COLS; i++)
+	{
+		R_reduce64(&m->elements[i], (int64_t)(random() % 2000001) - 1000000,
+			random() % 1000 + 1);
+	}
+	M_rehash(m);
+	/* Time writing it out. */
+	uint64_t numElements = (uint64_t)BENCH_ROWS * BENCH_COLS;
+	double start = BENCH_now();
+	if ( MIO_write(BENCH_PATH, m) )
+	{
+		fprintf(stderr, "Could not write %s\n", BENCH_PATH);
+		return 1;
+	}
+	double elapsed = BENCH_now() - start;
+	uint64_t numBytes = fileBytes(BENCH_PATH);
+	BENCH_record("MIO_write", numElements, elapsed, numBytes);
+	/* Time reading it back with increasing numbers of threads. */
+	unsigned int threadCounts[] = {1, 2, 4, 8};
+	for (unsigned int t = 0; t < sizeof(threadCounts) / sizeof(threadCounts[0]); t++)
+	{
+		Matrix *read;
+		start = BENCH_now();
+		int error = MIO_read(BENCH_PATH, threadCounts[t], &read);
+		elapsed = BENCH_now() - start;
+		if ( error || read->contentHash != m->contentHash )
+		{
+			fprintf(stderr, "Read with %u threads failed (%d)\n", threadCounts[t],
+				error);
+			return 1;
+		}
+		char name[64];
+		snprintf(name, sizeof(name), "MIO_read %u threads", threadCounts[t]);
+		BENCH_record(name, numElements, elapsed, numBytes);
+		M_free(read);
+	}
+	M_free(m);
+	remove(BENCH_PATH);
+	return BENCH_writeResults("bench_matrixio");
+}
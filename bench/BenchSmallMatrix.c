@@ -0,0 +1,229 @@
+/**
+@file BenchSmallMatrix.c
+@author Rob Thomas
+@brief Measures the fixed-size 2x2 to 4x4 kernels for multiply, determinant,
+inverse and solve against the general paths they replace, over many small
+matrices of fractions, and writes the results to
+build/results/bench_smallmatrix.csv.
+*/
+
+/*** INCLUDES: ***/
+#include <stdio.h>
+
+#include "Benchmark.h"
+#include "LinearSolve.h"
+#include "Matrix.h"
+#include "MatrixExpr.h"
+#include "Rational.h"
+#include "SmallMatrix.h"
+
+/*** DEFINES: ***/
+#define BENCH_NUM_MATRICES 1000
+#define BENCH_REPEATS 20
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn fillMatrix
+@brief Fills a matrix with small random fractions, like the entries of a
+transform.
+@param m Pointer to the Matrix to fill.
+*/
+static void fillMatrix (Matrix *m)
+{
+	for (size_t i = 0; i < (size_t)m->numRows * m->numCols; i++)
+	{
+		R_reduce64(&m->elements[i], random() % 21 - 10, random() % 4 + 1);
+	}
+	M_rehash(m);
+}
+
+/**
+@fn benchMultiply
+@brief Times dest = A*B over every pair of matrices, through the fixed-size
+kernels and through the general ME_evaluate path.
+@param n The size of the matrices.
+@param a The left operands.
+@param b The right operands.
+@param dest Pointer to the destination Matrix.
+*/
+static void benchMultiply (unsigned int n, Matrix **a, Matrix **b, Matrix *dest)
+{
+	char name[64];
+	Rational one = {1, 1};
+	Rational zero = {0, 1};
+	uint64_t numOps = (uint64_t)BENCH_NUM_MATRICES * BENCH_REPEATS;
+	double start = BENCH_now();
+	for (int r = 0; r < BENCH_REPEATS; r++)
+	{
+		for (int i = 0; i < BENCH_NUM_MATRICES; i++)
+		{
+			SM_multiply(dest, one, a[i], b[i]);
+			BENCH_KEEP(dest->contentHash);
+		}
+	}
+	snprintf(name, sizeof(name), "SM_multiply %ux%u", n, n);
+	BENCH_record(name, numOps, BENCH_now() - start, 0);
+	/* A second, zero-weighted term keeps ME_evaluate on its general path. */
+	start = BENCH_now();
+	for (int r = 0; r < BENCH_REPEATS; r++)
+	{
+		for (int i = 0; i < BENCH_NUM_MATRICES; i++)
+		{
+			MatrixTerm terms[2];
+			terms[0] = ME_product(one, a[i], b[i]);
+			terms[1] = ME_element(zero, b[i]);
+			ME_evaluate(dest, terms, 2);
+			BENCH_KEEP(dest->contentHash);
+		}
+	}
+	snprintf(name, sizeof(name), "ME_evaluate %ux%u", n, n);
+	BENCH_record(name, numOps, BENCH_now() - start, 0);
+}
+
+/**
+@fn benchDeterminant
+@brief Times the determinant of every matrix, through the fixed-size kernels
+and by factoring with LS_factor.
+@param n The size of the matrices.
+@param a The matrices.
+*/
+static void benchDeterminant (unsigned int n, Matrix **a)
+{
+	char name[64];
+	uint64_t numOps = (uint64_t)BENCH_NUM_MATRICES * BENCH_REPEATS;
+	Rational determinant;
+	double start = BENCH_now();
+	for (int r = 0; r < BENCH_REPEATS; r++)
+	{
+		for (int i = 0; i < BENCH_NUM_MATRICES; i++)
+		{
+			SM_determinant(a[i], &determinant);
+			BENCH_KEEP(determinant.top);
+		}
+	}
+	snprintf(name, sizeof(name), "SM_determinant %ux%u", n, n);
+	BENCH_record(name, numOps, BENCH_now() - start, 0);
+	start = BENCH_now();
+	for (int r = 0; r < BENCH_REPEATS; r++)
+	{
+		for (int i = 0; i < BENCH_NUM_MATRICES; i++)
+		{
+			LS_Factorization *f;
+			if ( LS_factor(a[i], &f) == 0 )
+			{
+				LS_determinant(f, &determinant);
+				BENCH_KEEP(determinant.top);
+				LS_free(f);
+			}
+		}
+	}
+	snprintf(name, sizeof(name), "LS_determinant %ux%u", n, n);
+	BENCH_record(name, numOps, BENCH_now() - start, 0);
+}
+
+/**
+@fn benchSolve
+@brief Times solving A*X = B and inverting A for every matrix, through the
+fixed-size kernels and by factoring with LS_factor.
+@param n The size of the matrices.
+@param a The matrices A.
+@param b The matrices B.
+@param identity Pointer to the nxn identity Matrix.
+@param x Pointer to the Matrix which will hold each solution.
+*/
+static void benchSolve (unsigned int n, Matrix **a, Matrix **b,
+	Matrix *identity, Matrix *x)
+{
+	char name[64];
+	uint64_t numOps = (uint64_t)BENCH_NUM_MATRICES * BENCH_REPEATS;
+	double start = BENCH_now();
+	for (int r = 0; r < BENCH_REPEATS; r++)
+	{
+		for (int i = 0; i < BENCH_NUM_MATRICES; i++)
+		{
+			SM_solve(a[i], b[i], x);
+			BENCH_KEEP(x->contentHash);
+		}
+	}
+	snprintf(name, sizeof(name), "SM_solve %ux%u", n, n);
+	BENCH_record(name, numOps, BENCH_now() - start, 0);
+	start = BENCH_now();
+	for (int r = 0; r < BENCH_REPEATS; r++)
+	{
+		for (int i = 0; i < BENCH_NUM_MATRICES; i++)
+		{
+			SM_inverse(a[i], x);
+			BENCH_KEEP(x->contentHash);
+		}
+	}
+	snprintf(name, sizeof(name), "SM_inverse %ux%u", n, n);
+	BENCH_record(name, numOps, BENCH_now() - start, 0);
+	start = BENCH_now();
+	for (int r = 0; r < BENCH_REPEATS; r++)
+	{
+		for (int i = 0; i < BENCH_NUM_MATRICES; i++)
+		{
+			LS_Factorization *f;
+			if ( LS_factor(a[i], &f) == 0 )
+			{
+				LS_solve(f, b[i], x);
+				BENCH_KEEP(x->contentHash);
+				LS_free(f);
+			}
+		}
+	}
+	snprintf(name, sizeof(name), "LS_solve %ux%u", n, n);
+	BENCH_record(name, numOps, BENCH_now() - start, 0);
+	start = BENCH_now();
+	for (int r = 0; r < BENCH_REPEATS; r++)
+	{
+		for (int i = 0; i < BENCH_NUM_MATRICES; i++)
+		{
+			LS_Factorization *f;
+			if ( LS_factor(a[i], &f) == 0 )
+			{
+				LS_solve(f, identity, x);
+				BENCH_KEEP(x->contentHash);
+				LS_free(f);
+			}
+		}
+	}
+	snprintf(name, sizeof(name), "LS_solve inverse %ux%u", n, n);
+	BENCH_record(name, numOps, BENCH_now() - start, 0);
+}
+
+int main ()
+{
+	srandom(1);
+	static Matrix *a[BENCH_NUM_MATRICES];
+	static Matrix *b[BENCH_NUM_MATRICES];
+	for (unsigned int n = SM_MIN_SIZE; n <= SM_MAX_SIZE; n++)
+	{
+		for (int i = 0; i < BENCH_NUM_MATRICES; i++)
+		{
+			a[i] = M_new(n, n);
+			b[i] = M_new(n, n);
+			fillMatrix(a[i]);
+			fillMatrix(b[i]);
+		}
+		Matrix *dest = M_new(n, n);
+		Matrix *identity = M_new(n, n);
+		for (unsigned int i = 0; i < n; i++)
+		{
+			M_AT(identity, i, i).top = 1;
+		}
+		M_rehash(identity);
+		benchMultiply(n, a, b, dest);
+		benchDeterminant(n, a);
+		benchSolve(n, a, b, identity, dest);
+		for (int i = 0; i < BENCH_NUM_MATRICES; i++)
+		{
+			M_free(a[i]);
+			M_free(b[i]);
+		}
+		M_free(dest);
+		M_free(identity);
+	}
+	return BENCH_writeResults("bench_smallmatrix");
+}
\ No newline at end of file
@@ -0,0 +1,137 @@
+/**
+@file BenchTiledMatrix.c
+@author Rob Thomas
+@brief Measures TM_multiply on matrices several times larger than its buffer
+cache, with and without read-ahead of upcoming tiles, against ME_evaluate on
+the same matrices held in memory, and writes the results to
+build/results/bench_tiledmatrix.csv. The operands' pages are dropped from the
+operating system's cache before each tiled run, so tiles really come from
+disk.
+*/
+
+/*** INCLUDES: ***/
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Benchmark.h"
+#include "Matrix.h"
+#include "MatrixExpr.h"
+#include "Rational.h"
+#include "TiledMatrix.h"
+
+/*** DEFINES: ***/
+#define BENCH_SIZE 512
+#define BENCH_TILE_SIZE 64
+#define BENCH_NUM_FRAMES 12
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn fillMatrix
+@brief Fills a matrix with small random integers.
+@param m Pointer to the Matrix to fill.
+*/
+static void fillMatrix (Matrix *m)
+{
+	for (size_t i = 0; i < (size_t)m->numRows * m->numCols; i++)
+	{
+		m->elements[i].top = random() % 201 - 100;
+		m->elements[i].bottom = 1;
+	}
+	M_rehash(m);
+}
+
+/**
+@fn dropFromPageCache
+@brief Writes a TiledMatrix's file to disk and asks the operating system to
+forget its pages.
+@param m Pointer to the TiledMatrix.
+*/
+static void dropFromPageCache (TiledMatrix *m)
+{
+	TM_flush(m);
+	fsync(m->fd);
+	posix_fadvise(m->fd, 0, 0, POSIX_FADV_DONTNEED);
+}
+
+/**
+@fn benchTiled
+@brief Times one tiled multiplication and checks it against the in-memory
+product.
+@param name The name to record the result under.
+@param dest Pointer to the TiledMatrix which will hold the product.
+@param a Pointer to the left operand.
+@param b Pointer to the right operand.
+@param expected Pointer to the in-memory product.
+*/
+static void benchTiled (const char *name, TiledMatrix *dest, TiledMatrix *a,
+	TiledMatrix *b, Matrix *expected)
+{
+	dropFromPageCache(a);
+	dropFromPageCache(b);
+	double start = BENCH_now();
+	if ( TM_multiply(dest, a, b) )
+	{
+		fprintf(stderr, "%s failed\n", name);
+		return;
+	}
+	double seconds = BENCH_now() - start;
+	uint64_t bytes = (uint64_t)a->numTileRows * b->numTileCols *
+		a->numTileCols * 2 * BENCH_TILE_SIZE * BENCH_TILE_SIZE * sizeof(Rational);
+	BENCH_record(name, (uint64_t)BENCH_SIZE * BENCH_SIZE * BENCH_SIZE, seconds,
+		bytes);
+	Matrix *product = M_new(BENCH_SIZE, BENCH_SIZE);
+	TM_toMatrix(dest, product);
+	if ( product->contentHash != expected->contentHash )
+	{
+		fprintf(stderr, "%s: product does not match\n", name);
+	}
+	M_free(product);
+}
+
+int main ()
+{
+	srandom(1);
+	Matrix *a = M_new(BENCH_SIZE, BENCH_SIZE);
+	Matrix *b = M_new(BENCH_SIZE, BENCH_SIZE);
+	Matrix *c = M_new(BENCH_SIZE, BENCH_SIZE);
+	fillMatrix(a);
+	fillMatrix(b);
+	Rational one = {1, 1};
+	MatrixTerm term = ME_product(one, a, b);
+	double start = BENCH_now();
+	ME_evaluate(c, &term, 1);
+	BENCH_record("ME_evaluate in memory",
+		(uint64_t)BENCH_SIZE * BENCH_SIZE * BENCH_SIZE, BENCH_now() - start, 0);
+
+	TM_BufferCache *cache = TM_newCache(BENCH_NUM_FRAMES, BENCH_TILE_SIZE);
+	TiledMatrix ta, tb, tc;
+	if ( !cache || TM_create("build/bench_tiled_a.tm", BENCH_SIZE, BENCH_SIZE, cache, &ta) ||
+		TM_create("build/bench_tiled_b.tm", BENCH_SIZE, BENCH_SIZE, cache, &tb) ||
+		TM_create("build/bench_tiled_c.tm", BENCH_SIZE, BENCH_SIZE, cache, &tc) ||
+		TM_fromMatrix(a, &ta) || TM_fromMatrix(b, &tb) )
+	{
+		fprintf(stderr, "could not create tiled matrices\n");
+		return 1;
+	}
+	cache->usePrefetch = false;
+	benchTiled("TM_multiply", &tc, &ta, &tb, c);
+	cache->usePrefetch = true;
+	benchTiled("TM_multiply prefetch", &tc, &ta, &tb, c);
+	printf("cache: %llu hits, %llu misses, %llu writebacks, %llu prefetches\n",
+		(unsigned long long)cache->hits, (unsigned long long)cache->misses,
+		(unsigned long long)cache->writebacks,
+		(unsigned long long)cache->prefetches);
+	TM_close(&ta);
+	TM_close(&tb);
+	TM_close(&tc);
+	TM_freeCache(cache);
+	unlink("build/bench_tiled_a.tm");
+	unlink("build/bench_tiled_b.tm");
+	unlink("build/bench_tiled_c.tm");
+	M_free(a);
+	M_free(b);
+	M_free(c);
+	return BENCH_writeResults("bench_tiledmatrix");
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+/**
+@file Benchmark.c
+@author Rob Thomas
+@brief Contains functions shared by the benchmark programs for timing code and
+writing the results under build/results in a machine-readable form.
+*/
+
+/*** INCLUDES: ***/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "Benchmark.h"
+
+/*** DEFINES: ***/
+#define BENCH_MAX_NAME_LENGTH 64
+
+/*** STRUCTS: ***/
+
+/**
+@def BenchResult
+@brief A struct representing the result of one benchmark.
+@var name The name of the benchmark.
+@var numOps The number of operations performed.
+@var seconds The time taken to perform them, in seconds.
+@var numBytes The number of bytes processed, or 0 if not applicable.
+*/
+typedef struct
+{
+	char name[BENCH_MAX_NAME_LENGTH];
+	uint64_t numOps;
+	double seconds;
+	uint64_t numBytes;
+} BenchResult;
+
+/*** GLOBALS: ***/
+volatile uint64_t benchSink = 0;
+
+static BenchResult results[BENCH_MAX_RESULTS];
+static unsigned int numResults = 0;
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn BENCH_now
+@brief Returns the current time of the monotonic clock.
+@return The current time in seconds.
+*/
+double BENCH_now ()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+/**
+@fn BENCH_record
+@brief Records the result of one benchmark and prints it to stdout.
+@param name The name of the benchmark. Must not contain commas.
+@param numOps The number of operations performed.
+@param seconds The time taken to perform them, in seconds.
+@param numBytes The number of bytes processed, or 0 if throughput in bytes is
+not meaningful for this benchmark.
+*/
+void BENCH_record (const char *name, uint64_t numOps, double seconds,
+	uint64_t numBytes)
+{
+	double nsPerOp = seconds * 1e9 / numOps;
+	if ( numBytes )
+	{
+		printf("%-40s %12.2f ns/op %10.1f MB/s\n", name, nsPerOp,
+			numBytes / seconds / 1e6);
+	}
+	else
+	{
+		printf("%-40s %12.2f ns/op %14.0f ops/s\n", name, nsPerOp,
+			numOps / seconds);
+	}
+	if ( numResults == BENCH_MAX_RESULTS )
+	{
+		return;
+	}
+	BenchResult *result = &results[numResults++];
+	strncpy(result->name, name, BENCH_MAX_NAME_LENGTH - 1);
+	result->name[BENCH_MAX_NAME_LENGTH - 1] = '\0';
+	result->numOps = numOps;
+	result->seconds = seconds;
+	result->numBytes = numBytes;
+}
+
+/**
+@fn BENCH_writeResults
+@brief Writes every recorded result to BENCH_RESULTS_DIR/<suite>.csv. The
+columns are benchmark, ops, seconds, ns_per_op, ops_per_sec and mb_per_sec.
+@param suite The name of the benchmark suite, used for the file name.
+@return 0 if the file was written, 1 otherwise.
+*/
+int BENCH_writeResults (const char *suite)
+{
+	char path[256];
+	snprintf(path, sizeof(path), "%s/%s.csv", BENCH_RESULTS_DIR, suite);
+	FILE *file = fopen(path, "w");
+	if ( !file )
+	{
+		fprintf(stderr, "Could not write %s\n", path);
+		return 1;
+	}
+	fprintf(file, "benchmark,ops,seconds,ns_per_op,ops_per_sec,mb_per_sec\n");
+	for (unsigned int i = 0; i < numResults; i++)
+	{
+		BenchResult *result = &results[i];
+		fprintf(file, "%s,%llu,%.9f,%.3f,%.1f,%.3f\n", result->name,
+			(unsigned long long)result->numOps, result->seconds,
+			result->seconds * 1e9 / result->numOps,
+			result->numOps / result->seconds,
+			result->numBytes / result->seconds / 1e6);
+	}
+	fclose(file);
+	printf("Results written to %s\n", path);
+	return 0;
+}
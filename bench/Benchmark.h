@@ -0,0 +1,67 @@
+/**
+@file Benchmark.h
+@author Rob Thomas
+@brief Contains functions shared by the benchmark programs for timing code and
+writing the results under build/results in a machine-readable form. Each
+benchmark program records any number of named results and then writes them
+all to a single CSV file, one row per result, so that the files produced by
+two versions of the library can be compared directly.
+*/
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+/*** INCLUDES: ***/
+#include <stdint.h>
+
+/*** DEFINES: ***/
+#define BENCH_RESULTS_DIR "build/results"
+#define BENCH_MAX_RESULTS 256
+
+/**
+@def BENCH_KEEP
+@brief Prevents the compiler from optimizing away a value computed inside a
+timed loop.
+@param value The value to keep.
+*/
+#define BENCH_KEEP(value) (benchSink += (uint64_t)(value))
+
+/*** GLOBALS: ***/
+
+/**
+@var benchSink
+@brief A volatile accumulator which BENCH_KEEP adds values to.
+*/
+extern volatile uint64_t benchSink;
+
+/*** FUNCTION PROTOTYPES: ***/
+
+/**
+@fn BENCH_now
+@brief Returns the current time of the monotonic clock.
+@return The current time in seconds.
+*/
+double BENCH_now ();
+
+/**
+@fn BENCH_record
+@brief Records the result of one benchmark and prints it to stdout.
+@param name The name of the benchmark. Must not contain commas.
+@param numOps The number of operations performed.
+@param seconds The time taken to perform them, in seconds.
+@param numBytes The number of bytes processed, or 0 if throughput in bytes is
+not meaningful for this benchmark.
+*/
+void BENCH_record (const char *name, uint64_t numOps, double seconds,
+	uint64_t numBytes);
+
+/**
+@fn BENCH_writeResults
+@brief Writes every recorded result to BENCH_RESULTS_DIR/<suite>.csv. The
+columns are benchmark, ops, seconds, ns_per_op, ops_per_sec and mb_per_sec.
+@param suite The name of the benchmark suite, used for the file name.
+@return 0 if the file was written, 1 otherwise.
+*/
+int BENCH_writeResults (const char *suite);
+
+#endif /* BENCHMARK_H */
@@ -0,0 +1,747 @@
+/**
+@file BatchScript.c
+@author Rob Thomas
+@brief Contains the BatchSession struct and functions for running matrix shell
+scripts non-interactively, many of them in one process. A session keeps one
+HashTable, one OutputBuffer and one file buffer for its whole life: between
+scripts the table is reset rather than freed and the buffers are reused, so a
+script costs no allocation beyond its own variables, and nothing is written to
+the output until the buffer fills or the batch ends.
+*/
+
+/*** INCLUDES: ***/
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "BatchScript.h"
+#include "Matrix.h"
+#include "MatrixChain.h"
+#include "MatrixExpr.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define BS_IS_DIGIT(c) ((c) >= '0' && (c) <= '9')
+#define BS_IS_NAME_START(c) \
+	(((c) >= 'a' && (c) <= 'z') || ((c) >= 'A' && (c) <= 'Z') || (c) == '_')
+#define BS_IS_NAME_CHAR(c) (BS_IS_NAME_START(c) || BS_IS_DIGIT(c))
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn BS_skipSpaces
+@brief Advances past spaces and tabs.
+@param cursor Pointer to the current position in the statement.
+@param end One past the last character of the statement.
+*/
+static void BS_skipSpaces (const char **cursor, const char *end)
+{
+	const char *c = *cursor;
+	while ( c < end && (*c == ' ' || *c == '\t' || *c == '\r') )
+	{
+		c++;
+	}
+	*cursor = c;
+}
+
+/**
+@fn BS_parseName
+@brief Parses a variable name: a letter or underscore followed by letters,
+digits and underscores.
+@param cursor Pointer to the current position in the statement. Advanced past
+the name.
+@param end One past the last character of the statement.
+@param name The buffer of BS_MAX_NAME_LENGTH + 1 characters the
+null-terminated name is written to.
+@return An error code. 0 if no problems were encountered.
+*/
+static int BS_parseName (const char **cursor, const char *end, char *name)
+{
+	const char *c = *cursor;
+	if ( c == end || !BS_IS_NAME_START(*c) )
+	{
+		return ERR_SCRIPT_SYNTAX;
+	}
+	size_t length = 0;
+	while ( c < end && BS_IS_NAME_CHAR(*c) )
+	{
+		if ( length == BS_MAX_NAME_LENGTH )
+		{
+			return ERR_SCRIPT_SYNTAX;
+		}
+		name[length++] = *c++;
+	}
+	name[length] = '\0';
+	*cursor = c;
+	return 0;
+}
+
+/**
+@fn BS_parseInteger
+@brief Parses a run of decimal digits which fits in an int32_t.
+@param cursor Pointer to the current position in the statement. Advanced past
+the digits.
+@param end One past the last character of the statement.
+@param value Pointer to the integer which the result will be written to.
+@return An error code. 0 if no problems were encountered.
+*/
+static int BS_parseInteger (const char **cursor, const char *end,
+	int64_t *value)
+{
+	const char *c = *cursor;
+	if ( c == end || !BS_IS_DIGIT(*c) )
+	{
+		return ERR_SCRIPT_SYNTAX;
+	}
+	int64_t result = 0;
+	while ( c < end && BS_IS_DIGIT(*c) )
+	{
+		result = result * 10 + (*c++ - '0');
+		if ( result > INT32_MAX )
+		{
+			return ERR_SCRIPT_SYNTAX;
+		}
+	}
+	*value = result;
+	*cursor = c;
+	return 0;
+}
+
+/**
+@fn BS_parseRational
+@brief Parses a Rational literal: an integer or a fraction p/q, optionally
+preceded by a minus sign.
+@param cursor Pointer to the current position in the statement. Advanced past
+the literal.
+@param end One past the last character of the statement.
+@param r Pointer to the Rational which the reduced result will be written to.
+@return An error code. 0 if no problems were encountered.
+*/
+static int BS_parseRational (const char **cursor, const char *end,
+	Rational *r)
+{
+	const char *c = *cursor;
+	bool isNegative = c < end && *c == '-';
+	c += isNegative;
+	int64_t top, bottom = 1;
+	int error = BS_parseInteger(&c, end, &top);
+	if ( !error && c < end && *c == '/' )
+	{
+		c++;
+		error = BS_parseInteger(&c, end, &bottom);
+		if ( !error && bottom == 0 )
+		{
+			error = ERR_SCRIPT_SYNTAX;
+		}
+	}
+	if ( error )
+	{
+		return error;
+	}
+	R_reduce64(r, isNegative ? -top : top, bottom);
+	*cursor = c;
+	return 0;
+}
+
+/**
+@fn BS_scanMatrix
+@brief Scans the rows of a Matrix literal up to and past its closing bracket.
+Rows are separated by semicolons, and entries by spaces or commas.
+@param cursor Pointer to the position just after the opening bracket. Advanced
+past the closing bracket.
+@param end One past the last character of the statement.
+@param m Pointer to the Matrix the entries are written to, which must have the
+dimensions found by an earlier scan. NULL to only find the dimensions.
+@param numRows Pointer to where the number of rows will be written.
+@param numCols Pointer to where the number of columns will be written.
+@return An error code. 0 if no problems were encountered.
+*/
+static int BS_scanMatrix (const char **cursor, const char *end, Matrix *m,
+	unsigned int *numRows, unsigned int *numCols)
+{
+	const char *c = *cursor;
+	unsigned int rows = 0, cols = 0, count = 0;
+	while ( true )
+	{
+		BS_skipSpaces(&c, end);
+		if ( c == end )
+		{
+			return ERR_SCRIPT_SYNTAX;
+		}
+		if ( *c == ';' || *c == ']' )
+		{
+			/* End the row, which must be as long as the first. */
+			if ( count == 0 || (rows > 0 && count != cols) )
+			{
+				return count ? ERR_DIMENSION_MISMATCH : ERR_SCRIPT_SYNTAX;
+			}
+			cols = count;
+			count = 0;
+			rows++;
+			if ( *c++ == ']' )
+			{
+				break;
+			}
+			continue;
+		}
+		if ( *c == ',' )
+		{
+			c++;
+			continue;
+		}
+		Rational r;
+		int error = BS_parseRational(&c, end, &r);
+		if ( error )
+		{
+			return error;
+		}
+		if ( m )
+		{
+			M_AT(m, rows, count) = r;
+		}
+		count++;
+	}
+	*cursor = c;
+	*numRows = rows;
+	*numCols = cols;
+	return 0;
+}
+
+/**
+@fn BS_parseMatrix
+@brief Parses a Matrix literal into a new Matrix.
+@param cursor Pointer to the position just after the opening bracket. Advanced
+past the closing bracket.
+@param end One past the last character of the statement.
+@param result Pointer to a Matrix pointer which will be set to the newly
+allocated Matrix.
+@return An error code. 0 if no problems were encountered.
+*/
+static int BS_parseMatrix (const char **cursor, const char *end,
+	Matrix **result)
+{
+	/* The first scan finds the dimensions and the second fills the Matrix. */
+	const char *c = *cursor;
+	unsigned int numRows, numCols;
+	int error = BS_scanMatrix(&c, end, NULL, &numRows, &numCols);
+	if ( error )
+	{
+		return error;
+	}
+	Matrix *m = M_new(numRows, numCols);
+	if ( !m )
+	{
+		return ERR_ALLOCATION_FAILED;
+	}
+	BS_scanMatrix(cursor, end, m, &numRows, &numCols);
+	M_rehash(m);
+	*result = m;
+	return 0;
+}
+
+/**
+@fn BS_evaluateChain
+@brief Evaluates coefficient * M0 * M1 * ... for a chain of three or more
+matrices, in the order chosen by MC_plan.
+@param matrices The matrices of the chain, in order.
+@param count The number of matrices.
+@param coefficient The Rational to scale the product by.
+@param result Pointer to a Matrix pointer which will be set to the newly
+allocated product.
+@return An error code. 0 if no problems were encountered.
+*/
+static int BS_evaluateChain (Matrix **matrices, unsigned int count,
+	Rational coefficient, Matrix **result)
+{
+	MC_Shape shapes[BS_MAX_CHAIN];
+	for (unsigned int i = 0; i < count; i++)
+	{
+		MC_shapeOf(matrices[i], true, &shapes[i]);
+	}
+	MC_CostModel model = {true, true, MC_DEFAULT_FRACTION_WEIGHT};
+	MC_Plan *plan;
+	int error = MC_plan(shapes, count, &model, &plan);
+	if ( error )
+	{
+		return error;
+	}
+	Matrix *m = M_new(matrices[0]->numRows, matrices[count - 1]->numCols);
+	error = m ? MC_evaluate(plan, matrices, coefficient, m) :
+		ERR_ALLOCATION_FAILED;
+	MC_freePlan(plan);
+	if ( error )
+	{
+		M_free(m);
+		return error;
+	}
+	*result = m;
+	return 0;
+}
+
+/**
+@fn BS_parseTerm
+@brief Parses one term of a sum: a product of Rational literals, Rational
+variables and up to BS_MAX_CHAIN Matrix variables. A product of three or more
+matrices is evaluated here, and the term refers to the result.
+@param table Pointer to the HashTable holding the variables.
+@param cursor Pointer to the current position in the statement. Advanced past
+the term.
+@param end One past the last character of the statement.
+@param term Pointer to the MatrixTerm to fill in. Its coefficient must already
+hold the term's sign.
+@param numMatrices Pointer to where the number of matrices in the term will be
+written.
+@param product Pointer to where the evaluated product of a chain of three or
+more matrices will be written, to be freed by the caller once the term has been
+used. Set to NULL for any other term.
+@return An error code. 0 if no problems were encountered.
+*/
+static int BS_parseTerm (HashTable *table, const char **cursor,
+	const char *end, MatrixTerm *term, unsigned int *numMatrices,
+	Matrix **product)
+{
+	Matrix *matrices[BS_MAX_CHAIN];
+	unsigned int count = 0;
+	const char *c = *cursor;
+	*product = NULL;
+	while ( true )
+	{
+		BS_skipSpaces(&c, end);
+		if ( c < end && BS_IS_DIGIT(*c) )
+		{
+			Rational r;
+			int error = BS_parseRational(&c, end, &r);
+			if ( error )
+			{
+				return error;
+			}
+			R_multR(&term->coefficient, r);
+		}
+		else
+		{
+			char name[BS_MAX_NAME_LENGTH + 1];
+			int error = BS_parseName(&c, end, name);
+			if ( error )
+			{
+				return error;
+			}
+			value_t type;
+			void *value = HT_get(table, name, &type);
+			if ( !value )
+			{
+				return ERR_SCRIPT_UNDEFINED;
+			}
+			if ( type == VT_RATIONAL )
+			{
+				R_multR(&term->coefficient, *(Rational *)value);
+			}
+			else if ( type == VT_MATRIX && count < BS_MAX_CHAIN )
+			{
+				matrices[count++] = (Matrix *)value;
+			}
+			else
+			{
+				return ERR_SCRIPT_TYPE;
+			}
+		}
+		BS_skipSpaces(&c, end);
+		if ( c == end || *c != '*' )
+		{
+			break;
+		}
+		c++;
+	}
+	if ( count > 2 )
+	{
+		/* The coefficient is folded into the product, so the term itself only
+		   copies it. */
+		int error = BS_evaluateChain(matrices, count, term->coefficient,
+			product);
+		if ( error )
+		{
+			return error;
+		}
+		Rational one = {1, 1};
+		*term = ME_element(one, *product);
+	}
+	else if ( count == 2 )
+	{
+		*term = ME_product(term->coefficient, matrices[0], matrices[1]);
+	}
+	else if ( count == 1 )
+	{
+		*term = ME_element(term->coefficient, matrices[0]);
+	}
+	*numMatrices = count;
+	*cursor = c;
+	return 0;
+}
+
+/**
+@fn BS_assignTerms
+@brief Evaluates a sum of parsed terms and assigns it to a variable.
+@param table Pointer to the HashTable holding the variables.
+@param name The name of the variable to assign.
+@param terms The terms of the sum.
+@param numTerms The number of terms.
+@param numMatrixTerms The number of terms which have a Matrix.
+@return An error code. 0 if no problems were encountered.
+*/
+static int BS_assignTerms (HashTable *table, char *name, MatrixTerm *terms,
+	unsigned int numTerms, unsigned int numMatrixTerms)
+{
+	if ( numMatrixTerms == 0 )
+	{
+		Rational sum = terms[0].coefficient;
+		for (unsigned int t = 1; t < numTerms; t++)
+		{
+			R_addR(&sum, terms[t].coefficient);
+		}
+		return HT_add(table, name, &sum, VT_RATIONAL);
+	}
+	if ( numMatrixTerms < numTerms )
+	{
+		return ERR_SCRIPT_TYPE;
+	}
+	Matrix *right = terms[0].type == MT_PRODUCT ? terms[0].right : terms[0].left;
+	Matrix *m = M_new(terms[0].left->numRows, right->numCols);
+	if ( !m )
+	{
+		return ERR_ALLOCATION_FAILED;
+	}
+	int error = ME_evaluate(m, terms, numTerms);
+	if ( !error )
+	{
+		error = HT_add(table, name, m, VT_MATRIX);
+	}
+	if ( error )
+	{
+		M_free(m);
+		return error;
+	}
+	/* The table now owns the element buffer. */
+	free(m);
+	return 0;
+}
+
+/**
+@fn BS_assignExpression
+@brief Evaluates a sum of terms and assigns it to a variable.
+@param table Pointer to the HashTable holding the variables.
+@param name The name of the variable to assign.
+@param c The start of the expression.
+@param end One past the last character of the statement.
+@return An error code. 0 if no problems were encountered.
+*/
+static int BS_assignExpression (HashTable *table, char *name, const char *c,
+	const char *end)
+{
+	MatrixTerm terms[BS_MAX_TERMS];
+	Matrix *products[BS_MAX_TERMS];
+	unsigned int numTerms = 0, numMatrixTerms = 0;
+	int error = 0;
+	BS_skipSpaces(&c, end);
+	bool isNegative = c < end && *c == '-';
+	c += isNegative;
+	while ( true )
+	{
+		if ( numTerms == BS_MAX_TERMS )
+		{
+			error = ERR_SCRIPT_SYNTAX;
+			break;
+		}
+		terms[numTerms].coefficient.top = isNegative ? -1 : 1;
+		terms[numTerms].coefficient.bottom = 1;
+		unsigned int numMatrices;
+		error = BS_parseTerm(table, &c, end, &terms[numTerms], &numMatrices,
+			&products[numTerms]);
+		if ( error )
+		{
+			break;
+		}
+		numMatrixTerms += numMatrices > 0;
+		numTerms++;
+		if ( c == end )
+		{
+			break;
+		}
+		if ( *c != '+' && *c != '-' )
+		{
+			error = ERR_SCRIPT_SYNTAX;
+			break;
+		}
+		isNegative = *c++ == '-';
+	}
+	if ( !error )
+	{
+		error = BS_assignTerms(table, name, terms, numTerms, numMatrixTerms);
+	}
+	for (unsigned int t = 0; t < numTerms; t++)
+	{
+		M_free(products[t]);
+	}
+	return error;
+}
+
+/**
+@fn BS_print
+@brief Writes a variable to a session's output.
+@param session Pointer to the BatchSession.
+@param name The name of the variable.
+@return An error code. 0 if no problems were encountered.
+*/
+static int BS_print (BatchSession *session, char *name)
+{
+	value_t type;
+	void *value = HT_get(session->table, name, &type);
+	if ( !value )
+	{
+		return ERR_SCRIPT_UNDEFINED;
+	}
+	OutputBuffer *out = &session->out;
+	OB_write(out, name, strlen(name));
+	if ( type == VT_RATIONAL )
+	{
+		OB_write(out, " = ", 3);
+		OB_writeRational(out, *(Rational *)value);
+		return OB_write(out, "\n", 1);
+	}
+	if ( type != VT_MATRIX )
+	{
+		return ERR_SCRIPT_TYPE;
+	}
+	OB_write(out, " =\n", 3);
+	return OB_writeMatrix(out, (Matrix *)value);
+}
+
+/**
+@fn BS_runStatement
+@brief Runs one statement of a script.
+@param session Pointer to the BatchSession.
+@param c The start of the statement.
+@param end One past the last character of the statement, with any comment
+already cut off.
+@return An error code. 0 if no problems were encountered.
+*/
+static int BS_runStatement (BatchSession *session, const char *c,
+	const char *end)
+{
+	BS_skipSpaces(&c, end);
+	if ( c == end )
+	{
+		return 0;
+	}
+	char name[BS_MAX_NAME_LENGTH + 1];
+	int error = BS_parseName(&c, end, name);
+	if ( error )
+	{
+		return error;
+	}
+	BS_skipSpaces(&c, end);
+	if ( c < end && *c == '=' )
+	{
+		c++;
+		BS_skipSpaces(&c, end);
+		if ( c == end || *c != '[' )
+		{
+			return BS_assignExpression(session->table, name, c, end);
+		}
+		c++;
+		Matrix *m;
+		error = BS_parseMatrix(&c, end, &m);
+		if ( error )
+		{
+			return error;
+		}
+		BS_skipSpaces(&c, end);
+		error = c == end ? HT_add(session->table, name, m, VT_MATRIX) :
+			ERR_SCRIPT_SYNTAX;
+		if ( error )
+		{
+			M_free(m);
+			return error;
+		}
+		free(m);
+		return 0;
+	}
+	if ( strcmp(name, "print") )
+	{
+		return ERR_SCRIPT_SYNTAX;
+	}
+	error = BS_parseName(&c, end, name);
+	BS_skipSpaces(&c, end);
+	if ( error || c != end )
+	{
+		return ERR_SCRIPT_SYNTAX;
+	}
+	return BS_print(session, name);
+}
+
+/**
+@fn BS_new
+@brief Creates a BatchSession, allocating its table and buffers up front.
+@param tableSize The number of variables the table can hold. 0 for
+BS_DEFAULT_TABLE_SIZE.
+@param outputFd The file descriptor output is written to.
+@return A pointer to the new BatchSession, or NULL if allocation failed.
+*/
+BatchSession *BS_new (unsigned int tableSize, int outputFd)
+{
+	BatchSession *session = (BatchSession *)malloc(sizeof(BatchSession));
+	if ( !session )
+	{
+		return NULL;
+	}
+	session->table = HT_newTable(tableSize ? tableSize : BS_DEFAULT_TABLE_SIZE);
+	session->text = (char *)malloc(BS_INITIAL_TEXT_SIZE);
+	session->textCapacity = BS_INITIAL_TEXT_SIZE;
+	session->errorLine = 0;
+	if ( OB_init(&session->out, outputFd, OB_DEFAULT_CAPACITY) ||
+		!session->table || !session->text )
+	{
+		BS_free(session);
+		return NULL;
+	}
+	return session;
+}
+
+/**
+@fn BS_free
+@brief Flushes a BatchSession's output and frees the session.
+@param session Pointer to the BatchSession to be freed.
+@return The first error produced by writing output. 0 if there was none.
+*/
+int BS_free (BatchSession *session)
+{
+	int error = OB_close(&session->out);
+	if ( session->table )
+	{
+		HT_freeTable(session->table);
+	}
+	free(session->text);
+	free(session);
+	return error;
+}
+
+/**
+@fn BS_runText
+@brief Runs a script against the session's current variables, stopping at the
+first statement which fails.
+@param session Pointer to the BatchSession.
+@param text The text of the script. Need not be null-terminated.
+@param length The number of characters of text.
+@return An error code. 0 if no problems were encountered. On error,
+session->errorLine is set to the failing line.
+*/
+int BS_runText (BatchSession *session, const char *text, size_t length)
+{
+	const char *end = text + length;
+	unsigned int line = 0;
+	session->errorLine = 0;
+	while ( text < end )
+	{
+		line++;
+		const char *lineEnd = (const char *)memchr(text, '\n', end - text);
+		lineEnd = lineEnd ? lineEnd : end;
+		const char *comment = (const char *)memchr(text, '#', lineEnd - text);
+		int error = BS_runStatement(session, text, comment ? comment : lineEnd);
+		if ( error )
+		{
+			session->errorLine = line;
+			return error;
+		}
+		text = lineEnd + 1;
+	}
+	return 0;
+}
+
+/**
+@fn BS_runFile
+@brief Reads a script file into the session's file buffer and runs it against
+the session's current variables.
+@param session Pointer to the BatchSession.
+@param path The path of the script.
+@return An error code. 0 if no problems were encountered.
+*/
+int BS_runFile (BatchSession *session, const char *path)
+{
+	session->errorLine = 0;
+	int fd = open(path, O_RDONLY);
+	struct stat info;
+	if ( fd < 0 || fstat(fd, &info) )
+	{
+		if ( fd >= 0 )
+		{
+			close(fd);
+		}
+		return ERR_SCRIPT_FILE;
+	}
+	size_t size = info.st_size;
+	if ( size > session->textCapacity )
+	{
+		char *text = (char *)realloc(session->text, size);
+		if ( !text )
+		{
+			close(fd);
+			return ERR_ALLOCATION_FAILED;
+		}
+		session->text = text;
+		session->textCapacity = size;
+	}
+	size_t length = 0;
+	while ( length < size )
+	{
+		ssize_t numRead = read(fd, session->text + length, size - length);
+		if ( numRead <= 0 )
+		{
+			break;
+		}
+		length += numRead;
+	}
+	close(fd);
+	if ( length < size )
+	{
+		return ERR_SCRIPT_FILE;
+	}
+	return BS_runText(session, session->text, length);
+}
+
+/**
+@fn BS_runBatch
+@brief Runs a list of script files one after another, resetting the table
+before each. A script which fails is reported on stderr as "path:line: error
+code" and the batch carries on. The output is flushed at the end.
+@param session Pointer to the BatchSession.
+@param paths The paths of the scripts.
+@param numPaths The number of scripts.
+@param numFailed Pointer to where the number of scripts which failed will be
+written. May be NULL.
+@return The first error produced by writing output. 0 if there was none.
+*/
+int BS_runBatch (BatchSession *session, char **paths, unsigned int numPaths,
+	unsigned int *numFailed)
+{
+	unsigned int failures = 0;
+	for (unsigned int i = 0; i < numPaths; i++)
+	{
+		HT_reset(session->table);
+		int error = BS_runFile(session, paths[i]);
+		if ( error )
+		{
+			/* Flush first so the message lands after the script's output. */
+			OB_flush(&session->out);
+			fprintf(stderr, "%s:%u: error %d\n", paths[i], session->errorLine,
+				error);
+			failures++;
+		}
+	}
+	HT_reset(session->table);
+	if ( numFailed )
+	{
+		*numFailed = failures;
+	}
+	return OB_flush(&session->out);
+}
\ No newline at end of file
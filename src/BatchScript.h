@@ -0,0 +1,118 @@
+/**
+@file BatchScript.h
+@author Rob Thomas
+@brief Contains the BatchSession struct and functions for running matrix shell
+scripts non-interactively, many of them in one process. A session keeps one
+HashTable, one OutputBuffer and one file buffer for its whole life: between
+scripts the table is reset rather than freed and the buffers are reused, so a
+script costs no allocation beyond its own variables, and nothing is written to
+the output until the buffer fills or the batch ends.
+@details Scripts have one statement per line, and '#' starts a comment.
+	name = [1 2/3; -4 5]	Assigns a Matrix, given row by row.
+	name = 2 * A * B + c * C - 1/2	Assigns a sum of terms. Each term is a
+		product of Rational literals and variables and up to BS_MAX_CHAIN
+		matrices. A product of three or more matrices is evaluated in the
+		order chosen by MC_plan. Either every term has a Matrix or none does.
+	print name	Writes "name = value", with a Matrix on the following lines.
+*/
+
+#ifndef BATCHSCRIPT_H
+#define BATCHSCRIPT_H
+
+/*** INCLUDES: ***/
+#include <stdlib.h>
+
+#include "HashTable.h"
+#include "OutputBuffer.h"
+
+/*** DEFINES: ***/
+#define BS_DEFAULT_TABLE_SIZE 256
+#define BS_INITIAL_TEXT_SIZE 4096
+#define BS_MAX_TERMS 16
+#define BS_MAX_CHAIN 16
+#define BS_MAX_NAME_LENGTH 63
+
+#define ERR_SCRIPT_SYNTAX -160
+#define ERR_SCRIPT_UNDEFINED -161
+#define ERR_SCRIPT_TYPE -162
+#define ERR_SCRIPT_FILE -163
+
+/*** STRUCTS: ***/
+
+/**
+@def BatchSession
+@brief A struct representing the state kept from one script to the next.
+@var table The variables of the script being run.
+@var out The buffered output shared by every script.
+@var text The buffer script files are read into.
+@var textCapacity The size of text.
+@var errorLine The line (1-indexed) of the statement which failed in the last
+script run. 0 if it succeeded.
+*/
+typedef struct
+{
+	HashTable *table;
+	OutputBuffer out;
+	char *text;
+	size_t textCapacity;
+	unsigned int errorLine;
+} BatchSession;
+
+/*** FUNCTION PROTOTYPES: ***/
+
+/**
+@fn BS_new
+@brief Creates a BatchSession, allocating its table and buffers up front.
+@param tableSize The number of variables the table can hold. 0 for
+BS_DEFAULT_TABLE_SIZE.
+@param outputFd The file descriptor output is written to.
+@return A pointer to the new BatchSession, or NULL if allocation failed.
+*/
+BatchSession *BS_new (unsigned int tableSize, int outputFd);
+
+/**
+@fn BS_free
+@brief Flushes a BatchSession's output and frees the session.
+@param session Pointer to the BatchSession to be freed.
+@return The first error produced by writing output. 0 if there was none.
+*/
+int BS_free (BatchSession *session);
+
+/**
+@fn BS_runText
+@brief Runs a script against the session's current variables, stopping at the
+first statement which fails.
+@param session Pointer to the BatchSession.
+@param text The text of the script. Need not be null-terminated.
+@param length The number of characters of text.
+@return An error code. 0 if no problems were encountered. On error,
+session->errorLine is set to the failing line.
+*/
+int BS_runText (BatchSession *session, const char *text, size_t length);
+
+/**
+@fn BS_runFile
+@brief Reads a script file into the session's file buffer and runs it against
+the session's current variables.
+@param session Pointer to the BatchSession.
+@param path The path of the script.
+@return An error code. 0 if no problems were encountered.
+*/
+int BS_runFile (BatchSession *session, const char *path);
+
+/**
+@fn BS_runBatch
+@brief Runs a list of script files one after another, resetting the table
+before each. A script which fails is reported on stderr as "path:line: error
+code" and the batch carries on. The output is flushed at the end.
+@param session Pointer to the BatchSession.
+@param paths The paths of the scripts.
+@param numPaths The number of scripts.
+@param numFailed Pointer to where the number of scripts which failed will be
+written. May be NULL.
+@return The first error produced by writing output. 0 if there was none.
+*/
+int BS_runBatch (BatchSession *session, char **paths, unsigned int numPaths,
+	unsigned int *numFailed);
+
+#endif /* BATCHSCRIPT_H */
\ No newline at end of file
@@ -0,0 +1,438 @@
+/**
+@file BufferPool.c
+@author Rob Thomas
+@brief Contains functions for a thread-local pool of buffers for matrix
+storage. Buffers come in power-of-two size classes and are aligned to
+BP_ALIGNMENT bytes for SIMD loads. Released buffers are kept on the releasing
+thread's free list for their class, so loops which create and drop same-sized
+temporaries reuse the same few buffers instead of going back to the system
+allocator. A buffer may be released on a different thread than the one which
+allocated it, such as a job's result freed by the thread which collected it; it
+then joins the releasing thread's free lists, which are bounded, and is freed
+when that thread exits. Large buffers can be mapped with transparent huge pages
+to cut TLB misses.
+*/
+
+/*** INCLUDES: ***/
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "BufferPool.h"
+
+/*** DEFINES: ***/
+#define BP_HEADER_SIZE BP_ALIGNMENT
+
+/*** STRUCTS: ***/
+
+/**
+@def BP_Header
+@brief A struct representing the bookkeeping stored in the BP_HEADER_SIZE
+bytes in front of every buffer.
+@var sizeClass The buffer's size class.
+@var mappedLength The length of the buffer's huge page mapping, including the
+page in front of the buffer which holds the header, or 0 if it came from the
+system allocator.
+*/
+typedef struct
+{
+	unsigned int sizeClass;
+	size_t mappedLength;
+} BP_Header;
+
+/**
+@def BP_FreeBuffer
+@brief A struct representing a released buffer on a free list. The link is
+stored in the buffer itself.
+@var next The next buffer on the same free list.
+*/
+typedef struct BP_FreeBuffer
+{
+	struct BP_FreeBuffer *next;
+} BP_FreeBuffer;
+
+/**
+@def BP_Pool
+@brief A struct representing one thread's pool.
+@var freeLists The released buffers of each size class.
+@var numFree The number of buffers on each free list.
+@var cachedBytes The capacity of the buffers on the free lists.
+@var stats The thread's counters. Its byte totals are unused, since they are
+kept process-wide in bpBytes.
+@var isRegistered Whether the pool will be trimmed when the thread exits.
+*/
+typedef struct
+{
+	BP_FreeBuffer *freeLists[BP_NUM_CLASSES];
+	unsigned int numFree[BP_NUM_CLASSES];
+	size_t cachedBytes;
+	BP_Stats stats;
+	bool isRegistered;
+} BP_Pool;
+
+/*** GLOBALS: ***/
+static _Thread_local BP_Pool bpPool;
+/* A buffer may be released on a different thread than the one which allocated
+   it, so the byte totals are shared by every thread. */
+static _Atomic int64_t bpBytesInUse;
+static _Atomic int64_t bpBytesCached;
+static _Atomic int64_t bpPeakBytesInUse;
+static _Atomic int64_t bpPeakFootprint;
+static atomic_bool bpUseHugePages;
+static pthread_key_t bpExitKey;
+static pthread_once_t bpExitOnce = PTHREAD_ONCE_INIT;
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn BP_header
+@brief Finds the header in front of a buffer.
+@param buffer The buffer.
+@return A pointer to the buffer's header.
+*/
+static BP_Header *BP_header (void *buffer)
+{
+	return (BP_Header *)((char *)buffer - BP_HEADER_SIZE);
+}
+
+/**
+@fn BP_classSize
+@brief Returns the capacity of the buffers in a size class.
+@param sizeClass The size class.
+@return The capacity in bytes.
+*/
+static size_t BP_classSize (unsigned int sizeClass)
+{
+	return (size_t)1 << (sizeClass + BP_MIN_CLASS_SHIFT);
+}
+
+/**
+@fn BP_sizeClass
+@brief Finds the smallest size class which holds a number of bytes.
+@param size The number of bytes. Must be non-zero.
+@return The size class.
+*/
+static unsigned int BP_sizeClass (size_t size)
+{
+	if ( size <= BP_classSize(0) )
+	{
+		return 0;
+	}
+	return 64 - __builtin_clzll(size - 1) - BP_MIN_CLASS_SHIFT;
+}
+
+/**
+@fn BP_raisePeak
+@brief Raises a process-wide peak to a value if it is lower.
+@param peak Pointer to the peak.
+@param value The value.
+*/
+static void BP_raisePeak (_Atomic int64_t *peak, int64_t value)
+{
+	int64_t current = atomic_load_explicit(peak, memory_order_relaxed);
+	while ( value > current && !atomic_compare_exchange_weak_explicit(peak,
+		&current, value, memory_order_relaxed, memory_order_relaxed) )
+	{
+	}
+}
+
+/**
+@fn BP_addBytes
+@brief Adjusts the process-wide byte totals and raises the peaks to match.
+@param inUse The change in the capacity of the buffers handed out.
+@param cached The change in the capacity of the buffers on free lists.
+*/
+static void BP_addBytes (int64_t inUse, int64_t cached)
+{
+	int64_t newInUse = atomic_fetch_add_explicit(&bpBytesInUse, inUse,
+		memory_order_relaxed) + inUse;
+	int64_t newCached = atomic_fetch_add_explicit(&bpBytesCached, cached,
+		memory_order_relaxed) + cached;
+	if ( inUse > 0 )
+	{
+		BP_raisePeak(&bpPeakBytesInUse, newInUse);
+	}
+	if ( inUse + cached > 0 )
+	{
+		BP_raisePeak(&bpPeakFootprint, newInUse + newCached);
+	}
+}
+
+/**
+@fn BP_exitThread
+@brief Trims a thread's pool when the thread exits.
+@param unused The thread's value for bpExitKey.
+*/
+static void BP_exitThread (void *unused)
+{
+	(void)unused;
+	BP_trim();
+}
+
+/**
+@fn BP_createExitKey
+@brief Creates the key whose destructor trims each thread's pool.
+*/
+static void BP_createExitKey ()
+{
+	pthread_key_create(&bpExitKey, BP_exitThread);
+}
+
+/**
+@fn BP_allocClass
+@brief Allocates a new buffer of a size class from the system.
+@param sizeClass The size class.
+@return A pointer to the buffer, or NULL if allocation failed.
+*/
+static void *BP_allocClass (unsigned int sizeClass)
+{
+	size_t capacity = BP_classSize(sizeClass);
+	char *base;
+	size_t mappedLength = 0;
+	if ( capacity >= BP_HUGE_PAGE_SIZE && atomic_load(&bpUseHugePages) )
+	{
+		/* The buffer itself starts on a huge page boundary, which transparent
+		   huge pages need, and the header goes in one ordinary page in front
+		   of it, so a class of n huge pages maps exactly n of them. Over-map
+		   by one huge page and trim the mapping to that layout. */
+		size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+		mappedLength = pageSize + capacity;
+		size_t rawLength = mappedLength + BP_HUGE_PAGE_SIZE;
+		char *raw = (char *)mmap(NULL, rawLength, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if ( raw == MAP_FAILED )
+		{
+			return NULL;
+		}
+		char *data = (char *)(((uintptr_t)raw + pageSize + BP_HUGE_PAGE_SIZE - 1)
+			& ~(uintptr_t)(BP_HUGE_PAGE_SIZE - 1));
+		char *start = data - pageSize;
+		if ( start > raw )
+		{
+			munmap(raw, start - raw);
+		}
+		if ( raw + rawLength > data + capacity )
+		{
+			munmap(data + capacity, raw + rawLength - (data + capacity));
+		}
+		madvise(data, capacity, MADV_HUGEPAGE);
+		bpPool.stats.hugePageBuffers++;
+		base = data - BP_HEADER_SIZE;
+	}
+	else if ( posix_memalign((void **)&base, BP_ALIGNMENT,
+		capacity + BP_HEADER_SIZE) )
+	{
+		return NULL;
+	}
+	BP_Header *header = (BP_Header *)base;
+	header->sizeClass = sizeClass;
+	header->mappedLength = mappedLength;
+	return base + BP_HEADER_SIZE;
+}
+
+/**
+@fn BP_freeBuffer
+@brief Returns a buffer to the system.
+@param buffer The buffer.
+*/
+static void BP_freeBuffer (void *buffer)
+{
+	BP_Header *header = BP_header(buffer);
+	if ( header->mappedLength )
+	{
+		size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+		munmap((char *)buffer - pageSize, header->mappedLength);
+	}
+	else
+	{
+		free(header);
+	}
+}
+
+/**
+@fn BP_alloc
+@brief Allocates a buffer of at least the given size, aligned to BP_ALIGNMENT
+bytes. Its contents are undefined.
+@param size The number of bytes needed.
+@return A pointer to the buffer, or NULL if size is 0 or allocation failed.
+*/
+void *BP_alloc (size_t size)
+{
+	if ( size == 0 )
+	{
+		return NULL;
+	}
+	unsigned int sizeClass = BP_sizeClass(size);
+	if ( sizeClass >= BP_NUM_CLASSES )
+	{
+		return NULL;
+	}
+	size_t capacity = BP_classSize(sizeClass);
+	void *buffer;
+	BP_FreeBuffer *reused = bpPool.freeLists[sizeClass];
+	if ( reused )
+	{
+		bpPool.freeLists[sizeClass] = reused->next;
+		bpPool.numFree[sizeClass]--;
+		bpPool.cachedBytes -= capacity;
+		bpPool.stats.reuses++;
+		buffer = reused;
+	}
+	else
+	{
+		buffer = BP_allocClass(sizeClass);
+		if ( !buffer )
+		{
+			return NULL;
+		}
+	}
+	bpPool.stats.allocations++;
+	BP_addBytes(capacity, reused ? -(int64_t)capacity : 0);
+	return buffer;
+}
+
+/**
+@fn BP_resize
+@brief Grows a buffer from BP_alloc, keeping its contents. The buffer is only
+moved if its size class is too small.
+@param buffer The buffer to grow, or NULL to allocate a new one.
+@param size The number of bytes needed.
+@return A pointer to the grown buffer, or NULL if allocation failed, in which
+case buffer is unchanged.
+*/
+void *BP_resize (void *buffer, size_t size)
+{
+	if ( !buffer )
+	{
+		return BP_alloc(size);
+	}
+	size_t capacity = BP_capacity(buffer);
+	if ( capacity >= size )
+	{
+		return buffer;
+	}
+	void *grown = BP_alloc(size);
+	if ( !grown )
+	{
+		return NULL;
+	}
+	memcpy(grown, buffer, capacity);
+	BP_release(buffer);
+	return grown;
+}
+
+/**
+@fn BP_release
+@brief Gives a buffer from BP_alloc back to the calling thread's pool. The
+buffer is kept for reuse unless its class's free list or the pool is full. Any
+thread may release a buffer, not just the one which allocated it.
+@param buffer The buffer to release. May be NULL.
+*/
+void BP_release (void *buffer)
+{
+	if ( !buffer )
+	{
+		return;
+	}
+	unsigned int sizeClass = BP_header(buffer)->sizeClass;
+	size_t capacity = BP_classSize(sizeClass);
+	bpPool.stats.releases++;
+	if ( bpPool.numFree[sizeClass] >= BP_MAX_CACHED_PER_CLASS ||
+		bpPool.cachedBytes + capacity > BP_MAX_CACHED_BYTES )
+	{
+		BP_addBytes(-(int64_t)capacity, 0);
+		BP_freeBuffer(buffer);
+		return;
+	}
+	/* Make sure this thread's cached buffers are freed when it exits. */
+	if ( !bpPool.isRegistered )
+	{
+		pthread_once(&bpExitOnce, BP_createExitKey);
+		pthread_setspecific(bpExitKey, &bpPool);
+		bpPool.isRegistered = true;
+	}
+	BP_FreeBuffer *freed = (BP_FreeBuffer *)buffer;
+	freed->next = bpPool.freeLists[sizeClass];
+	bpPool.freeLists[sizeClass] = freed;
+	bpPool.numFree[sizeClass]++;
+	bpPool.cachedBytes += capacity;
+	BP_addBytes(-(int64_t)capacity, capacity);
+}
+
+/**
+@fn BP_capacity
+@brief Returns the usable size of a buffer from BP_alloc.
+@param buffer The buffer.
+@return The size of the buffer's class in bytes.
+*/
+size_t BP_capacity (void *buffer)
+{
+	return BP_classSize(BP_header(buffer)->sizeClass);
+}
+
+/**
+@fn BP_setHugePages
+@brief Turns transparent huge pages on or off for buffers allocated from now
+on by every thread. When on, buffers of at least BP_HUGE_PAGE_SIZE bytes are
+mapped at huge page boundaries and marked with MADV_HUGEPAGE. Off by default.
+@param enable true to use huge pages, false otherwise.
+*/
+void BP_setHugePages (bool enable)
+{
+	atomic_store(&bpUseHugePages, enable);
+}
+
+/**
+@fn BP_trim
+@brief Returns every buffer on the calling thread's free lists to the system.
+Called automatically when a thread which has cached buffers exits.
+*/
+void BP_trim ()
+{
+	for (unsigned int c = 0; c < BP_NUM_CLASSES; c++)
+	{
+		while ( bpPool.freeLists[c] )
+		{
+			BP_FreeBuffer *buffer = bpPool.freeLists[c];
+			bpPool.freeLists[c] = buffer->next;
+			BP_freeBuffer(buffer);
+		}
+		bpPool.numFree[c] = 0;
+	}
+	BP_addBytes(0, -(int64_t)bpPool.cachedBytes);
+	bpPool.cachedBytes = 0;
+}
+
+/**
+@fn BP_getStats
+@brief Reads the calling thread's buffer pool counters and the process-wide
+byte totals.
+@param stats Pointer to the BP_Stats the statistics will be written to.
+*/
+void BP_getStats (BP_Stats *stats)
+{
+	*stats = bpPool.stats;
+	stats->bytesInUse = atomic_load(&bpBytesInUse);
+	stats->bytesCached = atomic_load(&bpBytesCached);
+	stats->peakBytesInUse = atomic_load(&bpPeakBytesInUse);
+	stats->peakFootprint = atomic_load(&bpPeakFootprint);
+}
+
+/**
+@fn BP_resetStats
+@brief Zeroes the calling thread's counters and restarts the process-wide
+peaks from the current footprint.
+*/
+void BP_resetStats ()
+{
+	BP_Stats *stats = &bpPool.stats;
+	stats->allocations = 0;
+	stats->reuses = 0;
+	stats->releases = 0;
+	stats->hugePageBuffers = 0;
+	int64_t bytesInUse = atomic_load(&bpBytesInUse);
+	atomic_store(&bpPeakBytesInUse, bytesInUse);
+	atomic_store(&bpPeakFootprint, bytesInUse + atomic_load(&bpBytesCached));
+}
\ No newline at end of file
@@ -0,0 +1,131 @@
+/**
+@file BufferPool.h
+@author Rob Thomas
+@brief Contains functions for a thread-local pool of buffers for matrix
+storage. Buffers come in power-of-two size classes and are aligned to
+BP_ALIGNMENT bytes for SIMD loads. Released buffers are kept on the releasing
+thread's free list for their class, so loops which create and drop same-sized
+temporaries reuse the same few buffers instead of going back to the system
+allocator. A buffer may be released on a different thread than the one which
+allocated it, such as a job's result freed by the thread which collected it; it
+then joins the releasing thread's free lists, which are bounded, and is freed
+when that thread exits. Large buffers can be mapped with transparent huge pages to cut TLB
+misses.
+*/
+
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+/*** INCLUDES: ***/
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*** DEFINES: ***/
+#define BP_ALIGNMENT 64
+#define BP_MIN_CLASS_SHIFT 6
+#define BP_NUM_CLASSES 36
+#define BP_HUGE_PAGE_SIZE ((size_t)2 << 20)
+#define BP_MAX_CACHED_PER_CLASS 8
+#define BP_MAX_CACHED_BYTES ((size_t)256 << 20)
+
+/*** STRUCTS: ***/
+
+/**
+@def BP_Stats
+@brief A struct representing buffer pool statistics. The counts of buffers are
+the calling thread's, while the byte totals and peaks cover every thread, since
+a buffer may be released on a different thread than the one which allocated
+it.
+@var allocations The number of buffers handed out.
+@var reuses The number of allocations satisfied from a free list.
+@var releases The number of buffers given back.
+@var hugePageBuffers The number of buffers mapped with huge pages.
+@var bytesInUse The capacity of the buffers handed out and not yet released.
+@var bytesCached The capacity of the buffers kept on free lists.
+@var peakBytesInUse The largest value bytesInUse has reached.
+@var peakFootprint The largest value bytesInUse + bytesCached has reached.
+*/
+typedef struct
+{
+	uint64_t allocations;
+	uint64_t reuses;
+	uint64_t releases;
+	uint64_t hugePageBuffers;
+	int64_t bytesInUse;
+	int64_t bytesCached;
+	int64_t peakBytesInUse;
+	int64_t peakFootprint;
+} BP_Stats;
+
+/*** FUNCTION PROTOTYPES: ***/
+
+/**
+@fn BP_alloc
+@brief Allocates a buffer of at least the given size, aligned to BP_ALIGNMENT
+bytes. Its contents are undefined.
+@param size The number of bytes needed.
+@return A pointer to the buffer, or NULL if size is 0 or allocation failed.
+*/
+void *BP_alloc (size_t size);
+
+/**
+@fn BP_resize
+@brief Grows a buffer from BP_alloc, keeping its contents. The buffer is only
+moved if its size class is too small.
+@param buffer The buffer to grow, or NULL to allocate a new one.
+@param size The number of bytes needed.
+@return A pointer to the grown buffer, or NULL if allocation failed, in which
+case buffer is unchanged.
+*/
+void *BP_resize (void *buffer, size_t size);
+
+/**
+@fn BP_release
+@brief Gives a buffer from BP_alloc back to the calling thread's pool. The
+buffer is kept for reuse unless its class's free list or the pool is full. Any
+thread may release a buffer, not just the one which allocated it.
+@param buffer The buffer to release. May be NULL.
+*/
+void BP_release (void *buffer);
+
+/**
+@fn BP_capacity
+@brief Returns the usable size of a buffer from BP_alloc.
+@param buffer The buffer.
+@return The size of the buffer's class in bytes.
+*/
+size_t BP_capacity (void *buffer);
+
+/**
+@fn BP_setHugePages
+@brief Turns transparent huge pages on or off for buffers allocated from now
+on by every thread. When on, buffers of at least BP_HUGE_PAGE_SIZE bytes are
+mapped at huge page boundaries and marked with MADV_HUGEPAGE. Off by default.
+@param enable true to use huge pages, false otherwise.
+*/
+void BP_setHugePages (bool enable);
+
+/**
+@fn BP_trim
+@brief Returns every buffer on the calling thread's free lists to the system.
+Called automatically when a thread which has cached buffers exits.
+*/
+void BP_trim ();
+
+/**
+@fn BP_getStats
+@brief Reads the calling thread's buffer pool counters and the process-wide
+byte totals.
+@param stats Pointer to the BP_Stats the statistics will be written to.
+*/
+void BP_getStats (BP_Stats *stats);
+
+/**
+@fn BP_resetStats
+@brief Zeroes the calling thread's counters and restarts the process-wide
+peaks from the current footprint.
+*/
+void BP_resetStats ();
+
+#endif /* BUFFERPOOL_H */
\ No newline at end of file
@@ -0,0 +1,1049 @@
+/**
+@file CharPoly.c
+@author Rob Thomas
+@brief Contains functions for the characteristic polynomial, the traces of
+powers and the minimal polynomial of a square Matrix. The Matrix is scaled by
+the least common multiple of its bottoms to an integer Matrix, which is reduced
+modulo a few word-sized primes. The characteristic polynomial is computed
+modulo each prime with the division-free Berkowitz algorithm. Its steps are
+independent of each other, so they are spread over threads. The Rational
+coefficients are then recovered from their residues. A bound on the
+eigenvalues bounds every coefficient, which decides whether a coefficient can
+be recovered exactly by the Chinese remainder theorem or must be found by
+rational reconstruction and checked against a spare prime.
+*/
+
+/*** INCLUDES: ***/
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "CharPoly.h"
+
+/*** DEFINES: ***/
+
+/* The primes are below 2^26, so a product of two residues is below 2^52 and
+   4095 of them can be added to a reduced residue before 64 bits overflow. */
+#define CP_DOT_BLOCK 4095
+
+/* Rational reconstruction looks for a fraction whose top and bottom both fit
+   in a Rational. The product of the first CP_NUM_USED_PRIMES - 1 primes, about
+   2^78, exceeds twice the product of these bounds, so that fraction is unique
+   and the last prime is left over to check it. */
+#define CP_NUMERATOR_BOUND ((__int128)1 << 31)
+#define CP_DENOMINATOR_BOUND ((__int128)1 << 31)
+
+/*** GLOBALS: ***/
+static const uint32_t CP_primes[CP_NUM_PRIMES] =
+	{67108859u, 67108837u, 67108819u, 67108777u, 67108763u, 67108757u,
+	67108753u, 67108747u};
+
+/*** STRUCTS: ***/
+
+/**
+@def CP_Engine
+@brief A struct representing an integer Matrix reduced modulo several primes,
+along with the work shared between the threads computing with it.
+@var size The number of rows (and columns) of the Matrix.
+@var numPrimes The number of primes used.
+@var primes The primes used. None of them divides the Matrix's denominator.
+@var reduced The scaled Matrix modulo each prime, one size^2 block per prime.
+@var steps The values computed by each Berkowitz step modulo each prime. Step
+r (1-indexed) has r values, which start at offset r(r - 1)/2 of the prime's
+block.
+@var results The coefficients of a polynomial modulo each prime, highest
+degree first, one block of size + 1 per prime.
+@var degrees The degree of the polynomial in results for each prime.
+@var numItems The number of items of work in the current pass.
+@var nextItem The next item of work to be claimed by a thread.
+@var error The error code produced by any thread. 0 if none.
+*/
+typedef struct
+{
+	unsigned int size;
+	unsigned int numPrimes;
+	uint32_t primes[CP_NUM_PRIMES];
+	uint32_t *reduced;
+	uint32_t *steps;
+	uint32_t *results;
+	unsigned int *degrees;
+	unsigned int numItems;
+	atomic_uint nextItem;
+	atomic_int error;
+} CP_Engine;
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn CP_powMod
+@brief Raises a number to a power modulo a prime below 2^32.
+@param base The number to raise.
+@param exponent The power to raise base to.
+@param prime The modulus.
+@return base^exponent mod prime.
+*/
+static uint64_t CP_powMod (uint64_t base, uint64_t exponent, uint64_t prime)
+{
+	uint64_t result = 1;
+	base %= prime;
+	while ( exponent > 0 )
+	{
+		if ( exponent & 1 )
+		{
+			result = result * base % prime;
+		}
+		base = base * base % prime;
+		exponent >>= 1;
+	}
+	return result;
+}
+
+/**
+@fn CP_mod
+@brief Reduces a signed 128-bit integer modulo a positive modulus.
+@param value The integer to reduce.
+@param modulus The modulus.
+@return value mod modulus, in the range [0, modulus).
+*/
+static uint64_t CP_mod (__int128 value, uint64_t modulus)
+{
+	__int128 remainder = value % (__int128)modulus;
+	return remainder < 0 ? remainder + modulus : remainder;
+}
+
+/**
+@fn CP_GCD128
+@brief Determines the greatest common denominator between two non-negative
+128-bit integers.
+@param a One of the two integers whose GCD will be found.
+@param b One of the two integers whose GCD will be found.
+@return The GCD of a and b.
+*/
+static unsigned __int128 CP_GCD128 (unsigned __int128 a, unsigned __int128 b)
+{
+	while ( b != 0 )
+	{
+		unsigned __int128 swap = a % b;
+		a = b;
+		b = swap;
+	}
+	return a;
+}
+
+/**
+@fn CP_mix
+@brief Scrambles a 64-bit integer, for filling vectors with pseudo-random
+residues.
+@param x The integer to scramble.
+@return The scrambled integer.
+*/
+static uint64_t CP_mix (uint64_t x)
+{
+	x = (x ^ (x >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+	x = (x ^ (x >> 27)) * UINT64_C(0x94d049bb133111eb);
+	return x ^ (x >> 31);
+}
+
+/**
+@fn CP_dot
+@brief Computes the dot product of two vectors of residues modulo a prime.
+Products are summed in 64 bits and only reduced once per CP_DOT_BLOCK of them.
+@param a One of the vectors.
+@param b The other vector.
+@param length The length of the vectors.
+@param prime The modulus.
+@return The dot product modulo prime.
+*/
+static uint32_t CP_dot (const uint32_t *a, const uint32_t *b,
+	unsigned int length, uint32_t prime)
+{
+	uint64_t sum = 0;
+	for (unsigned int start = 0; start < length; start += CP_DOT_BLOCK)
+	{
+		unsigned int end = length - start > CP_DOT_BLOCK ?
+			start + CP_DOT_BLOCK : length;
+		uint64_t block = sum;
+		for (unsigned int i = start; i < end; i++)
+		{
+			block += (uint64_t)a[i] * b[i];
+		}
+		sum = block % prime;
+	}
+	return sum;
+}
+
+/**
+@fn CP_denominator
+@brief Finds the least common multiple of the bottoms of a Matrix.
+@param a Pointer to the Matrix.
+@param denominator Pointer to where the least common multiple will be written.
+@return An error code. 0 if no problems were encountered.
+*/
+static int CP_denominator (Matrix *a, int64_t *denominator)
+{
+	int64_t multiple = 1;
+	for (size_t i = 0; i < (size_t)a->numRows * a->numCols && !a->isInteger; i++)
+	{
+		int64_t bottom = a->elements[i].bottom;
+		if ( bottom <= 0 )
+		{
+			return ERR_CHARPOLY_OVERFLOW;
+		}
+		if ( multiple % bottom && __builtin_mul_overflow(multiple,
+			bottom / R_GCD(multiple, bottom), &multiple) )
+		{
+			return ERR_CHARPOLY_OVERFLOW;
+		}
+	}
+	*denominator = multiple;
+	return 0;
+}
+
+/**
+@fn CP_freeEngine
+@brief Frees the buffers of a CP_Engine.
+@param engine Pointer to the CP_Engine.
+*/
+static void CP_freeEngine (CP_Engine *engine)
+{
+	free(engine->reduced);
+	free(engine->steps);
+	free(engine->results);
+	free(engine->degrees);
+}
+
+/**
+@fn CP_prepare
+@brief Scales a square Matrix to integers and reduces it modulo up to maxPrimes
+primes, skipping any prime which divides the denominator.
+@param a Pointer to the Matrix.
+@param maxPrimes The largest number of primes to use.
+@param engine Pointer to the CP_Engine to fill in. Its buffers must be freed
+with CP_freeEngine, even on error.
+@param denominator Pointer to where the denominator the Matrix was scaled by
+will be written.
+@return An error code. 0 if no problems were encountered.
+*/
+static int CP_prepare (Matrix *a, unsigned int maxPrimes, CP_Engine *engine,
+	int64_t *denominator)
+{
+	memset(engine, 0, sizeof(CP_Engine));
+	if ( a->numRows != a->numCols )
+	{
+		return ERR_DIMENSION_MISMATCH;
+	}
+	int error = CP_denominator(a, denominator);
+	if ( error )
+	{
+		return error;
+	}
+	unsigned int n = a->numRows;
+	engine->size = n;
+	for (int p = 0; p < CP_NUM_PRIMES && engine->numPrimes < maxPrimes; p++)
+	{
+		if ( *denominator % CP_primes[p] )
+		{
+			engine->primes[engine->numPrimes++] = CP_primes[p];
+		}
+	}
+	size_t numElements = (size_t)n * n;
+	engine->reduced = (uint32_t *)malloc(sizeof(uint32_t) * engine->numPrimes *
+		(numElements ? numElements : 1));
+	engine->results = (uint32_t *)malloc(sizeof(uint32_t) * engine->numPrimes *
+		(n + 1));
+	engine->degrees = (unsigned int *)malloc(sizeof(unsigned int) *
+		engine->numPrimes);
+	if ( !engine->reduced || !engine->results || !engine->degrees )
+	{
+		return ERR_ALLOCATION_FAILED;
+	}
+	/* Element (i, j) of the scaled Matrix is top * (denominator / bottom). */
+	for (size_t i = 0; i < numElements; i++)
+	{
+		Rational element = a->elements[i];
+		int64_t scale = *denominator / element.bottom;
+		for (unsigned int p = 0; p < engine->numPrimes; p++)
+		{
+			uint32_t prime = engine->primes[p];
+			engine->reduced[p * numElements + i] = CP_mod(element.top, prime) *
+				(uint64_t)(scale % prime) % prime;
+		}
+	}
+	return 0;
+}
+
+/**
+@fn CP_run
+@brief Runs a worker function on several threads, which share out
+engine->numItems items of work between them. If a thread cannot be started,
+the others take its share.
+@param engine Pointer to the CP_Engine.
+@param function The worker function. It claims items from engine->nextItem
+until none are left.
+@param numItems The number of items of work.
+@param numThreads The number of threads to use.
+@return An error code. 0 if no problems were encountered.
+*/
+static int CP_run (CP_Engine *engine, void *(*function)(void *),
+	unsigned int numItems, unsigned int numThreads)
+{
+	pthread_t threads[CP_MAX_THREADS];
+	unsigned int numStarted = 0;
+	engine->numItems = numItems;
+	atomic_store(&engine->nextItem, 0);
+	if ( numThreads > CP_MAX_THREADS )
+	{
+		numThreads = CP_MAX_THREADS;
+	}
+	if ( numThreads > numItems )
+	{
+		numThreads = numItems;
+	}
+	/* The calling thread works alongside the others. */
+	for (unsigned int t = 1; t < numThreads; t++)
+	{
+		if ( pthread_create(&threads[t], NULL, function, engine) )
+		{
+			break;
+		}
+		numStarted = t;
+	}
+	function(engine);
+	for (unsigned int t = 1; t <= numStarted; t++)
+	{
+		pthread_join(threads[t], NULL);
+	}
+	return atomic_load(&engine->error);
+}
+
+/**
+@fn CP_stepsWorker
+@brief Computes Berkowitz steps for a CP_Engine. Step r of a prime takes the
+leading principal r x r submatrix, splits off its last row R, last column S
+and corner element c, and computes c followed by R * A^i * S for each i from 0
+to r - 2, where A is the leading (r - 1) x (r - 1) submatrix.
+@param context Pointer to the CP_Engine.
+@return NULL.
+*/
+static void *CP_stepsWorker (void *context)
+{
+	CP_Engine *engine = (CP_Engine *)context;
+	unsigned int n = engine->size;
+	size_t numSteps = (size_t)n * (n + 1) / 2;
+	uint32_t *vectors = (uint32_t *)malloc(sizeof(uint32_t) * 2 * (n ? n : 1));
+	if ( !vectors )
+	{
+		atomic_store(&engine->error, ERR_ALLOCATION_FAILED);
+		return NULL;
+	}
+	unsigned int item;
+	while ( (item = atomic_fetch_add(&engine->nextItem, 1)) < engine->numItems )
+	{
+		/* The largest steps are handed out first, so that no thread is left
+		   with a long one at the end. */
+		unsigned int p = item % engine->numPrimes;
+		unsigned int r = n - item / engine->numPrimes;
+		uint32_t prime = engine->primes[p];
+		const uint32_t *m = engine->reduced + (size_t)p * n * n;
+		uint32_t *values = engine->steps + p * numSteps + (size_t)r * (r - 1) / 2;
+		unsigned int length = r - 1;
+		uint32_t *v = vectors, *w = vectors + n;
+		const uint32_t *lastRow = &m[(size_t)length * n];
+		values[0] = lastRow[length];
+		for (unsigned int i = 0; i < length; i++)
+		{
+			v[i] = m[(size_t)i * n + length];
+		}
+		for (unsigned int i = 0; i < length; i++)
+		{
+			values[i + 1] = CP_dot(lastRow, v, length, prime);
+			if ( i + 1 == length )
+			{
+				break;
+			}
+			for (unsigned int row = 0; row < length; row++)
+			{
+				w[row] = CP_dot(&m[(size_t)row * n], v, length, prime);
+			}
+			uint32_t *swap = v;
+			v = w;
+			w = swap;
+		}
+	}
+	free(vectors);
+	return NULL;
+}
+
+/**
+@fn CP_combineWorker
+@brief Combines the Berkowitz steps of each prime into the characteristic
+polynomial modulo that prime. The polynomial of the leading r x r submatrix is
+the product of a lower triangular Toeplitz matrix, whose first column is 1
+followed by the negated values of step r, with the polynomial of the leading
+(r - 1) x (r - 1) submatrix.
+@param context Pointer to the CP_Engine.
+@return NULL.
+*/
+static void *CP_combineWorker (void *context)
+{
+	CP_Engine *engine = (CP_Engine *)context;
+	unsigned int n = engine->size;
+	size_t numSteps = (size_t)n * (n + 1) / 2;
+	uint32_t *polynomial = (uint32_t *)malloc(sizeof(uint32_t) * 3 * (n + 1));
+	if ( !polynomial )
+	{
+		atomic_store(&engine->error, ERR_ALLOCATION_FAILED);
+		return NULL;
+	}
+	uint32_t *next = polynomial + n + 1;
+	uint32_t *column = next + n + 1;
+	unsigned int p;
+	while ( (p = atomic_fetch_add(&engine->nextItem, 1)) < engine->numItems )
+	{
+		uint32_t prime = engine->primes[p];
+		uint32_t *current = polynomial;
+		uint32_t *result = next;
+		current[0] = 1;
+		for (unsigned int r = 1; r <= n; r++)
+		{
+			const uint32_t *values = engine->steps + p * numSteps +
+				(size_t)r * (r - 1) / 2;
+			/* The first column of the Toeplitz matrix, reversed so that each
+			   coefficient of the product is a dot product. */
+			column[r] = 1;
+			for (unsigned int k = 1; k <= r; k++)
+			{
+				column[r - k] = values[k - 1] ? prime - values[k - 1] : 0;
+			}
+			for (unsigned int j = 0; j <= r; j++)
+			{
+				unsigned int length = j < r ? j + 1 : r;
+				result[j] = CP_dot(&column[r - j], current, length, prime);
+			}
+			uint32_t *swap = current;
+			current = result;
+			result = swap;
+		}
+		memcpy(engine->results + (size_t)p * (n + 1), current,
+			sizeof(uint32_t) * (n + 1));
+		engine->degrees[p] = n;
+	}
+	free(polynomial);
+	return NULL;
+}
+
+/**
+@fn CP_minPolyWorker
+@brief Computes the minimal polynomial of a pseudo-random vector v modulo each
+prime. A^k v is reduced against the reduced vectors before it, keeping track of
+each one as a polynomial in A applied to v, until one reduces to 0; its
+polynomial is then the minimal polynomial of v.
+@param context Pointer to the CP_Engine.
+@return NULL.
+*/
+static void *CP_minPolyWorker (void *context)
+{
+	CP_Engine *engine = (CP_Engine *)context;
+	unsigned int n = engine->size;
+	size_t numElements = (size_t)n * n;
+	uint32_t *basis = (uint32_t *)malloc(sizeof(uint32_t) *
+		(numElements + (size_t)n * (n + 1) + 2 * n + 1));
+	uint64_t *sums = (uint64_t *)malloc(sizeof(uint64_t) * (2 * n + 1));
+	unsigned int *pivots = (unsigned int *)malloc(sizeof(unsigned int) *
+		(n ? n : 1));
+	if ( !basis || !sums || !pivots )
+	{
+		free(basis);
+		free(sums);
+		free(pivots);
+		atomic_store(&engine->error, ERR_ALLOCATION_FAILED);
+		return NULL;
+	}
+	uint32_t *polynomials = basis + numElements;
+	uint32_t *krylov = polynomials + (size_t)n * (n + 1);
+	uint32_t *next = krylov + n;
+	uint64_t *u = sums;
+	uint64_t *polynomial = sums + n;
+	unsigned int p;
+	while ( (p = atomic_fetch_add(&engine->nextItem, 1)) < engine->numItems )
+	{
+		uint32_t prime = engine->primes[p];
+		const uint32_t *m = engine->reduced + p * numElements;
+		for (unsigned int i = 0; i < n; i++)
+		{
+			krylov[i] = CP_mix(((uint64_t)prime << 32) + i) % prime;
+		}
+		unsigned int numBasis = 0;
+		for (unsigned int k = 0; ; k++)
+		{
+			/* Reduce A^k v, which starts out as the polynomial x^k. */
+			for (unsigned int i = 0; i < n; i++)
+			{
+				u[i] = krylov[i];
+			}
+			memset(polynomial, 0, sizeof(uint64_t) * (k + 1));
+			polynomial[k] = 1;
+			for (unsigned int b = 0; b < numBasis; b++)
+			{
+				if ( b % CP_DOT_BLOCK == CP_DOT_BLOCK - 1 )
+				{
+					for (unsigned int i = 0; i < n; i++)
+					{
+						u[i] %= prime;
+					}
+					for (unsigned int j = 0; j <= k; j++)
+					{
+						polynomial[j] %= prime;
+					}
+				}
+				uint64_t factor = u[pivots[b]] % prime;
+				if ( factor == 0 )
+				{
+					continue;
+				}
+				factor = prime - factor;
+				const uint32_t *vector = basis + (size_t)b * n;
+				const uint32_t *terms = polynomials + (size_t)b * (n + 1);
+				for (unsigned int i = 0; i < n; i++)
+				{
+					u[i] += factor * vector[i];
+				}
+				for (unsigned int j = 0; j < k; j++)
+				{
+					polynomial[j] += factor * terms[j];
+				}
+			}
+			unsigned int pivot = n;
+			for (unsigned int i = 0; i < n; i++)
+			{
+				u[i] %= prime;
+				if ( u[i] && pivot == n )
+				{
+					pivot = i;
+				}
+			}
+			for (unsigned int j = 0; j <= k; j++)
+			{
+				polynomial[j] %= prime;
+			}
+			if ( pivot == n )
+			{
+				/* A^k v depends on the vectors before it, so the polynomial is
+				   monic of degree k and annihilates v. */
+				uint32_t *result = engine->results + (size_t)p * (n + 1);
+				for (unsigned int j = 0; j <= k; j++)
+				{
+					result[j] = polynomial[k - j];
+				}
+				engine->degrees[p] = k;
+				break;
+			}
+			/* Keep the reduced vector, scaled so that its pivot is 1. */
+			uint64_t inverse = CP_powMod(u[pivot], prime - 2, prime);
+			uint32_t *vector = basis + (size_t)numBasis * n;
+			uint32_t *terms = polynomials + (size_t)numBasis * (n + 1);
+			for (unsigned int i = 0; i < n; i++)
+			{
+				vector[i] = u[i] * inverse % prime;
+			}
+			for (unsigned int j = 0; j <= n; j++)
+			{
+				terms[j] = j <= k ? polynomial[j] * inverse % prime : 0;
+			}
+			pivots[numBasis++] = pivot;
+			for (unsigned int i = 0; i < n; i++)
+			{
+				next[i] = CP_dot(&m[(size_t)i * n], krylov, n, prime);
+			}
+			memcpy(krylov, next, sizeof(uint32_t) * n);
+		}
+	}
+	free(basis);
+	free(sums);
+	free(pivots);
+	return NULL;
+}
+
+/**
+@fn CP_combineResidues
+@brief Combines residues modulo several primes by the Chinese remainder
+theorem.
+@param primes The primes.
+@param residues The residue modulo each prime.
+@param numPrimes The number of primes.
+@param modulus Pointer to where the product of the primes will be written.
+@return The integer in [0, modulus) with the given residues.
+*/
+static __int128 CP_combineResidues (const uint32_t *primes,
+	const uint64_t *residues, unsigned int numPrimes, __int128 *modulus)
+{
+	__int128 value = residues[0];
+	*modulus = primes[0];
+	for (unsigned int i = 1; i < numPrimes; i++)
+	{
+		uint64_t prime = primes[i];
+		/* value + modulus * t is congruent to residues[i] modulo prime. */
+		uint64_t difference = (residues[i] + prime - CP_mod(value, prime)) % prime;
+		uint64_t t = difference * CP_powMod(CP_mod(*modulus, prime), prime - 2,
+			prime) % prime;
+		value += *modulus * t;
+		*modulus *= prime;
+	}
+	return value;
+}
+
+/**
+@fn CP_reconstruct
+@brief Finds the fraction num/den congruent to u modulo m with
+|num| < CP_NUMERATOR_BOUND and 0 < den < CP_DENOMINATOR_BOUND.
+@param u The residue, in the range [0, m).
+@param m The modulus.
+@param num Pointer to where the numerator will be written.
+@param den Pointer to where the denominator will be written.
+@return true if such a fraction exists, false otherwise.
+*/
+static bool CP_reconstruct (__int128 u, __int128 m, __int128 *num,
+	__int128 *den)
+{
+	__int128 r0 = m, r1 = u;
+	__int128 t0 = 0, t1 = 1;
+	while ( r1 >= CP_NUMERATOR_BOUND )
+	{
+		__int128 quotient = r0 / r1;
+		__int128 swap = r0 - quotient * r1;
+		r0 = r1;
+		r1 = swap;
+		swap = t0 - quotient * t1;
+		t0 = t1;
+		t1 = swap;
+	}
+	if ( t1 < 0 )
+	{
+		r1 = -r1;
+		t1 = -t1;
+	}
+	if ( t1 == 0 || t1 >= CP_DENOMINATOR_BOUND ||
+		CP_GCD128(r1 < 0 ? -r1 : r1, t1) != 1 )
+	{
+		return false;
+	}
+	*num = r1;
+	*den = t1;
+	return true;
+}
+
+/**
+@fn CP_divideByPower
+@brief Divides an integer by a power of the denominator and reduces the result.
+@param value The integer.
+@param denominator The denominator.
+@param power The power of denominator to divide by.
+@param result Pointer to where the reduced fraction will be written.
+@return An error code. 0 if no problems were encountered. ERR_CHARPOLY_OVERFLOW
+if the fraction does not fit in a Rational.
+*/
+static int CP_divideByPower (__int128 value, int64_t denominator,
+	unsigned int power, Rational *result)
+{
+	/* Dividing out one factor of denominator at a time keeps the fraction
+	   reduced without forming denominator^power. */
+	__int128 bottom = 1;
+	for (unsigned int i = 0; i < power && value != 0 && denominator != 1; i++)
+	{
+		__int128 gcd = CP_GCD128(value < 0 ? -value : value, denominator);
+		value /= gcd;
+		bottom *= denominator / gcd;
+		if ( bottom > INT32_MAX )
+		{
+			return ERR_CHARPOLY_OVERFLOW;
+		}
+	}
+	if ( value == 0 )
+	{
+		bottom = 1;
+	}
+	if ( value > INT32_MAX || value < -INT32_MAX )
+	{
+		return ERR_CHARPOLY_OVERFLOW;
+	}
+	result->top = value;
+	result->bottom = bottom;
+	return 0;
+}
+
+/**
+@fn CP_dividesPower
+@brief Checks whether a positive integer divides a power of the denominator.
+@param value The integer.
+@param denominator The denominator.
+@return true if every prime factor of value divides denominator, false
+otherwise.
+*/
+static bool CP_dividesPower (__int128 value, int64_t denominator)
+{
+	while ( value > 1 )
+	{
+		__int128 gcd = CP_GCD128(value, denominator);
+		if ( gcd == 1 )
+		{
+			return false;
+		}
+		value /= gcd;
+	}
+	return true;
+}
+
+/**
+@fn CP_recover
+@brief Recovers Rationals from their residues modulo CP_NUM_USED_PRIMES primes.
+Value k is an integer of the scaled Matrix which equals the wanted Rational
+times denominator^(firstPower + k).
+@details A value whose bound is below a quarter of the product of the primes is
+recovered exactly by the Chinese remainder theorem. Any other value is first
+divided by its power of the denominator modulo each prime, then reconstructed
+as the smallest fraction congruent to it modulo all but the last prime. The
+fraction is accepted if its bottom divides the power of the denominator and it
+agrees with the residue modulo the last prime.
+@param primes The primes.
+@param residues The residues of the values modulo each prime.
+@param count The number of values.
+@param firstPower The power of the denominator the first value is scaled by.
+@param denominator The denominator the Matrix was scaled by.
+@param bounds A bound on the absolute value of each value.
+@param result The buffer of count Rationals the values are written to.
+@return An error code. 0 if no problems were encountered. ERR_CHARPOLY_OVERFLOW
+if a value does not fit in a Rational.
+*/
+static int CP_recover (const uint32_t *primes, const uint32_t **residues,
+	unsigned int count, unsigned int firstPower, int64_t denominator,
+	const double *bounds, Rational *result)
+{
+	uint64_t inverses[CP_NUM_USED_PRIMES], scales[CP_NUM_USED_PRIMES];
+	double exactLimit = 0.25;
+	for (unsigned int i = 0; i < CP_NUM_USED_PRIMES; i++)
+	{
+		inverses[i] = CP_powMod(denominator % primes[i], primes[i] - 2,
+			primes[i]);
+		scales[i] = CP_powMod(inverses[i], firstPower, primes[i]);
+		exactLimit *= primes[i];
+	}
+	for (unsigned int k = 0; k < count; k++)
+	{
+		uint64_t values[CP_NUM_USED_PRIMES];
+		__int128 modulus;
+		if ( bounds[k] < exactLimit )
+		{
+			for (unsigned int i = 0; i < CP_NUM_USED_PRIMES; i++)
+			{
+				values[i] = residues[i][k];
+			}
+			__int128 value = CP_combineResidues(primes, values,
+				CP_NUM_USED_PRIMES, &modulus);
+			if ( value > modulus / 2 )
+			{
+				value -= modulus;
+			}
+			int error = CP_divideByPower(value, denominator, firstPower + k,
+				&result[k]);
+			if ( error )
+			{
+				return error;
+			}
+		}
+		else
+		{
+			for (unsigned int i = 0; i < CP_NUM_USED_PRIMES; i++)
+			{
+				values[i] = residues[i][k] * scales[i] % primes[i];
+			}
+			__int128 value = CP_combineResidues(primes, values,
+				CP_NUM_USED_PRIMES - 1, &modulus);
+			__int128 num, den;
+			uint32_t check = primes[CP_NUM_USED_PRIMES - 1];
+			if ( !CP_reconstruct(value, modulus, &num, &den) ||
+				!CP_dividesPower(den, denominator) ||
+				CP_mod(num, check) != values[CP_NUM_USED_PRIMES - 1] *
+				(uint64_t)(den % check) % check )
+			{
+				return ERR_CHARPOLY_OVERFLOW;
+			}
+			result[k].top = num;
+			result[k].bottom = den;
+		}
+		for (unsigned int i = 0; i < CP_NUM_USED_PRIMES; i++)
+		{
+			scales[i] = scales[i] * inverses[i] % primes[i];
+		}
+	}
+	return 0;
+}
+
+/**
+@fn CP_coefficientBounds
+@brief Bounds the coefficients of a monic polynomial whose roots are bounded.
+The coefficient of x^(degree - k) is a sum of C(degree, k) products of k roots.
+@param degree The degree of the polynomial.
+@param rootBound A bound on the absolute value of every root.
+@param bounds The buffer of degree + 1 bounds, highest degree first, to write.
+*/
+static void CP_coefficientBounds (unsigned int degree, double rootBound,
+	double *bounds)
+{
+	bounds[0] = 1;
+	for (unsigned int k = 1; k <= degree; k++)
+	{
+		bounds[k] = bounds[k - 1] * (degree - k + 1) / k * rootBound;
+	}
+}
+
+/**
+@fn CP_eigenvalueBound
+@brief Bounds the absolute value of every eigenvalue of a square Matrix. By
+Gershgorin's theorem, applied to the Matrix and to its transpose, no eigenvalue
+exceeds the largest absolute row sum or the largest absolute column sum.
+@param a Pointer to the Matrix.
+@return The smaller of the two sums.
+*/
+double CP_eigenvalueBound (Matrix *a)
+{
+	double rowBound = 0, columnBound = 0;
+	for (unsigned int i = 0; i < a->numRows; i++)
+	{
+		double rowSum = 0, columnSum = 0;
+		for (unsigned int j = 0; j < a->numCols; j++)
+		{
+			Rational row = M_AT(a, i, j), column = M_AT(a, j, i);
+			rowSum += (row.top < 0 ? -(double)row.top : row.top) / row.bottom;
+			columnSum += (column.top < 0 ? -(double)column.top : column.top) /
+				column.bottom;
+		}
+		rowBound = rowSum > rowBound ? rowSum : rowBound;
+		columnBound = columnSum > columnBound ? columnSum : columnBound;
+	}
+	return rowBound < columnBound ? rowBound : columnBound;
+}
+
+/**
+@fn CP_charPolyResidues
+@brief Computes the characteristic polynomial of the scaled Matrix modulo
+CP_NUM_USED_PRIMES primes, into engine->results.
+@param a Pointer to the square Matrix.
+@param numThreads The number of threads to use.
+@param engine Pointer to the CP_Engine to fill in. Its buffers must be freed
+with CP_freeEngine, even on error.
+@param denominator Pointer to where the denominator the Matrix was scaled by
+will be written.
+@return An error code. 0 if no problems were encountered.
+*/
+static int CP_charPolyResidues (Matrix *a, unsigned int numThreads,
+	CP_Engine *engine, int64_t *denominator)
+{
+	int error = CP_prepare(a, CP_NUM_USED_PRIMES, engine, denominator);
+	if ( error )
+	{
+		return error;
+	}
+	unsigned int n = engine->size;
+	size_t numSteps = (size_t)n * (n + 1) / 2;
+	engine->steps = (uint32_t *)malloc(sizeof(uint32_t) * engine->numPrimes *
+		(numSteps ? numSteps : 1));
+	if ( !engine->steps )
+	{
+		return ERR_ALLOCATION_FAILED;
+	}
+	error = CP_run(engine, CP_stepsWorker, engine->numPrimes * n, numThreads);
+	if ( error )
+	{
+		return error;
+	}
+	return CP_run(engine, CP_combineWorker, engine->numPrimes, numThreads);
+}
+
+/**
+@fn CP_charPoly
+@brief Computes the characteristic polynomial det(xI - A) of a square Matrix.
+@details The Berkowitz algorithm takes about n^4 / 4 multiply-adds modulo each
+of CP_NUM_USED_PRIMES primes and uses no division. Each of its n steps is a
+series of products with a leading principal submatrix. Those steps are
+independent, so they are shared out over the threads.
+@param a Pointer to the square Matrix.
+@param numThreads The number of threads to use. 0 or 1 computes on the calling
+thread.
+@param coefficients A buffer of a->numRows + 1 Rationals. coefficients[k] is
+written with the coefficient of x^(n - k), so coefficients[0] is 1.
+@return An error code. 0 if no problems were encountered. ERR_CHARPOLY_OVERFLOW
+if a coefficient does not fit in a Rational.
+*/
+int CP_charPoly (Matrix *a, unsigned int numThreads, Rational *coefficients)
+{
+	CP_Engine engine;
+	int64_t denominator;
+	int error = CP_charPolyResidues(a, numThreads, &engine, &denominator);
+	double *bounds = NULL;
+	if ( !error )
+	{
+		bounds = (double *)malloc(sizeof(double) * (engine.size + 1));
+		error = bounds ? 0 : ERR_ALLOCATION_FAILED;
+	}
+	if ( !error )
+	{
+		/* The coefficients of the scaled Matrix are bounded through its
+		   eigenvalues, which are those of A times the denominator. */
+		unsigned int n = engine.size;
+		CP_coefficientBounds(n, CP_eigenvalueBound(a) * denominator, bounds);
+		const uint32_t *residues[CP_NUM_USED_PRIMES];
+		for (unsigned int i = 0; i < CP_NUM_USED_PRIMES; i++)
+		{
+			residues[i] = engine.results + (size_t)i * (n + 1);
+		}
+		error = CP_recover(engine.primes, residues, n + 1, 0, denominator,
+			bounds, coefficients);
+	}
+	free(bounds);
+	CP_freeEngine(&engine);
+	return error;
+}
+
+/**
+@fn CP_tracePowers
+@brief Computes the traces of the first powers of a square Matrix. They are
+found from the characteristic polynomial by Newton's identities, which use no
+division either, so no power of the Matrix is ever formed.
+@param a Pointer to the square Matrix.
+@param count The number of powers.
+@param numThreads The number of threads to use.
+@param traces A buffer of count Rationals. traces[k] is written with the trace
+of A^(k + 1).
+@return An error code. 0 if no problems were encountered. ERR_CHARPOLY_OVERFLOW
+if a trace does not fit in a Rational.
+*/
+int CP_tracePowers (Matrix *a, unsigned int count, unsigned int numThreads,
+	Rational *traces)
+{
+	CP_Engine engine;
+	int64_t denominator;
+	int error = CP_charPolyResidues(a, numThreads, &engine, &denominator);
+	uint32_t *sums = NULL;
+	double *bounds = NULL;
+	if ( !error )
+	{
+		sums = (uint32_t *)malloc(sizeof(uint32_t) * CP_NUM_USED_PRIMES *
+			(count + 1));
+		bounds = (double *)malloc(sizeof(double) * (count + 1));
+		error = sums && bounds ? 0 : ERR_ALLOCATION_FAILED;
+	}
+	if ( !error )
+	{
+		unsigned int n = engine.size;
+		const uint32_t *residues[CP_NUM_USED_PRIMES];
+		for (unsigned int p = 0; p < CP_NUM_USED_PRIMES; p++)
+		{
+			/* Newton's identities: s_k = -(k c_k + c_1 s_(k-1) + ... +
+			   c_(k-1) s_1), with c_k = 0 past the degree. */
+			uint64_t prime = engine.primes[p];
+			const uint32_t *c = engine.results + (size_t)p * (n + 1);
+			uint32_t *s = sums + (size_t)p * (count + 1);
+			s[0] = n % prime;
+			for (unsigned int k = 1; k <= count; k++)
+			{
+				uint64_t sum = k <= n ? k % prime * c[k] % prime : 0;
+				for (unsigned int i = 1; i < k && i <= n; i++)
+				{
+					sum = (sum + (uint64_t)c[i] * s[k - i]) % prime;
+				}
+				s[k] = sum ? prime - sum : 0;
+			}
+			residues[p] = s + 1;
+		}
+		/* |tr(B^k)| is at most n times the k-th power of the eigenvalue bound. */
+		double rootBound = CP_eigenvalueBound(a) * denominator;
+		bounds[0] = n * rootBound;
+		for (unsigned int k = 1; k < count; k++)
+		{
+			bounds[k] = bounds[k - 1] * rootBound;
+		}
+		error = CP_recover(engine.primes, residues, count, 1, denominator,
+			bounds, traces);
+	}
+	free(sums);
+	free(bounds);
+	CP_freeEngine(&engine);
+	return error;
+}
+
+/**
+@fn CP_minPoly
+@brief Computes the minimal polynomial of a square Matrix.
+@details Modulo each prime, the Krylov sequence v, Av, A^2v, ... of a
+pseudo-random vector v is reduced until it becomes dependent, which gives the
+minimal polynomial of v in about n^3 multiply-adds. Modulo a prime this can
+only fall short of the true minimal polynomial, either because the prime
+divides something it should not or because v was unlucky. So every prime is
+tried, and only the primes that agree on the highest degree are used.
+@param a Pointer to the square Matrix.
+@param numThreads The number of threads to use.
+@param coefficients A buffer of a->numRows + 1 Rationals. coefficients[k] is
+written with the coefficient of x^(degree - k).
+@param degree Pointer to where the degree of the polynomial will be written.
+@return An error code. 0 if no problems were encountered. ERR_CHARPOLY_UNLUCKY
+if too few primes agreed.
+*/
+int CP_minPoly (Matrix *a, unsigned int numThreads, Rational *coefficients,
+	unsigned int *degree)
+{
+	CP_Engine engine;
+	int64_t denominator;
+	int error = CP_prepare(a, CP_NUM_PRIMES, &engine, &denominator);
+	if ( !error )
+	{
+		error = CP_run(&engine, CP_minPolyWorker, engine.numPrimes, numThreads);
+	}
+	double *bounds = NULL;
+	if ( !error )
+	{
+		bounds = (double *)malloc(sizeof(double) * (engine.size + 1));
+		error = bounds ? 0 : ERR_ALLOCATION_FAILED;
+	}
+	if ( !error )
+	{
+		unsigned int maxDegree = 0;
+		for (unsigned int p = 0; p < engine.numPrimes; p++)
+		{
+			if ( engine.degrees[p] > maxDegree )
+			{
+				maxDegree = engine.degrees[p];
+			}
+		}
+		uint32_t primes[CP_NUM_USED_PRIMES];
+		const uint32_t *residues[CP_NUM_USED_PRIMES];
+		unsigned int numAgreeing = 0;
+		for (unsigned int p = 0; p < engine.numPrimes &&
+			numAgreeing < CP_NUM_USED_PRIMES; p++)
+		{
+			if ( engine.degrees[p] == maxDegree )
+			{
+				primes[numAgreeing] = engine.primes[p];
+				residues[numAgreeing++] = engine.results +
+					(size_t)p * (engine.size + 1);
+			}
+		}
+		if ( numAgreeing < CP_NUM_USED_PRIMES )
+		{
+			error = ERR_CHARPOLY_UNLUCKY;
+		}
+		else
+		{
+			/* The minimal polynomial divides the characteristic polynomial, so
+			   its roots obey the same bound. */
+			CP_coefficientBounds(maxDegree, CP_eigenvalueBound(a) * denominator,
+				bounds);
+			error = CP_recover(primes, residues, maxDegree + 1, 0, denominator,
+				bounds, coefficients);
+			*degree = maxDegree;
+		}
+	}
+	free(bounds);
+	CP_freeEngine(&engine);
+	return error;
+}
\ No newline at end of file
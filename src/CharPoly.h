@@ -0,0 +1,99 @@
+/**
+@file CharPoly.h
+@author Rob Thomas
+@brief Contains functions for the characteristic polynomial, the traces of
+powers and the minimal polynomial of a square Matrix. The Matrix is scaled by
+the least common multiple of its bottoms to an integer Matrix, which is reduced
+modulo a few word-sized primes. The characteristic polynomial is computed
+modulo each prime with the division-free Berkowitz algorithm. Its steps are
+independent of each other, so they are spread over threads. The Rational
+coefficients are then recovered from their residues. A bound on the
+eigenvalues bounds every coefficient, which decides whether a coefficient can
+be recovered exactly by the Chinese remainder theorem or must be found by
+rational reconstruction and checked against a spare prime.
+*/
+
+#ifndef CHARPOLY_H
+#define CHARPOLY_H
+
+/*** INCLUDES: ***/
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "Matrix.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define CP_NUM_PRIMES 8
+#define CP_NUM_USED_PRIMES 4
+#define CP_MAX_THREADS 64
+
+#define ERR_CHARPOLY_OVERFLOW -140
+#define ERR_CHARPOLY_UNLUCKY -141
+
+/*** FUNCTION PROTOTYPES: ***/
+
+/**
+@fn CP_eigenvalueBound
+@brief Bounds the absolute value of every eigenvalue of a square Matrix. By
+Gershgorin's theorem, applied to the Matrix and to its transpose, no eigenvalue
+exceeds the largest absolute row sum or the largest absolute column sum.
+@param a Pointer to the Matrix.
+@return The smaller of the two sums.
+*/
+double CP_eigenvalueBound (Matrix *a);
+
+/**
+@fn CP_charPoly
+@brief Computes the characteristic polynomial det(xI - A) of a square Matrix.
+@details The Berkowitz algorithm takes about n^4 / 4 multiply-adds modulo each
+of CP_NUM_USED_PRIMES primes and uses no division. Each of its n steps is a
+series of products with a leading principal submatrix. Those steps are
+independent, so they are shared out over the threads.
+@param a Pointer to the square Matrix.
+@param numThreads The number of threads to use. 0 or 1 computes on the calling
+thread.
+@param coefficients A buffer of a->numRows + 1 Rationals. coefficients[k] is
+written with the coefficient of x^(n - k), so coefficients[0] is 1.
+@return An error code. 0 if no problems were encountered. ERR_CHARPOLY_OVERFLOW
+if a coefficient does not fit in a Rational.
+*/
+int CP_charPoly (Matrix *a, unsigned int numThreads, Rational *coefficients);
+
+/**
+@fn CP_tracePowers
+@brief Computes the traces of the first powers of a square Matrix. They are
+found from the characteristic polynomial by Newton's identities, which use no
+division either, so no power of the Matrix is ever formed.
+@param a Pointer to the square Matrix.
+@param count The number of powers.
+@param numThreads The number of threads to use.
+@param traces A buffer of count Rationals. traces[k] is written with the trace
+of A^(k + 1).
+@return An error code. 0 if no problems were encountered. ERR_CHARPOLY_OVERFLOW
+if a trace does not fit in a Rational.
+*/
+int CP_tracePowers (Matrix *a, unsigned int count, unsigned int numThreads,
+	Rational *traces);
+
+/**
+@fn CP_minPoly
+@brief Computes the minimal polynomial of a square Matrix.
+@details Modulo each prime, the Krylov sequence v, Av, A^2v, ... of a
+pseudo-random vector v is reduced until it becomes dependent, which gives the
+minimal polynomial of v in about n^3 multiply-adds. Modulo a prime this can
+only fall short of the true minimal polynomial, either because the prime
+divides something it should not or because v was unlucky. So every prime is
+tried, and only the primes that agree on the highest degree are used.
+@param a Pointer to the square Matrix.
+@param numThreads The number of threads to use.
+@param coefficients A buffer of a->numRows + 1 Rationals. coefficients[k] is
+written with the coefficient of x^(degree - k).
+@param degree Pointer to where the degree of the polynomial will be written.
+@return An error code. 0 if no problems were encountered. ERR_CHARPOLY_UNLUCKY
+if too few primes agreed.
+*/
+int CP_minPoly (Matrix *a, unsigned int numThreads, Rational *coefficients,
+	unsigned int *degree);
+
+#endif /* CHARPOLY_H */
\ No newline at end of file
@@ -0,0 +1,461 @@
+/**
+@file ConcurrentTable.c
+@author Rob Thomas
+@brief Contains functions for a variable table which can be shared by many
+shell sessions running on different threads. Reads take no locks: a reader
+only announces the epoch it is reading in, and nodes removed by writers are not
+freed until every reader that could still see them has finished (epoch-based
+reclamation). Writers lock one of a fixed number of stripes, so writes to
+different buckets proceed in parallel.
+*/
+
+/*** INCLUDES: ***/
+#include <string.h>
+
+#include "ConcurrentTable.h"
+
+/*** DEFINES: ***/
+#define CT_STATE_ACTIVE 1
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn CT_freeNode
+@brief Frees a node along with its key and value, releasing what the value owns
+unless the node replacing it took it over.
+@param node Pointer to the node to be freed.
+*/
+static void CT_freeNode (CT_Node *node)
+{
+	free(node->key);
+	if ( !node->isValueKept )
+	{
+		HT_releaseValue(node->value, node->valueType);
+	}
+	free(node->value);
+	free(node);
+}
+
+/**
+@fn CT_newNode
+@brief Allocates a node holding copies of a key and value.
+@param key The key. Must be null-terminated.
+@param hash The hash value of the key.
+@param value Pointer to the value.
+@param valueType The type of the value.
+@return A pointer to the new node, or NULL if allocation failed.
+*/
+static CT_Node *CT_newNode (char *key, unsigned int hash, void *value,
+	value_t valueType)
+{
+	CT_Node *node = (CT_Node *)malloc(sizeof(CT_Node));
+	if ( !node )
+	{
+		return NULL;
+	}
+	node->key = HT_copyString(key);
+	node->value = HT_copyValue(value, HT_typeSize(valueType));
+	if ( !node->key || !node->value )
+	{
+		free(node->key);
+		free(node->value);
+		free(node);
+		return NULL;
+	}
+	node->hash = hash;
+	node->valueType = valueType;
+	atomic_init(&node->next, NULL);
+	node->retireEpoch = 0;
+	node->nextRetired = NULL;
+	node->isValueKept = false;
+	return node;
+}
+
+/**
+@fn CT_tryAdvanceEpoch
+@brief Advances the global epoch if every reader currently inside a read
+section announced the current epoch. Must be called with retireLock held.
+@param table Pointer to the ConcurrentTable.
+*/
+static void CT_tryAdvanceEpoch (ConcurrentTable *table)
+{
+	uint64_t epoch = atomic_load(&table->globalEpoch);
+	for (int i = 0; i < CT_MAX_READERS; i++)
+	{
+		uint64_t state = atomic_load(&table->readers[i].state);
+		if ( (state & CT_STATE_ACTIVE) && (state >> 1) != epoch )
+		{
+			return;
+		}
+	}
+	atomic_compare_exchange_strong(&table->globalEpoch, &epoch, epoch + 1);
+}
+
+/**
+@fn CT_reclaim
+@brief Frees every retired node that no reader can still be looking at. A node
+retired in epoch e is safe once the global epoch reaches e + 2, since every
+read section that started before it was unlinked has ended by then. Must be
+called with retireLock held.
+@param table Pointer to the ConcurrentTable.
+*/
+static void CT_reclaim (ConcurrentTable *table)
+{
+	CT_tryAdvanceEpoch(table);
+	uint64_t epoch = atomic_load(&table->globalEpoch);
+	CT_Node **link = &table->retired;
+	while ( *link )
+	{
+		CT_Node *node = *link;
+		if ( node->retireEpoch + 2 <= epoch )
+		{
+			*link = node->nextRetired;
+			CT_freeNode(node);
+			table->numRetired--;
+		}
+		else
+		{
+			link = &node->nextRetired;
+		}
+	}
+}
+
+/**
+@fn CT_retire
+@brief Queues a node which has been unlinked from its bucket to be freed once
+no reader can still see it.
+@param table Pointer to the ConcurrentTable.
+@param node Pointer to the unlinked node.
+*/
+static void CT_retire (ConcurrentTable *table, CT_Node *node)
+{
+	/* The unlink must be visible before the epoch it is tagged with is read. */
+	atomic_thread_fence(memory_order_seq_cst);
+	pthread_mutex_lock(&table->retireLock);
+	node->retireEpoch = atomic_load(&table->globalEpoch);
+	node->nextRetired = table->retired;
+	table->retired = node;
+	table->numRetired++;
+	if ( table->numRetired % CT_RECLAIM_INTERVAL == 0 )
+	{
+		CT_reclaim(table);
+	}
+	pthread_mutex_unlock(&table->retireLock);
+}
+
+/**
+@fn CT_new
+@brief Generates a newly allocated, empty ConcurrentTable.
+@param numBuckets The minimum number of buckets. Rounded up to a power of two.
+@return A pointer to the new ConcurrentTable, or NULL if allocation failed.
+*/
+ConcurrentTable *CT_new (unsigned int numBuckets)
+{
+	size_t size = (sizeof(ConcurrentTable) + CT_CACHE_LINE - 1) /
+		CT_CACHE_LINE * CT_CACHE_LINE;
+	ConcurrentTable *table = (ConcurrentTable *)aligned_alloc(CT_CACHE_LINE, size);
+	if ( !table )
+	{
+		return NULL;
+	}
+	/* Round the number of buckets up to a power of two so that a mask can be
+	   used in place of a modulo. */
+	unsigned int rounded = 1;
+	while ( rounded < numBuckets )
+	{
+		rounded <<= 1;
+	}
+	table->numBuckets = rounded;
+	table->buckets = (_Atomic(CT_Node *) *)malloc(sizeof(*table->buckets) * rounded);
+	if ( !table->buckets )
+	{
+		free(table);
+		return NULL;
+	}
+	for (unsigned int i = 0; i < rounded; i++)
+	{
+		atomic_init(&table->buckets[i], NULL);
+	}
+	for (int i = 0; i < CT_NUM_STRIPES; i++)
+	{
+		pthread_mutex_init(&table->stripeLocks[i], NULL);
+	}
+	atomic_init(&table->numItems, 0);
+	atomic_init(&table->globalEpoch, 1);
+	for (int i = 0; i < CT_MAX_READERS; i++)
+	{
+		atomic_init(&table->readers[i].state, 0);
+		atomic_init(&table->readers[i].isRegistered, false);
+	}
+	pthread_mutex_init(&table->retireLock, NULL);
+	table->retired = NULL;
+	table->numRetired = 0;
+	return table;
+}
+
+/**
+@fn CT_free
+@brief Frees a ConcurrentTable along with every key and value in it.
+NOTE: no other thread may be using the table.
+@param table Pointer to the ConcurrentTable to be freed.
+*/
+void CT_free (ConcurrentTable *table)
+{
+	if ( !table )
+	{
+		return;
+	}
+	for (unsigned int i = 0; i < table->numBuckets; i++)
+	{
+		CT_Node *node = atomic_load(&table->buckets[i]);
+		while ( node )
+		{
+			CT_Node *next = atomic_load(&node->next);
+			CT_freeNode(node);
+			node = next;
+		}
+	}
+	while ( table->retired )
+	{
+		CT_Node *next = table->retired->nextRetired;
+		CT_freeNode(table->retired);
+		table->retired = next;
+	}
+	for (int i = 0; i < CT_NUM_STRIPES; i++)
+	{
+		pthread_mutex_destroy(&table->stripeLocks[i]);
+	}
+	pthread_mutex_destroy(&table->retireLock);
+	free(table->buckets);
+	free(table);
+}
+
+/**
+@fn CT_registerReader
+@brief Claims a reader slot for the calling thread. Each thread that reads the
+table needs its own slot.
+@param table Pointer to the ConcurrentTable.
+@return The slot's index, or FAIL_TOO_MANY_READERS if every slot is taken.
+*/
+int CT_registerReader (ConcurrentTable *table)
+{
+	for (int i = 0; i < CT_MAX_READERS; i++)
+	{
+		bool expected = false;
+		if ( atomic_compare_exchange_strong(&table->readers[i].isRegistered,
+			&expected, true) )
+		{
+			atomic_store(&table->readers[i].state, 0);
+			return i;
+		}
+	}
+	return FAIL_TOO_MANY_READERS;
+}
+
+/**
+@fn CT_unregisterReader
+@brief Releases a reader slot claimed by CT_registerReader.
+@param table Pointer to the ConcurrentTable.
+@param reader The slot's index.
+*/
+void CT_unregisterReader (ConcurrentTable *table, int reader)
+{
+	atomic_store(&table->readers[reader].state, 0);
+	atomic_store(&table->readers[reader].isRegistered, false);
+}
+
+/**
+@fn CT_readBegin
+@brief Starts a read section. Values found with CT_find stay valid until the
+matching CT_readEnd.
+@param table Pointer to the ConcurrentTable.
+@param reader The calling thread's slot index.
+*/
+void CT_readBegin (ConcurrentTable *table, int reader)
+{
+	uint64_t epoch = atomic_load_explicit(&table->globalEpoch,
+		memory_order_relaxed);
+	atomic_store_explicit(&table->readers[reader].state,
+		(epoch << 1) | CT_STATE_ACTIVE, memory_order_relaxed);
+	/* The announcement must be visible to writers before any node is read. */
+	atomic_thread_fence(memory_order_seq_cst);
+}
+
+/**
+@fn CT_readEnd
+@brief Ends a read section started with CT_readBegin.
+@param table Pointer to the ConcurrentTable.
+@param reader The calling thread's slot index.
+*/
+void CT_readEnd (ConcurrentTable *table, int reader)
+{
+	atomic_store_explicit(&table->readers[reader].state, 0, memory_order_release);
+}
+
+/**
+@fn CT_find
+@brief Finds the value associated with a key without taking any locks. Must be
+called inside a read section.
+@param table Pointer to the ConcurrentTable to search.
+@param key The key to find. Must be null-terminated.
+@param valueType Pointer to a value_t which the value's type will be written to.
+May be NULL.
+@return A pointer to the value, valid until the read section ends, or NULL if
+the key is not present.
+*/
+void *CT_find (ConcurrentTable *table, char *key, value_t *valueType)
+{
+	unsigned int hash = HT_hashValue(key);
+	CT_Node *node = atomic_load_explicit(
+		&table->buckets[hash & (table->numBuckets - 1)], memory_order_acquire);
+	while ( node )
+	{
+		if ( node->hash == hash && !strcmp(node->key, key) )
+		{
+			if ( valueType )
+			{
+				*valueType = node->valueType;
+			}
+			return node->value;
+		}
+		node = atomic_load_explicit(&node->next, memory_order_acquire);
+	}
+	return NULL;
+}
+
+/**
+@fn CT_get
+@brief Copies the value associated with a key out of the table, wrapping the
+lookup in its own read section. A Matrix is copied along with its elements,
+since the table's buffer may be released as soon as the read section ends. The
+copy's buffer comes from the buffer pool and belongs to the caller.
+@param table Pointer to the ConcurrentTable to search.
+@param reader The calling thread's slot index.
+@param key The key to find. Must be null-terminated.
+@param dest Pointer to a block of HT_typeSize(type) bytes the value is copied to.
+@param valueType Pointer to a value_t which the value's type will be written to.
+May be NULL.
+@return true if the key was found and copied, false otherwise.
+*/
+bool CT_get (ConcurrentTable *table, int reader, char *key, void *dest,
+	value_t *valueType)
+{
+	value_t type;
+	CT_readBegin(table, reader);
+	void *value = CT_find(table, key, &type);
+	if ( value && type == VT_MATRIX )
+	{
+		Matrix *copy = M_copy((Matrix *)value);
+		if ( copy )
+		{
+			*(Matrix *)dest = *copy;
+			free(copy);
+		}
+		else
+		{
+			value = NULL;
+		}
+	}
+	else if ( value )
+	{
+		memcpy(dest, value, HT_typeSize(type));
+	}
+	if ( value && valueType )
+	{
+		*valueType = type;
+	}
+	CT_readEnd(table, reader);
+	return value != NULL;
+}
+
+/**
+@fn CT_put
+@brief Adds a key/value pair, or replaces the value if the key is present.
+Readers which already found the old value keep seeing it until their read
+section ends. As with HT_add, the value struct is copied and a Matrix's element
+buffer or a TiledMatrix's file becomes owned by the table, which releases it
+once the value has been replaced or removed and no reader can still see it.
+@param table Pointer to the ConcurrentTable.
+@param key The key. Must be null-terminated.
+@param value Pointer to the value, which is copied.
+@param valueType The type of the value.
+@return An error code. 0 if no problems were encountered.
+*/
+int CT_put (ConcurrentTable *table, char *key, void *value, value_t valueType)
+{
+	unsigned int hash = HT_hashValue(key);
+	unsigned int bucket = hash & (table->numBuckets - 1);
+	/* Build the new node before taking the lock. */
+	CT_Node *node = CT_newNode(key, hash, value, valueType);
+	if ( !node )
+	{
+		return ERR_ALLOCATION_FAILED;
+	}
+	pthread_mutex_t *lock = &table->stripeLocks[bucket % CT_NUM_STRIPES];
+	pthread_mutex_lock(lock);
+	/* If the key is present, splice the new node in where the old one was.
+	   Readers see either the whole old node or the whole new one. */
+	_Atomic(CT_Node *) *link = &table->buckets[bucket];
+	CT_Node *current = atomic_load_explicit(link, memory_order_relaxed);
+	while ( current )
+	{
+		if ( current->hash == hash && !strcmp(current->key, key) )
+		{
+			atomic_store_explicit(&node->next,
+				atomic_load_explicit(&current->next, memory_order_relaxed),
+				memory_order_relaxed);
+			atomic_store_explicit(link, node, memory_order_release);
+			current->isValueKept = HT_sharesValue(current->value,
+				current->valueType, node->value, node->valueType);
+			pthread_mutex_unlock(lock);
+			CT_retire(table, current);
+			return 0;
+		}
+		link = &current->next;
+		current = atomic_load_explicit(link, memory_order_relaxed);
+	}
+	/* Otherwise, publish the new node at the head of its bucket. */
+	atomic_store_explicit(&node->next,
+		atomic_load_explicit(&table->buckets[bucket], memory_order_relaxed),
+		memory_order_relaxed);
+	atomic_store_explicit(&table->buckets[bucket], node, memory_order_release);
+	atomic_fetch_add(&table->numItems, 1);
+	pthread_mutex_unlock(lock);
+	return 0;
+}
+
+/**
+@fn CT_remove
+@brief Removes a key/value pair from the table.
+@param table Pointer to the ConcurrentTable.
+@param key The key to remove. Must be null-terminated.
+@return An error code. 0 if the key was removed.
+*/
+int CT_remove (ConcurrentTable *table, char *key)
+{
+	unsigned int hash = HT_hashValue(key);
+	unsigned int bucket = hash & (table->numBuckets - 1);
+	pthread_mutex_t *lock = &table->stripeLocks[bucket % CT_NUM_STRIPES];
+	pthread_mutex_lock(lock);
+	_Atomic(CT_Node *) *link = &table->buckets[bucket];
+	CT_Node *current = atomic_load_explicit(link, memory_order_relaxed);
+	while ( current )
+	{
+		if ( current->hash == hash && !strcmp(current->key, key) )
+		{
+			/* Readers already on the removed node can still follow its next
+			   pointer, which is left intact. */
+			atomic_store_explicit(link,
+				atomic_load_explicit(&current->next, memory_order_relaxed),
+				memory_order_release);
+			atomic_fetch_sub(&table->numItems, 1);
+			pthread_mutex_unlock(lock);
+			CT_retire(table, current);
+			return 0;
+		}
+		link = &current->next;
+		current = atomic_load_explicit(link, memory_order_relaxed);
+	}
+	pthread_mutex_unlock(lock);
+	return FAIL_KEY_NOT_FOUND;
+}
\ No newline at end of file
@@ -0,0 +1,212 @@
+/**
+@file ConcurrentTable.h
+@author Rob Thomas
+@brief Contains the ConcurrentTable struct and functions for a variable table
+which can be shared by many shell sessions running on different threads. Reads
+take no locks: a reader only announces the epoch it is reading in, and nodes
+removed by writers are not freed until every reader that could still see them
+has finished (epoch-based reclamation). Writers lock one of a fixed number of
+stripes, so writes to different buckets proceed in parallel.
+*/
+
+#ifndef CONCURRENTTABLE_H
+#define CONCURRENTTABLE_H
+
+/*** INCLUDES: ***/
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "HashTable.h"
+#include "Matrix.h"
+
+/*** DEFINES: ***/
+#define CT_NUM_STRIPES 64
+#define CT_MAX_READERS 128
+#define CT_RECLAIM_INTERVAL 64
+#define CT_CACHE_LINE 64
+
+#define FAIL_TOO_MANY_READERS -60
+
+/*** STRUCTS: ***/
+
+/**
+@def CT_Node
+@brief A struct representing one key/value pair in a ConcurrentTable. Once a
+node is reachable by readers its key and value never change; replacing a value
+swaps in a new node. A node owns its value's Matrix element buffer or
+TiledMatrix file, which is released when the node is freed (see
+HT_releaseValue).
+@var key The node's key.
+@var hash The hash value of the key.
+@var valueType The type of the value. See definition of value_t.
+@var value The node's value.
+@var next The next node in the same bucket.
+@var retireEpoch The epoch in which the node was unlinked from its bucket.
+@var nextRetired The next node waiting to be freed.
+@var isValueKept Whether the node replacing this one took over its value's
+element buffer or file, which must then not be released with this node.
+*/
+typedef struct CT_Node
+{
+	char *key;
+	unsigned int hash;
+	value_t valueType;
+	void *value;
+	_Atomic(struct CT_Node *) next;
+	uint64_t retireEpoch;
+	struct CT_Node *nextRetired;
+	bool isValueKept;
+} CT_Node;
+
+/**
+@def CT_ReaderSlot
+@brief A struct representing the epoch announcement of one registered reader,
+padded to a cache line so that readers never share a line.
+@var state The announced epoch shifted left by one, with the low bit set while
+the reader is inside a read section. 0 if the slot is unused.
+@var isRegistered Whether the slot belongs to a registered reader.
+*/
+typedef struct
+{
+	_Atomic uint64_t state;
+	atomic_bool isRegistered;
+	char padding[CT_CACHE_LINE - sizeof(uint64_t) - sizeof(atomic_bool)];
+} CT_ReaderSlot;
+
+/**
+@def ConcurrentTable
+@brief A struct representing a concurrent hash table of variables.
+@var buckets The chains of nodes, indexed by hash.
+@var numBuckets The number of buckets. Always a power of two.
+@var stripeLocks The locks writers take. Bucket i is guarded by lock
+i % CT_NUM_STRIPES.
+@var numItems The number of key/value pairs in the table.
+@var globalEpoch The current epoch.
+@var readers The announcement slots of registered readers.
+@var retireLock Guards the list of retired nodes.
+@var retired The nodes which have been unlinked but not yet freed.
+@var numRetired The number of nodes in retired.
+*/
+typedef struct
+{
+	_Atomic(CT_Node *) *buckets;
+	unsigned int numBuckets;
+	pthread_mutex_t stripeLocks[CT_NUM_STRIPES];
+	atomic_uint numItems;
+	_Alignas(CT_CACHE_LINE) _Atomic uint64_t globalEpoch;
+	_Alignas(CT_CACHE_LINE) CT_ReaderSlot readers[CT_MAX_READERS];
+	pthread_mutex_t retireLock;
+	CT_Node *retired;
+	unsigned int numRetired;
+} ConcurrentTable;
+
+/*** FUNCTION PROTOTYPES: ***/
+
+/**
+@fn CT_new
+@brief Generates a newly allocated, empty ConcurrentTable.
+@param numBuckets The minimum number of buckets. Rounded up to a power of two.
+@return A pointer to the new ConcurrentTable, or NULL if allocation failed.
+*/
+ConcurrentTable *CT_new (unsigned int numBuckets);
+
+/**
+@fn CT_free
+@brief Frees a ConcurrentTable along with every key and value in it.
+NOTE: no other thread may be using the table.
+@param table Pointer to the ConcurrentTable to be freed.
+*/
+void CT_free (ConcurrentTable *table);
+
+/**
+@fn CT_registerReader
+@brief Claims a reader slot for the calling thread. Each thread that reads the
+table needs its own slot.
+@param table Pointer to the ConcurrentTable.
+@return The slot's index, or FAIL_TOO_MANY_READERS if every slot is taken.
+*/
+int CT_registerReader (ConcurrentTable *table);
+
+/**
+@fn CT_unregisterReader
+@brief Releases a reader slot claimed by CT_registerReader.
+@param table Pointer to the ConcurrentTable.
+@param reader The slot's index.
+*/
+void CT_unregisterReader (ConcurrentTable *table, int reader);
+
+/**
+@fn CT_readBegin
+@brief Starts a read section. Values found with CT_find stay valid until the
+matching CT_readEnd.
+@param table Pointer to the ConcurrentTable.
+@param reader The calling thread's slot index.
+*/
+void CT_readBegin (ConcurrentTable *table, int reader);
+
+/**
+@fn CT_readEnd
+@brief Ends a read section started with CT_readBegin.
+@param table Pointer to the ConcurrentTable.
+@param reader The calling thread's slot index.
+*/
+void CT_readEnd (ConcurrentTable *table, int reader);
+
+/**
+@fn CT_find
+@brief Finds the value associated with a key without taking any locks. Must be
+called inside a read section.
+@param table Pointer to the ConcurrentTable to search.
+@param key The key to find. Must be null-terminated.
+@param valueType Pointer to a value_t which the value's type will be written to.
+May be NULL.
+@return A pointer to the value, valid until the read section ends, or NULL if
+the key is not present.
+*/
+void *CT_find (ConcurrentTable *table, char *key, value_t *valueType);
+
+/**
+@fn CT_get
+@brief Copies the value associated with a key out of the table, wrapping the
+lookup in its own read section. A Matrix is copied along with its elements,
+since the table's buffer may be released as soon as the read section ends. The
+copy's buffer comes from the buffer pool and belongs to the caller.
+@param table Pointer to the ConcurrentTable to search.
+@param reader The calling thread's slot index.
+@param key The key to find. Must be null-terminated.
+@param dest Pointer to a block of HT_typeSize(type) bytes the value is copied to.
+@param valueType Pointer to a value_t which the value's type will be written to.
+May be NULL.
+@return true if the key was found and copied, false otherwise.
+*/
+bool CT_get (ConcurrentTable *table, int reader, char *key, void *dest,
+	value_t *valueType);
+
+/**
+@fn CT_put
+@brief Adds a key/value pair, or replaces the value if the key is present.
+Readers which already found the old value keep seeing it until their read
+section ends. As with HT_add, the value struct is copied and a Matrix's element
+buffer or a TiledMatrix's file becomes owned by the table, which releases it
+once the value has been replaced or removed and no reader can still see it.
+@param table Pointer to the ConcurrentTable.
+@param key The key. Must be null-terminated.
+@param value Pointer to the value, which is copied.
+@param valueType The type of the value.
+@return An error code. 0 if no problems were encountered.
+*/
+int CT_put (ConcurrentTable *table, char *key, void *value, value_t valueType);
+
+/**
+@fn CT_remove
+@brief Removes a key/value pair from the table.
+@param table Pointer to the ConcurrentTable.
+@param key The key to remove. Must be null-terminated.
+@return An error code. 0 if the key was removed.
+*/
+int CT_remove (ConcurrentTable *table, char *key);
+
+#endif /* CONCURRENTTABLE_H */
\ No newline at end of file
@@ -0,0 +1,505 @@
+/**
+@file DenomMatrix.c
+@author Rob Thomas
+@brief Contains functions for matrices whose rows each keep a single shared
+denominator over 64-bit integer numerators. Row operations work on the
+numerators directly, and a row is normalized with one GCD across the whole row
+rather than one per element. Elements are read and written as Rationals, so a
+DenomMatrix can be converted to and from a Matrix.
+*/
+
+/*** INCLUDES: ***/
+#include <string.h>
+
+#include "DenomMatrix.h"
+#include "BufferPool.h"
+
+/*** DEFINES: ***/
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn DM_abs
+@brief Returns the magnitude of a 64-bit integer, which is representable even
+for INT64_MIN.
+@param x The integer.
+@return The magnitude of x.
+*/
+static inline uint64_t DM_abs (int64_t x)
+{
+	return x < 0 ? -(uint64_t)x : (uint64_t)x;
+}
+
+/**
+@fn DM_GCD
+@brief Determines the greatest common denominator between two integers using
+the binary GCD algorithm.
+@param a One of the two integers whose GCD will be found.
+@param b One of the two integers whose GCD will be found.
+@return The GCD of a and b, or the other input if either is 0.
+*/
+static uint64_t DM_GCD (uint64_t a, uint64_t b)
+{
+	if ( a == 0 || b == 0 )
+	{
+		return a | b;
+	}
+	int shift = __builtin_ctzll(a | b);
+	a >>= __builtin_ctzll(a);
+	do
+	{
+		b >>= __builtin_ctzll(b);
+		if ( a > b )
+		{
+			uint64_t swap = a;
+			a = b;
+			b = swap;
+		}
+		b -= a;
+	} while ( b != 0 );
+	return a << shift;
+}
+
+/**
+@fn DM_maxMagnitude
+@brief Finds the largest magnitude among a row of numerators. The loop has no
+branches, so it vectorizes.
+@param numerators Pointer to the first numerator of the row.
+@param count The number of numerators in the row.
+@return The largest magnitude.
+*/
+static uint64_t DM_maxMagnitude (const int64_t *numerators, unsigned int count)
+{
+	uint64_t max = 0;
+	for (unsigned int j = 0; j < count; j++)
+	{
+		uint64_t magnitude = DM_abs(numerators[j]);
+		max = magnitude > max ? magnitude : max;
+	}
+	return max;
+}
+
+/**
+@fn DM_new
+@brief Allocates a new DenomMatrix with every element equal to 0.
+@param numRows The number of rows in the new DenomMatrix.
+@param numCols The number of columns in the new DenomMatrix.
+@return A pointer to a dynamically allocated DenomMatrix, or NULL if
+allocation failed.
+*/
+DenomMatrix *DM_new (unsigned int numRows, unsigned int numCols)
+{
+	DenomMatrix *dm = (DenomMatrix *)malloc(sizeof(DenomMatrix));
+	if ( !dm )
+	{
+		return NULL;
+	}
+	dm->numRows = numRows;
+	dm->numCols = numCols;
+	size_t numElements = (size_t)numRows * numCols;
+	dm->numerators = (int64_t *)BP_alloc(sizeof(int64_t) *
+		(numElements ? numElements : 1));
+	dm->denominators = (int64_t *)BP_alloc(sizeof(int64_t) *
+		(numRows ? numRows : 1));
+	if ( !dm->numerators || !dm->denominators )
+	{
+		DM_free(dm);
+		return NULL;
+	}
+	memset(dm->numerators, 0, sizeof(int64_t) * numElements);
+	for (unsigned int i = 0; i < numRows; i++)
+	{
+		dm->denominators[i] = 1;
+	}
+	return dm;
+}
+
+/**
+@fn DM_free
+@brief Frees a dynamically allocated DenomMatrix along with its buffers.
+@param dm Pointer to the DenomMatrix to be freed.
+*/
+void DM_free (DenomMatrix *dm)
+{
+	if ( !dm )
+	{
+		return;
+	}
+	BP_release(dm->numerators);
+	BP_release(dm->denominators);
+	free(dm);
+}
+
+/**
+@fn DM_fromMatrix
+@brief Creates a DenomMatrix equal to a Matrix. Each row's denominator is the
+least common multiple of the bottoms in that row.
+@param m Pointer to the Matrix to convert.
+@param result Pointer to a DenomMatrix pointer which will be set to the newly
+allocated DenomMatrix.
+@return An error code. 0 if no problems were encountered.
+*/
+int DM_fromMatrix (Matrix *m, DenomMatrix **result)
+{
+	DenomMatrix *dm = DM_new(m->numRows, m->numCols);
+	if ( !dm )
+	{
+		return ERR_ALLOCATION_FAILED;
+	}
+	for (unsigned int i = 0; i < m->numRows; i++)
+	{
+		Rational *row = &M_AT(m, i, 0);
+		int64_t *numerators = &DM_NUMERATOR(dm, i, 0);
+		/* An integer matrix needs no common denominator. */
+		int64_t denominator = 1;
+		if ( !m->isInteger )
+		{
+			for (unsigned int j = 0; j < m->numCols; j++)
+			{
+				int64_t bottom = row[j].bottom < 0 ? -(int64_t)row[j].bottom :
+					row[j].bottom;
+				if ( bottom == 0 )
+				{
+					DM_free(dm);
+					return ERR_DENOM_ZERO;
+				}
+				if ( denominator % bottom == 0 )
+				{
+					continue;
+				}
+				int64_t multiple = bottom / DM_GCD(denominator, bottom);
+				if ( __builtin_mul_overflow(denominator, multiple, &denominator) )
+				{
+					DM_free(dm);
+					return ERR_DENOM_OVERFLOW;
+				}
+			}
+		}
+		/* Scale each top up to the common denominator. Since the denominator
+		   is a multiple of each bottom, top * (denominator / bottom) cannot
+		   exceed the denominator times the top's magnitude. */
+		for (unsigned int j = 0; j < m->numCols; j++)
+		{
+			int64_t top = row[j].bottom < 0 ? -(int64_t)row[j].top : row[j].top;
+			int64_t bottom = row[j].bottom < 0 ? -(int64_t)row[j].bottom :
+				row[j].bottom;
+			if ( __builtin_mul_overflow(top, denominator / bottom, &numerators[j]) )
+			{
+				DM_free(dm);
+				return ERR_DENOM_OVERFLOW;
+			}
+		}
+		dm->denominators[i] = denominator;
+		DM_normalizeRow(dm, i);
+	}
+	*result = dm;
+	return 0;
+}
+
+/**
+@fn DM_toRational
+@brief Reduces a 64-bit fraction and narrows it to a Rational.
+@param numerator The numerator of the fraction.
+@param denominator The positive denominator of the fraction.
+@param r Pointer to the Rational which will hold the result.
+@return An error code. 0 if no problems were encountered. ERR_DENOM_OVERFLOW
+if the reduced fraction does not fit in a Rational, in which case r is left
+unchanged.
+*/
+static int DM_toRational (int64_t numerator, int64_t denominator, Rational *r)
+{
+	int64_t divisor = (int64_t)DM_GCD(DM_abs(numerator), (uint64_t)denominator);
+	numerator /= divisor;
+	denominator /= divisor;
+	if ( numerator < INT32_MIN || numerator > INT32_MAX ||
+		denominator > INT32_MAX )
+	{
+		return ERR_DENOM_OVERFLOW;
+	}
+	r->top = (int32_t)numerator;
+	r->bottom = (int32_t)denominator;
+	return 0;
+}
+
+/**
+@fn DM_toMatrix
+@brief Writes the elements of a DenomMatrix into a Matrix of the same
+dimensions as reduced Rationals, and rehashes the Matrix.
+@param dm Pointer to the DenomMatrix to convert.
+@param m Pointer to the Matrix which will hold the result.
+@return An error code. 0 if no problems were encountered. ERR_DENOM_OVERFLOW
+if an element does not fit in a Rational, in which case the contents of m are
+unspecified.
+*/
+int DM_toMatrix (DenomMatrix *dm, Matrix *m)
+{
+	if ( dm->numRows != m->numRows || dm->numCols != m->numCols )
+	{
+		return ERR_DIMENSION_MISMATCH;
+	}
+	for (unsigned int i = 0; i < dm->numRows; i++)
+	{
+		int64_t *numerators = &DM_NUMERATOR(dm, i, 0);
+		Rational *row = &M_AT(m, i, 0);
+		int64_t denominator = dm->denominators[i];
+		/* Rows with a denominator of 1 hold integers, which need no GCD. Any
+		   numerator too large for a Rational is noted without branching. */
+		if ( denominator == 1 )
+		{
+			bool isNarrowed = false;
+			for (unsigned int j = 0; j < dm->numCols; j++)
+			{
+				row[j].top = (int32_t)numerators[j];
+				row[j].bottom = 1;
+				isNarrowed |= row[j].top != numerators[j];
+			}
+			if ( isNarrowed )
+			{
+				return ERR_DENOM_OVERFLOW;
+			}
+			continue;
+		}
+		for (unsigned int j = 0; j < dm->numCols; j++)
+		{
+			if ( DM_toRational(numerators[j], denominator, &row[j]) )
+			{
+				return ERR_DENOM_OVERFLOW;
+			}
+		}
+	}
+	M_rehash(m);
+	return 0;
+}
+
+/**
+@fn DM_get
+@brief Reads one element of a DenomMatrix as a reduced Rational.
+@param dm Pointer to the DenomMatrix.
+@param row The row (0-indexed) of the element.
+@param col The column (0-indexed) of the element.
+@param value Pointer to the Rational which will hold the element.
+@return An error code. 0 if no problems were encountered. ERR_DENOM_OVERFLOW
+if the element does not fit in a Rational, in which case value is left
+unchanged.
+*/
+int DM_get (DenomMatrix *dm, unsigned int row, unsigned int col,
+	Rational *value)
+{
+	return DM_toRational(DM_NUMERATOR(dm, row, col), dm->denominators[row],
+		value);
+}
+
+/**
+@fn DM_set
+@brief Sets one element of a DenomMatrix. If the value's bottom does not divide
+the row's denominator, the row is rescaled to a common denominator first.
+@param dm Pointer to the DenomMatrix to be altered.
+@param row The row (0-indexed) of the element.
+@param col The column (0-indexed) of the element.
+@param value The new value of the element. Must be reduced.
+@return An error code. 0 if no problems were encountered. On error the row is
+left unchanged.
+*/
+int DM_set (DenomMatrix *dm, unsigned int row, unsigned int col,
+	Rational value)
+{
+	if ( value.bottom <= 0 )
+	{
+		return ERR_DENOM_ZERO;
+	}
+	int64_t denominator = dm->denominators[row];
+	int64_t bottom = value.bottom;
+	int64_t *numerators = &DM_NUMERATOR(dm, row, 0);
+	/* If the bottom does not divide the denominator, the row is rescaled to the
+	   least common multiple of the two. Every overflow is checked before the
+	   row is touched. */
+	int64_t factor = 1;
+	if ( denominator % bottom != 0 )
+	{
+		factor = bottom / DM_GCD(denominator, bottom);
+		uint64_t bound;
+		if ( __builtin_mul_overflow(denominator, factor, &denominator) ||
+			__builtin_mul_overflow(DM_maxMagnitude(numerators, dm->numCols),
+			(uint64_t)factor, &bound) || bound > INT64_MAX )
+		{
+			return ERR_DENOM_OVERFLOW;
+		}
+	}
+	int64_t numerator;
+	if ( __builtin_mul_overflow((int64_t)value.top, denominator / bottom,
+		&numerator) )
+	{
+		return ERR_DENOM_OVERFLOW;
+	}
+	if ( factor != 1 )
+	{
+		for (unsigned int j = 0; j < dm->numCols; j++)
+		{
+			numerators[j] *= factor;
+		}
+	}
+	numerators[col] = numerator;
+	dm->denominators[row] = denominator;
+	return 0;
+}
+
+/**
+@fn DM_normalizeRow
+@brief Divides a row's denominator and numerators by their common GCD, so that
+the row is in lowest terms.
+@details Shared factors of two are found by OR-ing every magnitude together and
+removed with shifts, both of which vectorize. The odd part of the GCD is then
+accumulated across the row, stopping as soon as it reaches 1, which for most
+rows happens within the first few elements.
+@param dm Pointer to the DenomMatrix.
+@param row The row (0-indexed) to normalize.
+*/
+void DM_normalizeRow (DenomMatrix *dm, unsigned int row)
+{
+	int64_t *numerators = &DM_NUMERATOR(dm, row, 0);
+	unsigned int numCols = dm->numCols;
+	uint64_t denominator = dm->denominators[row];
+	/* Remove the factors of two shared by every element. */
+	uint64_t bits = denominator;
+	for (unsigned int j = 0; j < numCols; j++)
+	{
+		bits |= DM_abs(numerators[j]);
+	}
+	int shift = __builtin_ctzll(bits);
+	if ( shift > 0 )
+	{
+		/* Each numerator is an exact multiple of 2^shift, so an arithmetic
+		   shift divides it exactly even when it is negative. */
+		for (unsigned int j = 0; j < numCols; j++)
+		{
+			numerators[j] >>= shift;
+		}
+		denominator >>= shift;
+	}
+	/* Find the odd part of the GCD. */
+	uint64_t gcd = denominator;
+	for (unsigned int j = 0; j < numCols && gcd > 1; j++)
+	{
+		if ( numerators[j] != 0 )
+		{
+			gcd = DM_GCD(gcd, DM_abs(numerators[j]));
+		}
+	}
+	if ( gcd > 1 )
+	{
+		int64_t divisor = gcd;
+		for (unsigned int j = 0; j < numCols; j++)
+		{
+			numerators[j] /= divisor;
+		}
+		denominator /= gcd;
+	}
+	dm->denominators[row] = denominator;
+}
+
+/**
+@fn DM_scaleRow
+@brief Multiplies every element of a row by a Rational, then normalizes it.
+@param dm Pointer to the DenomMatrix.
+@param row The row (0-indexed) to scale.
+@param factor The Rational to multiply the row by. Must be reduced.
+@return An error code. 0 if no problems were encountered. On error the row is
+left unchanged.
+*/
+int DM_scaleRow (DenomMatrix *dm, unsigned int row, Rational factor)
+{
+	if ( factor.bottom <= 0 )
+	{
+		return ERR_DENOM_ZERO;
+	}
+	int64_t *numerators = &DM_NUMERATOR(dm, row, 0);
+	if ( factor.top == 0 )
+	{
+		memset(numerators, 0, sizeof(int64_t) * dm->numCols);
+		dm->denominators[row] = 1;
+		return 0;
+	}
+	/* Cancel the factor's top against the row's denominator first. */
+	int64_t denominator = dm->denominators[row];
+	int64_t gcd = DM_GCD(DM_abs(factor.top), denominator);
+	int64_t top = factor.top / gcd;
+	int64_t newDenominator;
+	uint64_t bound;
+	if ( __builtin_mul_overflow(denominator / gcd, (int64_t)factor.bottom,
+		&newDenominator) ||
+		__builtin_mul_overflow(DM_maxMagnitude(numerators, dm->numCols),
+		DM_abs(top), &bound) || bound > INT64_MAX )
+	{
+		return ERR_DENOM_OVERFLOW;
+	}
+	for (unsigned int j = 0; j < dm->numCols; j++)
+	{
+		numerators[j] *= top;
+	}
+	dm->denominators[row] = newDenominator;
+	DM_normalizeRow(dm, row);
+	return 0;
+}
+
+/**
+@fn DM_addScaledRow
+@brief Adds a multiple of one row to another (dest += factor * src), as in
+a step of Gaussian elimination, then normalizes the result.
+@details Both rows are brought to the least common multiple of their
+denominators, so each element costs two integer multiplies and an add. Overflow
+is ruled out up front from the largest magnitude in each row, so the inner loop
+has no checks and vectorizes.
+@param dm Pointer to the DenomMatrix.
+@param dest The row (0-indexed) to add to.
+@param src The row (0-indexed) to add a multiple of. May not equal dest.
+@param factor The Rational to multiply src by. Must be reduced.
+@return An error code. 0 if no problems were encountered. On error the row is
+left unchanged.
+*/
+int DM_addScaledRow (DenomMatrix *dm, unsigned int dest, unsigned int src,
+	Rational factor)
+{
+	if ( factor.bottom <= 0 )
+	{
+		return ERR_DENOM_ZERO;
+	}
+	if ( factor.top == 0 )
+	{
+		return 0;
+	}
+	int64_t *destRow = &DM_NUMERATOR(dm, dest, 0);
+	int64_t *srcRow = &DM_NUMERATOR(dm, src, 0);
+	unsigned int numCols = dm->numCols;
+	/* factor * src has denominator bottom * srcDenominator. Bring it and dest
+	   to the least common multiple of their denominators. */
+	int64_t destDenominator = dm->denominators[dest];
+	int64_t srcDenominator;
+	if ( __builtin_mul_overflow(dm->denominators[src], (int64_t)factor.bottom,
+		&srcDenominator) )
+	{
+		return ERR_DENOM_OVERFLOW;
+	}
+	int64_t gcd = DM_GCD(destDenominator, srcDenominator);
+	int64_t destScale = srcDenominator / gcd;
+	int64_t srcScale;
+	int64_t newDenominator;
+	uint64_t destBound, srcBound;
+	if ( __builtin_mul_overflow(destDenominator / gcd, (int64_t)factor.top,
+		&srcScale) ||
+		__builtin_mul_overflow(destDenominator, destScale, &newDenominator) ||
+		__builtin_mul_overflow(DM_maxMagnitude(destRow, numCols),
+		(uint64_t)destScale, &destBound) ||
+		__builtin_mul_overflow(DM_maxMagnitude(srcRow, numCols),
+		DM_abs(srcScale), &srcBound) ||
+		destBound > INT64_MAX || srcBound > INT64_MAX - destBound )
+	{
+		return ERR_DENOM_OVERFLOW;
+	}
+	for (unsigned int j = 0; j < numCols; j++)
+	{
+		destRow[j] = destRow[j] * destScale + srcRow[j] * srcScale;
+	}
+	dm->denominators[dest] = newDenominator;
+	DM_normalizeRow(dm, dest);
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,159 @@
+/**
+@file DenomMatrix.h
+@author Rob Thomas
+@brief Contains the DenomMatrix struct and functions for matrices whose rows
+each keep a single shared denominator over 64-bit integer numerators. Row
+operations work on the numerators directly, and a row is normalized with one
+GCD across the whole row rather than one per element. Elements are read and
+written as Rationals, so a DenomMatrix can be converted to and from a Matrix.
+*/
+
+#ifndef DENOMMATRIX_H
+#define DENOMMATRIX_H
+
+/*** INCLUDES: ***/
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "Matrix.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define ERR_DENOM_OVERFLOW -70
+#define ERR_DENOM_ZERO -71
+
+/**
+@def DM_NUMERATOR
+@brief Evaluates to the numerator of an element of a DenomMatrix.
+@param dm Pointer to the DenomMatrix.
+@param row The row (0-indexed) of the element.
+@param col The column (0-indexed) of the element.
+*/
+#define DM_NUMERATOR(dm, row, col) \
+	((dm)->numerators[(size_t)(row) * (dm)->numCols + (col)])
+
+/*** STRUCTS: ***/
+
+/**
+@def DenomMatrix
+@brief A struct representing a matrix of rationals in which each row shares one
+denominator. Element (i, j) equals numerators[i * numCols + j] / denominators[i].
+@var numRows The number of rows in the matrix.
+@var numCols The number of columns in the matrix.
+@var numerators A buffer of numRows * numCols numerators in row-major order.
+@var denominators The positive denominator of each row. After normalization the
+GCD of a row's denominator and all of its numerators is 1.
+*/
+typedef struct
+{
+	unsigned int numRows;
+	unsigned int numCols;
+	int64_t *numerators;
+	int64_t *denominators;
+} DenomMatrix;
+
+/*** FUNCTION PROTOTYPES: ***/
+
+/**
+@fn DM_new
+@brief Allocates a new DenomMatrix with every element equal to 0.
+@param numRows The number of rows in the new DenomMatrix.
+@param numCols The number of columns in the new DenomMatrix.
+@return A pointer to a dynamically allocated DenomMatrix, or NULL if
+allocation failed.
+*/
+DenomMatrix *DM_new (unsigned int numRows, unsigned int numCols);
+
+/**
+@fn DM_free
+@brief Frees a dynamically allocated DenomMatrix along with its buffers.
+@param dm Pointer to the DenomMatrix to be freed.
+*/
+void DM_free (DenomMatrix *dm);
+
+/**
+@fn DM_fromMatrix
+@brief Creates a DenomMatrix equal to a Matrix. Each row's denominator is the
+least common multiple of the bottoms in that row.
+@param m Pointer to the Matrix to convert.
+@param result Pointer to a DenomMatrix pointer which will be set to the newly
+allocated DenomMatrix.
+@return An error code. 0 if no problems were encountered.
+*/
+int DM_fromMatrix (Matrix *m, DenomMatrix **result);
+
+/**
+@fn DM_toMatrix
+@brief Writes the elements of a DenomMatrix into a Matrix of the same
+dimensions as reduced Rationals, and rehashes the Matrix.
+@param dm Pointer to the DenomMatrix to convert.
+@param m Pointer to the Matrix which will hold the result.
+@return An error code. 0 if no problems were encountered. ERR_DENOM_OVERFLOW
+if an element does not fit in a Rational, in which case the contents of m are
+unspecified.
+*/
+int DM_toMatrix (DenomMatrix *dm, Matrix *m);
+
+/**
+@fn DM_get
+@brief Reads one element of a DenomMatrix as a reduced Rational.
+@param dm Pointer to the DenomMatrix.
+@param row The row (0-indexed) of the element.
+@param col The column (0-indexed) of the element.
+@param value Pointer to the Rational which will hold the element.
+@return An error code. 0 if no problems were encountered. ERR_DENOM_OVERFLOW
+if the element does not fit in a Rational, in which case value is left
+unchanged.
+*/
+int DM_get (DenomMatrix *dm, unsigned int row, unsigned int col,
+	Rational *value);
+
+/**
+@fn DM_set
+@brief Sets one element of a DenomMatrix. If the value's bottom does not divide
+the row's denominator, the row is rescaled to a common denominator first.
+@param dm Pointer to the DenomMatrix to be altered.
+@param row The row (0-indexed) of the element.
+@param col The column (0-indexed) of the element.
+@param value The new value of the element. Must be reduced.
+@return An error code. 0 if no problems were encountered. On error the row is
+left unchanged.
+*/
+int DM_set (DenomMatrix *dm, unsigned int row, unsigned int col,
+	Rational value);
+
+/**
+@fn DM_normalizeRow
+@brief Divides a row's denominator and numerators by their common GCD, so that
+the row is in lowest terms.
+@param dm Pointer to the DenomMatrix.
+@param row The row (0-indexed) to normalize.
+*/
+void DM_normalizeRow (DenomMatrix *dm, unsigned int row);
+
+/**
+@fn DM_scaleRow
+@brief Multiplies every element of a row by a Rational, then normalizes it.
+@param dm Pointer to the DenomMatrix.
+@param row The row (0-indexed) to scale.
+@param factor The Rational to multiply the row by. Must be reduced.
+@return An error code. 0 if no problems were encountered. On error the row is
+left unchanged.
+*/
+int DM_scaleRow (DenomMatrix *dm, unsigned int row, Rational factor);
+
+/**
+@fn DM_addScaledRow
+@brief Adds a multiple of one row to another (dest += factor * src), as in
+a step of Gaussian elimination, then normalizes the result.
+@param dm Pointer to the DenomMatrix.
+@param dest The row (0-indexed) to add to.
+@param src The row (0-indexed) to add a multiple of. May not equal dest.
+@param factor The Rational to multiply src by. Must be reduced.
+@return An error code. 0 if no problems were encountered. On error the row is
+left unchanged.
+*/
+int DM_addScaledRow (DenomMatrix *dm, unsigned int dest, unsigned int src,
+	Rational factor);
+
+#endif /* DENOMMATRIX_H */
\ No newline at end of file
@@ -0,0 +1,434 @@
+/**
+@file DictMatrix.c
+@author Rob Thomas
+@brief Contains functions for dictionary-encoded matrices. Many structured
+matrices (incidence matrices, Toeplitz matrices, block patterns) hold only a
+few distinct Rationals, so a DictMatrix stores each distinct value once in a
+small table and each element as an 8 or 16-bit index into it. Kernels work on
+the indices directly: scaling touches only the table, and a product
+precomputes every product of two table values once, so its GCDs run once per
+distinct product rather than once per multiply-add.
+*/
+
+/*** INCLUDES: ***/
+#include <string.h>
+#include <stdbool.h>
+
+#include "DictMatrix.h"
+#include "BufferPool.h"
+
+/*** DEFINES: ***/
+#define DX_EMPTY_SLOT UINT32_MAX
+
+/**
+@def DX_DEFINE_SUM_ROW
+@brief Generates a kernel which accumulates one row of a product from the
+scaled product table, for one pair of index sizes.
+@param NAME The name of the generated function.
+@param A_TYPE The index type of the left operand.
+@param B_TYPE The index type of the right operand.
+*/
+#define DX_DEFINE_SUM_ROW(NAME, A_TYPE, B_TYPE) \
+static bool NAME (int64_t *sums, DictMatrix *a, DictMatrix *b, unsigned int i, \
+	const int64_t *scaled, const bool *isZero) \
+{ \
+	unsigned int numCols = b->numCols; \
+	const A_TYPE *aRow = (const A_TYPE *)a->indices + (size_t)i * a->numCols; \
+	bool overflow = false; \
+	for (unsigned int j = 0; j < numCols; j++) \
+	{ \
+		sums[j] = 0; \
+	} \
+	for (unsigned int k = 0; k < a->numCols; k++) \
+	{ \
+		unsigned int u = aRow[k]; \
+		if ( isZero[u] ) \
+		{ \
+			continue; \
+		} \
+		const int64_t *products = &scaled[(size_t)u * b->numValues]; \
+		const B_TYPE *bRow = (const B_TYPE *)b->indices + (size_t)k * numCols; \
+		for (unsigned int j = 0; j < numCols; j++) \
+		{ \
+			overflow |= __builtin_add_overflow(sums[j], products[bRow[j]], \
+				&sums[j]); \
+		} \
+	} \
+	return !overflow; \
+}
+
+/*** FUNCTION DEFINITIONS: ***/
+
+DX_DEFINE_SUM_ROW(DX_sumRow8x8, uint8_t, uint8_t)
+DX_DEFINE_SUM_ROW(DX_sumRow8x16, uint8_t, uint16_t)
+DX_DEFINE_SUM_ROW(DX_sumRow16x8, uint16_t, uint8_t)
+DX_DEFINE_SUM_ROW(DX_sumRow16x16, uint16_t, uint16_t)
+
+/**
+@fn DX_hash
+@brief Hashes a Rational by its top and bottom.
+@param r The Rational.
+@return The hash value.
+*/
+static uint32_t DX_hash (Rational r)
+{
+	uint64_t key = ((uint64_t)(uint32_t)r.top << 32) | (uint32_t)r.bottom;
+	return (key * UINT64_C(0x9E3779B97F4A7C15)) >> 32;
+}
+
+/**
+@fn DX_fromMatrix
+@brief Creates a DictMatrix equal to a Matrix. Values are matched by their top
+and bottom, so the Matrix's elements should be reduced; equal values in
+different forms still convert correctly but take separate table entries.
+@param m Pointer to the Matrix to convert.
+@param result Pointer to a DictMatrix pointer which will be set to the newly
+allocated DictMatrix.
+@return An error code. 0 if no problems were encountered.
+ERR_DICT_TOO_MANY_VALUES if m has more than DX_MAX_VALUES distinct values.
+*/
+int DX_fromMatrix (Matrix *m, DictMatrix **result)
+{
+	size_t numElements = (size_t)m->numRows * m->numCols;
+	size_t maxValues = numElements < DX_MAX_VALUES ? numElements : DX_MAX_VALUES;
+	/* Size the lookup table to stay at most half full. */
+	size_t numSlots = 16;
+	while ( numSlots < maxValues * 2 )
+	{
+		numSlots *= 2;
+	}
+	DictMatrix *dx = (DictMatrix *)calloc(1, sizeof(DictMatrix));
+	uint32_t *slots = (uint32_t *)malloc(sizeof(uint32_t) * numSlots);
+	uint16_t *wide = (uint16_t *)BP_alloc(sizeof(uint16_t) *
+		(numElements ? numElements : 1));
+	if ( dx )
+	{
+		dx->values = (Rational *)malloc(sizeof(Rational) *
+			(maxValues ? maxValues : 1));
+	}
+	if ( !dx || !slots || !wide || !dx->values )
+	{
+		free(slots);
+		BP_release(wide);
+		DX_free(dx);
+		return ERR_ALLOCATION_FAILED;
+	}
+	dx->numRows = m->numRows;
+	dx->numCols = m->numCols;
+	memset(slots, 0xff, sizeof(uint32_t) * numSlots);
+	/* Look each element up in the table, adding it if it is new. Runs of
+	   equal elements are common, so the previous element is checked first. */
+	int error = 0;
+	Rational previous = {0, 0};
+	uint32_t previousIndex = DX_EMPTY_SLOT;
+	for (size_t e = 0; e < numElements; e++)
+	{
+		Rational r = m->elements[e];
+		if ( previousIndex != DX_EMPTY_SLOT && r.top == previous.top &&
+			r.bottom == previous.bottom )
+		{
+			wide[e] = previousIndex;
+			continue;
+		}
+		size_t slot = DX_hash(r) & (numSlots - 1);
+		while ( slots[slot] != DX_EMPTY_SLOT &&
+			(dx->values[slots[slot]].top != r.top ||
+			dx->values[slots[slot]].bottom != r.bottom) )
+		{
+			slot = (slot + 1) & (numSlots - 1);
+		}
+		if ( slots[slot] == DX_EMPTY_SLOT )
+		{
+			if ( dx->numValues == DX_MAX_VALUES )
+			{
+				error = ERR_DICT_TOO_MANY_VALUES;
+				break;
+			}
+			slots[slot] = dx->numValues;
+			dx->values[dx->numValues++] = r;
+		}
+		wide[e] = slots[slot];
+		previous = r;
+		previousIndex = slots[slot];
+	}
+	free(slots);
+	if ( error )
+	{
+		BP_release(wide);
+		DX_free(dx);
+		return error;
+	}
+	/* Narrow the indices to a byte each if the table is small enough. */
+	if ( dx->numValues <= DX_MAX_NARROW_VALUES )
+	{
+		uint8_t *narrow = (uint8_t *)BP_alloc(numElements ? numElements : 1);
+		if ( !narrow )
+		{
+			BP_release(wide);
+			DX_free(dx);
+			return ERR_ALLOCATION_FAILED;
+		}
+		for (size_t e = 0; e < numElements; e++)
+		{
+			narrow[e] = wide[e];
+		}
+		BP_release(wide);
+		dx->indices = narrow;
+		dx->indexSize = 1;
+	}
+	else
+	{
+		dx->indices = wide;
+		dx->indexSize = 2;
+	}
+	*result = dx;
+	return 0;
+}
+
+/**
+@fn DX_toMatrix
+@brief Writes the elements of a DictMatrix into a Matrix of the same
+dimensions, and rehashes the Matrix.
+@param dx Pointer to the DictMatrix to convert.
+@param m Pointer to the Matrix which will hold the result.
+@return An error code. 0 if no problems were encountered.
+*/
+int DX_toMatrix (DictMatrix *dx, Matrix *m)
+{
+	if ( m->numRows != dx->numRows || m->numCols != dx->numCols )
+	{
+		return ERR_DIMENSION_MISMATCH;
+	}
+	size_t numElements = (size_t)dx->numRows * dx->numCols;
+	if ( dx->indexSize == 1 )
+	{
+		const uint8_t *indices = (const uint8_t *)dx->indices;
+		for (size_t e = 0; e < numElements; e++)
+		{
+			m->elements[e] = dx->values[indices[e]];
+		}
+	}
+	else
+	{
+		const uint16_t *indices = (const uint16_t *)dx->indices;
+		for (size_t e = 0; e < numElements; e++)
+		{
+			m->elements[e] = dx->values[indices[e]];
+		}
+	}
+	M_rehash(m);
+	return 0;
+}
+
+/**
+@fn DX_get
+@brief Reads one element of a DictMatrix.
+@param dx Pointer to the DictMatrix.
+@param row The row (0-indexed) of the element.
+@param col The column (0-indexed) of the element.
+@return The element.
+*/
+Rational DX_get (DictMatrix *dx, unsigned int row, unsigned int col)
+{
+	return dx->values[DX_INDEX(dx, row, col)];
+}
+
+/**
+@fn DX_storageSize
+@brief Returns the number of bytes a DictMatrix's table and indices occupy.
+@param dx Pointer to the DictMatrix.
+@return The size in bytes.
+*/
+size_t DX_storageSize (DictMatrix *dx)
+{
+	return sizeof(Rational) * dx->numValues +
+		(size_t)dx->indexSize * dx->numRows * dx->numCols;
+}
+
+/**
+@fn DX_scale
+@brief Multiplies every element of a DictMatrix by a Rational. Only the table
+is touched, so this takes one multiplication per distinct value.
+@param dx Pointer to the DictMatrix to be altered.
+@param factor The Rational to multiply by.
+*/
+void DX_scale (DictMatrix *dx, Rational factor)
+{
+	for (unsigned int v = 0; v < dx->numValues; v++)
+	{
+		R_multR(&dx->values[v], factor);
+	}
+}
+
+/**
+@fn DX_scaleProducts
+@brief Scales a table of reduced products to integers over their least common
+denominator.
+@param products The products.
+@param numProducts The number of products.
+@param scaled The buffer the scaled products are written to.
+@param denominator Pointer to where the common denominator is written.
+@return true if the denominator and every scaled product fit in 64 bits,
+false otherwise.
+*/
+static bool DX_scaleProducts (Rational *products, size_t numProducts,
+	int64_t *scaled, int64_t *denominator)
+{
+	int64_t lcm = 1;
+	for (size_t p = 0; p < numProducts; p++)
+	{
+		int64_t bottom = products[p].bottom;
+		if ( bottom <= 0 )
+		{
+			return false;
+		}
+		if ( lcm % bottom == 0 )
+		{
+			continue;
+		}
+		if ( __builtin_mul_overflow(lcm / R_GCD(lcm, bottom), bottom, &lcm) )
+		{
+			return false;
+		}
+	}
+	for (size_t p = 0; p < numProducts; p++)
+	{
+		if ( __builtin_mul_overflow((int64_t)products[p].top,
+			lcm / products[p].bottom, &scaled[p]) )
+		{
+			return false;
+		}
+	}
+	*denominator = lcm;
+	return true;
+}
+
+/**
+@fn DX_multiply
+@brief Computes dest = a * b from the indices of a and b.
+@details Every product of a value of a and a value of b is computed and
+reduced once, then scaled to an integer over the common denominator of all of
+them. Each row of the result is accumulated from that table in 64-bit
+integers and each entry is reduced with one GCD at the end. A row whose sums
+would overflow, or a product table without a 64-bit common denominator, is
+accumulated with Rational arithmetic over the same precomputed products
+instead.
+@param dest Pointer to the Matrix which will hold the result. Its dimensions
+must already be a->numRows x b->numCols.
+@param a Pointer to the left operand.
+@param b Pointer to the right operand.
+@return An error code. 0 if no problems were encountered.
+*/
+int DX_multiply (Matrix *dest, DictMatrix *a, DictMatrix *b)
+{
+	if ( a->numCols != b->numRows || dest->numRows != a->numRows ||
+		dest->numCols != b->numCols )
+	{
+		return ERR_DIMENSION_MISMATCH;
+	}
+	unsigned int numCols = b->numCols;
+	size_t numProducts = (size_t)a->numValues * b->numValues;
+	Rational *products = (Rational *)malloc(sizeof(Rational) *
+		(numProducts ? numProducts : 1));
+	int64_t *scaled = (int64_t *)malloc(sizeof(int64_t) *
+		(numProducts ? numProducts : 1));
+	bool *isZero = (bool *)malloc(sizeof(bool) *
+		(a->numValues ? a->numValues : 1));
+	int64_t *sums = (int64_t *)BP_alloc(sizeof(int64_t) * (numCols ? numCols : 1));
+	if ( !products || !scaled || !isZero || !sums )
+	{
+		free(products);
+		free(scaled);
+		free(isZero);
+		BP_release(sums);
+		return ERR_ALLOCATION_FAILED;
+	}
+	/* Compute each distinct product once. */
+	for (unsigned int u = 0; u < a->numValues; u++)
+	{
+		isZero[u] = a->values[u].top == 0;
+		for (unsigned int v = 0; v < b->numValues; v++)
+		{
+			Rational product = a->values[u];
+			R_multR(&product, b->values[v]);
+			products[(size_t)u * b->numValues + v] = product;
+		}
+	}
+	int64_t denominator = 1;
+	bool isScaled = DX_scaleProducts(products, numProducts, scaled, &denominator);
+	bool (*sumRow)(int64_t *, DictMatrix *, DictMatrix *, unsigned int,
+		const int64_t *, const bool *);
+	if ( a->indexSize == 1 )
+	{
+		sumRow = b->indexSize == 1 ? DX_sumRow8x8 : DX_sumRow8x16;
+	}
+	else
+	{
+		sumRow = b->indexSize == 1 ? DX_sumRow16x8 : DX_sumRow16x16;
+	}
+	for (unsigned int i = 0; i < a->numRows; i++)
+	{
+		Rational *row = &M_AT(dest, i, 0);
+		if ( isScaled && sumRow(sums, a, b, i, scaled, isZero) )
+		{
+			for (unsigned int j = 0; j < numCols; j++)
+			{
+				if ( denominator == 1 )
+				{
+					row[j].top = sums[j];
+					row[j].bottom = 1;
+				}
+				else
+				{
+					R_reduce64(&row[j], sums[j], denominator);
+				}
+			}
+			continue;
+		}
+		/* Fall back to Rational sums of the precomputed products. */
+		for (unsigned int j = 0; j < numCols; j++)
+		{
+			row[j].top = 0;
+			row[j].bottom = 1;
+		}
+		for (unsigned int k = 0; k < a->numCols; k++)
+		{
+			unsigned int u = DX_INDEX(a, i, k);
+			if ( isZero[u] )
+			{
+				continue;
+			}
+			const Rational *uProducts = &products[(size_t)u * b->numValues];
+			for (unsigned int j = 0; j < numCols; j++)
+			{
+				Rational product = uProducts[DX_INDEX(b, k, j)];
+				if ( product.top != 0 )
+				{
+					R_addR(&row[j], product);
+				}
+			}
+		}
+	}
+	free(products);
+	free(scaled);
+	free(isZero);
+	BP_release(sums);
+	M_rehash(dest);
+	return 0;
+}
+
+/**
+@fn DX_free
+@brief Frees a dynamically allocated DictMatrix along with its buffers.
+@param dx Pointer to the DictMatrix to be freed.
+*/
+void DX_free (DictMatrix *dx)
+{
+	if ( !dx )
+	{
+		return;
+	}
+	free(dx->values);
+	BP_release(dx->indices);
+	free(dx);
+}
\ No newline at end of file
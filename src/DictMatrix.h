@@ -0,0 +1,142 @@
+/**
+@file DictMatrix.h
+@author Rob Thomas
+@brief Contains the DictMatrix struct and functions for dictionary-encoded
+matrices. Many structured matrices (incidence matrices, Toeplitz matrices,
+block patterns) hold only a few distinct Rationals, so a DictMatrix stores each
+distinct value once in a small table and each element as an 8 or 16-bit index
+into it. Kernels work on the indices directly: scaling touches only the table,
+and a product precomputes every product of two table values once, so its GCDs
+run once per distinct product rather than once per multiply-add.
+*/
+
+#ifndef DICTMATRIX_H
+#define DICTMATRIX_H
+
+/*** INCLUDES: ***/
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "Matrix.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define DX_MAX_NARROW_VALUES 256
+#define DX_MAX_VALUES 65536
+
+#define ERR_DICT_TOO_MANY_VALUES -130
+
+/**
+@def DX_INDEX
+@brief Evaluates to the table index of an element of a DictMatrix.
+@param dx Pointer to the DictMatrix.
+@param row The row (0-indexed) of the element.
+@param col The column (0-indexed) of the element.
+*/
+#define DX_INDEX(dx, row, col) \
+	((dx)->indexSize == 1 ? \
+	((uint8_t *)(dx)->indices)[(size_t)(row) * (dx)->numCols + (col)] : \
+	((uint16_t *)(dx)->indices)[(size_t)(row) * (dx)->numCols + (col)])
+
+/*** STRUCTS: ***/
+
+/**
+@def DictMatrix
+@brief A struct representing a dictionary-encoded matrix of Rationals. Element
+(i, j) equals values[index], where index is element i * numCols + j of indices.
+@var numRows The number of rows in the matrix.
+@var numCols The number of columns in the matrix.
+@var values The table of distinct values.
+@var numValues The number of values in the table.
+@var indexSize The size of each index in bytes: 1 if the table has at most
+DX_MAX_NARROW_VALUES values, 2 otherwise.
+@var indices A buffer of numRows * numCols indices in row-major order.
+*/
+typedef struct
+{
+	unsigned int numRows;
+	unsigned int numCols;
+	Rational *values;
+	unsigned int numValues;
+	unsigned int indexSize;
+	void *indices;
+} DictMatrix;
+
+/*** FUNCTION PROTOTYPES: ***/
+
+/**
+@fn DX_fromMatrix
+@brief Creates a DictMatrix equal to a Matrix. Values are matched by their top
+and bottom, so the Matrix's elements should be reduced; equal values in
+different forms still convert correctly but take separate table entries.
+@param m Pointer to the Matrix to convert.
+@param result Pointer to a DictMatrix pointer which will be set to the newly
+allocated DictMatrix.
+@return An error code. 0 if no problems were encountered.
+ERR_DICT_TOO_MANY_VALUES if m has more than DX_MAX_VALUES distinct values.
+*/
+int DX_fromMatrix (Matrix *m, DictMatrix **result);
+
+/**
+@fn DX_toMatrix
+@brief Writes the elements of a DictMatrix into a Matrix of the same
+dimensions, and rehashes the Matrix.
+@param dx Pointer to the DictMatrix to convert.
+@param m Pointer to the Matrix which will hold the result.
+@return An error code. 0 if no problems were encountered.
+*/
+int DX_toMatrix (DictMatrix *dx, Matrix *m);
+
+/**
+@fn DX_get
+@brief Reads one element of a DictMatrix.
+@param dx Pointer to the DictMatrix.
+@param row The row (0-indexed) of the element.
+@param col The column (0-indexed) of the element.
+@return The element.
+*/
+Rational DX_get (DictMatrix *dx, unsigned int row, unsigned int col);
+
+/**
+@fn DX_storageSize
+@brief Returns the number of bytes a DictMatrix's table and indices occupy.
+@param dx Pointer to the DictMatrix.
+@return The size in bytes.
+*/
+size_t DX_storageSize (DictMatrix *dx);
+
+/**
+@fn DX_scale
+@brief Multiplies every element of a DictMatrix by a Rational. Only the table
+is touched, so this takes one multiplication per distinct value.
+@param dx Pointer to the DictMatrix to be altered.
+@param factor The Rational to multiply by.
+*/
+void DX_scale (DictMatrix *dx, Rational factor);
+
+/**
+@fn DX_multiply
+@brief Computes dest = a * b from the indices of a and b.
+@details Every product of a value of a and a value of b is computed and
+reduced once, then scaled to an integer over the common denominator of all of
+them. Each row of the result is accumulated from that table in 64-bit
+integers and each entry is reduced with one GCD at the end. A row whose sums
+would overflow, or a product table without a 64-bit common denominator, is
+accumulated with Rational arithmetic over the same precomputed products
+instead.
+@param dest Pointer to the Matrix which will hold the result. Its dimensions
+must already be a->numRows x b->numCols.
+@param a Pointer to the left operand.
+@param b Pointer to the right operand.
+@return An error code. 0 if no problems were encountered.
+*/
+int DX_multiply (Matrix *dest, DictMatrix *a, DictMatrix *b);
+
+/**
+@fn DX_free
+@brief Frees a dynamically allocated DictMatrix along with its buffers.
+@param dx Pointer to the DictMatrix to be freed.
+*/
+void DX_free (DictMatrix *dx);
+
+#endif /* DICTMATRIX_H */
\ No newline at end of file
@@ -9,14 +9,126 @@ matrix shell.
 */
 
 /*** INCLUDES: ***/
+#include <string.h>
+
 #include "HashTable.h"
+#include "Instrument.h"
+#include "BufferPool.h"
 #include "Matrix.h"
 #include "Rational.h"
+#include "TiledMatrix.h"
 
 /*** DEFINES: ***/
 
 /*** FUNCTION DEFINITIONS: ***/
 
+/**
+@fn HT_clearDependencies
+@brief Removes a HashSpace's record of the variables it was derived from, so
+that it is treated as a plain variable.
+@param space Pointer to the HashSpace whose dependencies will be removed.
+*/
+static void HT_clearDependencies(HashSpace *space)
+{
+	free(space->dependencyIndices);
+	free(space->dependencyVersions);
+	space->dependencyIndices = NULL;
+	space->dependencyVersions = NULL;
+	space->numDependencies = 0;
+	space->recompute = NULL;
+	space->recomputeContext = NULL;
+	space->isRecomputing = false;
+}
+
+/**
+@fn HT_clearCache
+@brief Frees the result cached alongside a HashSpace's value, if any.
+@param space Pointer to the HashSpace whose cache will be freed.
+*/
+static void HT_clearCache(HashSpace *space)
+{
+	if (space->cache)
+	{
+		space->freeCache(space->cache);
+	}
+	space->cache = NULL;
+	space->freeCache = NULL;
+}
+
+/**
+@fn HT_freeValue
+@brief Frees the value of a HashSpace, releasing what it owns unless the value
+replacing it still uses it: a Matrix whose elements are the same buffer, or a
+TiledMatrix on the same file and cache.
+@param space Pointer to the HashSpace whose value will be freed.
+@param replacement Pointer to the value replacing it. May be NULL.
+@param replacementType The type of the replacement value.
+*/
+static void HT_freeValue(HashSpace *space, void *replacement,
+	value_t replacementType)
+{
+	if (!replacement || !HT_sharesValue(space->value, space->valueType,
+		replacement, replacementType))
+	{
+		HT_releaseValue(space->value, space->valueType);
+	}
+	free(space->value);
+	space->value = NULL;
+}
+
+/**
+@fn HT_clearSpace
+@brief Frees the key, value, dependencies and cache of a HashSpace, leaving it
+empty.
+@param space Pointer to the HashSpace to be cleared.
+*/
+static void HT_clearSpace(HashSpace *space)
+{
+	if (space->key)
+	{
+		free(space->key);
+		space->key = NULL;
+	}
+	if (space->value)
+	{
+		HT_freeValue(space, NULL, VT_RATIONAL);
+	}
+	HT_clearDependencies(space);
+	HT_clearCache(space);
+	space->hasLink = false;
+	space->version = 0;
+}
+
+/**
+@fn HT_findIndex
+@brief Finds the index in a HashTable of the HashSpace holding a key.
+@param table Pointer to the HashTable struct to search.
+@param key The string representing the key to find. Must be null-terminated.
+@return The index of the key's HashSpace, or -1 if the key is not present.
+*/
+static int HT_findIndex(HashTable *table, char *key)
+{
+	unsigned int index = HT_hashValue(key) % table->maxNumItems;
+	/* If the space the key hashes to is empty, the key cannot be present. */
+	if (!table->pairs[index].key)
+	{
+		return -1;
+	}
+	/* Otherwise, follow the chain of collided pairs until the key is found. */
+	while (true)
+	{
+		if (!strcmp(key, table->pairs[index].key))
+		{
+			return index;
+		}
+		if (!table->pairs[index].hasLink)
+		{
+			return -1;
+		}
+		index = table->pairs[index].linkedIndex;
+	}
+}
+
 /**
 @fn HT_newTable
 @brief Generates a newly allocated HashTable struct and initializes it. All keys
@@ -37,6 +149,15 @@ HashTable *HT_newTable(unsigned int maxNumItems)
 	for (unsigned int i = 0; i < maxNumItems; i++)
 	{
 		table->pairs[i].key = NULL;
+		table->pairs[i].value = NULL;
+		table->pairs[i].hasLink = false;
+		table->pairs[i].version = 0;
+		table->pairs[i].dependencyIndices = NULL;
+		table->pairs[i].dependencyVersions = NULL;
+		HT_clearDependencies(&table->pairs[i]);
+		table->pairs[i].cache = NULL;
+		table->pairs[i].cacheVersion = 0;
+		table->pairs[i].freeCache = NULL;
 	}
 	return table;
 }
@@ -45,7 +166,8 @@ HashTable *HT_newTable(unsigned int maxNumItems)
 @fn HT_freeTable
 @brief Frees an allocated HashTable struct.
 NOTE: assumes that all keys and values in the table were dynamically allocated 
-for and thus frees those too.
+for and thus frees those too. The element buffers of matrices are released to
+the buffer pool unless they are borrowed.
 @param table Pointer to a dynamically allocated HashTable struct which will be
 freed.
 */
@@ -54,14 +176,7 @@ void HT_freeTable(HashTable *table)
 	/* Free each non-NULL key and value in the hash table. */
 	for (unsigned int i = 0; i < table->maxNumItems; i++)
 	{
-		if (table->pairs[i].key)
-		{
-			free(table->pairs[i].key);
-		}
-		if (table->pairs[i].value)
-		{
-			free(table->pairs[i].value);
-		}
+		HT_clearSpace(&table->pairs[i]);
 	}
 	/* Free the list of HashSpaces. */
 	free(table->pairs);
@@ -69,6 +184,29 @@ void HT_freeTable(HashTable *table)
 	free(table);
 }
 
+/**
+@fn HT_reset
+@brief Empties a HashTable without freeing it, so that it can be reused. Keys
+and values are freed as in HT_freeTable, but the list of HashSpaces is kept.
+Spaces are only ever emptied all at once, so the scan stops as soon as every
+key/value pair has been found.
+@param table Pointer to the HashTable to be emptied.
+*/
+void HT_reset(HashTable *table)
+{
+	unsigned int numCleared = 0;
+	for (unsigned int i = 0; i < table->maxNumItems && numCleared < table->numItems; i++)
+	{
+		if (table->pairs[i].key)
+		{
+			HT_clearSpace(&table->pairs[i]);
+			numCleared++;
+		}
+	}
+	table->numItems = 0;
+	table->nextLink = 0;
+}
+
 /**
 @fn HT_hashValue
 @brief Calculates the hash value of a key using the Jenkins one-at-a-time
@@ -92,7 +230,6 @@ positive length into the corresponding hash value.
 */
 unsigned int jenkins_one_at_a_time_hash_value(char *key, int len)
 {
-	int i = 0;
 	unsigned int hashValue = 0;
 	for (int i = 0; i < len; i++)
 	{
@@ -109,7 +246,12 @@ unsigned int jenkins_one_at_a_time_hash_value(char *key, int len)
 
 /**
 @fn HT_add
-@brief Adds a key/value pair to a HashTable.
+@brief Adds a key/value pair to a HashTable. The value struct is copied, and a
+Matrix's element buffer or a TiledMatrix's file becomes owned by the table,
+which releases it (see HT_releaseValue) when the variable is overwritten with a
+different buffer or file, or the table is reset or freed. The caller must not
+release it as well. A Matrix's buffer must come from BP_alloc unless it is
+borrowed, and a TiledMatrix's cache must outlive the variable.
 @param table Pointer to the HashTable struct which the key/value pair will be
 added to.
 @param key The string representing the key to be added. Must be null-terminated.
@@ -118,10 +260,13 @@ For instance, if the value is a Matrix struct, then this parameter would simply
 be the pointer to that struct.
 @param valueType The type of data of the value. If the value is a Matrix struct,
 then valueType will be VT_MATRIX.
-@return An error code. 0 if no problems were encountered.
+@return An error code. 0 if the pair was stored, in which case the table owns
+the value. Any other code means nothing was stored, so the value (and its
+buffer or file) is still the caller's to release.
 */
 int HT_add(HashTable *table, char *key, void *value, value_t valueType)
 {
+	INST_COUNT(tableAdds, 1);
 	/* First, make sure the table isn't already full. */
 	if (table->numItems >= table->maxNumItems)
 	{
@@ -129,28 +274,30 @@ int HT_add(HashTable *table, char *key, void *value, value_t valueType)
 	}
 	/* Get the index in the hash table that this key would normally be added at. */
 	unsigned int index = HT_hashValue(key) % table->maxNumItems;
+	INST_COUNT(tableProbes, 1);
 	/* If the HashSpace is empty, simply add the key/value pair in. */
 	if (!table->pairs[index].key)
 	{
 		/* Allocate and add the key and value. */
 		table->pairs[index].key = HT_copyString(key);
-		table->pairs[index].value = HT_copyValue(value, valueType);
+		table->pairs[index].value = HT_copyValue(value, HT_typeSize(valueType));
 		table->pairs[index].valueType = valueType;
+		table->pairs[index].version = 1;
+		table->numItems++;
 		/* Indicate that there is no chain from this space. */
 		table->pairs[index].linkedIndex = 0;
 		table->pairs[index].hasLink = false;
 		/* If this pair was added where the next link of a chain would be added,
-		   advance the next link pointer to the next free space. */
+		   advance the next link pointer to the next free space. The pair is
+		   stored either way, so running off the end of the table is left for
+		   the next chained add to report. */
 		if (index == table->nextLink)
 		{
-			while (table->pairs[table->nextLink].key)
+			while (table->nextLink < table->maxNumItems &&
+				table->pairs[table->nextLink].key)
 			{
 				table->nextLink++;
-				/* Catch no space being available for a new link. */
-				if (table->nextLink >= table->maxNumItems)
-				{
-					return ERR_NEXT_LINK_OUT_OF_BOUNDS;
-				}
+				INST_COUNT(tableNextLinkAdvances, 1);
 			}
 		}
 		return 0;
@@ -158,6 +305,8 @@ int HT_add(HashTable *table, char *key, void *value, value_t valueType)
 	/* If the HashSpace is filled, it may point to another space. If so, travel 
 	to the end of the linked chain so that the link of the HashSpace at the end 
 	can be set. */
+	INST_COUNT(tableCollisions, 1);
+	unsigned int chainLength = 0;
 	bool linkAvailable;
 	do
 	{
@@ -167,8 +316,9 @@ int HT_add(HashTable *table, char *key, void *value, value_t valueType)
 		{
 			if (table->pairs[index].value)
 			{
-				/* Free the old value. */
-				free(table->pairs[index].value);
+				/* Free the old value, keeping its element buffer or file if
+				   the new value still uses it. */
+				HT_freeValue(&table->pairs[index], value, valueType);
 				/* Decrement the number of items in the table to compensate for
 				   it being incremented when the new value is added. */
 				table->numItems--;
@@ -178,6 +328,13 @@ int HT_add(HashTable *table, char *key, void *value, value_t valueType)
 			table->pairs[index].value = HT_copyValue(value, size);
 			table->pairs[index].valueType = valueType;
 			table->numItems++;
+			/* Mark the value as changed so that variables derived from it are
+			   recomputed when next read. A plain assignment also replaces any
+			   derivation this variable had. */
+			table->pairs[index].version++;
+			HT_clearDependencies(&table->pairs[index]);
+			HT_clearCache(&table->pairs[index]);
+			INST_MAX(tableLongestChain, chainLength);
 			return 0;
 		}
 		if (table->pairs[index].hasLink)
@@ -185,12 +342,16 @@ int HT_add(HashTable *table, char *key, void *value, value_t valueType)
 			linkAvailable = true;
 			/* Move to the next space in the chain. */
 			index = table->pairs[index].linkedIndex;
+			chainLength++;
+			INST_COUNT(tableChainHops, 1);
+			INST_COUNT(tableProbes, 1);
 		}
 		else 
 		{
 			linkAvailable = false;
 		}
 	} while (linkAvailable);
+	INST_MAX(tableLongestChain, chainLength);
 	/* Once at the last HashSpace in the chain, make sure that the next link to
 	be made is within the bounds of the table. */
 	if (table->nextLink < table->maxNumItems)
@@ -198,16 +359,24 @@ int HT_add(HashTable *table, char *key, void *value, value_t valueType)
 		/* Link the space at the end of the chain to the next link space, where
 		this key/value pair will be added. */
 		table->pairs[index].linkedIndex = table->nextLink;
+		table->pairs[index].hasLink = true;
 		/* Add the key/value pair. */
 		table->pairs[table->nextLink].key = HT_copyString(key);
 		unsigned int size = HT_typeSize(valueType);
 		table->pairs[table->nextLink].value = HT_copyValue(value, size);
 		table->pairs[table->nextLink].valueType = valueType;
 		table->pairs[table->nextLink].linkedIndex = -1;
+		table->pairs[table->nextLink].hasLink = false;
+		table->pairs[table->nextLink].version = 1;
 		table->numItems++;
 		/* Advance the next link to point at the closest empty space below where
 		it originally pointed. */
-		while (table->pairs[++(table->nextLink)].key) {}
+		INST_COUNT(tableNextLinkAdvances, 1);
+		while (++(table->nextLink) < table->maxNumItems &&
+			table->pairs[table->nextLink].key)
+		{
+			INST_COUNT(tableNextLinkAdvances, 1);
+		}
 	}
 	/* If the next link was outside of the bounds of the table, return with an 
 	error code. */
@@ -218,17 +387,216 @@ int HT_add(HashTable *table, char *key, void *value, value_t valueType)
 	return 0;
 }
 
+/**
+@fn HT_addDerived
+@brief Adds a key/value pair to a HashTable whose value is derived from other
+variables already in the table. When any of those variables are later
+overwritten through HT_add, this variable is recomputed the next time it is
+read through HT_get. If none of them have changed, reading it does no work.
+@param table Pointer to the HashTable struct which the key/value pair will be
+added to.
+@param key The string representing the key to be added. Must be null-terminated.
+@param value Pointer to the current value of the derived variable.
+@param valueType The type of data of the value.
+@param dependencies The keys of the variables this variable is derived from.
+@param numDependencies The number of keys in dependencies.
+@param recompute The function which recomputes the value from its dependencies.
+@param context A pointer which will be passed to recompute.
+@return An error code. 0 if no problems were encountered.
+*/
+int HT_addDerived(HashTable *table, char *key, void *value, value_t valueType,
+	char **dependencies, unsigned int numDependencies, 
+	HT_RecomputeFunc recompute, void *context)
+{
+	/* Every dependency must already be in the table. */
+	for (unsigned int i = 0; i < numDependencies; i++)
+	{
+		if (HT_findIndex(table, dependencies[i]) < 0)
+		{
+			return FAIL_KEY_NOT_FOUND;
+		}
+	}
+	/* Add the value as a plain variable first. */
+	int error = HT_add(table, key, value, valueType);
+	if (error)
+	{
+		return error;
+	}
+	/* Then record which variables it was derived from, along with the versions
+	   of those variables that the given value corresponds to. Indexes are
+	   stored rather than keys since pairs never move once added. */
+	HashSpace *space = &table->pairs[HT_findIndex(table, key)];
+	space->dependencyIndices = (int *)malloc(sizeof(int) * numDependencies);
+	space->dependencyVersions = 
+		(unsigned int *)malloc(sizeof(unsigned int) * numDependencies);
+	for (unsigned int i = 0; i < numDependencies; i++)
+	{
+		int depIndex = HT_findIndex(table, dependencies[i]);
+		space->dependencyIndices[i] = depIndex;
+		space->dependencyVersions[i] = table->pairs[depIndex].version;
+	}
+	space->numDependencies = numDependencies;
+	space->recompute = recompute;
+	space->recomputeContext = context;
+	return 0;
+}
+
+/**
+@fn HT_refresh
+@brief Brings a HashSpace's value up to date. Each dependency is refreshed
+first; if any of them now has a different version than the one this value was
+computed from, the value is recomputed and its own version is incremented.
+@param table Pointer to the HashTable struct containing the space.
+@param index The index of the HashSpace to refresh.
+@return An error code. 0 if no problems were encountered.
+*/
+static int HT_refresh(HashTable *table, int index)
+{
+	HashSpace *space = &table->pairs[index];
+	/* Plain variables are always up to date. */
+	if (!space->recompute)
+	{
+		return 0;
+	}
+	/* Reaching a space that is already being refreshed means the dependency
+	   graph has a cycle. */
+	if (space->isRecomputing)
+	{
+		return FAIL_CYCLIC_DEPENDENCY;
+	}
+	space->isRecomputing = true;
+	bool isStale = false;
+	for (unsigned int i = 0; i < space->numDependencies; i++)
+	{
+		int depIndex = space->dependencyIndices[i];
+		int error = HT_refresh(table, depIndex);
+		if (error)
+		{
+			space->isRecomputing = false;
+			return error;
+		}
+		if (table->pairs[depIndex].version != space->dependencyVersions[i])
+		{
+			isStale = true;
+		}
+	}
+	/* Only recompute if an input actually changed. */
+	if (isStale)
+	{
+		int error = space->recompute(space->recomputeContext, space->value);
+		if (error)
+		{
+			space->isRecomputing = false;
+			return error;
+		}
+		for (unsigned int i = 0; i < space->numDependencies; i++)
+		{
+			space->dependencyVersions[i] = 
+				table->pairs[space->dependencyIndices[i]].version;
+		}
+		space->version++;
+		HT_clearCache(space);
+	}
+	space->isRecomputing = false;
+	return 0;
+}
+
+/**
+@fn HT_get
+@brief Finds the value associated with a key in a HashTable. If the value is
+derived from other variables and any of them have changed since it was last
+computed, it is recomputed first.
+@param table Pointer to the HashTable struct to search.
+@param key The string representing the key to find. Must be null-terminated.
+@param valueType Pointer to a value_t which the value's type will be written to.
+May be NULL.
+@return A pointer to the value, or NULL if the key is not present or the value
+could not be recomputed.
+*/
+void *HT_get(HashTable *table, char *key, value_t *valueType)
+{
+	int index = HT_findIndex(table, key);
+	if (index < 0)
+	{
+		return NULL;
+	}
+	if (HT_refresh(table, index))
+	{
+		return NULL;
+	}
+	if (valueType)
+	{
+		*valueType = table->pairs[index].valueType;
+	}
+	return table->pairs[index].value;
+}
+
+/**
+@fn HT_getCache
+@brief Finds the result cached alongside a variable by HT_setCache, bringing a
+derived variable up to date first.
+@param table Pointer to the HashTable struct to search.
+@param key The string representing the variable's key. Must be null-terminated.
+@return A pointer to the cached result, or NULL if the key is not present or
+nothing is cached for the variable's current value.
+*/
+void *HT_getCache(HashTable *table, char *key)
+{
+	int index = HT_findIndex(table, key);
+	if (index < 0 || HT_refresh(table, index))
+	{
+		return NULL;
+	}
+	HashSpace *space = &table->pairs[index];
+	if (space->cache && space->cacheVersion != space->version)
+	{
+		HT_clearCache(space);
+	}
+	return space->cache;
+}
+
+/**
+@fn HT_setCache
+@brief Caches a result computed from a variable's current value alongside it,
+replacing any previous cached result. The table takes ownership of the result,
+and frees it when the variable is reassigned through HT_add, recomputed, or
+freed along with the table.
+@param table Pointer to the HashTable struct containing the variable.
+@param key The string representing the variable's key. Must be null-terminated.
+@param cache Pointer to the result to cache.
+@param freeCache The function which will be used to free the result.
+@return An error code. 0 if no problems were encountered.
+*/
+int HT_setCache(HashTable *table, char *key, void *cache, HT_FreeFunc freeCache)
+{
+	int index = HT_findIndex(table, key);
+	if (index < 0)
+	{
+		return FAIL_KEY_NOT_FOUND;
+	}
+	HashSpace *space = &table->pairs[index];
+	HT_clearCache(space);
+	space->cache = cache;
+	space->cacheVersion = space->version;
+	space->freeCache = freeCache;
+	return 0;
+}
+
 /**
 @fn HT_copyString
 @brief Creates a dynamically allocated copy of the given string.
 @param str The string to be copied.
-@return A dynamically allocated string containing the string given.
+@return A dynamically allocated string containing the string given, or NULL if
+allocation failed.
 */
 char *HT_copyString(char *str)
 {
 	unsigned int len = strlen(str);
-	newStr = (char *)malloc(sizeof(char) * (len + 1));
-	strcpy(newStr, str);
+	char *newStr = (char *)malloc(sizeof(char) * (len + 1));
+	if (newStr)
+	{
+		strcpy(newStr, str);
+	}
 	return newStr;
 }
 
@@ -238,12 +606,15 @@ char *HT_copyString(char *str)
 @param value The data block to be copied.
 @param size The size (in bytes) of the data block to be copied.
 @return A pointer to a dynamically allocated block of data containing the data
-given in value.
+given in value, or NULL if allocation failed.
 */
 void *HT_copyValue(void *value, size_t size)
 {
 	void *newValue = malloc(size);
-	memcpy(newValue, value, size);
+	if (newValue)
+	{
+		memcpy(newValue, value, size);
+	}
 	return newValue;
 }
 
@@ -262,9 +633,68 @@ unsigned int HT_typeSize(value_t type)
 			return sizeof(Matrix);
 		case VT_RATIONAL: 
 			return sizeof(Rational);
+		case VT_TILED_MATRIX:
+			return sizeof(TiledMatrix);
 		default:
 			return FAIL_INVALID_TYPE;
 	}
 
 	return FAIL_INVALID_TYPE;
+}
+
+/**
+@fn HT_releaseValue
+@brief Releases what a value owns without freeing the value struct itself. A
+Matrix's element buffer is released to the buffer pool unless it is borrowed,
+and a TiledMatrix is closed (see TM_close), which flushes its modified tiles,
+drops them from its cache and closes its file. A Rational owns nothing.
+@param value Pointer to the value.
+@param valueType The type of the value.
+*/
+void HT_releaseValue(void *value, value_t valueType)
+{
+	if (valueType == VT_MATRIX)
+	{
+		Matrix *m = (Matrix *)value;
+		if (!m->isBorrowed)
+		{
+			BP_release(m->elements);
+		}
+	}
+	else if (valueType == VT_TILED_MATRIX)
+	{
+		TM_close((TiledMatrix *)value);
+	}
+}
+
+/**
+@fn HT_sharesValue
+@brief Checks whether two values own the same thing: two Matrices with the same
+element buffer, or two TiledMatrices on the same file and cache. Releasing one
+of them would then break the other.
+@param first Pointer to the first value.
+@param firstType The type of the first value.
+@param second Pointer to the second value.
+@param secondType The type of the second value.
+@return true if the values own the same thing, false otherwise.
+*/
+bool HT_sharesValue(void *first, value_t firstType, void *second,
+	value_t secondType)
+{
+	if (firstType != secondType)
+	{
+		return false;
+	}
+	if (firstType == VT_MATRIX)
+	{
+		return ((Matrix *)first)->elements == ((Matrix *)second)->elements;
+	}
+	if (firstType == VT_TILED_MATRIX)
+	{
+		TiledMatrix *firstTiled = (TiledMatrix *)first;
+		TiledMatrix *secondTiled = (TiledMatrix *)second;
+		return firstTiled->fd == secondTiled->fd &&
+			firstTiled->cache == secondTiled->cache;
+	}
+	return false;
 }
\ No newline at end of file
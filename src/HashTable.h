@@ -16,6 +16,11 @@ declared by the user through the matrix shell.
 #include <stdbool.h>
 
 /*** DEFINES: ***/
+#define FAIL_TABLE_FULL -1
+#define ERR_NEXT_LINK_OUT_OF_BOUNDS -2
+#define FAIL_INVALID_TYPE 0
+#define FAIL_KEY_NOT_FOUND -3
+#define FAIL_CYCLIC_DEPENDENCY -4
 
 /*** STRUCTS: ***/
 
@@ -27,13 +32,34 @@ hash table.
 the Matrix type.
 @var VT_RATIONAL Indicates that whatever variable this is associated with is of
 the Rational type.
+@var VT_TILED_MATRIX Indicates that whatever variable this is associated with is
+of the TiledMatrix type.
 */
 typedef enum 
 {
 	VT_MATRIX,
-	VT_RATIONAL
+	VT_RATIONAL,
+	VT_TILED_MATRIX
 } value_t;
 
+/**
+@def HT_RecomputeFunc
+@brief A function which recomputes the value of a derived variable from the
+variables it depends on.
+@param context The context pointer given when the derived variable was added.
+@param dest Pointer to the variable's value, which the function overwrites with
+the recomputed value.
+@return An error code. 0 if no problems were encountered.
+*/
+typedef int (*HT_RecomputeFunc)(void *context, void *dest);
+
+/**
+@def HT_FreeFunc
+@brief A function which frees a value cached alongside a variable.
+@param cache Pointer to the cached value.
+*/
+typedef void (*HT_FreeFunc)(void *cache);
+
 /**
 @def HashSpace
 @brief A struct representing a single cell in the hash table.
@@ -48,6 +74,24 @@ hash table its coalescing behavior. By following the chain of indexes, one can
 search through all key/value pairs that have collided.
 @var hasLink A boolean value representing whether or not this HashSpace links to 
 another HashSpace.
+@var version A counter which is incremented each time this space's value
+changes. Derived variables compare it against the versions they were computed
+from to decide whether they are out of date.
+@var dependencyIndices The indexes in the hash table of the variables this
+variable was derived from. NULL if this variable is not derived.
+@var dependencyVersions The versions of each dependency at the time this
+variable's value was last computed.
+@var numDependencies The number of variables this variable was derived from.
+@var recompute The function used to recompute this variable's value when any
+of its dependencies change. NULL if this variable is not derived.
+@var recomputeContext The context pointer passed to recompute.
+@var isRecomputing A boolean value which is true while this variable is being
+brought up to date. Used to detect cyclic dependencies.
+@var cache A result computed from this variable's value, such as a
+factorization of a Matrix, kept so that it is only computed once. NULL if there
+is none. Freed as soon as the value changes.
+@var cacheVersion The version of the value the cache was computed from.
+@var freeCache The function used to free cache.
 */
 typedef struct 
 {
@@ -56,6 +100,16 @@ typedef struct
 	value_t valueType;
 	int linkedIndex;
 	bool hasLink;
+	unsigned int version;
+	int *dependencyIndices;
+	unsigned int *dependencyVersions;
+	unsigned int numDependencies;
+	HT_RecomputeFunc recompute;
+	void *recomputeContext;
+	bool isRecomputing;
+	void *cache;
+	unsigned int cacheVersion;
+	HT_FreeFunc freeCache;
 } HashSpace;
 
 /**
@@ -93,12 +147,21 @@ HashTable *HT_newTable(unsigned int maxNumItems);
 @fn HT_freeTable
 @brief Frees an allocated HashTable struct.
 NOTE: assumes that all keys and values in the table were dynamically allocated 
-for and thus frees those too.
+for and thus frees those too. The element buffers of matrices are released to
+the buffer pool unless they are borrowed.
 @param table Pointer to a dynamically allocated HashTable struct which will be
 freed.
 */
 void HT_freeTable(HashTable *table);
 
+/**
+@fn HT_reset
+@brief Empties a HashTable without freeing it, so that it can be reused. Keys
+and values are freed as in HT_freeTable, but the list of HashSpaces is kept.
+@param table Pointer to the HashTable to be emptied.
+*/
+void HT_reset(HashTable *table);
+
 /**
 @fn HT_hashValue
 @brief Calculates the hash value of a key using the Jenkins one-at-a-time
@@ -120,7 +183,12 @@ unsigned int jenkins_one_at_a_time_hash_value(char *key, int len);
 
 /**
 @fn HT_add
-@brief Adds a key/value pair to a HashTable.
+@brief Adds a key/value pair to a HashTable. The value struct is copied, and a
+Matrix's element buffer or a TiledMatrix's file becomes owned by the table,
+which releases it (see HT_releaseValue) when the variable is overwritten with a
+different buffer or file, or the table is reset or freed. The caller must not
+release it as well. A Matrix's buffer must come from BP_alloc unless it is
+borrowed, and a TiledMatrix's cache must outlive the variable.
 @param table Pointer to the HashTable struct which the key/value pair will be
 added to.
 @param key The string representing the key to be added. Must be null-terminated.
@@ -129,15 +197,78 @@ For instance, if the value is a Matrix struct, then this parameter would simply
 be the pointer to that struct.
 @param valueType The type of data of the value. If the value is a Matrix struct,
 then valueType will be VT_MATRIX.
-@return An error code. 0 if no problems were encountered.
+@return An error code. 0 if the pair was stored, in which case the table owns
+the value. Any other code means nothing was stored, so the value (and its
+buffer or file) is still the caller's to release.
 */
 int HT_add(HashTable *table, char *key, void *value, value_t valueType);
 
+/**
+@fn HT_addDerived
+@brief Adds a key/value pair to a HashTable whose value is derived from other
+variables already in the table. When any of those variables are later
+overwritten through HT_add, this variable is recomputed the next time it is
+read through HT_get. If none of them have changed, reading it does no work.
+@param table Pointer to the HashTable struct which the key/value pair will be
+added to.
+@param key The string representing the key to be added. Must be null-terminated.
+@param value Pointer to the current value of the derived variable.
+@param valueType The type of data of the value.
+@param dependencies The keys of the variables this variable is derived from.
+@param numDependencies The number of keys in dependencies.
+@param recompute The function which recomputes the value from its dependencies.
+@param context A pointer which will be passed to recompute.
+@return An error code. 0 if no problems were encountered.
+*/
+int HT_addDerived(HashTable *table, char *key, void *value, value_t valueType,
+	char **dependencies, unsigned int numDependencies, 
+	HT_RecomputeFunc recompute, void *context);
+
+/**
+@fn HT_get
+@brief Finds the value associated with a key in a HashTable. If the value is
+derived from other variables and any of them have changed since it was last
+computed, it is recomputed first.
+@param table Pointer to the HashTable struct to search.
+@param key The string representing the key to find. Must be null-terminated.
+@param valueType Pointer to a value_t which the value's type will be written to.
+May be NULL.
+@return A pointer to the value, or NULL if the key is not present or the value
+could not be recomputed.
+*/
+void *HT_get(HashTable *table, char *key, value_t *valueType);
+
+/**
+@fn HT_getCache
+@brief Finds the result cached alongside a variable by HT_setCache, bringing a
+derived variable up to date first.
+@param table Pointer to the HashTable struct to search.
+@param key The string representing the variable's key. Must be null-terminated.
+@return A pointer to the cached result, or NULL if the key is not present or
+nothing is cached for the variable's current value.
+*/
+void *HT_getCache(HashTable *table, char *key);
+
+/**
+@fn HT_setCache
+@brief Caches a result computed from a variable's current value alongside it,
+replacing any previous cached result. The table takes ownership of the result,
+and frees it when the variable is reassigned through HT_add, recomputed, or
+freed along with the table.
+@param table Pointer to the HashTable struct containing the variable.
+@param key The string representing the variable's key. Must be null-terminated.
+@param cache Pointer to the result to cache.
+@param freeCache The function which will be used to free the result.
+@return An error code. 0 if no problems were encountered.
+*/
+int HT_setCache(HashTable *table, char *key, void *cache, HT_FreeFunc freeCache);
+
 /**
 @fn HT_copyString
 @brief Creates a dynamically allocated copy of the given string.
 @param str The string to be copied.
-@return A dynamically allocated string containing the string given.
+@return A dynamically allocated string containing the string given, or NULL if
+allocation failed.
 */
 char *HT_copyString(char *str);
 
@@ -147,7 +278,7 @@ char *HT_copyString(char *str);
 @param value The data block to be copied.
 @param size The size (in bytes) of the data block to be copied.
 @return A pointer to a dynamically allocated block of data containing the data
-given in value.
+given in value, or NULL if allocation failed.
 */
 void *HT_copyValue(void *value, size_t size);
 
@@ -160,6 +291,31 @@ a value_t variable.
 */
 unsigned int HT_typeSize(value_t type);
 
+/**
+@fn HT_releaseValue
+@brief Releases what a value owns without freeing the value struct itself. A
+Matrix's element buffer is released to the buffer pool unless it is borrowed,
+and a TiledMatrix is closed (see TM_close), which flushes its modified tiles,
+drops them from its cache and closes its file. A Rational owns nothing.
+@param value Pointer to the value.
+@param valueType The type of the value.
+*/
+void HT_releaseValue(void *value, value_t valueType);
+
+/**
+@fn HT_sharesValue
+@brief Checks whether two values own the same thing: two Matrices with the same
+element buffer, or two TiledMatrices on the same file and cache. Releasing one
+of them would then break the other.
+@param first Pointer to the first value.
+@param firstType The type of the first value.
+@param second Pointer to the second value.
+@param secondType The type of the second value.
+@return true if the values own the same thing, false otherwise.
+*/
+bool HT_sharesValue(void *first, value_t firstType, void *second,
+	value_t secondType);
+
 
 
 #endif /* HASHTABLE_H */
\ No newline at end of file
@@ -0,0 +1,193 @@
+/**
+@file Instrument.c
+@author Rob Thomas
+@brief Contains functions for reading, resetting and printing the optional
+instrumentation counters declared in Instrument.h.
+*/
+
+/*** INCLUDES: ***/
+#include <string.h>
+#include <pthread.h>
+
+#include "Instrument.h"
+
+/*** DEFINES: ***/
+
+/*** GLOBALS: ***/
+#ifdef MS_INSTRUMENT
+_Thread_local InstrumentCounters instrumentCounters;
+_Thread_local bool instrumentIsRegistered;
+static InstrumentCounters instrumentExited;
+static pthread_mutex_t instrumentLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t instrumentExitKey;
+static pthread_once_t instrumentExitOnce = PTHREAD_ONCE_INIT;
+#endif
+
+/*** FUNCTION DEFINITIONS: ***/
+
+#ifdef MS_INSTRUMENT
+/**
+@fn INST_merge
+@brief Adds one set of counters into another.
+@param dest Pointer to the counters to add to.
+@param src Pointer to the counters to add.
+*/
+static void INST_merge (InstrumentCounters *dest, const InstrumentCounters *src)
+{
+	dest->gcdCalls += src->gcdCalls;
+	dest->gcdIterations += src->gcdIterations;
+	dest->reduceCalls += src->reduceCalls;
+	dest->reduce64Calls += src->reduce64Calls;
+	dest->reductions += src->reductions;
+	dest->overflows += src->overflows;
+	dest->tableAdds += src->tableAdds;
+	dest->tableCollisions += src->tableCollisions;
+	dest->tableProbes += src->tableProbes;
+	dest->tableChainHops += src->tableChainHops;
+	if ( src->tableLongestChain > dest->tableLongestChain )
+	{
+		dest->tableLongestChain = src->tableLongestChain;
+	}
+	dest->tableNextLinkAdvances += src->tableNextLinkAdvances;
+}
+
+/**
+@fn INST_exitThread
+@brief Adds an exiting thread's counters to the totals.
+@param counters The thread's value for instrumentExitKey, which points to its
+counters.
+*/
+static void INST_exitThread (void *counters)
+{
+	pthread_mutex_lock(&instrumentLock);
+	INST_merge(&instrumentExited, (InstrumentCounters *)counters);
+	pthread_mutex_unlock(&instrumentLock);
+}
+
+/**
+@fn INST_createExitKey
+@brief Creates the key whose destructor collects each thread's counters.
+*/
+static void INST_createExitKey ()
+{
+	pthread_key_create(&instrumentExitKey, INST_exitThread);
+}
+
+/**
+@fn INST_registerThread
+@brief Arranges for the calling thread's counters to be added to the totals
+when it exits. Called by the INST_ macros the first time a thread counts.
+*/
+void INST_registerThread ()
+{
+	pthread_once(&instrumentExitOnce, INST_createExitKey);
+	pthread_setspecific(instrumentExitKey, &instrumentCounters);
+	instrumentIsRegistered = true;
+}
+#endif
+
+/**
+@fn INST_snapshot
+@brief Returns a copy of the calling thread's counters. All zero when
+instrumentation is compiled out.
+@return The calling thread's counters.
+*/
+InstrumentCounters INST_snapshot ()
+{
+#ifdef MS_INSTRUMENT
+	return instrumentCounters;
+#else
+	InstrumentCounters empty;
+	memset(&empty, 0, sizeof(empty));
+	return empty;
+#endif
+}
+
+/**
+@fn INST_total
+@brief Returns the calling thread's counters combined with those of every
+thread which has exited, such as the workers of a JobPool which has been
+freed. Counts are summed and tableLongestChain is the largest of them. All zero
+when instrumentation is compiled out.
+@return The combined counters.
+*/
+InstrumentCounters INST_total ()
+{
+	InstrumentCounters total = INST_snapshot();
+#ifdef MS_INSTRUMENT
+	pthread_mutex_lock(&instrumentLock);
+	INST_merge(&total, &instrumentExited);
+	pthread_mutex_unlock(&instrumentLock);
+#endif
+	return total;
+}
+
+/**
+@fn INST_reset
+@brief Sets all of the calling thread's counters, and the totals collected from
+threads which have exited, back to zero.
+*/
+void INST_reset ()
+{
+#ifdef MS_INSTRUMENT
+	memset(&instrumentCounters, 0, sizeof(instrumentCounters));
+	pthread_mutex_lock(&instrumentLock);
+	memset(&instrumentExited, 0, sizeof(instrumentExited));
+	pthread_mutex_unlock(&instrumentLock);
+#endif
+}
+
+#ifdef MS_INSTRUMENT
+/**
+@fn INST_ratio
+@brief Divides two counters, treating division by zero as zero.
+@param numerator The counter to divide.
+@param denominator The counter to divide by.
+@return numerator / denominator, or 0 if denominator is 0.
+*/
+static double INST_ratio (uint64_t numerator, uint64_t denominator)
+{
+	return denominator ? (double)numerator / denominator : 0.0;
+}
+#endif
+
+/**
+@fn INST_printSummary
+@brief Prints a summary of the counters returned by INST_total, including
+derived figures such as the mean Euclidean steps per GCD and mean chain length
+per HT_add.
+@param out The stream to print to.
+*/
+void INST_printSummary (FILE *out)
+{
+#ifndef MS_INSTRUMENT
+	fprintf(out, "Instrumentation is disabled. Rebuild with -DMS_INSTRUMENT.\n");
+#else
+	InstrumentCounters c = INST_total();
+	fprintf(out, "Rational:\n");
+	fprintf(out, "  GCD calls            %12llu  (%.2f steps each)\n",
+		(unsigned long long)c.gcdCalls, INST_ratio(c.gcdIterations, c.gcdCalls));
+	fprintf(out, "  R_reduce calls       %12llu\n",
+		(unsigned long long)c.reduceCalls);
+	fprintf(out, "  R_reduce64 calls     %12llu\n",
+		(unsigned long long)c.reduce64Calls);
+	fprintf(out, "  reductions (gcd > 1) %12llu\n",
+		(unsigned long long)c.reductions);
+	fprintf(out, "  32-bit overflows     %12llu\n",
+		(unsigned long long)c.overflows);
+	fprintf(out, "HashTable:\n");
+	fprintf(out, "  HT_add calls         %12llu\n",
+		(unsigned long long)c.tableAdds);
+	fprintf(out, "  collisions           %12llu  (%.1f%%)\n",
+		(unsigned long long)c.tableCollisions,
+		100.0 * INST_ratio(c.tableCollisions, c.tableAdds));
+	fprintf(out, "  spaces probed        %12llu  (%.2f per add)\n",
+		(unsigned long long)c.tableProbes, INST_ratio(c.tableProbes, c.tableAdds));
+	fprintf(out, "  chain hops           %12llu  (%.2f per add, longest %llu)\n",
+		(unsigned long long)c.tableChainHops,
+		INST_ratio(c.tableChainHops, c.tableAdds),
+		(unsigned long long)c.tableLongestChain);
+	fprintf(out, "  nextLink advances    %12llu\n",
+		(unsigned long long)c.tableNextLinkAdvances);
+#endif
+}
\ No newline at end of file
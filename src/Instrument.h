@@ -0,0 +1,152 @@
+/**
+@file Instrument.h
+@author Rob Thomas
+@brief Contains optional instrumentation counters for the hot paths of
+Rational.c and HashTable.c. Counters are only compiled in when MS_INSTRUMENT is
+defined; otherwise every INST_ macro expands to nothing. Each thread counts
+into its own set of counters, so instrumented code needs no synchronization,
+and a thread's counters are added to the process-wide totals when it exits.
+*/
+
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+/*** INCLUDES: ***/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*** STRUCTS: ***/
+
+/**
+@def InstrumentCounters
+@brief A struct representing one thread's instrumentation counters.
+@var gcdCalls The number of calls to R_GCD.
+@var gcdIterations The number of Euclidean steps taken by R_GCD.
+@var reduceCalls The number of calls to R_reduce.
+@var reduce64Calls The number of calls to R_reduce64.
+@var reductions The number of reductions where the GCD was greater than 1.
+@var overflows The number of R_reduce64 results which did not fit in 32 bits.
+@var tableAdds The number of calls to HT_add.
+@var tableCollisions The number of HT_add calls whose home space was taken.
+@var tableProbes The number of HashSpaces examined by HT_add.
+@var tableChainHops The number of links followed by HT_add.
+@var tableLongestChain The most links followed by a single HT_add call.
+@var tableNextLinkAdvances The number of times nextLink was moved forward.
+*/
+typedef struct
+{
+	uint64_t gcdCalls;
+	uint64_t gcdIterations;
+	uint64_t reduceCalls;
+	uint64_t reduce64Calls;
+	uint64_t reductions;
+	uint64_t overflows;
+	uint64_t tableAdds;
+	uint64_t tableCollisions;
+	uint64_t tableProbes;
+	uint64_t tableChainHops;
+	uint64_t tableLongestChain;
+	uint64_t tableNextLinkAdvances;
+} InstrumentCounters;
+
+/*** DEFINES: ***/
+
+#ifdef MS_INSTRUMENT
+
+/**
+@var instrumentCounters
+@brief The calling thread's instrumentation counters.
+*/
+extern _Thread_local InstrumentCounters instrumentCounters;
+
+/**
+@var instrumentIsRegistered
+@brief Whether the calling thread has arranged for its counters to be added to
+the totals when it exits.
+*/
+extern _Thread_local bool instrumentIsRegistered;
+
+/**
+@fn INST_registerThread
+@brief Arranges for the calling thread's counters to be added to the totals
+when it exits. Called by the INST_ macros the first time a thread counts.
+*/
+void INST_registerThread ();
+
+/**
+@def INST_THREAD
+@brief Registers the calling thread if it has not counted anything yet.
+*/
+#define INST_THREAD() \
+	(instrumentIsRegistered ? (void)0 : INST_registerThread())
+
+/**
+@def INST_COUNT
+@brief Adds to one of the calling thread's counters.
+@param counter The name of the counter field.
+@param amount The amount to add.
+*/
+#define INST_COUNT(counter, amount) \
+	(INST_THREAD(), instrumentCounters.counter += (amount))
+
+/**
+@def INST_MAX
+@brief Raises one of the calling thread's counters to a value if it is lower.
+@param counter The name of the counter field.
+@param value The value to compare against.
+*/
+#define INST_MAX(counter, value) \
+	do \
+	{ \
+		INST_THREAD(); \
+		if ( (uint64_t)(value) > instrumentCounters.counter ) \
+		{ \
+			instrumentCounters.counter = (value); \
+		} \
+	} while ( 0 )
+
+#else
+
+#define INST_COUNT(counter, amount) ((void)0)
+#define INST_MAX(counter, value) ((void)(value))
+
+#endif /* MS_INSTRUMENT */
+
+/*** FUNCTION PROTOTYPES: ***/
+
+/**
+@fn INST_snapshot
+@brief Returns a copy of the calling thread's counters. All zero when
+instrumentation is compiled out.
+@return The calling thread's counters.
+*/
+InstrumentCounters INST_snapshot ();
+
+/**
+@fn INST_total
+@brief Returns the calling thread's counters combined with those of every
+thread which has exited, such as the workers of a JobPool which has been
+freed. Counts are summed and tableLongestChain is the largest of them. All zero
+when instrumentation is compiled out.
+@return The combined counters.
+*/
+InstrumentCounters INST_total ();
+
+/**
+@fn INST_reset
+@brief Sets all of the calling thread's counters, and the totals collected from
+threads which have exited, back to zero.
+*/
+void INST_reset ();
+
+/**
+@fn INST_printSummary
+@brief Prints a summary of the counters returned by INST_total, including
+derived figures such as the mean Euclidean steps per GCD and mean chain length
+per HT_add.
+@param out The stream to print to.
+*/
+void INST_printSummary (FILE *out);
+
+#endif /* INSTRUMENT_H */
\ No newline at end of file
@@ -0,0 +1,688 @@
+/**
+@file JobPool.c
+@author Rob Thomas
+@brief Contains functions for running long matrix commands as background jobs
+on a pool of worker threads, so the shell prompt stays responsive. Each job
+computes the value of one variable, which is added to the pool's HashTable
+when the job finishes. Jobs report their progress and can be cancelled, and
+reading a variable whose job is still pending waits for that job.
+*/
+
+/*** INCLUDES: ***/
+#include <stdlib.h>
+#include <string.h>
+
+#include "JobPool.h"
+#include "BufferPool.h"
+
+/*** DEFINES: ***/
+
+/*** STRUCTS: ***/
+
+/**
+@def JP_ExpressionContext
+@brief A struct holding the matrix expression evaluated by a job submitted
+with JP_submitExpression.
+@var terms The copied list of terms.
+@var numTerms The number of terms in the list.
+@var numRows The number of rows of the result.
+@var numCols The number of columns of the result.
+*/
+typedef struct
+{
+	MatrixTerm *terms;
+	unsigned int numTerms;
+	unsigned int numRows;
+	unsigned int numCols;
+} JP_ExpressionContext;
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn JP_isPending
+@brief Checks whether a job has not yet finished.
+@param job Pointer to the job.
+@return true if the job is queued or running, false otherwise.
+*/
+static bool JP_isPending (JP_Job *job)
+{
+	return job->state == JS_QUEUED || job->state == JS_RUNNING;
+}
+
+/**
+@fn JP_findJob
+@brief Finds a job by id. Must be called with the pool's lock held.
+@param pool Pointer to the JobPool.
+@param id The job's id.
+@return A pointer to the job, or NULL if there is no such job.
+*/
+static JP_Job *JP_findJob (JobPool *pool, unsigned int id)
+{
+	for (JP_Job *job = pool->jobs; job; job = job->next)
+	{
+		if ( job->id == id )
+		{
+			return job;
+		}
+	}
+	return NULL;
+}
+
+/**
+@fn JP_hasPendingJob
+@brief Checks whether any job computing a variable is queued or running. Must
+be called with the pool's lock held.
+@param pool Pointer to the JobPool.
+@param key The key of the variable.
+@return true if such a job exists, false otherwise.
+*/
+static bool JP_hasPendingJob (JobPool *pool, char *key)
+{
+	for (JP_Job *job = pool->jobs; job; job = job->next)
+	{
+		if ( JP_isPending(job) && !strcmp(job->key, key) )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+@fn JP_finishJob
+@brief Records that a job is over and wakes anyone waiting on it. Must be
+called with the pool's lock held.
+@param pool Pointer to the JobPool.
+@param job Pointer to the job.
+@param error The job's error code.
+*/
+static void JP_finishJob (JobPool *pool, JP_Job *job, int error)
+{
+	job->error = error;
+	if ( !error )
+	{
+		job->state = JS_DONE;
+		atomic_store(&job->progress, JP_PROGRESS_SCALE);
+	}
+	else if ( error == ERR_JOB_CANCELLED )
+	{
+		job->state = JS_CANCELLED;
+	}
+	else
+	{
+		job->state = JS_FAILED;
+	}
+	if ( job->freeContext )
+	{
+		job->freeContext(job->context);
+	}
+	job->context = NULL;
+	pthread_cond_broadcast(&pool->jobFinished);
+}
+
+/**
+@fn JP_worker
+@brief The main loop of a worker thread: takes jobs off the queue, runs them
+without holding the lock, and adds each result to the table.
+@param arg Pointer to the JobPool.
+@return NULL.
+*/
+static void *JP_worker (void *arg)
+{
+	JobPool *pool = (JobPool *)arg;
+	pthread_mutex_lock(&pool->lock);
+	while ( true )
+	{
+		while ( !pool->queueHead && !pool->isShuttingDown )
+		{
+			pthread_cond_wait(&pool->jobQueued, &pool->lock);
+		}
+		if ( !pool->queueHead )
+		{
+			break;
+		}
+		JP_Job *job = pool->queueHead;
+		pool->queueHead = job->nextQueued;
+		if ( !pool->queueHead )
+		{
+			pool->queueTail = NULL;
+		}
+		if ( atomic_load(&job->isCancelled) )
+		{
+			JP_finishJob(pool, job, ERR_JOB_CANCELLED);
+			continue;
+		}
+		job->state = JS_RUNNING;
+		pthread_mutex_unlock(&pool->lock);
+
+		int error = 0;
+		void *result = calloc(1, HT_typeSize(job->valueType));
+		if ( !result )
+		{
+			error = ERR_ALLOCATION_FAILED;
+		}
+		else
+		{
+			error = job->run(job, job->context, result);
+		}
+		/* A job cancelled after computing its value still loses the value. */
+		if ( !error && atomic_load(&job->isCancelled) )
+		{
+			error = ERR_JOB_CANCELLED;
+			HT_releaseValue(result, job->valueType);
+		}
+
+		pthread_mutex_lock(&pool->lock);
+		if ( !error )
+		{
+			/* Only a stored result belongs to the table. */
+			error = HT_add(pool->table, job->key, result, job->valueType);
+			if ( error )
+			{
+				HT_releaseValue(result, job->valueType);
+			}
+		}
+		free(result);
+		JP_finishJob(pool, job, error);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+
+/**
+@fn JP_new
+@brief Creates a JobPool and starts its worker threads.
+@param table Pointer to the HashTable finished jobs add their variables to.
+@param numWorkers The number of worker threads. At least one is started.
+@return A pointer to the new JobPool, or NULL if it could not be created.
+*/
+JobPool *JP_new (HashTable *table, unsigned int numWorkers)
+{
+	if ( numWorkers == 0 )
+	{
+		numWorkers = 1;
+	}
+	JobPool *pool = (JobPool *)calloc(1, sizeof(JobPool));
+	if ( !pool )
+	{
+		return NULL;
+	}
+	pool->workers = (pthread_t *)malloc(sizeof(pthread_t) * numWorkers);
+	if ( !pool->workers )
+	{
+		free(pool);
+		return NULL;
+	}
+	pool->table = table;
+	pool->nextId = 1;
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->jobQueued, NULL);
+	pthread_cond_init(&pool->jobFinished, NULL);
+	for (unsigned int i = 0; i < numWorkers; i++)
+	{
+		if ( pthread_create(&pool->workers[i], NULL, JP_worker, pool) )
+		{
+			break;
+		}
+		pool->numWorkers++;
+	}
+	if ( pool->numWorkers == 0 )
+	{
+		JP_free(pool);
+		return NULL;
+	}
+	return pool;
+}
+
+/**
+@fn JP_free
+@brief Cancels every job which is not over yet, waits for the workers to stop,
+and frees the JobPool. The HashTable is not freed.
+@param pool Pointer to the JobPool to be freed.
+*/
+void JP_free (JobPool *pool)
+{
+	pthread_mutex_lock(&pool->lock);
+	for (JP_Job *job = pool->jobs; job; job = job->next)
+	{
+		atomic_store(&job->isCancelled, true);
+	}
+	pool->isShuttingDown = true;
+	pthread_cond_broadcast(&pool->jobQueued);
+	pthread_mutex_unlock(&pool->lock);
+	/* The workers drain the queue, finishing each cancelled job, before they
+	   exit. */
+	for (unsigned int i = 0; i < pool->numWorkers; i++)
+	{
+		pthread_join(pool->workers[i], NULL);
+	}
+	JP_Job *job = pool->jobs;
+	while ( job )
+	{
+		JP_Job *next = job->next;
+		free(job->key);
+		free(job);
+		job = next;
+	}
+	pthread_cond_destroy(&pool->jobFinished);
+	pthread_cond_destroy(&pool->jobQueued);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->workers);
+	free(pool);
+}
+
+/**
+@fn JP_submit
+@brief Queues a job which computes the value of a variable.
+@param pool Pointer to the JobPool.
+@param key The key of the variable the job computes. Must be null-terminated.
+@param valueType The type of the variable.
+@param run The function which computes the variable's value.
+@param context A pointer which will be passed to run.
+@param freeContext The function used to free context once the job is over.
+May be NULL.
+@param id Pointer to where the job's id will be written.
+@return An error code. 0 if no problems were encountered.
+*/
+int JP_submit (JobPool *pool, char *key, value_t valueType, JP_JobFunc run,
+	void *context, HT_FreeFunc freeContext, unsigned int *id)
+{
+	JP_Job *job = (JP_Job *)calloc(1, sizeof(JP_Job));
+	if ( !job )
+	{
+		return ERR_ALLOCATION_FAILED;
+	}
+	job->key = HT_copyString(key);
+	if ( !job->key )
+	{
+		free(job);
+		return ERR_ALLOCATION_FAILED;
+	}
+	job->valueType = valueType;
+	job->run = run;
+	job->context = context;
+	job->freeContext = freeContext;
+	job->state = JS_QUEUED;
+	atomic_init(&job->progress, 0);
+	atomic_init(&job->isCancelled, false);
+
+	pthread_mutex_lock(&pool->lock);
+	job->id = pool->nextId++;
+	job->next = pool->jobs;
+	pool->jobs = job;
+	if ( pool->queueTail )
+	{
+		pool->queueTail->nextQueued = job;
+	}
+	else
+	{
+		pool->queueHead = job;
+	}
+	pool->queueTail = job;
+	*id = job->id;
+	pthread_cond_signal(&pool->jobQueued);
+	pthread_mutex_unlock(&pool->lock);
+	return 0;
+}
+
+/**
+@fn JP_freeExpression
+@brief Frees a JP_ExpressionContext.
+@param context Pointer to the JP_ExpressionContext.
+*/
+static void JP_freeExpression (void *context)
+{
+	JP_ExpressionContext *expression = (JP_ExpressionContext *)context;
+	free(expression->terms);
+	free(expression);
+}
+
+/**
+@fn JP_rowView
+@brief Builds a Matrix which refers to a range of rows of another Matrix
+without copying them.
+@param m Pointer to the Matrix.
+@param firstRow The first row of the range.
+@param numRows The number of rows in the range.
+@return The view of the rows.
+*/
+static Matrix JP_rowView (Matrix *m, unsigned int firstRow, unsigned int numRows)
+{
+	Matrix view = *m;
+	view.numRows = numRows;
+	view.elements = &M_AT(m, firstRow, 0);
+	view.isBorrowed = true;
+	return view;
+}
+
+/**
+@fn JP_runExpression
+@brief The job function of JP_submitExpression. Evaluates the expression a
+block of rows at a time, since row i of every term only depends on row i of
+its left operand.
+@param job Pointer to the running job.
+@param context Pointer to the JP_ExpressionContext.
+@param result Pointer to the Matrix the result is written to.
+@return An error code. 0 if no problems were encountered.
+*/
+static int JP_runExpression (JP_Job *job, void *context, void *result)
+{
+	JP_ExpressionContext *expression = (JP_ExpressionContext *)context;
+	unsigned int numTerms = expression->numTerms;
+	Matrix *dest = M_new(expression->numRows, expression->numCols);
+	MatrixTerm *slices = (MatrixTerm *)malloc(sizeof(MatrixTerm) * numTerms);
+	Matrix *views = (Matrix *)malloc(sizeof(Matrix) * numTerms);
+	if ( !dest || !slices || !views )
+	{
+		if ( dest )
+		{
+			M_free(dest);
+		}
+		free(slices);
+		free(views);
+		return ERR_ALLOCATION_FAILED;
+	}
+	unsigned int step = expression->numRows / JP_PROGRESS_STEPS + 1;
+	int error = 0;
+	for (unsigned int row = 0; row < expression->numRows && !error; row += step)
+	{
+		if ( JP_isCancelled(job) )
+		{
+			error = ERR_JOB_CANCELLED;
+			break;
+		}
+		unsigned int numRows = expression->numRows - row < step ?
+			expression->numRows - row : step;
+		for (unsigned int t = 0; t < numTerms; t++)
+		{
+			views[t] = JP_rowView(expression->terms[t].left, row, numRows);
+			slices[t] = expression->terms[t];
+			slices[t].left = &views[t];
+		}
+		Matrix destView = JP_rowView(dest, row, numRows);
+		error = ME_evaluate(&destView, slices, numTerms);
+		JP_setProgress(job, (double)(row + numRows) / expression->numRows);
+	}
+	free(slices);
+	free(views);
+	if ( error )
+	{
+		M_free(dest);
+		return error;
+	}
+	/* The blocks were hashed separately, so hash the whole result. */
+	M_rehash(dest);
+	*(Matrix *)result = *dest;
+	free(dest);
+	return 0;
+}
+
+/**
+@fn JP_submitExpression
+@brief Queues a job which evaluates a matrix expression (see ME_evaluate) into
+a new Matrix variable. The rows of the result are evaluated in blocks, with the
+progress updated and cancellation checked between blocks.
+@param pool Pointer to the JobPool.
+@param key The key of the variable the result will be stored in.
+@param terms The list of terms to be summed. The list is copied, but the
+matrices it refers to must stay unchanged until the job is over.
+@param numTerms The number of terms in the list.
+@param numRows The number of rows of the result.
+@param numCols The number of columns of the result.
+@param id Pointer to where the job's id will be written.
+@return An error code. 0 if no problems were encountered.
+*/
+int JP_submitExpression (JobPool *pool, char *key, MatrixTerm *terms,
+	unsigned int numTerms, unsigned int numRows, unsigned int numCols,
+	unsigned int *id)
+{
+	if ( numTerms == 0 )
+	{
+		return ERR_NO_TERMS;
+	}
+	/* Check the dimensions now so mistakes are reported at the prompt rather
+	   than when the job runs. */
+	for (unsigned int t = 0; t < numTerms; t++)
+	{
+		Matrix *left = terms[t].left;
+		if ( left->numRows != numRows )
+		{
+			return ERR_DIMENSION_MISMATCH;
+		}
+		if ( terms[t].type == MT_PRODUCT ? (left->numCols != terms[t].right->numRows ||
+			terms[t].right->numCols != numCols) : left->numCols != numCols )
+		{
+			return ERR_DIMENSION_MISMATCH;
+		}
+	}
+	JP_ExpressionContext *expression =
+		(JP_ExpressionContext *)malloc(sizeof(JP_ExpressionContext));
+	if ( !expression )
+	{
+		return ERR_ALLOCATION_FAILED;
+	}
+	expression->terms = (MatrixTerm *)HT_copyValue(terms,
+		sizeof(MatrixTerm) * numTerms);
+	if ( !expression->terms )
+	{
+		free(expression);
+		return ERR_ALLOCATION_FAILED;
+	}
+	expression->numTerms = numTerms;
+	expression->numRows = numRows;
+	expression->numCols = numCols;
+	int error = JP_submit(pool, key, VT_MATRIX, JP_runExpression, expression,
+		JP_freeExpression, id);
+	if ( error )
+	{
+		JP_freeExpression(expression);
+	}
+	return error;
+}
+
+/**
+@fn JP_status
+@brief Reports how far along a job is.
+@param pool Pointer to the JobPool.
+@param id The job's id.
+@param state Pointer to where the job's state will be written.
+@param progress Pointer to where the fraction of the job completed will be
+written. May be NULL.
+@return An error code. 0 if no problems were encountered.
+*/
+int JP_status (JobPool *pool, unsigned int id, JobState *state,
+	double *progress)
+{
+	pthread_mutex_lock(&pool->lock);
+	JP_Job *job = JP_findJob(pool, id);
+	if ( job )
+	{
+		*state = job->state;
+		if ( progress )
+		{
+			*progress = (double)atomic_load(&job->progress) / JP_PROGRESS_SCALE;
+		}
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return job ? 0 : FAIL_JOB_NOT_FOUND;
+}
+
+/**
+@fn JP_cancel
+@brief Cancels a job. A queued job never runs. A running job stops the next
+time it checks JP_isCancelled, and its variable is not added to the table.
+@param pool Pointer to the JobPool.
+@param id The job's id.
+@return An error code. 0 if no problems were encountered.
+*/
+int JP_cancel (JobPool *pool, unsigned int id)
+{
+	pthread_mutex_lock(&pool->lock);
+	JP_Job *job = JP_findJob(pool, id);
+	if ( job )
+	{
+		atomic_store(&job->isCancelled, true);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return job ? 0 : FAIL_JOB_NOT_FOUND;
+}
+
+/**
+@fn JP_wait
+@brief Waits until a job is over.
+@param pool Pointer to the JobPool.
+@param id The job's id.
+@return The job's error code, 0 if it finished successfully, or
+FAIL_JOB_NOT_FOUND if there is no such job.
+*/
+int JP_wait (JobPool *pool, unsigned int id)
+{
+	pthread_mutex_lock(&pool->lock);
+	JP_Job *job = JP_findJob(pool, id);
+	while ( job && JP_isPending(job) )
+	{
+		pthread_cond_wait(&pool->jobFinished, &pool->lock);
+	}
+	int error = job ? job->error : FAIL_JOB_NOT_FOUND;
+	pthread_mutex_unlock(&pool->lock);
+	return error;
+}
+
+/**
+@fn JP_forget
+@brief Removes a job which is over from the pool, so that the pool does not
+keep every job ever submitted. Its id is no longer found afterwards.
+@param pool Pointer to the JobPool.
+@param id The job's id.
+@return An error code. 0 if the job was removed. FAIL_JOB_NOT_FOUND if there
+is no such job, or FAIL_JOB_PENDING if it is still queued or running.
+*/
+int JP_forget (JobPool *pool, unsigned int id)
+{
+	pthread_mutex_lock(&pool->lock);
+	JP_Job **link = &pool->jobs;
+	while ( *link && (*link)->id != id )
+	{
+		link = &(*link)->next;
+	}
+	JP_Job *job = *link;
+	int error = 0;
+	if ( !job )
+	{
+		error = FAIL_JOB_NOT_FOUND;
+	}
+	else if ( JP_isPending(job) )
+	{
+		error = FAIL_JOB_PENDING;
+	}
+	else
+	{
+		*link = job->next;
+		free(job->key);
+		free(job);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return error;
+}
+
+/**
+@fn JP_get
+@brief Copies the value of a variable out of the pool's table. If any job
+which computes the variable is queued or running, waits for it first.
+A Matrix is copied along with its elements, since the table's own buffer is
+released as soon as a job or JP_set replaces the variable. The copy's buffer
+comes from the buffer pool and belongs to the caller, who releases it with
+BP_release or hands the Matrix on to JP_set or HT_add.
+A TiledMatrix is copied as it is, so the copy refers to the table's file and
+is only valid until the variable is replaced.
+@param pool Pointer to the JobPool.
+@param key The key of the variable. Must be null-terminated.
+@param dest Pointer to a block of HT_typeSize(type) bytes the value is copied
+to.
+@param valueType Pointer to where the value's type will be written. May be
+NULL.
+@return An error code. 0 if no problems were encountered.
+*/
+int JP_get (JobPool *pool, char *key, void *dest, value_t *valueType)
+{
+	pthread_mutex_lock(&pool->lock);
+	while ( JP_hasPendingJob(pool, key) )
+	{
+		pthread_cond_wait(&pool->jobFinished, &pool->lock);
+	}
+	value_t type;
+	void *value = HT_get(pool->table, key, &type);
+	int error = value ? 0 : FAIL_KEY_NOT_FOUND;
+	if ( value && type == VT_MATRIX )
+	{
+		Matrix *copy = M_copy((Matrix *)value);
+		if ( copy )
+		{
+			*(Matrix *)dest = *copy;
+			free(copy);
+		}
+		else
+		{
+			error = ERR_ALLOCATION_FAILED;
+		}
+	}
+	else if ( value )
+	{
+		memcpy(dest, value, HT_typeSize(type));
+	}
+	if ( !error && valueType )
+	{
+		*valueType = type;
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return error;
+}
+
+/**
+@fn JP_set
+@brief Adds a key/value pair to the pool's table (see HT_add).
+@param pool Pointer to the JobPool.
+@param key The key of the variable. Must be null-terminated.
+@param value Pointer to the value.
+@param valueType The type of the value.
+@return An error code. 0 if no problems were encountered.
+*/
+int JP_set (JobPool *pool, char *key, void *value, value_t valueType)
+{
+	pthread_mutex_lock(&pool->lock);
+	int error = HT_add(pool->table, key, value, valueType);
+	pthread_mutex_unlock(&pool->lock);
+	return error;
+}
+
+/**
+@fn JP_setProgress
+@brief Records how far along a running job is. Called by job functions.
+@param job Pointer to the running job.
+@param fraction The fraction of the job completed, from 0 to 1.
+*/
+void JP_setProgress (JP_Job *job, double fraction)
+{
+	if ( fraction < 0 )
+	{
+		fraction = 0;
+	}
+	if ( fraction > 1 )
+	{
+		fraction = 1;
+	}
+	atomic_store_explicit(&job->progress,
+		(unsigned int)(fraction * JP_PROGRESS_SCALE), memory_order_relaxed);
+}
+
+/**
+@fn JP_isCancelled
+@brief Checks whether a running job has been cancelled. Called by job
+functions.
+@param job Pointer to the running job.
+@return true if the job has been cancelled, false otherwise.
+*/
+bool JP_isCancelled (JP_Job *job)
+{
+	return atomic_load_explicit(&job->isCancelled, memory_order_relaxed);
+}
\ No newline at end of file
@@ -0,0 +1,280 @@
+/**
+@file JobPool.h
+@author Rob Thomas
+@brief Contains the JobPool struct and functions for running long matrix
+commands as background jobs on a pool of worker threads, so the shell prompt
+stays responsive. Each job computes the value of one variable, which is added
+to the pool's HashTable when the job finishes. Jobs report their progress and
+can be cancelled, and reading a variable whose job is still pending waits for
+that job.
+NOTE: while a pool exists, its HashTable must only be accessed through JP_get
+and JP_set, which synchronize with the workers.
+*/
+
+#ifndef JOBPOOL_H
+#define JOBPOOL_H
+
+/*** INCLUDES: ***/
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "HashTable.h"
+#include "Matrix.h"
+#include "MatrixExpr.h"
+
+/*** DEFINES: ***/
+#define JP_PROGRESS_SCALE 1000000
+#define JP_PROGRESS_STEPS 100
+
+#define ERR_JOB_CANCELLED -100
+#define FAIL_JOB_NOT_FOUND -101
+#define FAIL_JOB_PENDING -102
+
+/*** STRUCTS: ***/
+
+/**
+@def JobState
+@brief An enumerated type representing how far along a job is.
+@var JS_QUEUED The job is waiting for a free worker.
+@var JS_RUNNING A worker is running the job.
+@var JS_DONE The job finished and its variable was added to the table.
+@var JS_FAILED The job returned an error.
+@var JS_CANCELLED The job was cancelled before it finished.
+*/
+typedef enum
+{
+	JS_QUEUED,
+	JS_RUNNING,
+	JS_DONE,
+	JS_FAILED,
+	JS_CANCELLED
+} JobState;
+
+struct JP_Job;
+
+/**
+@def JP_JobFunc
+@brief A function which computes the value of a job's variable. Long-running
+functions should call JP_setProgress as they go, and stop with
+ERR_JOB_CANCELLED once JP_isCancelled returns true.
+@param job Pointer to the job being run.
+@param context The context pointer given when the job was submitted.
+@param result Pointer to a block of HT_typeSize(valueType) bytes which the
+function writes the value into.
+@return An error code. 0 if no problems were encountered.
+*/
+typedef int (*JP_JobFunc)(struct JP_Job *job, void *context, void *result);
+
+/**
+@def JP_Job
+@brief A struct representing one background job.
+@var id The number identifying the job, unique within its pool.
+@var key The key of the variable the job computes.
+@var valueType The type of the variable.
+@var run The function which computes the variable's value.
+@var context The context pointer passed to run.
+@var freeContext The function used to free context once the job is over. May
+be NULL.
+@var state How far along the job is. Guarded by the pool's lock.
+@var progress The fraction of the job completed, in units of
+1/JP_PROGRESS_SCALE.
+@var isCancelled Set when the job is cancelled.
+@var error The job's error code once it is over.
+@var nextQueued The next job in the queue.
+@var next The next job in the pool's list of every job.
+*/
+typedef struct JP_Job
+{
+	unsigned int id;
+	char *key;
+	value_t valueType;
+	JP_JobFunc run;
+	void *context;
+	HT_FreeFunc freeContext;
+	JobState state;
+	atomic_uint progress;
+	atomic_bool isCancelled;
+	int error;
+	struct JP_Job *nextQueued;
+	struct JP_Job *next;
+} JP_Job;
+
+/**
+@def JobPool
+@brief A struct representing a pool of worker threads and the jobs given to it.
+@var table The HashTable finished jobs add their variables to.
+@var lock Guards the table, the queue, and the state of every job.
+@var jobQueued Signalled when a job is queued or the pool is shutting down.
+@var jobFinished Signalled whenever a job is over.
+@var queueHead The next job to run.
+@var queueTail The last job to run.
+@var jobs Every job submitted to the pool and not yet forgotten (see
+JP_forget), most recent first.
+@var nextId The id the next submitted job will get.
+@var workers The worker threads.
+@var numWorkers The number of worker threads.
+@var isShuttingDown Set when the pool is being freed.
+*/
+typedef struct
+{
+	HashTable *table;
+	pthread_mutex_t lock;
+	pthread_cond_t jobQueued;
+	pthread_cond_t jobFinished;
+	JP_Job *queueHead;
+	JP_Job *queueTail;
+	JP_Job *jobs;
+	unsigned int nextId;
+	pthread_t *workers;
+	unsigned int numWorkers;
+	bool isShuttingDown;
+} JobPool;
+
+/*** FUNCTION PROTOTYPES: ***/
+
+/**
+@fn JP_new
+@brief Creates a JobPool and starts its worker threads.
+@param table Pointer to the HashTable finished jobs add their variables to.
+@param numWorkers The number of worker threads. At least one is started.
+@return A pointer to the new JobPool, or NULL if it could not be created.
+*/
+JobPool *JP_new (HashTable *table, unsigned int numWorkers);
+
+/**
+@fn JP_free
+@brief Cancels every job which is not over yet, waits for the workers to stop,
+and frees the JobPool. The HashTable is not freed.
+@param pool Pointer to the JobPool to be freed.
+*/
+void JP_free (JobPool *pool);
+
+/**
+@fn JP_submit
+@brief Queues a job which computes the value of a variable.
+@param pool Pointer to the JobPool.
+@param key The key of the variable the job computes. Must be null-terminated.
+@param valueType The type of the variable.
+@param run The function which computes the variable's value.
+@param context A pointer which will be passed to run.
+@param freeContext The function used to free context once the job is over.
+May be NULL.
+@param id Pointer to where the job's id will be written.
+@return An error code. 0 if no problems were encountered.
+*/
+int JP_submit (JobPool *pool, char *key, value_t valueType, JP_JobFunc run,
+	void *context, HT_FreeFunc freeContext, unsigned int *id);
+
+/**
+@fn JP_submitExpression
+@brief Queues a job which evaluates a matrix expression (see ME_evaluate) into
+a new Matrix variable. The rows of the result are evaluated in blocks, with the
+progress updated and cancellation checked between blocks.
+@param pool Pointer to the JobPool.
+@param key The key of the variable the result will be stored in.
+@param terms The list of terms to be summed. The list is copied, but the
+matrices it refers to must stay unchanged until the job is over.
+@param numTerms The number of terms in the list.
+@param numRows The number of rows of the result.
+@param numCols The number of columns of the result.
+@param id Pointer to where the job's id will be written.
+@return An error code. 0 if no problems were encountered.
+*/
+int JP_submitExpression (JobPool *pool, char *key, MatrixTerm *terms,
+	unsigned int numTerms, unsigned int numRows, unsigned int numCols,
+	unsigned int *id);
+
+/**
+@fn JP_status
+@brief Reports how far along a job is.
+@param pool Pointer to the JobPool.
+@param id The job's id.
+@param state Pointer to where the job's state will be written.
+@param progress Pointer to where the fraction of the job completed will be
+written. May be NULL.
+@return An error code. 0 if no problems were encountered.
+*/
+int JP_status (JobPool *pool, unsigned int id, JobState *state,
+	double *progress);
+
+/**
+@fn JP_cancel
+@brief Cancels a job. A queued job never runs. A running job stops the next
+time it checks JP_isCancelled, and its variable is not added to the table.
+@param pool Pointer to the JobPool.
+@param id The job's id.
+@return An error code. 0 if no problems were encountered.
+*/
+int JP_cancel (JobPool *pool, unsigned int id);
+
+/**
+@fn JP_wait
+@brief Waits until a job is over.
+@param pool Pointer to the JobPool.
+@param id The job's id.
+@return The job's error code, 0 if it finished successfully, or
+FAIL_JOB_NOT_FOUND if there is no such job.
+*/
+int JP_wait (JobPool *pool, unsigned int id);
+
+/**
+@fn JP_forget
+@brief Removes a job which is over from the pool, so that the pool does not
+keep every job ever submitted. Its id is no longer found afterwards.
+@param pool Pointer to the JobPool.
+@param id The job's id.
+@return An error code. 0 if the job was removed. FAIL_JOB_NOT_FOUND if there
+is no such job, or FAIL_JOB_PENDING if it is still queued or running.
+*/
+int JP_forget (JobPool *pool, unsigned int id);
+
+/**
+@fn JP_get
+@brief Copies the value of a variable out of the pool's table. If any job
+which computes the variable is queued or running, waits for it first.
+A Matrix is copied along with its elements, since the table's own buffer is
+released as soon as a job or JP_set replaces the variable. The copy's buffer
+comes from the buffer pool and belongs to the caller, who releases it with
+BP_release or hands the Matrix on to JP_set or HT_add.
+A TiledMatrix is copied as it is, so the copy refers to the table's file and
+is only valid until the variable is replaced.
+@param pool Pointer to the JobPool.
+@param key The key of the variable. Must be null-terminated.
+@param dest Pointer to a block of HT_typeSize(type) bytes the value is copied
+to.
+@param valueType Pointer to where the value's type will be written. May be
+NULL.
+@return An error code. 0 if no problems were encountered.
+*/
+int JP_get (JobPool *pool, char *key, void *dest, value_t *valueType);
+
+/**
+@fn JP_set
+@brief Adds a key/value pair to the pool's table (see HT_add).
+@param pool Pointer to the JobPool.
+@param key The key of the variable. Must be null-terminated.
+@param value Pointer to the value.
+@param valueType The type of the value.
+@return An error code. 0 if no problems were encountered.
+*/
+int JP_set (JobPool *pool, char *key, void *value, value_t valueType);
+
+/**
+@fn JP_setProgress
+@brief Records how far along a running job is. Called by job functions.
+@param job Pointer to the running job.
+@param fraction The fraction of the job completed, from 0 to 1.
+*/
+void JP_setProgress (JP_Job *job, double fraction);
+
+/**
+@fn JP_isCancelled
+@brief Checks whether a running job has been cancelled. Called by job
+functions.
+@param job Pointer to the running job.
+@return true if the job has been cancelled, false otherwise.
+*/
+bool JP_isCancelled (JP_Job *job);
+
+#endif /* JOBPOOL_H */
\ No newline at end of file
@@ -0,0 +1,976 @@
+/**
+@file LinearSolve.c
+@author Rob Thomas
+@brief Contains functions for solving linear systems A*X = B exactly. Rather
+than eliminating over Rationals, whose tops and bottoms grow until they
+overflow, A is scaled to integers and factored once modulo a word-sized prime.
+Each right-hand side is then solved by p-adic (Dixon) lifting: every lifting
+step is one modular triangular solve and one integer matrix-vector product,
+and the exact rational solution is recovered from the p-adic one by rational
+reconstruction. Any number of right-hand sides can be solved against a single
+factorization.
+*/
+
+/*** INCLUDES: ***/
+#include <string.h>
+
+#include "LinearSolve.h"
+#include "SmallMatrix.h"
+
+/*** DEFINES: ***/
+#define LS_NUM_PRIMES 6
+#define LS_NUM_FACTOR_PRIMES 3
+#define LS_NUM_DETERMINANT_PRIMES 4
+#define LS_MAX_SCALED ((int64_t)1 << 62)
+#define LS_CHECK_PRIME (((uint64_t)1 << 61) - 1)
+#define LS_PRIME_BITS 30
+
+/* The bounds rational reconstruction searches within. The numerator bound
+   leaves room for the common denominator of a right-hand side, which is
+   divided out afterwards. prime^LS_LIFTING_STEPS exceeds twice their product,
+   which makes the reconstructed solution unique. */
+#define LS_NUMERATOR_BOUND ((__int128)1 << 62)
+#define LS_DENOMINATOR_BOUND ((__int128)1 << 31)
+
+/* The determinant of the scaled Matrix is recovered from its residues modulo
+   LS_NUM_DETERMINANT_PRIMES primes, whose product is about 2^124. It equals
+   the determinant of the original Matrix times the product of the row scales,
+   so that product must stay below 2^92 for a determinant which fits in a
+   Rational to be recovered. */
+#define LS_MAX_SCALE_PRODUCT ((__int128)1 << 92)
+
+/*** GLOBALS: ***/
+static const uint32_t LS_primes[LS_NUM_PRIMES] =
+	{2147483647u, 2147483629u, 2147483587u, 2147483579u, 2147483563u,
+	2147483549u};
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn LS_powMod
+@brief Raises a number to a power modulo a prime less than 2^63.
+@param base The number to raise.
+@param exponent The power to raise base to.
+@param prime The modulus.
+@return base^exponent mod prime.
+*/
+static uint64_t LS_powMod (uint64_t base, uint64_t exponent, uint64_t prime)
+{
+	uint64_t result = 1;
+	base %= prime;
+	while ( exponent > 0 )
+	{
+		if ( exponent & 1 )
+		{
+			result = (unsigned __int128)result * base % prime;
+		}
+		base = (unsigned __int128)base * base % prime;
+		exponent >>= 1;
+	}
+	return result;
+}
+
+/**
+@fn LS_mod
+@brief Reduces a signed 128-bit integer modulo a positive modulus.
+@param value The integer to reduce.
+@param modulus The modulus.
+@return value mod modulus, in the range [0, modulus).
+*/
+static uint64_t LS_mod (__int128 value, uint64_t modulus)
+{
+	__int128 remainder = value % (__int128)modulus;
+	return remainder < 0 ? remainder + modulus : remainder;
+}
+
+/**
+@fn LS_GCD128
+@brief Determines the greatest common denominator between two non-negative
+128-bit integers.
+@param a One of the two integers whose GCD will be found.
+@param b One of the two integers whose GCD will be found.
+@return The GCD of a and b.
+*/
+static unsigned __int128 LS_GCD128 (unsigned __int128 a, unsigned __int128 b)
+{
+	while ( b != 0 )
+	{
+		unsigned __int128 swap = a % b;
+		a = b;
+		b = swap;
+	}
+	return a;
+}
+
+/**
+@fn LS_lcm
+@brief Replaces a positive integer with its least common multiple with another.
+@param multiple Pointer to the integer to replace.
+@param value The positive integer to take the least common multiple with.
+@return true if the result fits in 64 bits, false otherwise.
+*/
+static bool LS_lcm (int64_t *multiple, int64_t value)
+{
+	if ( *multiple % value == 0 )
+	{
+		return true;
+	}
+	return !__builtin_mul_overflow(*multiple, value / R_GCD(*multiple, value),
+		multiple);
+}
+
+/**
+@fn LS_factorModPrime
+@brief Factors the scaled Matrix of a factorization modulo one prime using
+Gaussian elimination with row swaps.
+@param f Pointer to the factorization, whose scaled Matrix is filled in.
+@param prime The prime to factor modulo.
+@return true if the Matrix is non-singular modulo prime, false otherwise.
+*/
+static bool LS_factorModPrime (LS_Factorization *f, uint32_t prime)
+{
+	unsigned int n = f->size;
+	uint32_t *lu = f->lu;
+	for (size_t i = 0; i < (size_t)n * n; i++)
+	{
+		lu[i] = LS_mod(f->scaled[i], prime);
+	}
+	for (unsigned int i = 0; i < n; i++)
+	{
+		f->permutation[i] = i;
+	}
+	for (unsigned int k = 0; k < n; k++)
+	{
+		/* Find a row with a non-zero pivot and swap it into place. */
+		unsigned int pivot = k;
+		while ( pivot < n && lu[(size_t)pivot * n + k] == 0 )
+		{
+			pivot++;
+		}
+		if ( pivot == n )
+		{
+			return false;
+		}
+		if ( pivot != k )
+		{
+			for (unsigned int j = 0; j < n; j++)
+			{
+				uint32_t swap = lu[(size_t)k * n + j];
+				lu[(size_t)k * n + j] = lu[(size_t)pivot * n + j];
+				lu[(size_t)pivot * n + j] = swap;
+			}
+			unsigned int swap = f->permutation[k];
+			f->permutation[k] = f->permutation[pivot];
+			f->permutation[pivot] = swap;
+		}
+		uint32_t *pivotRow = &lu[(size_t)k * n];
+		uint64_t inverse = LS_powMod(pivotRow[k], prime - 2, prime);
+		f->inversePivots[k] = inverse;
+		/* Eliminate below the pivot, storing each multiplier in L. */
+		for (unsigned int i = k + 1; i < n; i++)
+		{
+			uint32_t *row = &lu[(size_t)i * n];
+			if ( row[k] == 0 )
+			{
+				continue;
+			}
+			uint64_t multiplier = row[k] * inverse % prime;
+			uint64_t negated = prime - multiplier;
+			row[k] = multiplier;
+			for (unsigned int j = k + 1; j < n; j++)
+			{
+				row[j] = (row[j] + negated * pivotRow[j]) % prime;
+			}
+		}
+	}
+	return true;
+}
+
+/**
+@fn LS_solveModPrime
+@brief Solves A*x = v modulo the factorization's prime.
+@details Sums of products are accumulated without reducing each product: each
+is below prime^2, so subtracting prime^2 whenever the sum reaches it keeps the
+sum below 2^63.
+@param f Pointer to the factorization of A.
+@param v The right-hand side modulo prime, in the original row order.
+@param x The buffer the solution modulo prime is written to.
+*/
+static void LS_solveModPrime (LS_Factorization *f, const uint32_t *v,
+	uint32_t *x)
+{
+	unsigned int n = f->size;
+	uint64_t prime = f->prime;
+	uint64_t primeSquared = prime * prime;
+	const uint32_t *lu = f->lu;
+	/* Forward substitution with L, applying the row permutation. */
+	for (unsigned int i = 0; i < n; i++)
+	{
+		const uint32_t *row = &lu[(size_t)i * n];
+		uint64_t sum = v[f->permutation[i]];
+		for (unsigned int k = 0; k < i; k++)
+		{
+			sum += (prime - row[k]) * x[k];
+			sum -= sum >= primeSquared ? primeSquared : 0;
+		}
+		x[i] = sum % prime;
+	}
+	/* Back substitution with U. */
+	for (unsigned int i = n; i-- > 0; )
+	{
+		const uint32_t *row = &lu[(size_t)i * n];
+		uint64_t sum = x[i];
+		for (unsigned int k = i + 1; k < n; k++)
+		{
+			sum += (prime - row[k]) * x[k];
+			sum -= sum >= primeSquared ? primeSquared : 0;
+		}
+		x[i] = sum % prime * f->inversePivots[i] % prime;
+	}
+}
+
+/**
+@fn LS_reconstruct
+@brief Recovers a fraction num/den from its residue modulo m using the extended
+Euclidean algorithm, where |num| < LS_NUMERATOR_BOUND and
+0 < den < LS_DENOMINATOR_BOUND.
+@param u The residue, in the range [0, m).
+@param m The modulus.
+@param num Pointer to where the numerator will be written.
+@param den Pointer to where the denominator will be written.
+@return true if such a fraction exists, false otherwise.
+*/
+static bool LS_reconstruct (__int128 u, __int128 m, __int128 *num,
+	__int128 *den)
+{
+	__int128 r0 = m, r1 = u;
+	__int128 t0 = 0, t1 = 1;
+	while ( r1 >= LS_NUMERATOR_BOUND )
+	{
+		__int128 quotient = r0 / r1;
+		__int128 swap = r0 - quotient * r1;
+		r0 = r1;
+		r1 = swap;
+		swap = t0 - quotient * t1;
+		t0 = t1;
+		t1 = swap;
+	}
+	if ( t1 < 0 )
+	{
+		r1 = -r1;
+		t1 = -t1;
+	}
+	if ( t1 == 0 || t1 >= LS_DENOMINATOR_BOUND ||
+		LS_GCD128(r1 < 0 ? -r1 : r1, t1) != 1 )
+	{
+		return false;
+	}
+	*num = r1;
+	*den = t1;
+	return true;
+}
+
+/**
+@fn LS_scale
+@brief Scales each row of a square Matrix by the least common multiple of its
+bottoms, which makes every element an integer.
+@param a Pointer to the Matrix to scale.
+@param scaled The buffer of a->numRows^2 integers the scaled Matrix is written
+to.
+@param rowScales The buffer the factor of each row is written to. May be NULL.
+@return An error code. 0 if no problems were encountered.
+*/
+static int LS_scale (Matrix *a, int64_t *scaled, int64_t *rowScales)
+{
+	unsigned int n = a->numRows;
+	for (unsigned int i = 0; i < n; i++)
+	{
+		Rational *row = &M_AT(a, i, 0);
+		int64_t scale = 1;
+		for (unsigned int j = 0; j < n && !a->isInteger; j++)
+		{
+			if ( row[j].bottom <= 0 || !LS_lcm(&scale, row[j].bottom) )
+			{
+				return ERR_SOLVE_OVERFLOW;
+			}
+		}
+		if ( rowScales )
+		{
+			rowScales[i] = scale;
+		}
+		for (unsigned int j = 0; j < n; j++)
+		{
+			int64_t *element = &scaled[(size_t)i * n + j];
+			if ( __builtin_mul_overflow((int64_t)row[j].top,
+				scale / row[j].bottom, element) ||
+				*element >= LS_MAX_SCALED || *element <= -LS_MAX_SCALED )
+			{
+				return ERR_SOLVE_OVERFLOW;
+			}
+		}
+	}
+	return 0;
+}
+
+/**
+@fn LS_eliminateModPrime
+@brief Reduces a scaled Matrix to row echelon form modulo a prime, skipping
+columns with no pivot, to find its rank and determinant modulo that prime.
+@param scaled The scaled Matrix.
+@param n The number of rows (and columns) of the Matrix.
+@param prime The prime to eliminate modulo.
+@param work A buffer of n^2 values to eliminate in.
+@param rank Pointer to where the rank modulo prime will be written.
+@return The determinant modulo prime.
+*/
+static uint64_t LS_eliminateModPrime (const int64_t *scaled, unsigned int n,
+	uint32_t prime, uint32_t *work, unsigned int *rank)
+{
+	for (size_t i = 0; i < (size_t)n * n; i++)
+	{
+		work[i] = LS_mod(scaled[i], prime);
+	}
+	uint64_t determinant = 1;
+	unsigned int pivotRow = 0;
+	for (unsigned int k = 0; k < n && pivotRow < n; k++)
+	{
+		unsigned int pivot = pivotRow;
+		while ( pivot < n && work[(size_t)pivot * n + k] == 0 )
+		{
+			pivot++;
+		}
+		if ( pivot == n )
+		{
+			determinant = 0;
+			continue;
+		}
+		if ( pivot != pivotRow )
+		{
+			for (unsigned int j = k; j < n; j++)
+			{
+				uint32_t swap = work[(size_t)pivotRow * n + j];
+				work[(size_t)pivotRow * n + j] = work[(size_t)pivot * n + j];
+				work[(size_t)pivot * n + j] = swap;
+			}
+			determinant = determinant ? prime - determinant : 0;
+		}
+		uint32_t *top = &work[(size_t)pivotRow * n];
+		determinant = determinant * top[k] % prime;
+		uint64_t inverse = LS_powMod(top[k], prime - 2, prime);
+		for (unsigned int i = pivotRow + 1; i < n; i++)
+		{
+			uint32_t *row = &work[(size_t)i * n];
+			if ( row[k] == 0 )
+			{
+				continue;
+			}
+			uint64_t negated = prime - row[k] * inverse % prime;
+			for (unsigned int j = k; j < n; j++)
+			{
+				row[j] = (row[j] + negated * top[j]) % prime;
+			}
+		}
+		pivotRow++;
+	}
+	*rank = pivotRow;
+	return determinant;
+}
+
+/**
+@fn LS_isPrime
+@brief Determines whether a 32-bit integer is prime with the Miller-Rabin test.
+The bases 2, 3, 5 and 7 give the right answer for every integer below 2^32.
+@param n The integer to test. Must be odd and greater than 7.
+@return true if n is prime, false otherwise.
+*/
+static bool LS_isPrime (uint32_t n)
+{
+	static const uint32_t bases[4] = {2, 3, 5, 7};
+	uint32_t odd = n - 1;
+	int twos = 0;
+	while ( !(odd & 1) )
+	{
+		odd >>= 1;
+		twos++;
+	}
+	for (int b = 0; b < 4; b++)
+	{
+		uint64_t x = LS_powMod(bases[b], odd, n);
+		if ( x == 1 || x == n - 1 )
+		{
+			continue;
+		}
+		int i = 1;
+		for (; i < twos && x != n - 1; i++)
+		{
+			x = x * x % n;
+		}
+		if ( x != n - 1 )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+@fn LS_nthPrime
+@brief Finds the prime at a given position in a descending list of primes below
+2^31. The first LS_NUM_PRIMES come from LS_primes, and the rest are found by
+searching down from the previous one.
+@param index The position in the list.
+@param previous The prime at position index - 1. Ignored if index is 0.
+@return The prime.
+*/
+static uint32_t LS_nthPrime (unsigned int index, uint32_t previous)
+{
+	if ( index < LS_NUM_PRIMES )
+	{
+		return LS_primes[index];
+	}
+	uint32_t candidate = previous - 2;
+	while ( !LS_isPrime(candidate) )
+	{
+		candidate -= 2;
+	}
+	return candidate;
+}
+
+/**
+@fn LS_compareBits
+@brief Compares two bit counts for sorting them in descending order with qsort.
+@param a Pointer to the first count.
+@param b Pointer to the second count.
+@return A negative value if a is larger, a positive value if b is larger, or 0.
+*/
+static int LS_compareBits (const void *a, const void *b)
+{
+	unsigned int first = *(const unsigned int *)a;
+	unsigned int second = *(const unsigned int *)b;
+	return (first < second) - (first > second);
+}
+
+/**
+@fn LS_certifiedRank
+@brief Finds the exact rank of a scaled Matrix by elimination modulo as many
+primes as it takes to prove it.
+@details The rank modulo a prime is never above the true rank r, and is below
+it only when the prime divides every r-by-r minor. A minor made of k rows is
+below the product of their 2-norms (Hadamard's bound), so once the primes tried
+multiply to more than the bound for the largest rank seen plus one, no larger
+minor can be non-zero. Most matrices are settled by the first prime; proving
+a Matrix singular takes about one prime per LS_PRIME_BITS bits of that bound.
+@param scaled The scaled Matrix.
+@param n The number of rows (and columns) of the Matrix.
+@param work A buffer of n^2 values to eliminate in.
+@param rank Pointer to where the rank will be written.
+@param fullRankPrime Pointer to where a prime the Matrix is non-singular
+modulo will be written, if the rank is n.
+@return An error code. 0 if no problems were encountered.
+*/
+static int LS_certifiedRank (const int64_t *scaled, unsigned int n,
+	uint32_t *work, unsigned int *rank, uint32_t *fullRankPrime)
+{
+	/* Bound the size of every row by the number of bits in its 2-norm, or in
+	   its 1-norm if the sum of squares does not fit in 128 bits. */
+	unsigned int *bits = (unsigned int *)malloc(sizeof(unsigned int) * (n ? n : 1));
+	if ( !bits )
+	{
+		return ERR_ALLOCATION_FAILED;
+	}
+	for (unsigned int i = 0; i < n; i++)
+	{
+		unsigned __int128 squares = 0, norm = 0;
+		bool isSquaresOverflow = false;
+		for (unsigned int j = 0; j < n; j++)
+		{
+			int64_t element = scaled[(size_t)i * n + j];
+			uint64_t magnitude = element < 0 ? -(uint64_t)element : (uint64_t)element;
+			norm += magnitude;
+			isSquaresOverflow |= __builtin_add_overflow(squares,
+				(unsigned __int128)magnitude * magnitude, &squares);
+		}
+		if ( !isSquaresOverflow )
+		{
+			norm = squares;
+		}
+		uint64_t high = norm >> 64, low = norm;
+		bits[i] = high ? 128 - __builtin_clzll(high) :
+			low ? 64 - __builtin_clzll(low) : 0;
+		if ( !isSquaresOverflow )
+		{
+			bits[i] = (bits[i] + 1) / 2;
+		}
+	}
+	/* The largest k-row minor is below 2^(the k largest bit counts). */
+	qsort(bits, n, sizeof(unsigned int), LS_compareBits);
+	*rank = 0;
+	uint64_t primeBits = 0;
+	uint32_t prime = 0;
+	for (unsigned int p = 0; *rank < n; p++)
+	{
+		prime = LS_nthPrime(p, prime);
+		unsigned int primeRank;
+		LS_eliminateModPrime(scaled, n, prime, work, &primeRank);
+		if ( primeRank > *rank )
+		{
+			*rank = primeRank;
+		}
+		if ( *rank == n )
+		{
+			*fullRankPrime = prime;
+			break;
+		}
+		primeBits += LS_PRIME_BITS;
+		uint64_t boundBits = 0;
+		for (unsigned int i = 0; i <= *rank; i++)
+		{
+			boundBits += bits[i];
+		}
+		if ( primeBits >= boundBits )
+		{
+			break;
+		}
+	}
+	free(bits);
+	return 0;
+}
+
+/**
+@fn LS_factor
+@brief Scales a square Matrix to integers and factors it modulo a prime. If the
+Matrix is singular modulo each of a few fixed primes, its rank is found exactly
+(see LS_rank), so ERR_SINGULAR means the Matrix is singular.
+@param a Pointer to the Matrix to factor.
+@param result Pointer to an LS_Factorization pointer which will be set to the
+newly allocated factorization.
+@return An error code. 0 if no problems were encountered.
+*/
+int LS_factor (Matrix *a, LS_Factorization **result)
+{
+	if ( a->numRows != a->numCols )
+	{
+		return ERR_DIMENSION_MISMATCH;
+	}
+	unsigned int n = a->numRows;
+	size_t numElements = (size_t)n * n;
+	LS_Factorization *f = (LS_Factorization *)calloc(1, sizeof(LS_Factorization));
+	if ( !f )
+	{
+		return ERR_ALLOCATION_FAILED;
+	}
+	f->size = n;
+	f->lu = (uint32_t *)malloc(sizeof(uint32_t) * (numElements ? numElements : 1));
+	f->inversePivots = (uint32_t *)malloc(sizeof(uint32_t) * (n ? n : 1));
+	f->permutation = (unsigned int *)malloc(sizeof(unsigned int) * (n ? n : 1));
+	f->scaled = (int64_t *)malloc(sizeof(int64_t) * (numElements ? numElements : 1));
+	f->rowScales = (int64_t *)malloc(sizeof(int64_t) * (n ? n : 1));
+	if ( !f->lu || !f->inversePivots || !f->permutation || !f->scaled ||
+		!f->rowScales )
+	{
+		LS_free(f);
+		return ERR_ALLOCATION_FAILED;
+	}
+	int error = LS_scale(a, f->scaled, f->rowScales);
+	if ( error )
+	{
+		LS_free(f);
+		return error;
+	}
+	/* A non-singular Matrix is rarely singular modulo any one of these
+	   primes, but one whose determinant they all divide is. Only report it
+	   singular once its rank has been proven to be below n. */
+	uint32_t prime = 0;
+	for (int p = 0; p < LS_NUM_FACTOR_PRIMES; p++)
+	{
+		if ( LS_factorModPrime(f, LS_primes[p]) )
+		{
+			prime = LS_primes[p];
+			break;
+		}
+	}
+	if ( !prime )
+	{
+		unsigned int rank;
+		error = LS_certifiedRank(f->scaled, n, f->lu, &rank, &prime);
+		if ( error || rank < n )
+		{
+			LS_free(f);
+			return error ? error : ERR_SINGULAR;
+		}
+		LS_factorModPrime(f, prime);
+	}
+	f->prime = prime;
+	*result = f;
+	return 0;
+}
+
+/**
+@fn LS_scaleColumn
+@brief Scales one right-hand side to integers to match the scaled Matrix. Row i
+is multiplied by the same factor as row i of A, then the whole column by the
+least common multiple of the resulting bottoms.
+@param f Pointer to the factorization of A.
+@param b Pointer to the Matrix of right-hand sides.
+@param col The column of b to scale.
+@param scaled The buffer the scaled column is written to.
+@param denominator Pointer to where the column's common multiple is written.
+The solution of the scaled system must be divided by it.
+@return An error code. 0 if no problems were encountered.
+*/
+static int LS_scaleColumn (LS_Factorization *f, Matrix *b, unsigned int col,
+	__int128 *scaled, int64_t *denominator)
+{
+	unsigned int n = f->size;
+	int64_t common = 1;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		for (unsigned int i = 0; i < n; i++)
+		{
+			Rational value = M_AT(b, i, col);
+			if ( value.bottom <= 0 )
+			{
+				return ERR_SOLVE_OVERFLOW;
+			}
+			/* value * rowScale, reduced by cancelling the bottom. */
+			int64_t gcd = R_GCD(f->rowScales[i], value.bottom);
+			int64_t top;
+			if ( __builtin_mul_overflow((int64_t)value.top,
+				f->rowScales[i] / gcd, &top) )
+			{
+				return ERR_SOLVE_OVERFLOW;
+			}
+			int64_t bottom = value.bottom / gcd;
+			if ( pass == 0 )
+			{
+				if ( !LS_lcm(&common, bottom) )
+				{
+					return ERR_SOLVE_OVERFLOW;
+				}
+			}
+			else
+			{
+				scaled[i] = (__int128)top * (common / bottom);
+			}
+		}
+	}
+	*denominator = common;
+	return 0;
+}
+
+/**
+@fn LS_solve
+@brief Solves A*X = B for X using a factorization of A. Each column of B is a
+separate right-hand side, and the matching column of X is its solution.
+@details Each column is lifted LS_LIFTING_STEPS times, which determines the
+solution modulo prime^LS_LIFTING_STEPS, enough to reconstruct any solution
+whose elements fit in a Rational. The reconstructed solution is checked against
+the system modulo a second prime.
+@param f Pointer to the factorization of A.
+@param b Pointer to the Matrix of right-hand sides. Must have as many rows as A.
+@param x Pointer to the Matrix which will hold the solutions. Must have the
+same dimensions as b. May be the same Matrix as b.
+@return An error code. 0 if no problems were encountered. ERR_SOLVE_OVERFLOW
+if an element of the solution does not fit in a Rational.
+*/
+int LS_solve (LS_Factorization *f, Matrix *b, Matrix *x)
+{
+	unsigned int n = f->size;
+	if ( b->numRows != n || x->numRows != n || x->numCols != b->numCols )
+	{
+		return ERR_DIMENSION_MISMATCH;
+	}
+	unsigned int numColumns = b->numCols;
+	size_t size = n ? n : 1;
+	__int128 *rhs = (__int128 *)malloc(sizeof(__int128) * size);
+	__int128 *residual = (__int128 *)malloc(sizeof(__int128) * size);
+	__int128 *lifted = (__int128 *)malloc(sizeof(__int128) * size);
+	__int128 *numerators = (__int128 *)malloc(sizeof(__int128) * size);
+	__int128 *denominators = (__int128 *)malloc(sizeof(__int128) * size);
+	uint32_t *residue = (uint32_t *)malloc(sizeof(uint32_t) * size);
+	uint32_t *digits = (uint32_t *)malloc(sizeof(uint32_t) * size);
+	uint64_t *checks = (uint64_t *)malloc(sizeof(uint64_t) * size);
+	Rational *solution = (Rational *)malloc(sizeof(Rational) *
+		(size_t)size * (numColumns ? numColumns : 1));
+	int error = 0;
+	if ( !rhs || !residual || !lifted || !numerators || !denominators ||
+		!residue || !digits || !checks || !solution )
+	{
+		error = ERR_ALLOCATION_FAILED;
+	}
+	for (unsigned int c = 0; !error && c < numColumns; c++)
+	{
+		int64_t denominator;
+		error = LS_scaleColumn(f, b, c, rhs, &denominator);
+		if ( error )
+		{
+			break;
+		}
+		/* Lift: each step finds the next base-prime digit of the solution
+		   and divides what is left of the right-hand side by prime. */
+		memcpy(residual, rhs, sizeof(__int128) * n);
+		memset(lifted, 0, sizeof(__int128) * n);
+		__int128 modulus = 1;
+		for (int step = 0; step < LS_LIFTING_STEPS; step++)
+		{
+			for (unsigned int i = 0; i < n; i++)
+			{
+				residue[i] = LS_mod(residual[i], f->prime);
+			}
+			LS_solveModPrime(f, residue, digits);
+			for (unsigned int j = 0; j < n; j++)
+			{
+				lifted[j] += digits[j] * modulus;
+			}
+			modulus *= f->prime;
+			if ( step == LS_LIFTING_STEPS - 1 )
+			{
+				break;
+			}
+			for (unsigned int i = 0; i < n; i++)
+			{
+				const int64_t *row = &f->scaled[(size_t)i * n];
+				__int128 sum = residual[i];
+				for (unsigned int j = 0; j < n; j++)
+				{
+					sum -= (__int128)row[j] * digits[j];
+				}
+				residual[i] = sum / f->prime;
+			}
+		}
+		for (unsigned int j = 0; j < n && !error; j++)
+		{
+			if ( !LS_reconstruct(lifted[j], modulus, &numerators[j],
+				&denominators[j]) )
+			{
+				error = ERR_SOLVE_OVERFLOW;
+			}
+		}
+		/* A solution too large to reconstruct can still produce a fraction
+		   within the bounds, so check it modulo an unrelated prime. */
+		for (unsigned int j = 0; j < n && !error; j++)
+		{
+			checks[j] = (unsigned __int128)LS_mod(numerators[j], LS_CHECK_PRIME) *
+				LS_powMod(denominators[j], LS_CHECK_PRIME - 2, LS_CHECK_PRIME) %
+				LS_CHECK_PRIME;
+		}
+		for (unsigned int i = 0; i < n && !error; i++)
+		{
+			const int64_t *row = &f->scaled[(size_t)i * n];
+			uint64_t sum = 0;
+			for (unsigned int j = 0; j < n; j++)
+			{
+				sum = (sum + (unsigned __int128)LS_mod(row[j], LS_CHECK_PRIME) *
+					checks[j]) % LS_CHECK_PRIME;
+			}
+			if ( sum != LS_mod(rhs[i], LS_CHECK_PRIME) )
+			{
+				error = ERR_SOLVE_OVERFLOW;
+			}
+		}
+		/* Divide out the column's common multiple and store the solution. */
+		for (unsigned int j = 0; j < n && !error; j++)
+		{
+			__int128 top = numerators[j];
+			__int128 bottom = denominators[j] * denominator;
+			__int128 gcd = LS_GCD128(top < 0 ? -top : top, bottom);
+			top /= gcd;
+			bottom /= gcd;
+			if ( top > INT32_MAX || top < INT32_MIN || bottom > INT32_MAX )
+			{
+				error = ERR_SOLVE_OVERFLOW;
+				break;
+			}
+			solution[(size_t)j * numColumns + c].top = top;
+			solution[(size_t)j * numColumns + c].bottom = bottom;
+		}
+	}
+	if ( !error )
+	{
+		memcpy(x->elements, solution, sizeof(Rational) * (size_t)n * numColumns);
+		M_rehash(x);
+	}
+	free(rhs);
+	free(residual);
+	free(lifted);
+	free(numerators);
+	free(denominators);
+	free(residue);
+	free(digits);
+	free(checks);
+	free(solution);
+	return error;
+}
+
+/**
+@fn LS_solveSystem
+@brief Solves A*X = B for X. Small systems are handled by the fixed-size
+kernels (see SM_solve); otherwise A is factored and the factorization is
+discarded.
+@param a Pointer to the square Matrix A.
+@param b Pointer to the Matrix of right-hand sides.
+@param x Pointer to the Matrix which will hold the solutions. Must have the
+same dimensions as b.
+@return An error code. 0 if no problems were encountered.
+*/
+int LS_solveSystem (Matrix *a, Matrix *b, Matrix *x)
+{
+	/* Small systems are cheaper to solve with the adjugate than to factor. */
+	int error = SM_solve(a, b, x);
+	if ( error != FAIL_SMALL_UNSUPPORTED )
+	{
+		return error;
+	}
+	LS_Factorization *f;
+	error = LS_factor(a, &f);
+	if ( error )
+	{
+		return error;
+	}
+	error = LS_solve(f, b, x);
+	LS_free(f);
+	return error;
+}
+
+/**
+@fn LS_determinant
+@brief Computes the exact determinant of a factored Matrix. The determinant
+modulo the factorization's prime is read off the diagonal of U, and is
+combined by the Chinese remainder theorem with the determinant modulo a few
+more primes.
+@param f Pointer to the factorization of the Matrix.
+@param determinant Pointer to where the determinant will be written.
+@return An error code. 0 if no problems were encountered. ERR_SOLVE_OVERFLOW
+if the determinant does not fit in a Rational.
+*/
+int LS_determinant (LS_Factorization *f, Rational *determinant)
+{
+	unsigned int n = f->size;
+	/* det(scaled) = det(A) * the product of the row scales. */
+	__int128 scaleProduct = 1;
+	for (unsigned int i = 0; i < n; i++)
+	{
+		scaleProduct *= f->rowScales[i];
+		if ( scaleProduct >= LS_MAX_SCALE_PRODUCT )
+		{
+			return ERR_SOLVE_OVERFLOW;
+		}
+	}
+	/* The factorization gives the determinant modulo its own prime. */
+	uint64_t residue = 1;
+	for (unsigned int k = 0; k < n; k++)
+	{
+		residue = residue * f->lu[(size_t)k * n + k] % f->prime;
+		/* Each row that was swapped away from its place flips the sign. */
+		for (unsigned int i = k + 1; i < n; i++)
+		{
+			if ( f->permutation[i] < f->permutation[k] )
+			{
+				residue = residue ? f->prime - residue : 0;
+			}
+		}
+	}
+	size_t numElements = (size_t)n * n;
+	uint32_t *work = (uint32_t *)malloc(sizeof(uint32_t) *
+		(numElements ? numElements : 1));
+	if ( !work )
+	{
+		return ERR_ALLOCATION_FAILED;
+	}
+	/* Combine it with the determinant modulo further primes. */
+	__int128 value = residue;
+	__int128 modulus = f->prime;
+	int numPrimes = 1;
+	for (int p = 0; p < LS_NUM_PRIMES && numPrimes < LS_NUM_DETERMINANT_PRIMES; p++)
+	{
+		uint64_t prime = LS_primes[p];
+		if ( prime == f->prime )
+		{
+			continue;
+		}
+		unsigned int rank;
+		residue = LS_eliminateModPrime(f->scaled, n, prime, work, &rank);
+		/* value + modulus * t is congruent to residue modulo prime. */
+		uint64_t difference = (residue + prime - LS_mod(value, prime)) % prime;
+		uint64_t t = (unsigned __int128)difference *
+			LS_powMod(LS_mod(modulus, prime), prime - 2, prime) % prime;
+		value += modulus * t;
+		modulus *= prime;
+		numPrimes++;
+	}
+	free(work);
+	/* Take the residue closest to zero. */
+	if ( value > modulus / 2 )
+	{
+		value -= modulus;
+	}
+	__int128 gcd = LS_GCD128(value < 0 ? -value : value, scaleProduct);
+	value /= gcd;
+	scaleProduct /= gcd;
+	if ( value > INT32_MAX || value < INT32_MIN || scaleProduct > INT32_MAX )
+	{
+		return ERR_SOLVE_OVERFLOW;
+	}
+	determinant->top = value;
+	determinant->bottom = scaleProduct;
+	return 0;
+}
+
+/**
+@fn LS_rank
+@brief Computes the exact rank of a square Matrix by elimination modulo
+primes. The rank modulo a prime can only be lower than the true rank, and only
+when the prime divides every minor of that rank. Primes are tried until their
+product exceeds Hadamard's bound on the next larger minors, which proves the
+largest rank found is the true rank.
+@param a Pointer to the Matrix.
+@param rank Pointer to where the rank will be written.
+@return An error code. 0 if no problems were encountered.
+*/
+int LS_rank (Matrix *a, unsigned int *rank)
+{
+	if ( a->numRows != a->numCols )
+	{
+		return ERR_DIMENSION_MISMATCH;
+	}
+	unsigned int n = a->numRows;
+	size_t numElements = (size_t)n * n;
+	int64_t *scaled = (int64_t *)malloc(sizeof(int64_t) *
+		(numElements ? numElements : 1));
+	uint32_t *work = (uint32_t *)malloc(sizeof(uint32_t) *
+		(numElements ? numElements : 1));
+	if ( !scaled || !work )
+	{
+		free(scaled);
+		free(work);
+		return ERR_ALLOCATION_FAILED;
+	}
+	int error = LS_scale(a, scaled, NULL);
+	if ( !error )
+	{
+		uint32_t prime;
+		error = LS_certifiedRank(scaled, n, work, rank, &prime);
+	}
+	free(scaled);
+	free(work);
+	return error;
+}
+
+/**
+@fn LS_free
+@brief Frees a factorization created by LS_factor.
+@param f Pointer to the factorization to be freed.
+*/
+void LS_free (LS_Factorization *f)
+{
+	if ( !f )
+	{
+		return;
+	}
+	free(f->lu);
+	free(f->inversePivots);
+	free(f->permutation);
+	free(f->scaled);
+	free(f->rowScales);
+	free(f);
+}
\ No newline at end of file
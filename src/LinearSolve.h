@@ -0,0 +1,135 @@
+/**
+@file LinearSolve.h
+@author Rob Thomas
+@brief Contains functions for solving linear systems A*X = B exactly. Rather
+than eliminating over Rationals, whose tops and bottoms grow until they
+overflow, A is scaled to integers and factored once modulo a word-sized prime.
+Each right-hand side is then solved by p-adic (Dixon) lifting: every lifting
+step is one modular triangular solve and one integer matrix-vector product,
+and the exact rational solution is recovered from the p-adic one by rational
+reconstruction. Any number of right-hand sides can be solved against a single
+factorization.
+*/
+
+#ifndef LINEARSOLVE_H
+#define LINEARSOLVE_H
+
+/*** INCLUDES: ***/
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "Matrix.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define LS_LIFTING_STEPS 4
+
+#define ERR_SINGULAR -80
+#define ERR_SOLVE_OVERFLOW -81
+
+/*** STRUCTS: ***/
+
+/**
+@def LS_Factorization
+@brief A struct representing a square Matrix scaled to integers and factored
+as P*A = L*U modulo a prime.
+@var size The number of rows (and columns) of the factored Matrix.
+@var prime The prime the factorization is modulo.
+@var lu The factors modulo prime in row-major order. L (with an implied unit
+diagonal) is below the diagonal and U is on and above it.
+@var inversePivots The inverse modulo prime of each diagonal element of U.
+@var permutation The original index of the row in each position after
+pivoting.
+@var scaled The Matrix with each row multiplied by the least common multiple
+of its bottoms, which makes every element an integer.
+@var rowScales The factor each row of scaled was multiplied by.
+*/
+typedef struct
+{
+	unsigned int size;
+	uint32_t prime;
+	uint32_t *lu;
+	uint32_t *inversePivots;
+	unsigned int *permutation;
+	int64_t *scaled;
+	int64_t *rowScales;
+} LS_Factorization;
+
+/*** FUNCTION PROTOTYPES: ***/
+
+/**
+@fn LS_factor
+@brief Scales a square Matrix to integers and factors it modulo a prime. If the
+Matrix is singular modulo each of a few fixed primes, its rank is found exactly
+(see LS_rank), so ERR_SINGULAR means the Matrix is singular.
+@param a Pointer to the Matrix to factor.
+@param result Pointer to an LS_Factorization pointer which will be set to the
+newly allocated factorization.
+@return An error code. 0 if no problems were encountered.
+*/
+int LS_factor (Matrix *a, LS_Factorization **result);
+
+/**
+@fn LS_solve
+@brief Solves A*X = B for X using a factorization of A. Each column of B is a
+separate right-hand side, and the matching column of X is its solution.
+@details Each column is lifted LS_LIFTING_STEPS times, which determines the
+solution modulo prime^LS_LIFTING_STEPS, enough to reconstruct any solution
+whose elements fit in a Rational. The reconstructed solution is checked against
+the system modulo a second prime.
+@param f Pointer to the factorization of A.
+@param b Pointer to the Matrix of right-hand sides. Must have as many rows as A.
+@param x Pointer to the Matrix which will hold the solutions. Must have the
+same dimensions as b. May be the same Matrix as b.
+@return An error code. 0 if no problems were encountered. ERR_SOLVE_OVERFLOW
+if an element of the solution does not fit in a Rational.
+*/
+int LS_solve (LS_Factorization *f, Matrix *b, Matrix *x);
+
+/**
+@fn LS_solveSystem
+@brief Solves A*X = B for X. Small systems are handled by the fixed-size
+kernels (see SM_solve); otherwise A is factored and the factorization is
+discarded.
+@param a Pointer to the square Matrix A.
+@param b Pointer to the Matrix of right-hand sides.
+@param x Pointer to the Matrix which will hold the solutions. Must have the
+same dimensions as b.
+@return An error code. 0 if no problems were encountered.
+*/
+int LS_solveSystem (Matrix *a, Matrix *b, Matrix *x);
+
+/**
+@fn LS_determinant
+@brief Computes the exact determinant of a factored Matrix. The determinant
+modulo the factorization's prime is read off the diagonal of U, and is
+combined by the Chinese remainder theorem with the determinant modulo a few
+more primes.
+@param f Pointer to the factorization of the Matrix.
+@param determinant Pointer to where the determinant will be written.
+@return An error code. 0 if no problems were encountered. ERR_SOLVE_OVERFLOW
+if the determinant does not fit in a Rational.
+*/
+int LS_determinant (LS_Factorization *f, Rational *determinant);
+
+/**
+@fn LS_rank
+@brief Computes the exact rank of a square Matrix by elimination modulo
+primes. The rank modulo a prime can only be lower than the true rank, and only
+when the prime divides every minor of that rank. Primes are tried until their
+product exceeds Hadamard's bound on the next larger minors, which proves the
+largest rank found is the true rank.
+@param a Pointer to the Matrix.
+@param rank Pointer to where the rank will be written.
+@return An error code. 0 if no problems were encountered.
+*/
+int LS_rank (Matrix *a, unsigned int *rank);
+
+/**
+@fn LS_free
+@brief Frees a factorization created by LS_factor.
+@param f Pointer to the factorization to be freed.
+*/
+void LS_free (LS_Factorization *f);
+
+#endif /* LINEARSOLVE_H */
\ No newline at end of file
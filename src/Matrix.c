@@ -0,0 +1,159 @@
+/**
+@file Matrix.c
+@author Rob Thomas
+@brief Contains functions for creating and deleting matrices of Rationals. A
+matrix's elements are stored in a single contiguous buffer in row-major order.
+Each matrix also keeps a hash of its contents which is updated incrementally as
+elements are set.
+*/
+
+/*** INCLUDES: ***/
+#include <string.h>
+
+#include "Matrix.h"
+#include "BufferPool.h"
+
+/*** DEFINES: ***/
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn M_hashElement
+@brief Hashes a single element together with its position in the element
+buffer, using the splitmix64 finalizer.
+@param index The position of the element in the element buffer.
+@param r The element to hash.
+@return The 64-bit hash of the element at that position.
+*/
+static uint64_t M_hashElement (size_t index, Rational r)
+{
+	uint64_t x = ((uint64_t)(uint32_t)r.top << 32) | (uint32_t)r.bottom;
+	x ^= (uint64_t)index * 0x9E3779B97F4A7C15ULL;
+	x ^= x >> 30;
+	x *= 0xBF58476D1CE4E5B9ULL;
+	x ^= x >> 27;
+	x *= 0x94D049BB133111EBULL;
+	x ^= x >> 31;
+	return x;
+}
+
+/**
+@fn M_new
+@brief Allocates a new Matrix with every element equal to 0/1. The element
+buffer comes from the calling thread's buffer pool.
+@param numRows The number of rows in the new Matrix.
+@param numCols The number of columns in the new Matrix.
+@return A pointer to a dynamically allocated Matrix, or NULL if allocation
+failed.
+*/
+Matrix *M_new (unsigned int numRows, unsigned int numCols)
+{
+	Matrix *m = (Matrix *)malloc(sizeof(Matrix));
+	if ( !m )
+	{
+		return NULL;
+	}
+	m->numRows = numRows;
+	m->numCols = numCols;
+	/* Allocate the element buffer. */
+	size_t numElements = (size_t)numRows * numCols;
+	m->elements = (Rational *)BP_alloc(sizeof(Rational) * numElements);
+	m->isBorrowed = false;
+	if ( !m->elements && numElements > 0 )
+	{
+		free(m);
+		return NULL;
+	}
+	/* Set every element to 0/1. */
+	for (size_t i = 0; i < numElements; i++)
+	{
+		m->elements[i].top = 0;
+		m->elements[i].bottom = 1;
+	}
+	M_rehash(m);
+	return m;
+}
+
+/**
+@fn M_copy
+@brief Creates a dynamically allocated copy of a Matrix and its elements.
+@param m Pointer to the Matrix to be copied.
+@return A pointer to a dynamically allocated copy of m, or NULL if allocation
+failed.
+*/
+Matrix *M_copy (Matrix *m)
+{
+	Matrix *c = M_new(m->numRows, m->numCols);
+	if ( !c )
+	{
+		return NULL;
+	}
+	memcpy(c->elements, m->elements,
+		sizeof(Rational) * (size_t)m->numRows * m->numCols);
+	c->contentHash = m->contentHash;
+	c->isInteger = m->isInteger;
+	return c;
+}
+
+/**
+@fn M_set
+@brief Sets one element of a Matrix, updating its content hash incrementally.
+Writing a fraction clears the Matrix's isInteger flag. Writing an integer leaves
+the flag as it is, since other elements may still be fractions.
+@param m Pointer to the Matrix to be altered.
+@param row The row (0-indexed) of the element.
+@param col The column (0-indexed) of the element.
+@param value The new value of the element.
+*/
+void M_set (Matrix *m, unsigned int row, unsigned int col, Rational value)
+{
+	size_t index = (size_t)row * m->numCols + col;
+	/* Swap the old element's contribution to the hash for the new one's. */
+	m->contentHash -= M_hashElement(index, m->elements[index]);
+	m->contentHash += M_hashElement(index, value);
+	m->elements[index] = value;
+	if ( value.bottom != 1 )
+	{
+		m->isInteger = false;
+	}
+}
+
+/**
+@fn M_rehash
+@brief Recomputes a Matrix's content hash and isInteger flag from all of its
+elements. Must be called after elements have been written without going
+through M_set.
+@param m Pointer to the Matrix whose hash will be recomputed.
+*/
+void M_rehash (Matrix *m)
+{
+	size_t numElements = (size_t)m->numRows * m->numCols;
+	uint64_t hash = 0;
+	bool isInteger = true;
+	for (size_t i = 0; i < numElements; i++)
+	{
+		hash += M_hashElement(i, m->elements[i]);
+		isInteger &= m->elements[i].bottom == 1;
+	}
+	m->contentHash = hash;
+	m->isInteger = isInteger;
+}
+
+/**
+@fn M_free
+@brief Frees a dynamically allocated Matrix. Its element buffer is released
+to the buffer pool unless it is borrowed.
+@param m Pointer to the Matrix to be freed.
+*/
+void M_free (Matrix *m)
+{
+	if ( !m )
+	{
+		return;
+	}
+	if ( !m->isBorrowed )
+	{
+		BP_release(m->elements);
+	}
+	free(m);
+}
\ No newline at end of file
@@ -0,0 +1,114 @@
+/**
+@file Matrix.h
+@author Rob Thomas
+@brief Contains the Matrix struct and functions for creating and deleting
+matrices of Rationals. A matrix's elements are stored in a single contiguous
+buffer in row-major order. Each matrix also keeps a hash of its contents which
+is updated incrementally as elements are set.
+*/
+
+#ifndef MATRIX_H
+#define MATRIX_H
+
+/*** INCLUDES: ***/
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define ERR_DIMENSION_MISMATCH -10
+#define ERR_ALLOCATION_FAILED -11
+
+/**
+@def M_AT
+@brief Evaluates to the element of a Matrix at the given row and column.
+@param m Pointer to the Matrix.
+@param row The row (0-indexed) of the element.
+@param col The column (0-indexed) of the element.
+*/
+#define M_AT(m, row, col) ((m)->elements[(size_t)(row) * (m)->numCols + (col)])
+
+/*** STRUCTS: ***/
+
+/**
+@def Matrix
+@brief A struct representing a matrix of Rationals.
+@var numRows The number of rows in the matrix.
+@var numCols The number of columns in the matrix.
+@var elements A buffer of numRows * numCols Rationals stored in row-major order.
+Unless isBorrowed is set, it must come from BP_alloc, since M_free and a
+HashTable holding the Matrix give it back with BP_release.
+@var contentHash A hash of the matrix's elements. It is the sum of a hash of
+each element and its position, so changing one element only requires that
+element's old and new hashes. Kept current by M_set; code which writes to
+elements directly must call M_rehash afterwards.
+@var isInteger Whether every element is known to have a bottom of 1. When set,
+arithmetic on the matrix can run on plain 64-bit integers instead of Rationals.
+M_set clears it as soon as a fraction is written, and M_rehash recomputes it.
+@var isBorrowed Whether elements belongs to something else, such as a mapped
+workspace file or the Matrix a view was made from. Borrowed elements are never
+released by M_free or by a HashTable holding the Matrix.
+*/
+typedef struct
+{
+	unsigned int numRows;
+	unsigned int numCols;
+	Rational *elements;
+	uint64_t contentHash;
+	bool isInteger;
+	bool isBorrowed;
+} Matrix;
+
+/*** FUNCTION PROTOTYPES: ***/
+
+/**
+@fn M_new
+@brief Allocates a new Matrix with every element equal to 0/1. The element
+buffer comes from the calling thread's buffer pool.
+@param numRows The number of rows in the new Matrix.
+@param numCols The number of columns in the new Matrix.
+@return A pointer to a dynamically allocated Matrix, or NULL if allocation
+failed.
+*/
+Matrix *M_new (unsigned int numRows, unsigned int numCols);
+
+/**
+@fn M_copy
+@brief Creates a dynamically allocated copy of a Matrix and its elements.
+@param m Pointer to the Matrix to be copied.
+@return A pointer to a dynamically allocated copy of m, or NULL if allocation
+failed.
+*/
+Matrix *M_copy (Matrix *m);
+
+/**
+@fn M_set
+@brief Sets one element of a Matrix, updating its content hash incrementally.
+Writing a fraction clears the Matrix's isInteger flag. Writing an integer leaves
+the flag as it is, since other elements may still be fractions.
+@param m Pointer to the Matrix to be altered.
+@param row The row (0-indexed) of the element.
+@param col The column (0-indexed) of the element.
+@param value The new value of the element.
+*/
+void M_set (Matrix *m, unsigned int row, unsigned int col, Rational value);
+
+/**
+@fn M_rehash
+@brief Recomputes a Matrix's content hash and isInteger flag from all of its
+elements. Must be called after elements have been written without going
+through M_set.
+@param m Pointer to the Matrix whose hash will be recomputed.
+*/
+void M_rehash (Matrix *m);
+
+/**
+@fn M_free
+@brief Frees a dynamically allocated Matrix. Its element buffer is released
+to the buffer pool unless it is borrowed.
+@param m Pointer to the Matrix to be freed.
+*/
+void M_free (Matrix *m);
+
+#endif /* MATRIX_H */
\ No newline at end of file
@@ -0,0 +1,469 @@
+/**
+@file MatrixChain.c
+@author Rob Thomas
+@brief Contains functions for choosing the order in which a chain of matrix
+products such as A*B*C*D is evaluated. Every way of parenthesizing the chain
+gives the same result, but the cost can differ by orders of magnitude, and with
+exact entries a bad order also grows the entries of the intermediate products.
+The cheapest order is found by dynamic programming over the subchains, using
+the shapes of the matrices and, optionally, estimates of their entry sizes and
+sparsity.
+*/
+
+/*** INCLUDES: ***/
+#include <stdlib.h>
+
+#include "MatrixChain.h"
+#include "MatrixExpr.h"
+
+/*** DEFINES: ***/
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn MC_bits
+@brief Counts the bits needed to hold the magnitude of an integer.
+@param value The integer.
+@return The number of bits, which is 0 for 0.
+*/
+static unsigned int MC_bits (int64_t value)
+{
+	uint64_t magnitude = value < 0 ? -(uint64_t)value : (uint64_t)value;
+	return magnitude ? 64 - __builtin_clzll(magnitude) : 0;
+}
+
+/**
+@fn MC_shapeOf
+@brief Describes a Matrix for the planner.
+@param m Pointer to the Matrix.
+@param scanEntries Whether to scan the elements to estimate entry sizes and
+density. Otherwise the entries are assumed to be dense and MC_INTEGER_BITS
+bits.
+@param shape Pointer to the MC_Shape to fill in.
+*/
+void MC_shapeOf (Matrix *m, bool scanEntries, MC_Shape *shape)
+{
+	shape->numRows = m->numRows;
+	shape->numCols = m->numCols;
+	shape->entryBits = MC_INTEGER_BITS;
+	shape->density = 1;
+	shape->isInteger = m->isInteger;
+	size_t numElements = (size_t)m->numRows * m->numCols;
+	if ( !scanEntries || numElements == 0 )
+	{
+		return;
+	}
+	unsigned int maxBits = 0;
+	size_t numNonZero = 0;
+	for (size_t i = 0; i < numElements; i++)
+	{
+		Rational r = m->elements[i];
+		unsigned int bits = MC_bits(r.top);
+		if ( r.bottom != 1 )
+		{
+			bits += MC_bits(r.bottom);
+		}
+		maxBits = bits > maxBits ? bits : maxBits;
+		numNonZero += r.top != 0;
+	}
+	shape->entryBits = maxBits;
+	shape->density = (double)numNonZero / numElements;
+}
+
+/**
+@fn MC_productCost
+@brief Prices one product of two subchains and estimates the shape of the
+result.
+@param left Pointer to the shape of the left operand.
+@param right Pointer to the shape of the right operand.
+@param model Pointer to the cost model.
+@param result Pointer to the MC_Shape the product's shape is written to.
+@return The estimated cost of the product.
+*/
+static double MC_productCost (MC_Shape *left, MC_Shape *right,
+	MC_CostModel *model, MC_Shape *result)
+{
+	double inner = left->numCols;
+	double cost = (double)left->numRows * inner * right->numCols;
+	result->numRows = left->numRows;
+	result->numCols = right->numCols;
+	/* Each entry is a sum of inner products, so it is as large as one product
+	   plus the bits the sum can carry into. */
+	result->entryBits = left->entryBits + right->entryBits +
+		MC_bits(left->numCols);
+	result->isInteger = left->isInteger && right->isInteger;
+	/* An entry is non-zero if any of its inner products is, assuming the zeros
+	   are spread independently. */
+	result->density = left->density * right->density * inner;
+	result->density = result->density < 1 ? result->density : 1;
+	if ( !model->useBitSizes && !model->useSparsity )
+	{
+		return cost;
+	}
+	bool isIntegerKernel = result->isInteger &&
+		result->entryBits <= MC_INTEGER_BITS;
+	/* Both kernels skip zeros of the left operand. Only the Rational kernel
+	   skips zeros of the right operand as well. */
+	if ( model->useSparsity )
+	{
+		cost *= left->density;
+		if ( !model->useBitSizes || !isIntegerKernel )
+		{
+			cost *= right->density;
+		}
+	}
+	if ( model->useBitSizes && !isIntegerKernel )
+	{
+		cost *= model->fractionWeight;
+	}
+	return cost;
+}
+
+/**
+@fn MC_plan
+@brief Finds the cheapest order to evaluate a chain of products in.
+@param shapes The shapes of the matrices in the chain, in order.
+@param numMatrices The number of matrices in the chain.
+@param model Pointer to the cost model to use, or NULL to count multiply-adds
+from the shapes alone.
+@param plan Pointer to an MC_Plan pointer which will be set to the new plan.
+@return An error code. 0 if no problems were encountered.
+*/
+int MC_plan (MC_Shape *shapes, unsigned int numMatrices, MC_CostModel *model,
+	MC_Plan **plan)
+{
+	if ( numMatrices == 0 )
+	{
+		return ERR_NO_TERMS;
+	}
+	for (unsigned int i = 0; i + 1 < numMatrices; i++)
+	{
+		if ( shapes[i].numCols != shapes[i + 1].numRows )
+		{
+			return ERR_DIMENSION_MISMATCH;
+		}
+	}
+	MC_Plan *p = (MC_Plan *)calloc(1, sizeof(MC_Plan));
+	size_t numCells = (size_t)numMatrices * numMatrices;
+	if ( p )
+	{
+		p->shapes = (MC_Shape *)malloc(sizeof(MC_Shape) * numCells);
+		p->costs = (double *)malloc(sizeof(double) * numCells);
+		p->splits = (unsigned int *)malloc(sizeof(unsigned int) * numCells);
+	}
+	if ( !p || !p->shapes || !p->costs || !p->splits )
+	{
+		MC_freePlan(p);
+		return ERR_ALLOCATION_FAILED;
+	}
+	unsigned int n = numMatrices;
+	p->numMatrices = n;
+	if ( model )
+	{
+		p->model = *model;
+	}
+	else
+	{
+		p->model.fractionWeight = MC_DEFAULT_FRACTION_WEIGHT;
+	}
+	for (unsigned int i = 0; i < n; i++)
+	{
+		p->shapes[(size_t)i * n + i] = shapes[i];
+		p->costs[(size_t)i * n + i] = 0;
+		p->splits[(size_t)i * n + i] = i;
+	}
+	/* Solve the subchains in order of length, so that both halves of every
+	   split have already been solved. */
+	for (unsigned int length = 2; length <= n; length++)
+	{
+		for (unsigned int i = 0; i + length <= n; i++)
+		{
+			unsigned int j = i + length - 1;
+			size_t cell = (size_t)i * n + j;
+			p->costs[cell] = -1;
+			for (unsigned int k = i; k < j; k++)
+			{
+				MC_Shape product;
+				double cost = p->costs[(size_t)i * n + k] +
+					p->costs[(size_t)(k + 1) * n + j] +
+					MC_productCost(&p->shapes[(size_t)i * n + k],
+					&p->shapes[(size_t)(k + 1) * n + j], &p->model, &product);
+				if ( p->costs[cell] < 0 || cost < p->costs[cell] )
+				{
+					p->costs[cell] = cost;
+					p->splits[cell] = k;
+					p->shapes[cell] = product;
+				}
+			}
+		}
+	}
+	p->cost = p->costs[n - 1];
+	/* Price the left to right order for comparison. */
+	MC_Shape running = shapes[0];
+	p->leftToRightCost = 0;
+	for (unsigned int i = 1; i < n; i++)
+	{
+		MC_Shape product;
+		p->leftToRightCost += MC_productCost(&running, &shapes[i], &p->model,
+			&product);
+		running = product;
+	}
+	*plan = p;
+	return 0;
+}
+
+/**
+@fn MC_evaluateRange
+@brief Evaluates the product of a subchain in the order chosen by a plan.
+@param plan Pointer to the plan.
+@param matrices The matrices of the chain.
+@param first The index of the first matrix of the subchain.
+@param last The index of the last matrix of the subchain.
+@param result Pointer to a Matrix pointer which will be set to the product. If
+the subchain is a single matrix, this is that matrix. Otherwise it is a newly
+allocated Matrix which the caller must free.
+@return An error code. 0 if no problems were encountered.
+*/
+static int MC_evaluateRange (MC_Plan *plan, Matrix **matrices,
+	unsigned int first, unsigned int last, Matrix **result)
+{
+	if ( first == last )
+	{
+		*result = matrices[first];
+		return 0;
+	}
+	unsigned int k = plan->splits[(size_t)first * plan->numMatrices + last];
+	Matrix *left = NULL;
+	Matrix *right = NULL;
+	Matrix *product = NULL;
+	int error = MC_evaluateRange(plan, matrices, first, k, &left);
+	if ( !error )
+	{
+		error = MC_evaluateRange(plan, matrices, k + 1, last, &right);
+	}
+	if ( !error )
+	{
+		product = M_new(left->numRows, right->numCols);
+		if ( !product )
+		{
+			error = ERR_ALLOCATION_FAILED;
+		}
+	}
+	if ( !error )
+	{
+		Rational one = {1, 1};
+		MatrixTerm term = ME_product(one, left, right);
+		error = ME_evaluate(product, &term, 1);
+	}
+	if ( left && left != matrices[first] )
+	{
+		M_free(left);
+	}
+	if ( right && right != matrices[k + 1] )
+	{
+		M_free(right);
+	}
+	if ( error )
+	{
+		M_free(product);
+		return error;
+	}
+	*result = product;
+	return 0;
+}
+
+/**
+@fn MC_evaluate
+@brief Evaluates dest = coefficient * M0 * M1 * ... in the order chosen by a
+plan. Each intermediate product is computed with ME_evaluate and freed as soon
+as it has been used.
+@param plan Pointer to the plan.
+@param matrices The matrices of the chain. Their shapes must match the ones
+the plan was made for.
+@param coefficient The Rational to scale the product by.
+@param dest Pointer to the Matrix which will hold the result. Its dimensions
+must already match those of the product. It may be any matrix of the chain,
+since it is only written by the last product.
+@return An error code. 0 if no problems were encountered.
+*/
+int MC_evaluate (MC_Plan *plan, Matrix **matrices, Rational coefficient,
+	Matrix *dest)
+{
+	unsigned int n = plan->numMatrices;
+	for (unsigned int i = 0; i < n; i++)
+	{
+		if ( matrices[i]->numRows != plan->shapes[(size_t)i * n + i].numRows ||
+			matrices[i]->numCols != plan->shapes[(size_t)i * n + i].numCols )
+		{
+			return ERR_DIMENSION_MISMATCH;
+		}
+	}
+	if ( n == 1 )
+	{
+		MatrixTerm term = ME_element(coefficient, matrices[0]);
+		return ME_evaluate(dest, &term, 1);
+	}
+	/* Evaluate both halves of the outermost split, then write their product
+	   straight into dest with the coefficient folded in. */
+	unsigned int k = plan->splits[n - 1];
+	Matrix *left = NULL;
+	Matrix *right = NULL;
+	int error = MC_evaluateRange(plan, matrices, 0, k, &left);
+	if ( !error )
+	{
+		error = MC_evaluateRange(plan, matrices, k + 1, n - 1, &right);
+	}
+	if ( !error )
+	{
+		MatrixTerm term = ME_product(coefficient, left, right);
+		error = ME_evaluate(dest, &term, 1);
+	}
+	if ( left && left != matrices[0] )
+	{
+		M_free(left);
+	}
+	if ( right && right != matrices[k + 1] )
+	{
+		M_free(right);
+	}
+	return error;
+}
+
+/**
+@fn MC_printRange
+@brief Prints the parenthesized product of a subchain.
+@param plan Pointer to the plan.
+@param names The names of the matrices, or NULL.
+@param first The index of the first matrix of the subchain.
+@param last The index of the last matrix of the subchain.
+@param isOutermost Whether the subchain is the whole chain, which is printed
+without parentheses.
+@param out The stream to print to.
+*/
+static void MC_printRange (MC_Plan *plan, char **names, unsigned int first,
+	unsigned int last, bool isOutermost, FILE *out)
+{
+	if ( first == last )
+	{
+		if ( names )
+		{
+			fprintf(out, "%s", names[first]);
+		}
+		else
+		{
+			fprintf(out, "M%u", first);
+		}
+		return;
+	}
+	unsigned int k = plan->splits[(size_t)first * plan->numMatrices + last];
+	fprintf(out, "%s", isOutermost ? "" : "(");
+	MC_printRange(plan, names, first, k, false, out);
+	fprintf(out, "*");
+	MC_printRange(plan, names, k + 1, last, false, out);
+	fprintf(out, "%s", isOutermost ? "" : ")");
+}
+
+/**
+@fn MC_printSteps
+@brief Prints each product of a subchain in the order it is computed, naming
+intermediate products T1, T2 and so on.
+@param plan Pointer to the plan.
+@param names The names of the matrices, or NULL.
+@param first The index of the first matrix of the subchain.
+@param last The index of the last matrix of the subchain.
+@param numSteps Pointer to the number of products printed so far.
+@param out The stream to print to.
+@return The step number of the subchain's product, or 0 if it is a single
+matrix.
+*/
+static unsigned int MC_printSteps (MC_Plan *plan, char **names,
+	unsigned int first, unsigned int last, unsigned int *numSteps, FILE *out)
+{
+	if ( first == last )
+	{
+		return 0;
+	}
+	unsigned int n = plan->numMatrices;
+	unsigned int k = plan->splits[(size_t)first * n + last];
+	unsigned int leftStep = MC_printSteps(plan, names, first, k, numSteps, out);
+	unsigned int rightStep = MC_printSteps(plan, names, k + 1, last, numSteps,
+		out);
+	unsigned int step = ++*numSteps;
+	MC_Shape *left = &plan->shapes[(size_t)first * n + k];
+	MC_Shape *right = &plan->shapes[(size_t)(k + 1) * n + last];
+	MC_Shape product;
+	double cost = MC_productCost(left, right, &plan->model, &product);
+	fprintf(out, "  T%u = ", step);
+	if ( leftStep )
+	{
+		fprintf(out, "T%u", leftStep);
+	}
+	else
+	{
+		MC_printRange(plan, names, first, first, true, out);
+	}
+	fprintf(out, " * ");
+	if ( rightStep )
+	{
+		fprintf(out, "T%u", rightStep);
+	}
+	else
+	{
+		MC_printRange(plan, names, last, last, true, out);
+	}
+	fprintf(out, "  %ux%u * %ux%u  cost %.4g", left->numRows, left->numCols,
+		right->numRows, right->numCols, cost);
+	if ( plan->model.useBitSizes )
+	{
+		fprintf(out, "  ~%.0f-bit entries", product.entryBits);
+	}
+	if ( plan->model.useSparsity )
+	{
+		fprintf(out, "  %.0f%% dense", 100 * product.density);
+	}
+	fprintf(out, "\n");
+	return step;
+}
+
+/**
+@fn MC_explain
+@brief Prints a plan: the parenthesized chain, its estimated cost against
+evaluating from left to right, and each intermediate product in the order it is
+computed.
+@param plan Pointer to the plan.
+@param names The names of the matrices of the chain, or NULL to call them
+M0, M1 and so on.
+@param out The stream to print to.
+*/
+void MC_explain (MC_Plan *plan, char **names, FILE *out)
+{
+	unsigned int n = plan->numMatrices;
+	fprintf(out, "plan: ");
+	MC_printRange(plan, names, 0, n - 1, true, out);
+	fprintf(out, "\nestimated cost %.4g, left to right %.4g", plan->cost,
+		plan->leftToRightCost);
+	if ( plan->cost > 0 )
+	{
+		fprintf(out, " (%.1fx)", plan->leftToRightCost / plan->cost);
+	}
+	fprintf(out, "\n");
+	unsigned int numSteps = 0;
+	MC_printSteps(plan, names, 0, n - 1, &numSteps, out);
+}
+
+/**
+@fn MC_freePlan
+@brief Frees a plan made by MC_plan.
+@param plan Pointer to the plan to be freed.
+*/
+void MC_freePlan (MC_Plan *plan)
+{
+	if ( !plan )
+	{
+		return;
+	}
+	free(plan->shapes);
+	free(plan->costs);
+	free(plan->splits);
+	free(plan);
+}
\ No newline at end of file
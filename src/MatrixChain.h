@@ -0,0 +1,156 @@
+/**
+@file MatrixChain.h
+@author Rob Thomas
+@brief Contains the MC_Plan struct and functions for choosing the order in
+which a chain of matrix products such as A*B*C*D is evaluated. Every way of
+parenthesizing the chain gives the same result, but the cost can differ by
+orders of magnitude, and with exact entries a bad order also grows the entries
+of the intermediate products. The cheapest order is found by dynamic
+programming over the subchains, using the shapes of the matrices and,
+optionally, estimates of their entry sizes and sparsity.
+*/
+
+#ifndef MATRIXCHAIN_H
+#define MATRIXCHAIN_H
+
+/*** INCLUDES: ***/
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "Matrix.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define MC_DEFAULT_FRACTION_WEIGHT 25.0
+#define MC_INTEGER_BITS 31
+
+/*** STRUCTS: ***/
+
+/**
+@def MC_Shape
+@brief A struct representing what the planner knows about one matrix of a
+chain, or about the product of a subchain.
+@var numRows The number of rows.
+@var numCols The number of columns.
+@var entryBits An estimate of the number of bits in the largest entry. For a
+fraction this counts the bits of both the top and the bottom.
+@var density The estimated fraction of entries which are non-zero.
+@var isInteger Whether every entry is expected to be an integer.
+*/
+typedef struct
+{
+	unsigned int numRows;
+	unsigned int numCols;
+	double entryBits;
+	double density;
+	bool isInteger;
+} MC_Shape;
+
+/**
+@def MC_CostModel
+@brief A struct representing how the planner prices one product.
+@var useBitSizes Whether to account for entry sizes. When set, a product whose
+operands are integers and whose entries are estimated to fit in
+MC_INTEGER_BITS bits costs one unit per multiply-add, as ME_evaluate's integer
+kernels do, and any other product costs fractionWeight units. When clear, every
+multiply-add costs one unit.
+@var useSparsity Whether to skip the multiply-adds with a zero operand, as
+ME_evaluate does.
+@var fractionWeight The cost of a multiply-add on Rationals relative to one on
+integers.
+*/
+typedef struct
+{
+	bool useBitSizes;
+	bool useSparsity;
+	double fractionWeight;
+} MC_CostModel;
+
+/**
+@def MC_Plan
+@brief A struct representing the chosen evaluation order of a chain.
+@var numMatrices The number of matrices in the chain.
+@var model The cost model the plan was made with.
+@var shapes The numMatrices * numMatrices estimated shapes of the products of
+subchains. The product of matrices i to j is at index i * numMatrices + j.
+@var costs The cheapest cost of each subchain, indexed as in shapes.
+@var splits The split of each subchain: the product of matrices i to j is
+evaluated as (i to k) * (k + 1 to j), where k is splits[i * numMatrices + j].
+@var cost The estimated cost of the whole chain.
+@var leftToRightCost The estimated cost of evaluating the chain from left to
+right, for comparison.
+*/
+typedef struct
+{
+	unsigned int numMatrices;
+	MC_CostModel model;
+	MC_Shape *shapes;
+	double *costs;
+	unsigned int *splits;
+	double cost;
+	double leftToRightCost;
+} MC_Plan;
+
+/*** FUNCTION PROTOTYPES: ***/
+
+/**
+@fn MC_shapeOf
+@brief Describes a Matrix for the planner.
+@param m Pointer to the Matrix.
+@param scanEntries Whether to scan the elements to estimate entry sizes and
+density. Otherwise the entries are assumed to be dense and MC_INTEGER_BITS
+bits.
+@param shape Pointer to the MC_Shape to fill in.
+*/
+void MC_shapeOf (Matrix *m, bool scanEntries, MC_Shape *shape);
+
+/**
+@fn MC_plan
+@brief Finds the cheapest order to evaluate a chain of products in.
+@param shapes The shapes of the matrices in the chain, in order.
+@param numMatrices The number of matrices in the chain.
+@param model Pointer to the cost model to use, or NULL to count multiply-adds
+from the shapes alone.
+@param plan Pointer to an MC_Plan pointer which will be set to the new plan.
+@return An error code. 0 if no problems were encountered.
+*/
+int MC_plan (MC_Shape *shapes, unsigned int numMatrices, MC_CostModel *model,
+	MC_Plan **plan);
+
+/**
+@fn MC_evaluate
+@brief Evaluates dest = coefficient * M0 * M1 * ... in the order chosen by a
+plan. Each intermediate product is computed with ME_evaluate and freed as soon
+as it has been used.
+@param plan Pointer to the plan.
+@param matrices The matrices of the chain. Their shapes must match the ones
+the plan was made for.
+@param coefficient The Rational to scale the product by.
+@param dest Pointer to the Matrix which will hold the result. Its dimensions
+must already match those of the product. It may be any matrix of the chain,
+since it is only written by the last product.
+@return An error code. 0 if no problems were encountered.
+*/
+int MC_evaluate (MC_Plan *plan, Matrix **matrices, Rational coefficient,
+	Matrix *dest);
+
+/**
+@fn MC_explain
+@brief Prints a plan: the parenthesized chain, its estimated cost against
+evaluating from left to right, and each intermediate product in the order it is
+computed.
+@param plan Pointer to the plan.
+@param names The names of the matrices of the chain, or NULL to call them
+M0, M1 and so on.
+@param out The stream to print to.
+*/
+void MC_explain (MC_Plan *plan, char **names, FILE *out);
+
+/**
+@fn MC_freePlan
+@brief Frees a plan made by MC_plan.
+@param plan Pointer to the plan to be freed.
+*/
+void MC_freePlan (MC_Plan *plan);
+
+#endif /* MATRIXCHAIN_H */
\ No newline at end of file
@@ -0,0 +1,371 @@
+/**
+@file MatrixExpr.c
+@author Rob Thomas
+@brief Contains functions for evaluating compound matrix expressions without
+creating intermediate matrices. An expression such as D = A*B + C - 2*E is
+described as a list of scaled terms, and every term is accumulated into the
+destination in a single pass over its rows. Product terms are evaluated as a
+multiply-with-accumulate, so A*B + C never materializes A*B on its own.
+*/
+
+/*** INCLUDES: ***/
+#include <string.h>
+
+#include "MatrixExpr.h"
+#include "SmallMatrix.h"
+#include "BufferPool.h"
+#include "Instrument.h"
+
+/*** DEFINES: ***/
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn ME_element
+@brief Builds an MT_ELEMENT term representing coefficient * m.
+@param coefficient The Rational to scale m by.
+@param m Pointer to the Matrix of the term.
+@return The built MatrixTerm.
+*/
+MatrixTerm ME_element (Rational coefficient, Matrix *m)
+{
+	MatrixTerm term;
+	term.type = MT_ELEMENT;
+	term.coefficient = coefficient;
+	term.left = m;
+	term.right = NULL;
+	return term;
+}
+
+/**
+@fn ME_product
+@brief Builds an MT_PRODUCT term representing coefficient * left * right.
+@param coefficient The Rational to scale the product by.
+@param left Pointer to the left operand of the product.
+@param right Pointer to the right operand of the product.
+@return The built MatrixTerm.
+*/
+MatrixTerm ME_product (Rational coefficient, Matrix *left, Matrix *right)
+{
+	MatrixTerm term;
+	term.type = MT_PRODUCT;
+	term.coefficient = coefficient;
+	term.left = left;
+	term.right = right;
+	return term;
+}
+
+/**
+@fn ME_checkDimensions
+@brief Verifies that every term of an expression has dimensions compatible
+with the destination Matrix.
+@param dest Pointer to the destination Matrix.
+@param terms The list of terms to check.
+@param numTerms The number of terms in the list.
+@return An error code. 0 if every term is compatible.
+*/
+static int ME_checkDimensions (Matrix *dest, MatrixTerm *terms,
+	unsigned int numTerms)
+{
+	for (unsigned int t = 0; t < numTerms; t++)
+	{
+		Matrix *left = terms[t].left;
+		Matrix *right = terms[t].right;
+		if ( terms[t].type == MT_ELEMENT )
+		{
+			if ( left->numRows != dest->numRows ||
+				left->numCols != dest->numCols )
+			{
+				return ERR_DIMENSION_MISMATCH;
+			}
+		}
+		else
+		{
+			if ( left->numRows != dest->numRows ||
+				right->numCols != dest->numCols ||
+				left->numCols != right->numRows )
+			{
+				return ERR_DIMENSION_MISMATCH;
+			}
+		}
+	}
+	return 0;
+}
+
+/**
+@fn ME_isIntegerExpr
+@brief Determines whether every operand and coefficient of an expression is an
+integer, in which case it can be evaluated with ME_evaluateIntegerRow.
+@param terms The list of terms to check.
+@param numTerms The number of terms in the list.
+@return true if the whole expression is made of integers, false otherwise.
+*/
+static bool ME_isIntegerExpr (MatrixTerm *terms, unsigned int numTerms)
+{
+	for (unsigned int t = 0; t < numTerms; t++)
+	{
+		if ( terms[t].coefficient.bottom != 1 || !terms[t].left->isInteger ||
+			(terms[t].type == MT_PRODUCT && !terms[t].right->isInteger) )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+@fn ME_evaluateIntegerRow
+@brief Evaluates one row of an all-integer expression using plain 64-bit
+integer arithmetic, with no cross-multiplication or GCDs.
+@param row The integer scratch row the result is accumulated into.
+@param terms The list of terms to be summed. Every operand must be an integer
+Matrix and every coefficient an integer.
+@param numTerms The number of terms in the list.
+@param i The index of the row being evaluated.
+@param numCols The number of columns of the result.
+@param dest Pointer to the destination Matrix.
+@param aliasedRight Pointer to the copy of dest used in place of any right
+operand which aliases it, or NULL.
+@return true if the row was evaluated, false if it overflowed.
+*/
+static bool ME_evaluateIntegerRow (int64_t *row, MatrixTerm *terms,
+	unsigned int numTerms, unsigned int i, unsigned int numCols, Matrix *dest,
+	Matrix *aliasedRight)
+{
+	bool overflow = false;
+	memset(row, 0, sizeof(int64_t) * numCols);
+	for (unsigned int t = 0; t < numTerms; t++)
+	{
+		int64_t coefficient = terms[t].coefficient.top;
+		if ( coefficient == 0 )
+		{
+			continue;
+		}
+		Matrix *left = terms[t].left;
+		if ( terms[t].type == MT_ELEMENT )
+		{
+			Rational *leftRow = &M_AT(left, i, 0);
+			for (unsigned int j = 0; j < numCols; j++)
+			{
+				/* A 32-bit element times a 32-bit coefficient cannot overflow,
+				   so only the sum needs checking. */
+				overflow |= __builtin_add_overflow(row[j],
+					coefficient * leftRow[j].top, &row[j]);
+			}
+		}
+		else
+		{
+			Matrix *right = terms[t].right;
+			if ( right->elements == dest->elements )
+			{
+				right = aliasedRight;
+			}
+			for (unsigned int k = 0; k < left->numCols; k++)
+			{
+				int64_t scaled = coefficient * M_AT(left, i, k).top;
+				if ( scaled == 0 )
+				{
+					continue;
+				}
+				Rational *rightRow = &M_AT(right, k, 0);
+				for (unsigned int j = 0; j < numCols; j++)
+				{
+					int64_t product;
+					overflow |= __builtin_mul_overflow(scaled, (int64_t)rightRow[j].top,
+						&product);
+					overflow |= __builtin_add_overflow(row[j], product, &row[j]);
+				}
+			}
+			if ( overflow )
+			{
+				return false;
+			}
+		}
+	}
+	/* Every entry has to fit back into a Rational. */
+	for (unsigned int j = 0; j < numCols; j++)
+	{
+		overflow |= row[j] > INT32_MAX || row[j] < INT32_MIN;
+	}
+	return !overflow;
+}
+
+/**
+@fn ME_evaluateRow
+@brief Evaluates one row of an expression using Rational arithmetic.
+@param row The scratch row the result is accumulated into.
+@param terms The list of terms to be summed.
+@param numTerms The number of terms in the list.
+@param i The index of the row being evaluated.
+@param numCols The number of columns of the result.
+@param dest Pointer to the destination Matrix.
+@param aliasedRight Pointer to the copy of dest used in place of any right
+operand which aliases it, or NULL.
+*/
+static void ME_evaluateRow (Rational *row, MatrixTerm *terms,
+	unsigned int numTerms, unsigned int i, unsigned int numCols, Matrix *dest,
+	Matrix *aliasedRight)
+{
+	Rational product;
+	/* Start the row at zero. */
+	for (unsigned int j = 0; j < numCols; j++)
+	{
+		row[j].top = 0;
+		row[j].bottom = 1;
+	}
+	/* Accumulate every term into the row. */
+	for (unsigned int t = 0; t < numTerms; t++)
+	{
+		Rational coefficient = terms[t].coefficient;
+		/* Terms scaled by zero contribute nothing. */
+		if ( coefficient.top == 0 )
+		{
+			continue;
+		}
+		Matrix *left = terms[t].left;
+		if ( terms[t].type == MT_ELEMENT )
+		{
+			Rational *leftRow = &M_AT(left, i, 0);
+			for (unsigned int j = 0; j < numCols; j++)
+			{
+				product = leftRow[j];
+				R_multR(&product, coefficient);
+				R_addR(&row[j], product);
+			}
+		}
+		else
+		{
+			Matrix *right = terms[t].right;
+			if ( right->elements == dest->elements )
+			{
+				right = aliasedRight;
+			}
+			/* Walk row i of left and the rows of right in order, so that
+			   right is streamed through contiguously. The coefficient is
+			   folded into each element of left once rather than into
+			   every product. */
+			for (unsigned int k = 0; k < left->numCols; k++)
+			{
+				Rational scaled = M_AT(left, i, k);
+				if ( scaled.top == 0 )
+				{
+					continue;
+				}
+				R_multR(&scaled, coefficient);
+				Rational *rightRow = &M_AT(right, k, 0);
+				for (unsigned int j = 0; j < numCols; j++)
+				{
+					if ( rightRow[j].top == 0 )
+					{
+						continue;
+					}
+					product = scaled;
+					R_multR(&product, rightRow[j]);
+					R_addR(&row[j], product);
+				}
+			}
+		}
+	}
+}
+
+/**
+@fn ME_evaluate
+@brief Evaluates the sum of a list of terms directly into a destination Matrix.
+@details Each row of the result is accumulated into a single row-sized scratch
+buffer and then written into dest, so no full-size temporaries are created.
+dest may be the same Matrix as any MT_ELEMENT operand or the left operand of any
+MT_PRODUCT term. If dest is the right operand of a product, that operand is
+copied once before evaluation begins. If every operand is an integer Matrix and
+every coefficient an integer, rows are evaluated with 64-bit integers. Such a
+result is exact or does not fit in a Rational at all, so a row which overflows
+is reported rather than evaluated again with Rationals, which would truncate it.
+@param dest Pointer to the Matrix which will hold the result. Its dimensions
+must already match the dimensions of the expression.
+@param terms The list of terms to be summed.
+@param numTerms The number of terms in the list.
+@return An error code. 0 if no problems were encountered. ERR_EXPR_OVERFLOW if
+an all-integer expression has an element which does not fit in a Rational, in
+which case the contents of dest are unspecified.
+*/
+int ME_evaluate (Matrix *dest, MatrixTerm *terms, unsigned int numTerms)
+{
+	if ( numTerms == 0 )
+	{
+		return ERR_NO_TERMS;
+	}
+	int error = ME_checkDimensions(dest, terms, numTerms);
+	if ( error )
+	{
+		return error;
+	}
+	/* A lone product of small square matrices is handled by the fixed-size
+	   kernels, unless they report that the operands are out of their range. */
+	if ( numTerms == 1 && terms[0].type == MT_PRODUCT &&
+		SM_multiply(dest, terms[0].coefficient, terms[0].left,
+		terms[0].right) == 0 )
+	{
+		return 0;
+	}
+	/* Row i of dest is only written after every read of row i of an element
+	   operand or a left operand, so those may alias dest. The right operand of
+	   a product is read in full for every row, so if it aliases dest it has to
+	   be copied up front. */
+	Matrix *aliasedRight = NULL;
+	for (unsigned int t = 0; t < numTerms; t++)
+	{
+		if ( terms[t].type == MT_PRODUCT &&
+			terms[t].right->elements == dest->elements && !aliasedRight )
+		{
+			aliasedRight = M_copy(dest);
+			if ( !aliasedRight )
+			{
+				return ERR_ALLOCATION_FAILED;
+			}
+		}
+	}
+	/* Allocate the scratch rows that each row of the result accumulates into. */
+	unsigned int numCols = dest->numCols;
+	bool isInteger = ME_isIntegerExpr(terms, numTerms);
+	Rational *row = (Rational *)BP_alloc(sizeof(Rational) * (numCols ? numCols : 1));
+	int64_t *integerRow = NULL;
+	if ( isInteger )
+	{
+		integerRow = (int64_t *)BP_alloc(sizeof(int64_t) * (numCols ? numCols : 1));
+	}
+	if ( !row || (isInteger && !integerRow) )
+	{
+		BP_release(row);
+		BP_release(integerRow);
+		M_free(aliasedRight);
+		return ERR_ALLOCATION_FAILED;
+	}
+	for (unsigned int i = 0; i < dest->numRows; i++)
+	{
+		if ( !isInteger )
+		{
+			ME_evaluateRow(row, terms, numTerms, i, numCols, dest, aliasedRight);
+		}
+		else if ( ME_evaluateIntegerRow(integerRow, terms, numTerms, i, numCols,
+			dest, aliasedRight) )
+		{
+			for (unsigned int j = 0; j < numCols; j++)
+			{
+				row[j].top = integerRow[j];
+				row[j].bottom = 1;
+			}
+		}
+		else
+		{
+			INST_COUNT(overflows, 1);
+			error = ERR_EXPR_OVERFLOW;
+			break;
+		}
+		/* Write the finished row into dest. */
+		memcpy(&M_AT(dest, i, 0), row, sizeof(Rational) * numCols);
+	}
+	BP_release(row);
+	BP_release(integerRow);
+	M_free(aliasedRight);
+	M_rehash(dest);
+	return error;
+}
\ No newline at end of file
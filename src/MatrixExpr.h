@@ -0,0 +1,94 @@
+/**
+@file MatrixExpr.h
+@author Rob Thomas
+@brief Contains functions for evaluating compound matrix expressions without
+creating intermediate matrices. An expression such as D = A*B + C - 2*E is
+described as a list of scaled terms, and every term is accumulated into the
+destination in a single pass over its rows. Product terms are evaluated as a
+multiply-with-accumulate, so A*B + C never materializes A*B on its own.
+*/
+
+#ifndef MATRIXEXPR_H
+#define MATRIXEXPR_H
+
+/*** INCLUDES: ***/
+#include "Matrix.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define ERR_NO_TERMS -20
+#define ERR_EXPR_OVERFLOW -21
+
+/*** STRUCTS: ***/
+
+/**
+@def MatrixTermType
+@brief An enumerated type representing the kind of a term in a MatrixExpr.
+@var MT_ELEMENT The term is a single matrix scaled by a coefficient.
+@var MT_PRODUCT The term is the product of two matrices scaled by a coefficient.
+*/
+typedef enum
+{
+	MT_ELEMENT,
+	MT_PRODUCT
+} MatrixTermType;
+
+/**
+@def MatrixTerm
+@brief A struct representing a single scaled term of a matrix expression.
+@var type The kind of term. See definition of MatrixTermType above.
+@var coefficient The Rational that the term is scaled by. Subtraction is
+expressed with a negative coefficient.
+@var left The matrix of an MT_ELEMENT term, or the left operand of an
+MT_PRODUCT term.
+@var right The right operand of an MT_PRODUCT term. Unused by MT_ELEMENT terms.
+*/
+typedef struct
+{
+	MatrixTermType type;
+	Rational coefficient;
+	Matrix *left;
+	Matrix *right;
+} MatrixTerm;
+
+/*** FUNCTION PROTOTYPES: ***/
+
+/**
+@fn ME_element
+@brief Builds an MT_ELEMENT term representing coefficient * m.
+@param coefficient The Rational to scale m by.
+@param m Pointer to the Matrix of the term.
+@return The built MatrixTerm.
+*/
+MatrixTerm ME_element (Rational coefficient, Matrix *m);
+
+/**
+@fn ME_product
+@brief Builds an MT_PRODUCT term representing coefficient * left * right.
+@param coefficient The Rational to scale the product by.
+@param left Pointer to the left operand of the product.
+@param right Pointer to the right operand of the product.
+@return The built MatrixTerm.
+*/
+MatrixTerm ME_product (Rational coefficient, Matrix *left, Matrix *right);
+
+/**
+@fn ME_evaluate
+@brief Evaluates the sum of a list of terms directly into a destination Matrix.
+@details Each row of the result is accumulated into a single row-sized scratch
+buffer and then written into dest, so no full-size temporaries are created.
+dest may be the same Matrix as any MT_ELEMENT operand or the left operand of any
+MT_PRODUCT term. If dest is the right operand of a product, that operand is
+copied once before evaluation begins. If every operand is an integer Matrix and
+every coefficient an integer, rows are evaluated with 64-bit integers.
+@param dest Pointer to the Matrix which will hold the result. Its dimensions
+must already match the dimensions of the expression.
+@param terms The list of terms to be summed.
+@param numTerms The number of terms in the list.
+@return An error code. 0 if no problems were encountered. ERR_EXPR_OVERFLOW if
+an all-integer expression has an element which does not fit in a Rational, in
+which case the contents of dest are unspecified.
+*/
+int ME_evaluate (Matrix *dest, MatrixTerm *terms, unsigned int numTerms);
+
+#endif /* MATRIXEXPR_H */
\ No newline at end of file
@@ -0,0 +1,256 @@
+/**
+@file MatrixFactor.c
+@author Rob Thomas
+@brief Contains functions for solving with, and taking the determinant,
+inverse and rank of, Matrix variables stored in a HashTable. The factorization
+each of these needs is computed the first time any of them is used on a
+variable and cached alongside it in the table, so later calls on the same
+variable reuse it. Reassigning the variable through HT_add discards it.
+*/
+
+/*** INCLUDES: ***/
+#include "MatrixFactor.h"
+#include "SmallMatrix.h"
+
+/*** DEFINES: ***/
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn MF_smallMatrix
+@brief Finds a Matrix variable small enough for the fixed-size kernels, which
+are cheaper than computing or even looking up a cached factorization.
+@param table Pointer to the HashTable holding the variable.
+@param key The key of the variable. Must be null-terminated.
+@return A pointer to the Matrix, or NULL if the variable is not a small
+square Matrix.
+*/
+static Matrix *MF_smallMatrix (HashTable *table, char *key)
+{
+	value_t valueType;
+	Matrix *m = (Matrix *)HT_get(table, key, &valueType);
+	if ( !m || valueType != VT_MATRIX || !SM_isSmall(m) )
+	{
+		return NULL;
+	}
+	return m;
+}
+
+/**
+@fn MF_factorization
+@brief Finds the factorization cached alongside a Matrix variable, computing
+and caching it first if there is none.
+@param table Pointer to the HashTable holding the variable.
+@param key The key of the variable. Must be null-terminated.
+@param result Pointer to an MF_Factorization pointer which will be set to the
+cached factorization. It belongs to the table.
+@return An error code. 0 if no problems were encountered.
+*/
+int MF_factorization (HashTable *table, char *key, MF_Factorization **result)
+{
+	MF_Factorization *f = (MF_Factorization *)HT_getCache(table, key);
+	if ( f )
+	{
+		*result = f;
+		return 0;
+	}
+	value_t valueType;
+	Matrix *m = (Matrix *)HT_get(table, key, &valueType);
+	if ( !m )
+	{
+		return FAIL_KEY_NOT_FOUND;
+	}
+	if ( valueType != VT_MATRIX )
+	{
+		return ERR_NOT_A_MATRIX;
+	}
+	f = (MF_Factorization *)calloc(1, sizeof(MF_Factorization));
+	if ( !f )
+	{
+		return ERR_ALLOCATION_FAILED;
+	}
+	int error = LS_factor(m, &f->lu);
+	if ( error == ERR_SINGULAR )
+	{
+		/* A singular Matrix has no factorization to reuse, but its rank and
+		   determinant are still worth keeping. LS_factor only reports
+		   ERR_SINGULAR once the rank is proven to be below n, so the
+		   determinant really is 0. */
+		f->lu = NULL;
+		f->hasDeterminant = true;
+		f->determinant.top = 0;
+		f->determinant.bottom = 1;
+		error = LS_rank(m, &f->rank);
+	}
+	else if ( !error )
+	{
+		f->rank = m->numRows;
+	}
+	if ( !error )
+	{
+		error = HT_setCache(table, key, f, MF_free);
+	}
+	if ( error )
+	{
+		MF_free(f);
+		return error;
+	}
+	*result = f;
+	return 0;
+}
+
+/**
+@fn MF_solve
+@brief Solves A*X = B for X, where A is a Matrix variable.
+@param table Pointer to the HashTable holding A.
+@param key The key of A. Must be null-terminated.
+@param b Pointer to the Matrix of right-hand sides.
+@param x Pointer to the Matrix which will hold the solutions. Must have the
+same dimensions as b.
+@return An error code. 0 if no problems were encountered. ERR_SINGULAR if A is
+singular.
+*/
+int MF_solve (HashTable *table, char *key, Matrix *b, Matrix *x)
+{
+	Matrix *m = MF_smallMatrix(table, key);
+	if ( m )
+	{
+		int error = SM_solve(m, b, x);
+		if ( error != FAIL_SMALL_UNSUPPORTED )
+		{
+			return error;
+		}
+	}
+	MF_Factorization *f;
+	int error = MF_factorization(table, key, &f);
+	if ( error )
+	{
+		return error;
+	}
+	if ( !f->lu )
+	{
+		return ERR_SINGULAR;
+	}
+	return LS_solve(f->lu, b, x);
+}
+
+/**
+@fn MF_determinant
+@brief Computes the determinant of a Matrix variable.
+@param table Pointer to the HashTable holding the Matrix.
+@param key The key of the Matrix. Must be null-terminated.
+@param determinant Pointer to where the determinant will be written.
+@return An error code. 0 if no problems were encountered.
+*/
+int MF_determinant (HashTable *table, char *key, Rational *determinant)
+{
+	Matrix *m = MF_smallMatrix(table, key);
+	if ( m )
+	{
+		int error = SM_determinant(m, determinant);
+		if ( error != FAIL_SMALL_UNSUPPORTED )
+		{
+			return error;
+		}
+	}
+	MF_Factorization *f;
+	int error = MF_factorization(table, key, &f);
+	if ( error )
+	{
+		return error;
+	}
+	if ( !f->hasDeterminant )
+	{
+		f->determinantError = LS_determinant(f->lu, &f->determinant);
+		f->hasDeterminant = true;
+	}
+	if ( !f->determinantError )
+	{
+		*determinant = f->determinant;
+	}
+	return f->determinantError;
+}
+
+/**
+@fn MF_inverse
+@brief Computes the inverse of a Matrix variable.
+@param table Pointer to the HashTable holding the Matrix.
+@param key The key of the Matrix. Must be null-terminated.
+@param inverse Pointer to the Matrix which will hold the inverse. Must have the
+same dimensions as the variable.
+@return An error code. 0 if no problems were encountered. ERR_SINGULAR if the
+Matrix is singular.
+*/
+int MF_inverse (HashTable *table, char *key, Matrix *inverse)
+{
+	Matrix *m = MF_smallMatrix(table, key);
+	if ( m )
+	{
+		int error = SM_inverse(m, inverse);
+		if ( error != FAIL_SMALL_UNSUPPORTED )
+		{
+			return error;
+		}
+	}
+	MF_Factorization *f;
+	int error = MF_factorization(table, key, &f);
+	if ( error )
+	{
+		return error;
+	}
+	if ( !f->lu )
+	{
+		return ERR_SINGULAR;
+	}
+	/* Solve against every column of the identity at once. */
+	unsigned int n = f->lu->size;
+	Matrix *identity = M_new(n, n);
+	if ( !identity )
+	{
+		return ERR_ALLOCATION_FAILED;
+	}
+	for (unsigned int i = 0; i < n; i++)
+	{
+		M_AT(identity, i, i).top = 1;
+	}
+	M_rehash(identity);
+	error = LS_solve(f->lu, identity, inverse);
+	M_free(identity);
+	return error;
+}
+
+/**
+@fn MF_rank
+@brief Computes the rank of a Matrix variable.
+@param table Pointer to the HashTable holding the Matrix.
+@param key The key of the Matrix. Must be null-terminated.
+@param rank Pointer to where the rank will be written.
+@return An error code. 0 if no problems were encountered.
+*/
+int MF_rank (HashTable *table, char *key, unsigned int *rank)
+{
+	MF_Factorization *f;
+	int error = MF_factorization(table, key, &f);
+	if ( error )
+	{
+		return error;
+	}
+	*rank = f->rank;
+	return 0;
+}
+
+/**
+@fn MF_free
+@brief Frees an MF_Factorization. Passed to HT_setCache so that the table can
+free the factorization when the variable changes.
+@param f Pointer to the MF_Factorization to be freed.
+*/
+void MF_free (void *f)
+{
+	if ( !f )
+	{
+		return;
+	}
+	LS_free(((MF_Factorization *)f)->lu);
+	free(f);
+}
\ No newline at end of file
@@ -0,0 +1,113 @@
+/**
+@file MatrixFactor.h
+@author Rob Thomas
+@brief Contains functions for solving with, and taking the determinant,
+inverse and rank of, Matrix variables stored in a HashTable. The factorization
+each of these needs is computed the first time any of them is used on a
+variable and cached alongside it in the table, so later calls on the same
+variable reuse it. Reassigning the variable through HT_add discards it.
+*/
+
+#ifndef MATRIXFACTOR_H
+#define MATRIXFACTOR_H
+
+/*** INCLUDES: ***/
+#include <stdbool.h>
+
+#include "HashTable.h"
+#include "LinearSolve.h"
+#include "Matrix.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define ERR_NOT_A_MATRIX -90
+
+/*** STRUCTS: ***/
+
+/**
+@def MF_Factorization
+@brief A struct representing everything cached about a Matrix variable.
+@var lu The factorization of the Matrix. NULL if the Matrix is singular.
+@var rank The rank of the Matrix.
+@var hasDeterminant Whether determinant has been computed yet.
+@var determinant The determinant of the Matrix, once computed.
+@var determinantError The error code from computing the determinant, so that
+a determinant which does not fit in a Rational is not recomputed either.
+*/
+typedef struct
+{
+	LS_Factorization *lu;
+	unsigned int rank;
+	bool hasDeterminant;
+	Rational determinant;
+	int determinantError;
+} MF_Factorization;
+
+/*** FUNCTION PROTOTYPES: ***/
+
+/**
+@fn MF_factorization
+@brief Finds the factorization cached alongside a Matrix variable, computing
+and caching it first if there is none.
+@param table Pointer to the HashTable holding the variable.
+@param key The key of the variable. Must be null-terminated.
+@param result Pointer to an MF_Factorization pointer which will be set to the
+cached factorization. It belongs to the table.
+@return An error code. 0 if no problems were encountered.
+*/
+int MF_factorization (HashTable *table, char *key, MF_Factorization **result);
+
+/**
+@fn MF_solve
+@brief Solves A*X = B for X, where A is a Matrix variable.
+@param table Pointer to the HashTable holding A.
+@param key The key of A. Must be null-terminated.
+@param b Pointer to the Matrix of right-hand sides.
+@param x Pointer to the Matrix which will hold the solutions. Must have the
+same dimensions as b.
+@return An error code. 0 if no problems were encountered. ERR_SINGULAR if A is
+singular.
+*/
+int MF_solve (HashTable *table, char *key, Matrix *b, Matrix *x);
+
+/**
+@fn MF_determinant
+@brief Computes the determinant of a Matrix variable.
+@param table Pointer to the HashTable holding the Matrix.
+@param key The key of the Matrix. Must be null-terminated.
+@param determinant Pointer to where the determinant will be written.
+@return An error code. 0 if no problems were encountered.
+*/
+int MF_determinant (HashTable *table, char *key, Rational *determinant);
+
+/**
+@fn MF_inverse
+@brief Computes the inverse of a Matrix variable.
+@param table Pointer to the HashTable holding the Matrix.
+@param key The key of the Matrix. Must be null-terminated.
+@param inverse Pointer to the Matrix which will hold the inverse. Must have the
+same dimensions as the variable.
+@return An error code. 0 if no problems were encountered. ERR_SINGULAR if the
+Matrix is singular.
+*/
+int MF_inverse (HashTable *table, char *key, Matrix *inverse);
+
+/**
+@fn MF_rank
+@brief Computes the rank of a Matrix variable.
+@param table Pointer to the HashTable holding the Matrix.
+@param key The key of the Matrix. Must be null-terminated.
+@param rank Pointer to where the rank will be written.
+@return An error code. 0 if no problems were encountered.
+*/
+int MF_rank (HashTable *table, char *key, unsigned int *rank);
+
+/**
+@fn MF_free
+@brief Frees an MF_Factorization. Passed to HT_setCache so that the table can
+free the factorization when the variable changes.
+@param f Pointer to the MF_Factorization to be freed.
+*/
+void MF_free (void *f);
+
+#endif /* MATRIXFACTOR_H */
\ No newline at end of file
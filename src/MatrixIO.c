@@ -0,0 +1,649 @@
+/**
+@file MatrixIO.c
+@author Rob Thomas
+@brief Contains functions for reading matrices of Rationals from text files
+and writing them back out. Each line of a file is one row of the matrix, and
+entries are integers or fractions of the form p/q separated by whitespace or
+commas. Files are parsed in chunks straight into the matrix's element buffer,
+optionally split across several threads by line ranges.
+*/
+
+/*** INCLUDES: ***/
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "MatrixIO.h"
+#include "BufferPool.h"
+#include "OutputBuffer.h"
+
+/*** DEFINES: ***/
+#define MIO_IS_SEPARATOR(c) ((c) == ' ' || (c) == '\t' || (c) == ',' || (c) == '\r')
+#define MIO_IS_DIGIT(c) ((c) >= '0' && (c) <= '9')
+
+/*** STRUCTS: ***/
+
+/**
+@def MIO_Range
+@brief A struct representing the share of a file parsed by one thread.
+@var start The first character of the range. Always the start of a line.
+@var end One past the last character of the range.
+@var numRows The number of non-blank lines in the range.
+@var firstRow The row of the result that the range's first line belongs in.
+@var numCols The number of columns of the result.
+@var elements The element buffer of the result.
+@var error The error code produced while parsing the range. 0 if none.
+*/
+typedef struct
+{
+	const char *start;
+	const char *end;
+	size_t numRows;
+	size_t firstRow;
+	unsigned int numCols;
+	Rational *elements;
+	int error;
+} MIO_Range;
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn MIO_parseInteger
+@brief Parses a run of decimal digits into a non-negative 64-bit integer.
+@param cursor Pointer to the current position in the text. Advanced past the
+digits.
+@param end One past the last character of the text.
+@param value Pointer to the integer which the result will be written to.
+@return An error code. 0 if no problems were encountered.
+*/
+static int MIO_parseInteger (const char **cursor, const char *end,
+	int64_t *value)
+{
+	const char *c = *cursor;
+	if ( c == end || !MIO_IS_DIGIT(*c) )
+	{
+		return ERR_IO_PARSE;
+	}
+	int64_t result = 0;
+	while ( c < end && MIO_IS_DIGIT(*c) )
+	{
+		/* Anything past 2^62 cannot reduce down to a 32-bit Rational anyway. */
+		if ( result > (INT64_C(1) << 62) / 10 )
+		{
+			return ERR_IO_OVERFLOW;
+		}
+		result = result * 10 + (*c - '0');
+		c++;
+	}
+	*cursor = c;
+	*value = result;
+	return 0;
+}
+
+/**
+@fn MIO_parseEntry
+@brief Parses a single entry of the form [-]p or [-]p/q and reduces it.
+@param cursor Pointer to the current position in the text. Advanced past the
+entry.
+@param end One past the last character of the text.
+@param dest Pointer to the Rational which the entry will be written to.
+@return An error code. 0 if no problems were encountered.
+*/
+static int MIO_parseEntry (const char **cursor, const char *end, Rational *dest)
+{
+	const char *c = *cursor;
+	bool isNegative = false;
+	if ( c < end && (*c == '-' || *c == '+') )
+	{
+		isNegative = *c == '-';
+		c++;
+	}
+	int64_t top, bottom = 1;
+	int error = MIO_parseInteger(&c, end, &top);
+	if ( error )
+	{
+		return error;
+	}
+	if ( c < end && *c == '/' )
+	{
+		c++;
+		error = MIO_parseInteger(&c, end, &bottom);
+		if ( error )
+		{
+			return error;
+		}
+		if ( bottom == 0 )
+		{
+			return ERR_IO_ZERO_DENOMINATOR;
+		}
+	}
+	/* An entry must be followed by a separator or the end of the line. */
+	if ( c < end && !MIO_IS_SEPARATOR(*c) )
+	{
+		return ERR_IO_PARSE;
+	}
+	/* Make sure the reduced fraction fits in 32 bits before reducing it. A
+	   negative top may reach INT32_MIN, one further than a positive top. */
+	int64_t topLimit = isNegative ? -(int64_t)INT32_MIN : INT32_MAX;
+	if ( top > topLimit || bottom > INT32_MAX )
+	{
+		int64_t gcd = R_GCD(top, bottom);
+		if ( top / gcd > topLimit || bottom / gcd > INT32_MAX )
+		{
+			return ERR_IO_OVERFLOW;
+		}
+	}
+	R_reduce64(dest, isNegative ? -top : top, bottom);
+	*cursor = c;
+	return 0;
+}
+
+/**
+@fn MIO_parseLine
+@brief Parses every entry of one line of text.
+@param start The first character of the line.
+@param end One past the last character of the line, not including the newline.
+@param dest The buffer the entries will be written to.
+@param capacity The maximum number of entries that may be written to dest.
+@param count Pointer to an unsigned int which the number of entries parsed will
+be written to.
+@return An error code. 0 if no problems were encountered.
+*/
+static int MIO_parseLine (const char *start, const char *end, Rational *dest,
+	size_t capacity, unsigned int *count)
+{
+	const char *c = start;
+	*count = 0;
+	while ( true )
+	{
+		while ( c < end && MIO_IS_SEPARATOR(*c) )
+		{
+			c++;
+		}
+		if ( c == end )
+		{
+			return 0;
+		}
+		if ( *count == capacity )
+		{
+			return ERR_IO_ROW_LENGTH;
+		}
+		int error = MIO_parseEntry(&c, end, &dest[*count]);
+		if ( error )
+		{
+			return error;
+		}
+		(*count)++;
+	}
+}
+
+/**
+@fn MIO_isBlank
+@brief Determines whether a line of text contains only separators.
+@param start The first character of the line.
+@param end One past the last character of the line.
+@return true if the line is blank, false otherwise.
+*/
+static bool MIO_isBlank (const char *start, const char *end)
+{
+	for (const char *c = start; c < end; c++)
+	{
+		if ( !MIO_IS_SEPARATOR(*c) )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+@fn MIO_newMatrix
+@brief Wraps an already-filled element buffer in a newly allocated Matrix.
+@param numRows The number of rows of the Matrix.
+@param numCols The number of columns of the Matrix.
+@param elements The element buffer, allocated with BP_alloc. Ownership passes
+to the Matrix.
+@return A pointer to the new Matrix, or NULL if allocation failed.
+*/
+static Matrix *MIO_newMatrix (size_t numRows, unsigned int numCols,
+	Rational *elements)
+{
+	Matrix *m = (Matrix *)malloc(sizeof(Matrix));
+	if ( !m )
+	{
+		return NULL;
+	}
+	m->numRows = numRows;
+	m->numCols = numCols;
+	m->elements = elements;
+	m->isBorrowed = false;
+	M_rehash(m);
+	return m;
+}
+
+/**
+@fn MIO_readStreaming
+@brief Reads a matrix from a text file on the calling thread, streaming the
+file through a chunk buffer and appending each row to the element buffer.
+@param path The path of the file to read.
+@param result Pointer to a Matrix pointer which will be set to the result.
+@return An error code. 0 if no problems were encountered.
+*/
+static int MIO_readStreaming (const char *path, Matrix **result)
+{
+	int fd = open(path, O_RDONLY);
+	if ( fd < 0 )
+	{
+		return ERR_IO_FILE;
+	}
+	size_t chunkSize = MIO_CHUNK_SIZE;
+	char *chunk = (char *)malloc(chunkSize);
+	Rational *elements = NULL;
+	size_t numElements = 0, capacity = 0, numRows = 0, filled = 0;
+	unsigned int numCols = 0;
+	bool isEndOfFile = false;
+	int error = chunk ? 0 : ERR_ALLOCATION_FAILED;
+	while ( !error && !isEndOfFile )
+	{
+		ssize_t numRead = read(fd, chunk + filled, chunkSize - filled);
+		if ( numRead < 0 )
+		{
+			error = ERR_IO_FILE;
+			break;
+		}
+		isEndOfFile = numRead == 0;
+		filled += numRead;
+		/* Parse every complete line in the chunk. At the end of the file, the
+		   last line counts as complete even without a newline. */
+		char *lineStart = chunk;
+		char *end = chunk + filled;
+		while ( !error && lineStart < end )
+		{
+			char *lineEnd = (char *)memchr(lineStart, '\n', end - lineStart);
+			if ( !lineEnd && !isEndOfFile )
+			{
+				break;
+			}
+			if ( !lineEnd )
+			{
+				lineEnd = end;
+			}
+			/* The first row decides the number of columns, so until then
+			   reserve enough room for the most entries a line could hold. */
+			size_t needed = numCols ? numCols : (size_t)(lineEnd - lineStart) / 2 + 1;
+			if ( numElements + needed > capacity )
+			{
+				size_t newCapacity = capacity ? capacity * 2 : 1024;
+				while ( numElements + needed > newCapacity )
+				{
+					newCapacity *= 2;
+				}
+				Rational *grown = (Rational *)BP_resize(elements,
+					sizeof(Rational) * newCapacity);
+				if ( !grown )
+				{
+					error = ERR_ALLOCATION_FAILED;
+					break;
+				}
+				elements = grown;
+				capacity = newCapacity;
+			}
+			unsigned int count;
+			error = MIO_parseLine(lineStart, lineEnd, elements + numElements,
+				needed, &count);
+			if ( !error && count > 0 )
+			{
+				if ( numCols == 0 )
+				{
+					numCols = count;
+				}
+				else if ( count != numCols )
+				{
+					error = ERR_IO_ROW_LENGTH;
+				}
+				numElements += count;
+				numRows++;
+			}
+			lineStart = lineEnd + 1;
+		}
+		if ( error || isEndOfFile )
+		{
+			break;
+		}
+		/* Move the incomplete last line to the front of the chunk. If it
+		   fills the whole chunk, grow the chunk so the line can finish. */
+		size_t remaining = end - lineStart;
+		memmove(chunk, lineStart, remaining);
+		filled = remaining;
+		if ( filled == chunkSize )
+		{
+			char *grown = (char *)realloc(chunk, chunkSize * 2);
+			if ( !grown )
+			{
+				error = ERR_ALLOCATION_FAILED;
+				break;
+			}
+			chunk = grown;
+			chunkSize *= 2;
+		}
+	}
+	close(fd);
+	free(chunk);
+	if ( !error )
+	{
+		*result = MIO_newMatrix(numRows, numCols, elements);
+		if ( !*result )
+		{
+			error = ERR_ALLOCATION_FAILED;
+		}
+	}
+	if ( error )
+	{
+		BP_release(elements);
+	}
+	return error;
+}
+
+/**
+@fn MIO_countRange
+@brief Thread function which counts the non-blank lines in a MIO_Range.
+@param arg Pointer to the MIO_Range.
+@return NULL.
+*/
+static void *MIO_countRange (void *arg)
+{
+	MIO_Range *range = (MIO_Range *)arg;
+	const char *lineStart = range->start;
+	range->numRows = 0;
+	while ( lineStart < range->end )
+	{
+		const char *lineEnd = (const char *)memchr(lineStart, '\n',
+			range->end - lineStart);
+		if ( !lineEnd )
+		{
+			lineEnd = range->end;
+		}
+		if ( !MIO_isBlank(lineStart, lineEnd) )
+		{
+			range->numRows++;
+		}
+		lineStart = lineEnd + 1;
+	}
+	return NULL;
+}
+
+/**
+@fn MIO_parseRange
+@brief Thread function which parses every line of a MIO_Range directly into
+that range's rows of the result.
+@param arg Pointer to the MIO_Range.
+@return NULL.
+*/
+static void *MIO_parseRange (void *arg)
+{
+	MIO_Range *range = (MIO_Range *)arg;
+	const char *lineStart = range->start;
+	Rational *row = range->elements + range->firstRow * range->numCols;
+	range->error = 0;
+	while ( lineStart < range->end )
+	{
+		const char *lineEnd = (const char *)memchr(lineStart, '\n',
+			range->end - lineStart);
+		if ( !lineEnd )
+		{
+			lineEnd = range->end;
+		}
+		unsigned int count;
+		range->error = MIO_parseLine(lineStart, lineEnd, row, range->numCols,
+			&count);
+		if ( range->error )
+		{
+			return NULL;
+		}
+		if ( count > 0 )
+		{
+			if ( count != range->numCols )
+			{
+				range->error = ERR_IO_ROW_LENGTH;
+				return NULL;
+			}
+			row += range->numCols;
+		}
+		lineStart = lineEnd + 1;
+	}
+	return NULL;
+}
+
+/**
+@fn MIO_runRanges
+@brief Runs a thread function over every MIO_Range, one thread per range. If a
+thread cannot be started, its range is run on the calling thread instead.
+@param function The thread function to run.
+@param ranges The list of ranges.
+@param numRanges The number of ranges.
+*/
+static void MIO_runRanges (void *(*function)(void *), MIO_Range *ranges,
+	unsigned int numRanges)
+{
+	pthread_t threads[MIO_MAX_THREADS];
+	unsigned int numStarted = 0;
+	/* The calling thread takes the first range itself. */
+	for (unsigned int t = 1; t < numRanges; t++)
+	{
+		if ( pthread_create(&threads[t], NULL, function, &ranges[t]) )
+		{
+			break;
+		}
+		numStarted = t;
+	}
+	function(&ranges[0]);
+	for (unsigned int t = 1; t <= numStarted; t++)
+	{
+		pthread_join(threads[t], NULL);
+	}
+	/* Any range that never got a thread is run here instead. */
+	for (unsigned int t = numStarted + 1; t < numRanges; t++)
+	{
+		function(&ranges[t]);
+	}
+}
+
+/**
+@fn MIO_readParallel
+@brief Reads a matrix from a text file using several threads. The file is
+mapped, divided into line ranges, and parsed in two passes: one which counts
+the rows in each range, and one which parses each range into its rows.
+@param path The path of the file to read.
+@param numThreads The number of threads to parse with.
+@param result Pointer to a Matrix pointer which will be set to the result.
+@return An error code. 0 if no problems were encountered.
+*/
+static int MIO_readParallel (const char *path, unsigned int numThreads,
+	Matrix **result)
+{
+	int fd = open(path, O_RDONLY);
+	if ( fd < 0 )
+	{
+		return ERR_IO_FILE;
+	}
+	struct stat info;
+	if ( fstat(fd, &info) )
+	{
+		close(fd);
+		return ERR_IO_FILE;
+	}
+	size_t size = info.st_size;
+	if ( size == 0 )
+	{
+		close(fd);
+		*result = MIO_newMatrix(0, 0, NULL);
+		return *result ? 0 : ERR_ALLOCATION_FAILED;
+	}
+	const char *text = (const char *)mmap(NULL, size, PROT_READ, MAP_PRIVATE,
+		fd, 0);
+	close(fd);
+	if ( text == MAP_FAILED )
+	{
+		return ERR_IO_FILE;
+	}
+	madvise((void *)text, size, MADV_SEQUENTIAL);
+	const char *end = text + size;
+	/* Split the file into ranges of roughly equal size, moving each split
+	   forward to the start of the next line. */
+	MIO_Range ranges[MIO_MAX_THREADS];
+	const char *start = text;
+	for (unsigned int t = 0; t < numThreads; t++)
+	{
+		const char *split = text + size / numThreads * (t + 1);
+		if ( t == numThreads - 1 || split >= end )
+		{
+			split = end;
+		}
+		else if ( split > start )
+		{
+			const char *newline = (const char *)memchr(split - 1, '\n',
+				end - (split - 1));
+			split = newline ? newline + 1 : end;
+		}
+		else
+		{
+			split = start;
+		}
+		ranges[t].start = start;
+		ranges[t].end = split;
+		start = split;
+	}
+	/* The first non-blank line decides the number of columns. */
+	const char *lineStart = text;
+	unsigned int numCols = 0;
+	int error = 0;
+	while ( lineStart < end && numCols == 0 && !error )
+	{
+		const char *lineEnd = (const char *)memchr(lineStart, '\n', end - lineStart);
+		if ( !lineEnd )
+		{
+			lineEnd = end;
+		}
+		size_t capacity = (size_t)(lineEnd - lineStart) / 2 + 1;
+		Rational *firstRow = (Rational *)malloc(sizeof(Rational) * capacity);
+		if ( !firstRow )
+		{
+			error = ERR_ALLOCATION_FAILED;
+			break;
+		}
+		error = MIO_parseLine(lineStart, lineEnd, firstRow, capacity, &numCols);
+		free(firstRow);
+		lineStart = lineEnd + 1;
+	}
+	/* Count the rows in each range, then give each range its first row. */
+	size_t numRows = 0;
+	if ( !error )
+	{
+		MIO_runRanges(MIO_countRange, ranges, numThreads);
+	}
+	for (unsigned int t = 0; !error && t < numThreads; t++)
+	{
+		ranges[t].firstRow = numRows;
+		numRows += ranges[t].numRows;
+	}
+	Rational *elements = NULL;
+	if ( !error && numRows * numCols > 0 )
+	{
+		elements = (Rational *)BP_alloc(sizeof(Rational) * numRows * numCols);
+		if ( !elements )
+		{
+			error = ERR_ALLOCATION_FAILED;
+		}
+	}
+	/* Parse every range into its rows. */
+	if ( !error )
+	{
+		for (unsigned int t = 0; t < numThreads; t++)
+		{
+			ranges[t].numCols = numCols;
+			ranges[t].elements = elements;
+		}
+		MIO_runRanges(MIO_parseRange, ranges, numThreads);
+	}
+	for (unsigned int t = 0; !error && t < numThreads; t++)
+	{
+		error = ranges[t].error;
+	}
+	munmap((void *)text, size);
+	if ( !error )
+	{
+		*result = MIO_newMatrix(numRows, numCols, elements);
+		if ( !*result )
+		{
+			error = ERR_ALLOCATION_FAILED;
+		}
+	}
+	if ( error )
+	{
+		BP_release(elements);
+	}
+	return error;
+}
+
+/**
+@fn MIO_read
+@brief Reads a matrix from a text file.
+@details With one thread, the file is streamed through a fixed-size chunk
+buffer so memory use is bounded by the size of the matrix itself. With more
+threads, the file is mapped, divided into line ranges at newline boundaries,
+and each range is parsed directly into its rows of the result in parallel.
+@param path The path of the file to read.
+@param numThreads The number of threads to parse with. 0 or 1 parses on the
+calling thread.
+@param result Pointer to a Matrix pointer which will be set to a newly
+allocated Matrix holding the file's contents.
+@return An error code. 0 if no problems were encountered.
+*/
+int MIO_read (const char *path, unsigned int numThreads, Matrix **result)
+{
+	if ( numThreads > MIO_MAX_THREADS )
+	{
+		numThreads = MIO_MAX_THREADS;
+	}
+	if ( numThreads <= 1 )
+	{
+		return MIO_readStreaming(path, result);
+	}
+	return MIO_readParallel(path, numThreads, result);
+}
+
+/**
+@fn MIO_write
+@brief Writes a matrix to a text file in the format read by MIO_read. Entries
+are formatted through an OutputBuffer of MIO_CHUNK_SIZE bytes.
+@param path The path of the file to write.
+@param m Pointer to the Matrix to be written.
+@return An error code. 0 if no problems were encountered.
+*/
+int MIO_write (const char *path, Matrix *m)
+{
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if ( fd < 0 )
+	{
+		return ERR_IO_FILE;
+	}
+	OutputBuffer out;
+	int error = OB_init(&out, fd, MIO_CHUNK_SIZE);
+	if ( !error )
+	{
+		OB_writeMatrix(&out, m);
+	}
+	if ( OB_close(&out) && !error )
+	{
+		error = ERR_IO_FILE;
+	}
+	if ( close(fd) && !error )
+	{
+		error = ERR_IO_FILE;
+	}
+	return error;
+}
\ No newline at end of file
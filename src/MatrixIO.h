@@ -0,0 +1,56 @@
+/**
+@file MatrixIO.h
+@author Rob Thomas
+@brief Contains functions for reading matrices of Rationals from text files
+and writing them back out. Each line of a file is one row of the matrix, and
+entries are integers or fractions of the form p/q separated by whitespace or
+commas. Files are parsed in chunks straight into the matrix's element buffer,
+optionally split across several threads by line ranges.
+*/
+
+#ifndef MATRIXIO_H
+#define MATRIXIO_H
+
+/*** INCLUDES: ***/
+#include "Matrix.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define MIO_CHUNK_SIZE (1 << 20)
+#define MIO_MAX_THREADS 64
+
+#define ERR_IO_FILE -50
+#define ERR_IO_PARSE -51
+#define ERR_IO_ROW_LENGTH -52
+#define ERR_IO_OVERFLOW -53
+#define ERR_IO_ZERO_DENOMINATOR -54
+
+/*** FUNCTION PROTOTYPES: ***/
+
+/**
+@fn MIO_read
+@brief Reads a matrix from a text file.
+@details With one thread, the file is streamed through a fixed-size chunk
+buffer so memory use is bounded by the size of the matrix itself. With more
+threads, the file is mapped, divided into line ranges at newline boundaries,
+and each range is parsed directly into its rows of the result in parallel.
+@param path The path of the file to read.
+@param numThreads The number of threads to parse with. 0 or 1 parses on the
+calling thread.
+@param result Pointer to a Matrix pointer which will be set to a newly
+allocated Matrix holding the file's contents.
+@return An error code. 0 if no problems were encountered.
+*/
+int MIO_read (const char *path, unsigned int numThreads, Matrix **result);
+
+/**
+@fn MIO_write
+@brief Writes a matrix to a text file in the format read by MIO_read. Entries
+are formatted through an OutputBuffer of MIO_CHUNK_SIZE bytes.
+@param path The path of the file to write.
+@param m Pointer to the Matrix to be written.
+@return An error code. 0 if no problems were encountered.
+*/
+int MIO_write (const char *path, Matrix *m);
+
+#endif /* MATRIXIO_H */
\ No newline at end of file
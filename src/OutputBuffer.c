@@ -0,0 +1,155 @@
+/**
+@file OutputBuffer.c
+@author Rob Thomas
+@brief Contains the OutputBuffer struct and functions for buffered output to a
+file descriptor. Text is gathered in one large buffer which is written out
+whenever it fills, and Rationals and matrices are formatted straight into it
+with R_format, so printing a value costs neither a printf nor a system call.
+*/
+
+/*** INCLUDES: ***/
+#include <string.h>
+#include <unistd.h>
+
+#include "OutputBuffer.h"
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn OB_init
+@brief Sets up an OutputBuffer which writes to a file descriptor.
+@param out Pointer to the OutputBuffer.
+@param fd The file descriptor to write to. It is not closed by OB_close.
+@param capacity The size of the buffer. Raised to R_FORMAT_MAX_LENGTH * 2 if
+smaller.
+@return An error code. 0 if no problems were encountered.
+*/
+int OB_init (OutputBuffer *out, int fd, size_t capacity)
+{
+	if ( capacity < R_FORMAT_MAX_LENGTH * 2 )
+	{
+		capacity = R_FORMAT_MAX_LENGTH * 2;
+	}
+	out->fd = fd;
+	out->buffer = (char *)malloc(capacity);
+	out->capacity = capacity;
+	out->used = 0;
+	out->error = out->buffer ? 0 : ERR_ALLOCATION_FAILED;
+	return out->error;
+}
+
+/**
+@fn OB_close
+@brief Flushes an OutputBuffer and frees its buffer.
+@param out Pointer to the OutputBuffer.
+@return The first error produced by any write. 0 if there was none.
+*/
+int OB_close (OutputBuffer *out)
+{
+	int error = out->buffer ? OB_flush(out) : out->error;
+	free(out->buffer);
+	out->buffer = NULL;
+	out->capacity = 0;
+	return error;
+}
+
+/**
+@fn OB_flush
+@brief Writes everything in an OutputBuffer out to its file descriptor.
+@param out Pointer to the OutputBuffer.
+@return The first error produced by any write. 0 if there was none.
+*/
+int OB_flush (OutputBuffer *out)
+{
+	const char *text = out->buffer;
+	size_t length = out->used;
+	while ( length > 0 && !out->error )
+	{
+		ssize_t numWritten = write(out->fd, text, length);
+		if ( numWritten < 0 )
+		{
+			out->error = ERR_OUTPUT_IO;
+			break;
+		}
+		text += numWritten;
+		length -= numWritten;
+	}
+	out->used = 0;
+	return out->error;
+}
+
+/**
+@fn OB_write
+@brief Adds text to an OutputBuffer.
+@param out Pointer to the OutputBuffer.
+@param text The text to add.
+@param length The number of characters of text.
+@return The first error produced by any write. 0 if there was none.
+*/
+int OB_write (OutputBuffer *out, const char *text, size_t length)
+{
+	while ( length > 0 && !out->error )
+	{
+		if ( out->used == out->capacity )
+		{
+			OB_flush(out);
+			continue;
+		}
+		size_t numCopied = out->capacity - out->used;
+		numCopied = length < numCopied ? length : numCopied;
+		memcpy(out->buffer + out->used, text, numCopied);
+		out->used += numCopied;
+		text += numCopied;
+		length -= numCopied;
+	}
+	return out->error;
+}
+
+/**
+@fn OB_writeRational
+@brief Adds the text form of a Rational (see R_format) to an OutputBuffer.
+@param out Pointer to the OutputBuffer.
+@param r The Rational to add.
+@return The first error produced by any write. 0 if there was none.
+*/
+int OB_writeRational (OutputBuffer *out, Rational r)
+{
+	if ( out->capacity - out->used < R_FORMAT_MAX_LENGTH )
+	{
+		OB_flush(out);
+	}
+	if ( !out->error )
+	{
+		out->used += R_format(r, out->buffer + out->used);
+	}
+	return out->error;
+}
+
+/**
+@fn OB_writeMatrix
+@brief Adds a Matrix to an OutputBuffer in the format read by MIO_read: one
+line per row, with entries separated by spaces.
+@param out Pointer to the OutputBuffer.
+@param m Pointer to the Matrix to add.
+@return The first error produced by any write. 0 if there was none.
+*/
+int OB_writeMatrix (OutputBuffer *out, Matrix *m)
+{
+	for (unsigned int i = 0; i < m->numRows && !out->error; i++)
+	{
+		for (unsigned int j = 0; j < m->numCols; j++)
+		{
+			/* Flush whenever the next entry and its separator might not fit. */
+			if ( out->capacity - out->used < R_FORMAT_MAX_LENGTH + 1 )
+			{
+				if ( OB_flush(out) )
+				{
+					break;
+				}
+			}
+			out->used += R_format(M_AT(m, i, j), out->buffer + out->used);
+			out->buffer[out->used++] = j + 1 < m->numCols ? ' ' : '\n';
+		}
+	}
+	return out->error;
+}
\ No newline at end of file
@@ -0,0 +1,103 @@
+/**
+@file OutputBuffer.h
+@author Rob Thomas
+@brief Contains the OutputBuffer struct and functions for buffered output to a
+file descriptor. Text is gathered in one large buffer which is written out
+whenever it fills, and Rationals and matrices are formatted straight into it
+with R_format, so printing a value costs neither a printf nor a system call.
+*/
+
+#ifndef OUTPUTBUFFER_H
+#define OUTPUTBUFFER_H
+
+/*** INCLUDES: ***/
+#include <stdlib.h>
+
+#include "Matrix.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define OB_DEFAULT_CAPACITY (1 << 16)
+
+#define ERR_OUTPUT_IO -150
+
+/*** STRUCTS: ***/
+
+/**
+@def OutputBuffer
+@brief A struct representing buffered output to a file descriptor.
+@var fd The file descriptor written to.
+@var buffer The text waiting to be written.
+@var capacity The size of buffer. Always more than R_FORMAT_MAX_LENGTH.
+@var used The number of characters in buffer.
+@var error The first error produced by a write. Once set, further output is
+discarded.
+*/
+typedef struct
+{
+	int fd;
+	char *buffer;
+	size_t capacity;
+	size_t used;
+	int error;
+} OutputBuffer;
+
+/*** FUNCTION PROTOTYPES: ***/
+
+/**
+@fn OB_init
+@brief Sets up an OutputBuffer which writes to a file descriptor.
+@param out Pointer to the OutputBuffer.
+@param fd The file descriptor to write to. It is not closed by OB_close.
+@param capacity The size of the buffer. Raised to R_FORMAT_MAX_LENGTH * 2 if
+smaller.
+@return An error code. 0 if no problems were encountered.
+*/
+int OB_init (OutputBuffer *out, int fd, size_t capacity);
+
+/**
+@fn OB_close
+@brief Flushes an OutputBuffer and frees its buffer.
+@param out Pointer to the OutputBuffer.
+@return The first error produced by any write. 0 if there was none.
+*/
+int OB_close (OutputBuffer *out);
+
+/**
+@fn OB_flush
+@brief Writes everything in an OutputBuffer out to its file descriptor.
+@param out Pointer to the OutputBuffer.
+@return The first error produced by any write. 0 if there was none.
+*/
+int OB_flush (OutputBuffer *out);
+
+/**
+@fn OB_write
+@brief Adds text to an OutputBuffer.
+@param out Pointer to the OutputBuffer.
+@param text The text to add.
+@param length The number of characters of text.
+@return The first error produced by any write. 0 if there was none.
+*/
+int OB_write (OutputBuffer *out, const char *text, size_t length);
+
+/**
+@fn OB_writeRational
+@brief Adds the text form of a Rational (see R_format) to an OutputBuffer.
+@param out Pointer to the OutputBuffer.
+@param r The Rational to add.
+@return The first error produced by any write. 0 if there was none.
+*/
+int OB_writeRational (OutputBuffer *out, Rational r);
+
+/**
+@fn OB_writeMatrix
+@brief Adds a Matrix to an OutputBuffer in the format read by MIO_read: one
+line per row, with entries separated by spaces.
+@param out Pointer to the OutputBuffer.
+@param m Pointer to the Matrix to add.
+@return The first error produced by any write. 0 if there was none.
+*/
+int OB_writeMatrix (OutputBuffer *out, Matrix *m);
+
+#endif /* OUTPUTBUFFER_H */
\ No newline at end of file
@@ -5,9 +5,12 @@
 */
 
 /*** INCLUDES: ***/
+#include <limits.h>
+
 #include "Random.h"
 
 /*** DEFINES: ***/
+#define RANDOM_BITS 31
 #define NEGATIVE_MAX -1
 #define MIN_GREATER_THAN_MAX -2
 
@@ -60,34 +63,26 @@ int32_t Random_in_range (int32_t min, int32_t max, int *errorCode)
 	{
 		return max;
 	}
-	/* The size of the set of integers between RAND_MIN and RAND_MAX. This set is 
-	   the set that random() will choose from. setSize is stored in a 64-bit
-	   integer since RAND_MAX - RAND_MIN + 1 is 1 larger than the maximum 
-	   magnitude of an unsigned 32-bit integer. */
-	uint64_t setSize = (uint64_t)((RAND_MAX - RAND_MIN) + 1);
-	/* Divide the set of all integers between RAND_MIN and RAND_MAX into 
-	   equally-sized bins. numBins is stored in a 64-bit integer because
-	   max - min + 1 could overflow a 32-bit unsigned integer. */
-	uint64_t numBins = (uint64_t)((max - min) + 1);
+	/* The size of the set that each choice is drawn from. random() only gives
+	   31 bits, which is fewer than a full 32-bit range needs, so two calls
+	   are combined into a 62-bit choice. */
+	uint64_t setSize = (uint64_t)1 << (2 * RANDOM_BITS);
+	/* Divide the set into equally-sized bins, one per possible result. 
+	   numBins is computed in 64 bits because max - min + 1 could overflow a
+	   32-bit integer. */
+	uint64_t numBins = (uint64_t)((int64_t)max - (int64_t)min) + 1;
 	/* Determine the size of each of these bins. */
 	uint64_t binSize = setSize / numBins;
 	/* Not all of the set will be covered by these bins. Only numBins * binSize
-	   will be covered, so if random() chooses an integer greater than 
-	   numBins * binSize - 1, that choice will be invalid. */
-	int32_t invalidSize = (int32_t)(setSize % numBins);
-	/* Use random() to choose from the set. If the choice is within one of the
-	   bins, then determine which bin and return the corresponding value.
-	   If the choice was invalid, then choose again. */
-	int32_t choice;
+	   will be covered, so any choice at or past that is invalid. */
+	uint64_t validSize = numBins * binSize;
+	/* Choose from the set until the choice lands within one of the bins. */
+	uint64_t choice;
 	do 
 	{
-		choice = random();
-	} while ( choice > RAND_MAX - invalidSize );
-	/* Once a valid choice has been made, find which bin it corresponds to and
-	   return that answer. (choice / binSize) sorts the choice into the 
-	   corresponding bin, but these bins will be indexed in the set 
-	   [-numBins/2, numBins/2]. Adding (numBins / 2) will shift the indexing of
-	   the bins to [0, numBins - 1]. Finally, adding min will shift the indexing
-	   of the bins to [min, max]. */
-	return (int32_t)((int64_t)(choice) / binSize) + (int32_t)(numBins / 2) + min;
+		choice = ((uint64_t)random() << RANDOM_BITS) | (uint64_t)random();
+	} while ( choice >= validSize );
+	/* Once a valid choice has been made, (choice / binSize) gives the index of
+	   its bin in [0, numBins - 1]. Adding min shifts this to [min, max]. */
+	return (int32_t)((int64_t)(choice / binSize) + min);
 }
\ No newline at end of file
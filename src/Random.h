@@ -4,8 +4,12 @@
 @brief Contains functions for simple random number generation.
 */
 
+#ifndef RANDOM_H
+#define RANDOM_H
+
 /*** INCLUDES: ***/
 #include <stdlib.h>
+#include <stdint.h>
 
 /*** DEFINES: ***/
 
@@ -34,4 +38,6 @@ int32_t Random_at_most (int32_t max, int *errorCode);
 @return A 32-bit integer randomly picked with even distribution from the range
 [min, max].
 */
-int32_t Random_in_range (int32_t min, int32_t max, int *errorCode);
\ No newline at end of file
+int32_t Random_in_range (int32_t min, int32_t max, int *errorCode);
+
+#endif /* RANDOM_H */
\ No newline at end of file
@@ -8,12 +8,50 @@ the integers q and p.
 */
 
 /*** INCLUDES: ***/
+#include <stdbool.h>
+
+#include "Instrument.h"
 #include "Rational.h"
 
 /*** DEFINES: ***/
 
 /*** FUNCTION DEFINITIONS: ***/
 
+/**
+@fn R_GCD32
+@brief Determines the greatest common denominator between two non-negative
+integers using the binary GCD algorithm, which needs no division. Used where
+both inputs are known to fit in 32 bits and be valid, so R_GCD's checks can be
+skipped.
+@param a One of the two integers whose GCD will be found.
+@param b One of the two integers whose GCD will be found.
+@return The GCD of a and b, or the other input if either is 0.
+*/
+static inline uint32_t R_GCD32 (uint32_t a, uint32_t b)
+{
+	INST_COUNT(gcdCalls, 1);
+	if ( a == 0 || b == 0 )
+	{
+		return a | b;
+	}
+	/* Remove the shared factors of two, then repeatedly replace the larger
+	   value with the odd part of the difference. The loop body has no
+	   branches apart from its exit, so it does not suffer mispredictions. */
+	int shift = __builtin_ctz(a | b);
+	b >>= __builtin_ctz(b);
+	int zeros = __builtin_ctz(a);
+	while ( a != 0 )
+	{
+		INST_COUNT(gcdIterations, 1);
+		a >>= zeros;
+		int64_t difference = (int64_t)b - a;
+		zeros = __builtin_ctzll(difference | ((uint64_t)1 << 32));
+		b = a < b ? a : b;
+		a = difference < 0 ? -difference : difference;
+	}
+	return b << shift;
+}
+
 /**
 @fn R_new
 @brief Allocates a new Rational equal to 1/1.
@@ -50,8 +88,9 @@ Rational *R_copy (Rational r)
 non-negative.
 @return The GCD of top and bottom. -1 if either top and/or bottom was negative.
 */
-int64_t R_GCD (int64_t top, int64_t bottom)
+R_KERNEL int64_t R_GCD (int64_t top, int64_t bottom)
 {
+	INST_COUNT(gcdCalls, 1);
 	/* Ensure that top and bottom are non-negative. */
 	if ( top < 0 || bottom < 0 )
 	{
@@ -88,6 +127,7 @@ int64_t R_GCD (int64_t top, int64_t bottom)
 	/* Use Euclidean algorithm to find the GCD. */
 	while ( larger > 0 && smaller > 0 )
 	{
+		INST_COUNT(gcdIterations, 1);
 		larger %= smaller;
 		swap = larger;
 		larger = smaller;
@@ -106,17 +146,20 @@ positive.
 */
 void R_reduce (Rational *r)
 {
+	INST_COUNT(reduceCalls, 1);
 	/* If the bottom is negative, make the top negative instead. */
 	if ( r->bottom < 0 )
 	{
 		r->bottom *= -1;
 		r->top *= -1;
 	}
-	/* Find the GCD between the top and bottom. */
-	int32_t gcd = R_GCD(r->top, r->bottom);
+	/* Find the GCD between the top and bottom. R_GCD() only accepts 
+	   non-negative inputs, so use the magnitude of the top. */
+	int32_t gcd = R_GCD(r->top < 0 ? -(int64_t)r->top : r->top, r->bottom);
 	/* Divide the top and bottom by the GCD, thus reducing the fraction. */
 	if ( gcd > 1 )
 	{
+		INST_COUNT(reductions, 1);
 		r->top /= gcd;
 		r->bottom /= gcd;
 	}
@@ -134,22 +177,30 @@ stored.
 @param top 64-bit integer representing the top of the Rational being reduced.
 @param bottom 64-bit integer representing the bottom of the Rational being reduced.
 */
-void R_reduce64 (Rational *dest, int64_t top, int64_t bottom)
+R_KERNEL void R_reduce64 (Rational *dest, int64_t top, int64_t bottom)
 {
+	INST_COUNT(reduce64Calls, 1);
 	/* If the bottom is negative, make the top negative instead. */
 	if ( bottom < 0 )
 	{
 		bottom *= -1;
 		top *= -1;
 	}
-	/* Find the GCD between the top and bottom. */
-	int64_t gcd = R_GCD(top, bottom);
+	/* Find the GCD between the top and bottom. R_GCD() only accepts 
+	   non-negative inputs, so use the magnitude of the top. */
+	int64_t gcd = R_GCD(top < 0 ? -top : top, bottom);
 	/* Divide the top and bottom by the GCD, thus reducing the fraction. */
 	if ( gcd > 1 )
 	{
+		INST_COUNT(reductions, 1);
 		top /= gcd;
 		bottom /= gcd;
 	}
+	/* Count results that will be truncated when stored in 32 bits. */
+	if ( top > INT32_MAX || top < INT32_MIN || bottom > INT32_MAX )
+	{
+		INST_COUNT(overflows, 1);
+	}
 	/* Set dest's top and bottom to the top and bottom just formulated. */
 	dest->top = top;
 	dest->bottom = bottom;
@@ -193,7 +244,7 @@ void R_add (Rational *r, int32_t i)
 @param r Pointer to the Rational which will be altered by the addition.
 @param a The Rational to add to r.
 */
-void R_addR (Rational *r, Rational a)
+R_KERNEL void R_addR (Rational *r, Rational a)
 {
 	/* Cross-multiply the two rationals to prepare them for addition. */
 	/* While cross-multiplying, cast the products as 64-bit ints to avoid
@@ -257,7 +308,7 @@ being multiplied have extreme magnitudes.
 @param r Pointer to the Rational which will be altered by the multiplication.
 @param m The Rational to multiply r by.
 */
-void R_multR (Rational *r, Rational m)
+R_KERNEL void R_multR (Rational *r, Rational m)
 {
 	/* Multiply the tops together and the bottoms together. */
 	int64_t tempTop, tempBottom;
@@ -292,11 +343,308 @@ being divided have extreme magnitudes.
 This Rational will be the numerator.
 @param a The Rational to divide r by.
 */
-void R_divR (Rational *r, Rational d)
+R_KERNEL void R_divR (Rational *r, Rational d)
 {
 	/* Divide r by d by multiplying by the inverse of d. */
-	Rational *inverted = R_invert(R_copy(d));
-	R_multR(r, inverted);
-	/* Free the inverted copy of d. */
-	free(inverted);
+	R_invert(&d);
+	R_multR(r, d);
+}
+
+/**
+@fn R_prepareDivisor
+@brief Prepares a Rational for dividing many Rationals by it, as when a row is
+divided by its pivot during elimination.
+@details A divisor of 0 is prepared as well, and dividing by it produces a
+bottom of 0 just as R_divR does.
+@param prepared Pointer to the RationalDivisor to fill in.
+@param d The divisor. Must be reduced.
+*/
+void R_prepareDivisor (RationalDivisor *prepared, Rational d)
+{
+	/* Store the reciprocal, keeping its bottom non-negative. */
+	if ( d.top < 0 )
+	{
+		prepared->top = -(int64_t)d.bottom;
+		prepared->bottom = -(int64_t)d.top;
+	}
+	else
+	{
+		prepared->top = d.bottom;
+		prepared->bottom = d.top;
+	}
+}
+
+/**
+@fn R_divPrepared
+@brief Divides a Rational by a prepared divisor. Gives the same result as
+R_divR, but cancels common factors between the two Rationals before
+multiplying, so the result is reduced without a GCD of the full product.
+@details If the quotient does not fit in 32 bits it is truncated, as in
+R_divR, but this is reported rather than passing silently.
+@param r Pointer to the Rational which will be divided. Must be reduced.
+@param d Pointer to the prepared divisor.
+@return true if the quotient fit in a Rational, false if it was truncated.
+*/
+R_KERNEL bool R_divPrepared (Rational *r, const RationalDivisor *d)
+{
+	/* r and the reciprocal are both reduced, so once the top of each has been
+	   cancelled against the bottom of the other the product is reduced too.
+	   Both GCDs are of 32-bit values, where R_reduce64 would take the GCD of
+	   the 64-bit products. */
+	int64_t top = r->top;
+	int64_t bottom = r->bottom;
+	uint32_t gcd = R_GCD32(top < 0 ? -top : top, d->bottom);
+	if ( gcd > 1 )
+	{
+		top /= gcd;
+	}
+	int64_t dBottom = gcd > 1 ? d->bottom / gcd : d->bottom;
+	int64_t dTop = d->top;
+	gcd = R_GCD32(dTop < 0 ? -dTop : dTop, bottom);
+	if ( gcd > 1 )
+	{
+		dTop /= gcd;
+		bottom /= gcd;
+	}
+	top *= dTop;
+	bottom *= dBottom;
+	/* A zero top still needs a bottom of 1, unless the divisor was zero. */
+	if ( top == 0 && bottom != 0 )
+	{
+		bottom = 1;
+	}
+	/* Count results that will be truncated when stored in 32 bits. */
+	bool fits = top <= INT32_MAX && top >= INT32_MIN && bottom <= INT32_MAX;
+	if ( !fits )
+	{
+		INST_COUNT(overflows, 1);
+	}
+	r->top = top;
+	r->bottom = bottom;
+	return fits;
+}
+
+/**
+@fn R_divRowPrepared
+@brief Divides every Rational in an array by the same prepared divisor.
+@param row Pointer to the first Rational to be divided. Each must be reduced.
+@param count The number of Rationals in the array.
+@param d Pointer to the prepared divisor.
+@return true if every quotient fit in a Rational, false if any was truncated.
+*/
+R_KERNEL bool R_divRowPrepared (Rational *row, size_t count,
+	const RationalDivisor *d)
+{
+	/* Dividing by 1 leaves the row as it is. */
+	if ( d->top == 1 && d->bottom == 1 )
+	{
+		return true;
+	}
+	/* Dividing by an integer's reciprocal only needs the bottoms cancelled
+	   against it. The bottoms only shrink, so only the tops can overflow, and
+	   they are checked without branching. */
+	if ( d->bottom == 1 )
+	{
+		int64_t dTop = d->top < 0 ? -d->top : d->top;
+		uint64_t numOverflows = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			int64_t bottom = row[i].bottom;
+			uint32_t gcd = R_GCD32(dTop, bottom);
+			int64_t top = (int64_t)row[i].top * (d->top / gcd);
+			row[i].top = top;
+			row[i].bottom = bottom / gcd;
+			numOverflows += row[i].top != top;
+		}
+		INST_COUNT(overflows, numOverflows);
+		return numOverflows == 0;
+	}
+	bool fits = true;
+	for (size_t i = 0; i < count; i++)
+	{
+		fits &= R_divPrepared(&row[i], d);
+	}
+	return fits;
+}
+
+/**
+@fn R_compare
+@brief Compares two Rationals by cross-multiplying in 64 bits, which cannot
+overflow and needs no GCD.
+@param a The first Rational. Its bottom must be positive, as it is after
+R_reduce.
+@param b The second Rational. Its bottom must be positive.
+@return -1 if a < b, 0 if a == b, and 1 if a > b.
+*/
+int R_compare (Rational a, Rational b)
+{
+	/* Both bottoms are positive, so a < b exactly when a.top * b.bottom <
+	   b.top * a.bottom. Each product of two 32-bit values fits in 64 bits. */
+	int64_t left = (int64_t)a.top * b.bottom;
+	int64_t right = (int64_t)b.top * a.bottom;
+	return (left > right) - (left < right);
+}
+
+/**
+@fn R_sign
+@brief Finds the sign of a Rational.
+@param r The Rational. Its bottom must be positive.
+@return -1 if r is negative, 0 if r is 0, and 1 if r is positive.
+*/
+int R_sign (Rational r)
+{
+	return (r.top > 0) - (r.top < 0);
+}
+
+/**
+@fn R_abs
+@brief Finds the absolute value of a Rational.
+@details Note that this function is vulnerable to overflow if the top of the
+Rational is INT32_MIN.
+@param r The Rational. Its bottom must be positive.
+@return The absolute value of r.
+*/
+Rational R_abs (Rational r)
+{
+	if ( r.top < 0 )
+	{
+		r.top = -(int64_t)r.top;
+	}
+	return r;
+}
+
+/**
+@fn R_argmaxAbs
+@brief Finds the Rational of largest magnitude among evenly spaced Rationals,
+such as a column of a row-major matrix during partial pivoting.
+@details Magnitudes are compared as in R_compare. The loop keeps R_ARGMAX_LANES
+independent running maxima with branch-free updates, so comparisons do not wait
+on one another, and merges them at the end.
+@param values Pointer to the first Rational. Each bottom must be positive.
+@param count The number of Rationals to search.
+@param stride The distance, in Rationals, between consecutive Rationals.
+@return The position (0 to count - 1) of the first Rational of largest
+magnitude, or 0 if count is 0.
+*/
+R_KERNEL size_t R_argmaxAbs (const Rational *values, size_t count, size_t stride)
+{
+	if ( count == 0 )
+	{
+		return 0;
+	}
+	/* Lane l holds the largest magnitude seen so far among the positions
+	   congruent to l modulo R_ARGMAX_LANES. Magnitudes are kept in 64 bits so
+	   that INT32_MIN can be negated. */
+	int64_t bestTop[R_ARGMAX_LANES];
+	int64_t bestBottom[R_ARGMAX_LANES];
+	size_t bestIndex[R_ARGMAX_LANES];
+	size_t numLanes = count < R_ARGMAX_LANES ? count : R_ARGMAX_LANES;
+	for (size_t l = 0; l < numLanes; l++)
+	{
+		int64_t top = values[l * stride].top;
+		bestTop[l] = top < 0 ? -top : top;
+		bestBottom[l] = values[l * stride].bottom;
+		bestIndex[l] = l;
+	}
+	/* Only a strictly larger magnitude replaces a lane's maximum, so each lane
+	   keeps its first occurrence. */
+	size_t i = numLanes;
+	for (; i + R_ARGMAX_LANES <= count; i += R_ARGMAX_LANES)
+	{
+		#pragma GCC unroll 4
+		for (size_t l = 0; l < R_ARGMAX_LANES; l++)
+		{
+			const Rational *v = &values[(i + l) * stride];
+			int64_t top = v->top < 0 ? -(int64_t)v->top : v->top;
+			int64_t bottom = v->bottom;
+			bool isLarger = top * bestBottom[l] > bestTop[l] * bottom;
+			bestTop[l] = isLarger ? top : bestTop[l];
+			bestBottom[l] = isLarger ? bottom : bestBottom[l];
+			bestIndex[l] = isLarger ? i + l : bestIndex[l];
+		}
+	}
+	/* Fewer than R_ARGMAX_LANES positions remain, and since i is a multiple of
+	   R_ARGMAX_LANES, position i + l belongs to lane l. Bounding the loop by
+	   the lane count as well lets the compiler see that (i + l) * stride
+	   cannot wrap once this is inlined with a constant count. */
+	for (size_t l = 0; l < R_ARGMAX_LANES && i + l < count; l++)
+	{
+		const Rational *v = &values[(i + l) * stride];
+		int64_t top = v->top < 0 ? -(int64_t)v->top : v->top;
+		int64_t bottom = v->bottom;
+		if ( top * bestBottom[l] > bestTop[l] * bottom )
+		{
+			bestTop[l] = top;
+			bestBottom[l] = bottom;
+			bestIndex[l] = i + l;
+		}
+	}
+	/* Merge the lanes, breaking ties by position. */
+	size_t best = 0;
+	for (size_t l = 1; l < numLanes; l++)
+	{
+		int64_t left = bestTop[l] * bestBottom[best];
+		int64_t right = bestTop[best] * bestBottom[l];
+		if ( left > right || (left == right && bestIndex[l] < bestIndex[best]) )
+		{
+			best = l;
+		}
+	}
+	return bestIndex[best];
+}
+
+/**
+@fn R_format
+@brief Writes the text form of a Rational into a buffer without using printf.
+The text form is "top/bottom", or just "top" if bottom is 1.
+@param r The Rational to be formatted.
+@param buffer The buffer to write into. Must have room for R_FORMAT_MAX_LENGTH
+characters. No null terminator is written.
+@return The number of characters written.
+*/
+int R_format (Rational r, char *buffer)
+{
+	int length = 0;
+	/* Work with the magnitude of each half in 64 bits so that INT32_MIN can
+	   be negated safely. */
+	int64_t top = r.top;
+	if ( top < 0 )
+	{
+		buffer[length++] = '-';
+		top = -top;
+	}
+	/* Write the digits of the top in reverse, then flip them into place. */
+	char digits[10];
+	int numDigits = 0;
+	do
+	{
+		digits[numDigits++] = '0' + (char)(top % 10);
+		top /= 10;
+	} while ( top > 0 );
+	while ( numDigits > 0 )
+	{
+		buffer[length++] = digits[--numDigits];
+	}
+	if ( r.bottom == 1 )
+	{
+		return length;
+	}
+	/* Do the same for the bottom. */
+	buffer[length++] = '/';
+	int64_t bottom = r.bottom;
+	if ( bottom < 0 )
+	{
+		buffer[length++] = '-';
+		bottom = -bottom;
+	}
+	do
+	{
+		digits[numDigits++] = '0' + (char)(bottom % 10);
+		bottom /= 10;
+	} while ( bottom > 0 );
+	while ( numDigits > 0 )
+	{
+		buffer[length++] = digits[--numDigits];
+	}
+	return length;
 }
\ No newline at end of file
@@ -7,9 +7,30 @@ Rationals are represented by two signed integers, each 32 bytes, representing
 the integers q and p.
 */
 
+#ifndef RATIONAL_H
+#define RATIONAL_H
+
 /*** INCLUDES: ***/
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdint.h>
 
 /*** DEFINES: ***/
+#define R_FORMAT_MAX_LENGTH 23
+#define R_ARGMAX_LANES 4
+
+/**
+@def R_KERNEL
+@brief Marks a hot arithmetic function for function multiversioning. When built
+with MS_MULTIVERSION on x86-64, the function is compiled once each for baseline
+x86-64, x86-64-v2 and x86-64-v3, and the best version for the running CPU is
+chosen when the program is loaded. Otherwise it has no effect.
+*/
+#if defined(MS_MULTIVERSION) && defined(__x86_64__) && defined(__GNUC__)
+#define R_KERNEL __attribute__((target_clones("default", "arch=x86-64-v2", "arch=x86-64-v3")))
+#else
+#define R_KERNEL
+#endif
 
 /*** STRUCTS: ***/
 
@@ -25,6 +46,21 @@ typedef struct
 	int32_t bottom;
 } Rational;
 
+/**
+@def RationalDivisor
+@brief A struct representing a Rational prepared by R_prepareDivisor for
+repeated division. It holds the reciprocal of the divisor with the sign moved to
+the top, so that dividing by it is a multiplication whose common factors can be
+cancelled before multiplying.
+@var top The top of the reciprocal (the bottom of the divisor, signed).
+@var bottom The bottom of the reciprocal (the magnitude of the divisor's top).
+*/
+typedef struct
+{
+	int64_t top;
+	int64_t bottom;
+} RationalDivisor;
+
 /**
 @fn R_new
 @brief Allocates a new Rational equal to 1/1.
@@ -153,4 +189,95 @@ being divided have extreme magnitudes.
 This Rational will be the numerator.
 @param a The Rational to divide r by.
 */
-void R_divR (Rational *r, Rational d);
\ No newline at end of file
+void R_divR (Rational *r, Rational d);
+
+/**
+@fn R_prepareDivisor
+@brief Prepares a Rational for dividing many Rationals by it, as when a row is
+divided by its pivot during elimination.
+@details A divisor of 0 is prepared as well, and dividing by it produces a
+bottom of 0 just as R_divR does.
+@param prepared Pointer to the RationalDivisor to fill in.
+@param d The divisor. Must be reduced.
+*/
+void R_prepareDivisor (RationalDivisor *prepared, Rational d);
+
+/**
+@fn R_divPrepared
+@brief Divides a Rational by a prepared divisor. Gives the same result as
+R_divR, but cancels common factors between the two Rationals before
+multiplying, so the result is reduced without a GCD of the full product.
+@details If the quotient does not fit in 32 bits it is truncated, as in
+R_divR, but this is reported rather than passing silently.
+@param r Pointer to the Rational which will be divided. Must be reduced.
+@param d Pointer to the prepared divisor.
+@return true if the quotient fit in a Rational, false if it was truncated.
+*/
+bool R_divPrepared (Rational *r, const RationalDivisor *d);
+
+/**
+@fn R_divRowPrepared
+@brief Divides every Rational in an array by the same prepared divisor.
+@param row Pointer to the first Rational to be divided. Each must be reduced.
+@param count The number of Rationals in the array.
+@param d Pointer to the prepared divisor.
+@return true if every quotient fit in a Rational, false if any was truncated.
+*/
+bool R_divRowPrepared (Rational *row, size_t count, const RationalDivisor *d);
+
+/**
+@fn R_compare
+@brief Compares two Rationals by cross-multiplying in 64 bits, which cannot
+overflow and needs no GCD.
+@param a The first Rational. Its bottom must be positive, as it is after
+R_reduce.
+@param b The second Rational. Its bottom must be positive.
+@return -1 if a < b, 0 if a == b, and 1 if a > b.
+*/
+int R_compare (Rational a, Rational b);
+
+/**
+@fn R_sign
+@brief Finds the sign of a Rational.
+@param r The Rational. Its bottom must be positive.
+@return -1 if r is negative, 0 if r is 0, and 1 if r is positive.
+*/
+int R_sign (Rational r);
+
+/**
+@fn R_abs
+@brief Finds the absolute value of a Rational.
+@details Note that this function is vulnerable to overflow if the top of the
+Rational is INT32_MIN.
+@param r The Rational. Its bottom must be positive.
+@return The absolute value of r.
+*/
+Rational R_abs (Rational r);
+
+/**
+@fn R_argmaxAbs
+@brief Finds the Rational of largest magnitude among evenly spaced Rationals,
+such as a column of a row-major matrix during partial pivoting.
+@details Magnitudes are compared as in R_compare. The loop keeps R_ARGMAX_LANES
+independent running maxima with branch-free updates, so comparisons do not wait
+on one another, and merges them at the end.
+@param values Pointer to the first Rational. Each bottom must be positive.
+@param count The number of Rationals to search.
+@param stride The distance, in Rationals, between consecutive Rationals.
+@return The position (0 to count - 1) of the first Rational of largest
+magnitude, or 0 if count is 0.
+*/
+size_t R_argmaxAbs (const Rational *values, size_t count, size_t stride);
+
+/**
+@fn R_format
+@brief Writes the text form of a Rational into a buffer without using printf.
+The text form is "top/bottom", or just "top" if bottom is 1.
+@param r The Rational to be formatted.
+@param buffer The buffer to write into. Must have room for R_FORMAT_MAX_LENGTH
+characters. No null terminator is written.
+@return The number of characters written.
+*/
+int R_format (Rational r, char *buffer);
+
+#endif /* RATIONAL_H */
\ No newline at end of file
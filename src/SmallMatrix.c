@@ -0,0 +1,623 @@
+/**
+@file SmallMatrix.c
+@author Rob Thomas
+@brief Contains fixed-size kernels for multiplying, and taking the determinant
+and inverse of, square matrices from 2x2 to 4x4, and for solving systems with
+them. The kernels are generated once per size by SM_DEFINE_KERNELS, so every
+loop has a constant trip count and is fully unrolled, and all working storage
+is on the stack. Each operand is scaled to integers over a common denominator,
+the result is computed exactly in 128-bit integers, and each entry of the
+result is reduced with a single GCD at the end.
+*/
+
+/*** INCLUDES: ***/
+#include <string.h>
+
+#include "SmallMatrix.h"
+#include "Instrument.h"
+
+/*** DEFINES: ***/
+#define SM_UNROLL _Pragma("GCC unroll 16")
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn SM_GCD
+@brief Finds the greatest common divisor of two non-negative 128-bit integers
+with the binary GCD algorithm, using 64-bit arithmetic whenever both fit.
+@param a The first integer.
+@param b The second integer. Must be non-zero.
+@return The greatest common divisor of a and b.
+*/
+static unsigned __int128 SM_GCD (unsigned __int128 a, unsigned __int128 b)
+{
+	INST_COUNT(gcdCalls, 1);
+	if ( a == 0 )
+	{
+		return b;
+	}
+	if ( !((a | b) >> 64) )
+	{
+		uint64_t x = a, y = b;
+		int shift = __builtin_ctzll(x | y);
+		x >>= __builtin_ctzll(x);
+		do
+		{
+			y >>= __builtin_ctzll(y);
+			uint64_t smaller = x < y ? x : y;
+			y = x < y ? y - x : x - y;
+			x = smaller;
+		} while ( y );
+		return (unsigned __int128)x << shift;
+	}
+	/* Count trailing zeros of a 128-bit value one half at a time. */
+	#define SM_CTZ128(v) ((uint64_t)(v) ? __builtin_ctzll((uint64_t)(v)) : \
+		64 + __builtin_ctzll((uint64_t)((v) >> 64)))
+	int shift = SM_CTZ128(a | b);
+	a >>= SM_CTZ128(a);
+	do
+	{
+		b >>= SM_CTZ128(b);
+		if ( a > b )
+		{
+			unsigned __int128 swap = a;
+			a = b;
+			b = swap;
+		}
+		b -= a;
+	} while ( b );
+	#undef SM_CTZ128
+	return a << shift;
+}
+
+/**
+@fn SM_reduce
+@brief Reduces a 128-bit fraction with one GCD and stores it in a Rational.
+@param dest Pointer to the Rational the fraction is stored in.
+@param top The top of the fraction.
+@param bottom The bottom of the fraction.
+@return true if the reduced fraction fits in a Rational, false otherwise, in
+which case dest is unchanged.
+*/
+static bool SM_reduce (Rational *dest, __int128 top, __int128 bottom)
+{
+	if ( bottom == 0 )
+	{
+		return false;
+	}
+	if ( bottom < 0 )
+	{
+		top = -top;
+		bottom = -bottom;
+	}
+	/* Integer and zero results need no GCD at all. */
+	if ( bottom == 1 || top == 0 )
+	{
+		if ( top > INT32_MAX || top < INT32_MIN )
+		{
+			return false;
+		}
+		dest->top = top;
+		dest->bottom = 1;
+		return true;
+	}
+	unsigned __int128 magnitude = top < 0 ? -(unsigned __int128)top :
+		(unsigned __int128)top;
+	unsigned __int128 gcd = SM_GCD(magnitude, bottom);
+	if ( gcd > 1 && !((magnitude | (unsigned __int128)bottom) >> 63) )
+	{
+		/* 64-bit division is much cheaper than 128-bit division. */
+		top = (int64_t)top / (int64_t)gcd;
+		bottom = (int64_t)bottom / (int64_t)gcd;
+	}
+	else if ( gcd > 1 )
+	{
+		top /= (__int128)gcd;
+		bottom /= (__int128)gcd;
+	}
+	if ( top > INT32_MAX || top < INT32_MIN || bottom > INT32_MAX )
+	{
+		return false;
+	}
+	dest->top = top;
+	dest->bottom = bottom;
+	return true;
+}
+
+/**
+@fn SM_scale
+@brief Writes a Matrix as integers over a common denominator: the entries of
+m are scaled[i] / denominator.
+@param m Pointer to the Matrix.
+@param scaled The array the scaled entries are written to, row by row.
+@param denominator Pointer to where the common denominator will be written.
+@return true if the denominator and every scaled entry are within
+SM_MAX_SCALED, false otherwise.
+*/
+static bool SM_scale (Matrix *m, int64_t *scaled, int64_t *denominator)
+{
+	size_t numElements = (size_t)m->numRows * m->numCols;
+	int64_t d = 1;
+	if ( !m->isInteger )
+	{
+		for (size_t i = 0; i < numElements; i++)
+		{
+			int64_t bottom = m->elements[i].bottom;
+			if ( bottom <= 0 )
+			{
+				return false;
+			}
+			/* Most entries are integers or share a denominator already, so the
+			   division and the GCD are rarely needed. */
+			if ( bottom != 1 && bottom != d && d % bottom )
+			{
+				d = d / (int64_t)SM_GCD(d, bottom) * bottom;
+				if ( d > SM_MAX_SCALED )
+				{
+					return false;
+				}
+			}
+		}
+	}
+	for (size_t i = 0; i < numElements; i++)
+	{
+		int64_t top = m->elements[i].top;
+		int64_t bottom = m->elements[i].bottom;
+		if ( bottom == 1 )
+		{
+			top *= d;
+		}
+		else if ( bottom != d )
+		{
+			top *= d / bottom;
+		}
+		if ( top > SM_MAX_SCALED || top < -SM_MAX_SCALED )
+		{
+			return false;
+		}
+		scaled[i] = top;
+	}
+	*denominator = d;
+	return true;
+}
+
+/**
+@fn SM_determinant2
+@brief Computes the determinant of a 2x2 integer matrix.
+@param m The matrix's entries, row by row.
+@return The determinant.
+*/
+static __int128 SM_determinant2 (const int64_t *m)
+{
+	return (__int128)m[0] * m[3] - (__int128)m[1] * m[2];
+}
+
+/**
+@fn SM_determinant3
+@brief Computes the determinant of a 3x3 integer matrix by expanding along
+the first row.
+@param m The matrix's entries, row by row.
+@return The determinant.
+*/
+static __int128 SM_determinant3 (const int64_t *m)
+{
+	return (__int128)m[0] * (m[4] * m[8] - m[5] * m[7]) -
+		(__int128)m[1] * (m[3] * m[8] - m[5] * m[6]) +
+		(__int128)m[2] * (m[3] * m[7] - m[4] * m[6]);
+}
+
+/**
+@fn SM_minors4
+@brief Computes the 2x2 minors of the top two rows (s) and the bottom two rows
+(c) of a 4x4 integer matrix, from which its determinant and adjugate are built.
+@param m The matrix's entries, row by row.
+@param s The array the six minors of rows 0 and 1 are written to.
+@param c The array the six minors of rows 2 and 3 are written to.
+*/
+static void SM_minors4 (const int64_t *m, int64_t *s, int64_t *c)
+{
+	s[0] = m[0] * m[5] - m[4] * m[1];
+	s[1] = m[0] * m[6] - m[4] * m[2];
+	s[2] = m[0] * m[7] - m[4] * m[3];
+	s[3] = m[1] * m[6] - m[5] * m[2];
+	s[4] = m[1] * m[7] - m[5] * m[3];
+	s[5] = m[2] * m[7] - m[6] * m[3];
+	c[0] = m[8] * m[13] - m[12] * m[9];
+	c[1] = m[8] * m[14] - m[12] * m[10];
+	c[2] = m[8] * m[15] - m[12] * m[11];
+	c[3] = m[9] * m[14] - m[13] * m[10];
+	c[4] = m[9] * m[15] - m[13] * m[11];
+	c[5] = m[10] * m[15] - m[14] * m[11];
+}
+
+/**
+@fn SM_determinant4
+@brief Computes the determinant of a 4x4 integer matrix from the 2x2 minors of
+its top and bottom halves (Laplace expansion along the first two rows).
+@param m The matrix's entries, row by row.
+@return The determinant.
+*/
+static __int128 SM_determinant4 (const int64_t *m)
+{
+	int64_t s[6], c[6];
+	SM_minors4(m, s, c);
+	return (__int128)s[0] * c[5] - (__int128)s[1] * c[4] +
+		(__int128)s[2] * c[3] + (__int128)s[3] * c[2] -
+		(__int128)s[4] * c[1] + (__int128)s[5] * c[0];
+}
+
+/**
+@fn SM_adjugate2
+@brief Computes the adjugate and determinant of a 2x2 integer matrix.
+@param m The matrix's entries, row by row.
+@param adj The array the adjugate's entries are written to, row by row.
+@return The determinant.
+*/
+static __int128 SM_adjugate2 (const int64_t *m, __int128 *adj)
+{
+	adj[0] = m[3];
+	adj[1] = -m[1];
+	adj[2] = -m[2];
+	adj[3] = m[0];
+	return SM_determinant2(m);
+}
+
+/**
+@fn SM_adjugate3
+@brief Computes the adjugate and determinant of a 3x3 integer matrix.
+@param m The matrix's entries, row by row.
+@param adj The array the adjugate's entries are written to, row by row.
+@return The determinant.
+*/
+static __int128 SM_adjugate3 (const int64_t *m, __int128 *adj)
+{
+	adj[0] = m[4] * m[8] - m[5] * m[7];
+	adj[1] = m[2] * m[7] - m[1] * m[8];
+	adj[2] = m[1] * m[5] - m[2] * m[4];
+	adj[3] = m[5] * m[6] - m[3] * m[8];
+	adj[4] = m[0] * m[8] - m[2] * m[6];
+	adj[5] = m[2] * m[3] - m[0] * m[5];
+	adj[6] = m[3] * m[7] - m[4] * m[6];
+	adj[7] = m[1] * m[6] - m[0] * m[7];
+	adj[8] = m[0] * m[4] - m[1] * m[3];
+	return m[0] * adj[0] + m[1] * adj[3] + m[2] * adj[6];
+}
+
+/**
+@fn SM_adjugate4
+@brief Computes the adjugate and determinant of a 4x4 integer matrix from the
+2x2 minors of its top and bottom halves.
+@param m The matrix's entries, row by row.
+@param adj The array the adjugate's entries are written to, row by row.
+@return The determinant.
+*/
+static __int128 SM_adjugate4 (const int64_t *m, __int128 *adj)
+{
+	int64_t s[6], c[6];
+	SM_minors4(m, s, c);
+	__int128 S[6], C[6];
+	for (int i = 0; i < 6; i++)
+	{
+		S[i] = s[i];
+		C[i] = c[i];
+	}
+	adj[0] = m[5] * C[5] - m[6] * C[4] + m[7] * C[3];
+	adj[1] = -m[1] * C[5] + m[2] * C[4] - m[3] * C[3];
+	adj[2] = m[13] * S[5] - m[14] * S[4] + m[15] * S[3];
+	adj[3] = -m[9] * S[5] + m[10] * S[4] - m[11] * S[3];
+	adj[4] = -m[4] * C[5] + m[6] * C[2] - m[7] * C[1];
+	adj[5] = m[0] * C[5] - m[2] * C[2] + m[3] * C[1];
+	adj[6] = -m[12] * S[5] + m[14] * S[2] - m[15] * S[1];
+	adj[7] = m[8] * S[5] - m[10] * S[2] + m[11] * S[1];
+	adj[8] = m[4] * C[4] - m[5] * C[2] + m[7] * C[0];
+	adj[9] = -m[0] * C[4] + m[1] * C[2] - m[3] * C[0];
+	adj[10] = m[12] * S[4] - m[13] * S[2] + m[15] * S[0];
+	adj[11] = -m[8] * S[4] + m[9] * S[2] - m[11] * S[0];
+	adj[12] = -m[4] * C[3] + m[5] * C[1] - m[6] * C[0];
+	adj[13] = m[0] * C[3] - m[1] * C[1] + m[2] * C[0];
+	adj[14] = -m[12] * S[3] + m[13] * S[1] - m[14] * S[0];
+	adj[15] = m[8] * S[3] - m[9] * S[1] + m[10] * S[0];
+	return S[0] * C[5] - S[1] * C[4] + S[2] * C[3] + S[3] * C[2] -
+		S[4] * C[1] + S[5] * C[0];
+}
+
+/**
+@def SM_DEFINE_KERNELS
+@brief Generates the multiply, determinant, inverse and solve kernels for NxN
+matrices. Each writes its result to a stack buffer and returns 0,
+ERR_SINGULAR, or FAIL_SMALL_UNSUPPORTED if the operands cannot be scaled or an
+intermediate or the result does not fit.
+*/
+#define SM_DEFINE_KERNELS(N) \
+static int SM_multiply##N (Rational *result, Rational coefficient, Matrix *a, \
+	Matrix *b) \
+{ \
+	int64_t sa[N * N], sb[N * N], da, db; \
+	if ( !SM_scale(a, sa, &da) || !SM_scale(b, sb, &db) ) \
+	{ \
+		return FAIL_SMALL_UNSUPPORTED; \
+	} \
+	__int128 bottom = (__int128)coefficient.bottom * da * db; \
+	SM_UNROLL for (int i = 0; i < N; i++) \
+	{ \
+		SM_UNROLL for (int j = 0; j < N; j++) \
+		{ \
+			int64_t sum = 0; \
+			SM_UNROLL for (int k = 0; k < N; k++) \
+			{ \
+				sum += sa[i * N + k] * sb[k * N + j]; \
+			} \
+			if ( !SM_reduce(&result[i * N + j], \
+				(__int128)coefficient.top * sum, bottom) ) \
+			{ \
+				return FAIL_SMALL_UNSUPPORTED; \
+			} \
+		} \
+	} \
+	return 0; \
+} \
+\
+static int SM_determinant##N##x##N (Rational *result, Matrix *a) \
+{ \
+	int64_t sa[N * N], d; \
+	if ( !SM_scale(a, sa, &d) ) \
+	{ \
+		return FAIL_SMALL_UNSUPPORTED; \
+	} \
+	__int128 bottom = d; \
+	SM_UNROLL for (int i = 1; i < N; i++) \
+	{ \
+		bottom *= d; \
+	} \
+	if ( !SM_reduce(result, SM_determinant##N(sa), bottom) ) \
+	{ \
+		return FAIL_SMALL_UNSUPPORTED; \
+	} \
+	return 0; \
+} \
+\
+static int SM_inverse##N (Rational *result, Matrix *a) \
+{ \
+	int64_t sa[N * N], d; \
+	__int128 adj[N * N]; \
+	if ( !SM_scale(a, sa, &d) ) \
+	{ \
+		return FAIL_SMALL_UNSUPPORTED; \
+	} \
+	/* inverse(sa / d) = d * adjugate(sa) / determinant(sa) */ \
+	__int128 determinant = SM_adjugate##N(sa, adj); \
+	if ( determinant == 0 ) \
+	{ \
+		return ERR_SINGULAR; \
+	} \
+	SM_UNROLL for (int i = 0; i < N * N; i++) \
+	{ \
+		if ( !SM_reduce(&result[i], adj[i] * d, determinant) ) \
+		{ \
+			return FAIL_SMALL_UNSUPPORTED; \
+		} \
+	} \
+	return 0; \
+} \
+\
+static int SM_solve##N (Rational *result, Matrix *a, Matrix *b) \
+{ \
+	int64_t sa[N * N], sb[N * SM_MAX_SIZE], da, db; \
+	__int128 adj[N * N]; \
+	if ( !SM_scale(a, sa, &da) || !SM_scale(b, sb, &db) ) \
+	{ \
+		return FAIL_SMALL_UNSUPPORTED; \
+	} \
+	/* x = inverse(sa / da) * (sb / db) = adjugate(sa) * sb * da / \
+	   (determinant(sa) * db) */ \
+	__int128 determinant = SM_adjugate##N(sa, adj); \
+	if ( determinant == 0 ) \
+	{ \
+		return ERR_SINGULAR; \
+	} \
+	__int128 bottom; \
+	if ( __builtin_mul_overflow(determinant, db, &bottom) ) \
+	{ \
+		return FAIL_SMALL_UNSUPPORTED; \
+	} \
+	unsigned int numCols = b->numCols; \
+	for (unsigned int j = 0; j < numCols; j++) \
+	{ \
+		SM_UNROLL for (int i = 0; i < N; i++) \
+		{ \
+			__int128 sum = 0; \
+			SM_UNROLL for (int k = 0; k < N; k++) \
+			{ \
+				sum += adj[i * N + k] * sb[k * numCols + j]; \
+			} \
+			__int128 top; \
+			if ( __builtin_mul_overflow(sum, da, &top) || \
+				!SM_reduce(&result[i * numCols + j], top, bottom) ) \
+			{ \
+				return FAIL_SMALL_UNSUPPORTED; \
+			} \
+		} \
+	} \
+	return 0; \
+}
+
+SM_DEFINE_KERNELS(2)
+SM_DEFINE_KERNELS(3)
+SM_DEFINE_KERNELS(4)
+
+/**
+@fn SM_isSmall
+@brief Checks whether a Matrix is square with a size the kernels handle.
+@param m Pointer to the Matrix.
+@return true if m is NxN with SM_MIN_SIZE <= N <= SM_MAX_SIZE, false otherwise.
+*/
+bool SM_isSmall (Matrix *m)
+{
+	return m->numRows == m->numCols && m->numRows >= SM_MIN_SIZE &&
+		m->numRows <= SM_MAX_SIZE;
+}
+
+/**
+@fn SM_store
+@brief Copies a result computed on the stack into a Matrix and rehashes it.
+@param m Pointer to the Matrix.
+@param result The result's entries, row by row.
+*/
+static void SM_store (Matrix *m, Rational *result)
+{
+	memcpy(m->elements, result, sizeof(Rational) * m->numRows * m->numCols);
+	M_rehash(m);
+}
+
+/**
+@fn SM_multiply
+@brief Computes dest = coefficient * a * b. dest may alias a or b.
+@param dest Pointer to the Matrix which will hold the product.
+@param coefficient The Rational the product is scaled by.
+@param a Pointer to the left operand.
+@param b Pointer to the right operand.
+@return An error code. 0 if no problems were encountered.
+FAIL_SMALL_UNSUPPORTED if the operands are not small square matrices of the
+same size, are too large to scale, or the product does not fit in Rationals,
+in which case dest is unchanged.
+*/
+int SM_multiply (Matrix *dest, Rational coefficient, Matrix *a, Matrix *b)
+{
+	unsigned int n = a->numRows;
+	if ( !SM_isSmall(a) || b->numRows != n || b->numCols != n ||
+		dest->numRows != n || dest->numCols != n )
+	{
+		return FAIL_SMALL_UNSUPPORTED;
+	}
+	Rational result[SM_MAX_SIZE * SM_MAX_SIZE];
+	int error;
+	switch ( n )
+	{
+		case 2:
+			error = SM_multiply2(result, coefficient, a, b);
+			break;
+		case 3:
+			error = SM_multiply3(result, coefficient, a, b);
+			break;
+		default:
+			error = SM_multiply4(result, coefficient, a, b);
+			break;
+	}
+	if ( !error )
+	{
+		SM_store(dest, result);
+	}
+	return error;
+}
+
+/**
+@fn SM_determinant
+@brief Computes the determinant of a small square Matrix.
+@param a Pointer to the Matrix.
+@param determinant Pointer to where the determinant will be written.
+@return An error code. 0 if no problems were encountered.
+FAIL_SMALL_UNSUPPORTED if the kernels cannot handle the Matrix.
+*/
+int SM_determinant (Matrix *a, Rational *determinant)
+{
+	if ( !SM_isSmall(a) )
+	{
+		return FAIL_SMALL_UNSUPPORTED;
+	}
+	switch ( a->numRows )
+	{
+		case 2:
+			return SM_determinant2x2(determinant, a);
+		case 3:
+			return SM_determinant3x3(determinant, a);
+		default:
+			return SM_determinant4x4(determinant, a);
+	}
+}
+
+/**
+@fn SM_inverse
+@brief Computes the inverse of a small square Matrix from its adjugate.
+inverse may alias a.
+@param a Pointer to the Matrix.
+@param inverse Pointer to the Matrix which will hold the inverse. Must have
+the same dimensions as a.
+@return An error code. 0 if no problems were encountered. ERR_SINGULAR if a is
+singular. FAIL_SMALL_UNSUPPORTED if the kernels cannot handle the Matrix, in
+which case inverse is unchanged.
+*/
+int SM_inverse (Matrix *a, Matrix *inverse)
+{
+	if ( !SM_isSmall(a) )
+	{
+		return FAIL_SMALL_UNSUPPORTED;
+	}
+	if ( inverse->numRows != a->numRows || inverse->numCols != a->numCols )
+	{
+		return ERR_DIMENSION_MISMATCH;
+	}
+	Rational result[SM_MAX_SIZE * SM_MAX_SIZE];
+	int error;
+	switch ( a->numRows )
+	{
+		case 2:
+			error = SM_inverse2(result, a);
+			break;
+		case 3:
+			error = SM_inverse3(result, a);
+			break;
+		default:
+			error = SM_inverse4(result, a);
+			break;
+	}
+	if ( !error )
+	{
+		SM_store(inverse, result);
+	}
+	return error;
+}
+
+/**
+@fn SM_solve
+@brief Solves A*X = B for X, where A is a small square Matrix, by multiplying
+B by the adjugate of A. x may alias b.
+@param a Pointer to A.
+@param b Pointer to the Matrix of right-hand sides. Must have as many rows as
+A, and at most SM_MAX_SIZE columns.
+@param x Pointer to the Matrix which will hold the solutions. Must have the
+same dimensions as b.
+@return An error code. 0 if no problems were encountered. ERR_SINGULAR if A is
+singular. FAIL_SMALL_UNSUPPORTED if the kernels cannot handle the operands, in
+which case x is unchanged.
+*/
+int SM_solve (Matrix *a, Matrix *b, Matrix *x)
+{
+	if ( !SM_isSmall(a) || b->numCols > SM_MAX_SIZE )
+	{
+		return FAIL_SMALL_UNSUPPORTED;
+	}
+	if ( b->numRows != a->numRows || x->numRows != b->numRows ||
+		x->numCols != b->numCols )
+	{
+		return ERR_DIMENSION_MISMATCH;
+	}
+	Rational result[SM_MAX_SIZE * SM_MAX_SIZE];
+	int error;
+	switch ( a->numRows )
+	{
+		case 2:
+			error = SM_solve2(result, a, b);
+			break;
+		case 3:
+			error = SM_solve3(result, a, b);
+			break;
+		default:
+			error = SM_solve4(result, a, b);
+			break;
+	}
+	if ( !error )
+	{
+		SM_store(x, result);
+	}
+	return error;
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+/**
+@file SmallMatrix.h
+@author Rob Thomas
+@brief Contains fixed-size kernels for multiplying, and taking the determinant
+and inverse of, square matrices from 2x2 to 4x4, and for solving systems with
+them. The kernels are generated once per size, so every loop has a constant
+trip count and is fully unrolled, and all working storage is on the stack.
+Each operand is scaled to integers over a common denominator, the result is
+computed exactly in 128-bit integers, and each entry of the result is reduced
+with a single GCD at the end. The size is chosen from the operands'
+dimensions; operands these kernels cannot handle are reported with
+FAIL_SMALL_UNSUPPORTED so callers fall back to the general path.
+*/
+
+#ifndef SMALLMATRIX_H
+#define SMALLMATRIX_H
+
+/*** INCLUDES: ***/
+#include <stdbool.h>
+
+#include "LinearSolve.h"
+#include "Matrix.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define SM_MIN_SIZE 2
+#define SM_MAX_SIZE 4
+/* Bound on the magnitude of the scaled entries and the common denominator of
+   an operand. It keeps every intermediate of a 4x4 kernel within 127 bits. */
+#define SM_MAX_SCALED (INT64_C(1) << 30)
+
+#define FAIL_SMALL_UNSUPPORTED -110
+
+/*** FUNCTION PROTOTYPES: ***/
+
+/**
+@fn SM_isSmall
+@brief Checks whether a Matrix is square with a size the kernels handle.
+@param m Pointer to the Matrix.
+@return true if m is NxN with SM_MIN_SIZE <= N <= SM_MAX_SIZE, false otherwise.
+*/
+bool SM_isSmall (Matrix *m);
+
+/**
+@fn SM_multiply
+@brief Computes dest = coefficient * a * b. dest may alias a or b.
+@param dest Pointer to the Matrix which will hold the product.
+@param coefficient The Rational the product is scaled by.
+@param a Pointer to the left operand.
+@param b Pointer to the right operand.
+@return An error code. 0 if no problems were encountered.
+FAIL_SMALL_UNSUPPORTED if the operands are not small square matrices of the
+same size, are too large to scale, or the product does not fit in Rationals,
+in which case dest is unchanged.
+*/
+int SM_multiply (Matrix *dest, Rational coefficient, Matrix *a, Matrix *b);
+
+/**
+@fn SM_determinant
+@brief Computes the determinant of a small square Matrix.
+@param a Pointer to the Matrix.
+@param determinant Pointer to where the determinant will be written.
+@return An error code. 0 if no problems were encountered.
+FAIL_SMALL_UNSUPPORTED if the kernels cannot handle the Matrix.
+*/
+int SM_determinant (Matrix *a, Rational *determinant);
+
+/**
+@fn SM_inverse
+@brief Computes the inverse of a small square Matrix from its adjugate.
+inverse may alias a.
+@param a Pointer to the Matrix.
+@param inverse Pointer to the Matrix which will hold the inverse. Must have
+the same dimensions as a.
+@return An error code. 0 if no problems were encountered. ERR_SINGULAR if a is
+singular. FAIL_SMALL_UNSUPPORTED if the kernels cannot handle the Matrix, in
+which case inverse is unchanged.
+*/
+int SM_inverse (Matrix *a, Matrix *inverse);
+
+/**
+@fn SM_solve
+@brief Solves A*X = B for X, where A is a small square Matrix, by multiplying
+B by the adjugate of A. x may alias b.
+@param a Pointer to A.
+@param b Pointer to the Matrix of right-hand sides. Must have as many rows as
+A, and at most SM_MAX_SIZE columns.
+@param x Pointer to the Matrix which will hold the solutions. Must have the
+same dimensions as b.
+@return An error code. 0 if no problems were encountered. ERR_SINGULAR if A is
+singular. FAIL_SMALL_UNSUPPORTED if the kernels cannot handle the operands, in
+which case x is unchanged.
+*/
+int SM_solve (Matrix *a, Matrix *b, Matrix *x);
+
+#endif /* SMALLMATRIX_H */
\ No newline at end of file
@@ -0,0 +1,735 @@
+/**
+@file TiledMatrix.c
+@author Rob Thomas
+@brief Contains functions for matrices too large to hold in memory. A
+TiledMatrix lives in a file as a grid of square tiles of Rationals. Tiles are
+paged in and out through a TM_BufferCache holding a fixed number of them, and
+the blocked algorithms ask the operating system to read ahead the tiles they
+will touch next, so disk reads overlap with arithmetic.
+*/
+
+/*** INCLUDES: ***/
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "TiledMatrix.h"
+#include "MatrixExpr.h"
+
+/*** DEFINES: ***/
+#define TM_ALIGNMENT 64
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn TM_tileElements
+@brief Returns the number of elements in each tile of a cache.
+@param cache Pointer to the TM_BufferCache.
+@return The number of elements in a tile.
+*/
+static size_t TM_tileElements (TM_BufferCache *cache)
+{
+	return (size_t)cache->tileSize * cache->tileSize;
+}
+
+/**
+@fn TM_frameBytes
+@brief Returns the distance between consecutive frames in a cache's buffer:
+the size of a tile rounded up to TM_ALIGNMENT, so every frame starts aligned.
+@param cache Pointer to the TM_BufferCache.
+@return The distance in bytes.
+*/
+static size_t TM_frameBytes (TM_BufferCache *cache)
+{
+	size_t tileBytes = TM_tileElements(cache) * sizeof(Rational);
+	return (tileBytes + TM_ALIGNMENT - 1) & ~(size_t)(TM_ALIGNMENT - 1);
+}
+
+/**
+@fn TM_tileOffset
+@brief Returns the offset of a tile in its TiledMatrix's file.
+@param m Pointer to the TiledMatrix.
+@param tileRow The row of the tile in the grid.
+@param tileCol The column of the tile in the grid.
+@return The offset in bytes.
+*/
+static uint64_t TM_tileOffset (TiledMatrix *m, unsigned int tileRow,
+	unsigned int tileCol)
+{
+	return TM_DATA_OFFSET + ((uint64_t)tileRow * m->numTileCols + tileCol) *
+		TM_tileElements(m->cache) * sizeof(Rational);
+}
+
+/**
+@fn TM_findFrame
+@brief Finds the frame holding a tile, if it is cached.
+@param m Pointer to the TiledMatrix.
+@param tileRow The row of the tile in the grid.
+@param tileCol The column of the tile in the grid.
+@return A pointer to the frame, or NULL if the tile is not cached.
+*/
+static TM_Frame *TM_findFrame (TiledMatrix *m, unsigned int tileRow,
+	unsigned int tileCol)
+{
+	TM_BufferCache *cache = m->cache;
+	for (unsigned int i = 0; i < cache->numFrames; i++)
+	{
+		TM_Frame *frame = &cache->frames[i];
+		if ( frame->isValid && frame->fd == m->fd &&
+			frame->tileRow == tileRow && frame->tileCol == tileCol )
+		{
+			return frame;
+		}
+	}
+	return NULL;
+}
+
+/**
+@fn TM_writeFrame
+@brief Writes a modified tile back to its file.
+@param cache Pointer to the TM_BufferCache.
+@param frame Pointer to the frame holding the tile.
+@return An error code. 0 if no problems were encountered.
+*/
+static int TM_writeFrame (TM_BufferCache *cache, TM_Frame *frame)
+{
+	if ( !frame->isValid || !frame->isDirty )
+	{
+		return 0;
+	}
+	size_t size = TM_tileElements(cache) * sizeof(Rational);
+	const char *data = (const char *)frame->data;
+	size_t written = 0;
+	while ( written < size )
+	{
+		ssize_t n = pwrite(frame->fd, data + written, size - written,
+			frame->tileOffset + written);
+		if ( n <= 0 )
+		{
+			return ERR_TILE_IO;
+		}
+		written += n;
+	}
+	frame->isDirty = false;
+	cache->writebacks++;
+	return 0;
+}
+
+/**
+@fn TM_readFrame
+@brief Reads a tile from its file into a frame. Files are created sparse, so
+tiles which were never written read back as zero bytes; their elements are
+given a bottom of 1 so that they read as 0/1.
+@param cache Pointer to the TM_BufferCache.
+@param frame Pointer to the frame, which must already describe the tile.
+@return An error code. 0 if no problems were encountered.
+*/
+static int TM_readFrame (TM_BufferCache *cache, TM_Frame *frame)
+{
+	size_t count = TM_tileElements(cache);
+	size_t size = count * sizeof(Rational);
+	char *data = (char *)frame->data;
+	size_t numRead = 0;
+	while ( numRead < size )
+	{
+		ssize_t n = pread(frame->fd, data + numRead, size - numRead,
+			frame->tileOffset + numRead);
+		if ( n < 0 )
+		{
+			return ERR_TILE_IO;
+		}
+		if ( n == 0 )
+		{
+			memset(data + numRead, 0, size - numRead);
+			break;
+		}
+		numRead += n;
+	}
+	for (size_t i = 0; i < count; i++)
+	{
+		if ( frame->data[i].bottom == 0 )
+		{
+			frame->data[i].bottom = 1;
+		}
+	}
+	return 0;
+}
+
+/**
+@fn TM_evict
+@brief Chooses a frame for a new tile with the clock algorithm, writing back
+the tile it held if that tile was modified.
+@param cache Pointer to the TM_BufferCache.
+@param frame Pointer to a frame pointer which will be set to the chosen frame.
+@return An error code. 0 if no problems were encountered. FAIL_CACHE_FULL if
+every frame is pinned.
+*/
+static int TM_evict (TM_BufferCache *cache, TM_Frame **frame)
+{
+	/* Two sweeps clear every reference bit, so a third finds a victim unless
+	   every frame is pinned. */
+	for (unsigned int step = 0; step < 3 * cache->numFrames; step++)
+	{
+		TM_Frame *candidate = &cache->frames[cache->clockHand];
+		cache->clockHand = (cache->clockHand + 1) % cache->numFrames;
+		if ( candidate->pinCount > 0 )
+		{
+			continue;
+		}
+		if ( candidate->isValid && candidate->isReferenced )
+		{
+			candidate->isReferenced = false;
+			continue;
+		}
+		int error = TM_writeFrame(cache, candidate);
+		if ( error )
+		{
+			return error;
+		}
+		candidate->isValid = false;
+		*frame = candidate;
+		return 0;
+	}
+	return FAIL_CACHE_FULL;
+}
+
+/**
+@fn TM_newCache
+@brief Allocates a TM_BufferCache.
+@param numFrames The number of tiles the cache holds. At least TM_MIN_FRAMES.
+@param tileSize The number of rows and columns in each tile.
+@return A pointer to the new TM_BufferCache, or NULL if allocation failed.
+*/
+TM_BufferCache *TM_newCache (unsigned int numFrames, unsigned int tileSize)
+{
+	if ( numFrames < TM_MIN_FRAMES )
+	{
+		numFrames = TM_MIN_FRAMES;
+	}
+	if ( tileSize == 0 )
+	{
+		return NULL;
+	}
+	TM_BufferCache *cache = (TM_BufferCache *)calloc(1, sizeof(TM_BufferCache));
+	if ( !cache )
+	{
+		return NULL;
+	}
+	cache->numFrames = numFrames;
+	cache->tileSize = tileSize;
+	cache->usePrefetch = true;
+	cache->frames = (TM_Frame *)calloc(numFrames, sizeof(TM_Frame));
+	size_t frameBytes = TM_frameBytes(cache);
+	if ( !cache->frames || posix_memalign((void **)&cache->buffer, TM_ALIGNMENT,
+		frameBytes * numFrames) )
+	{
+		free(cache->frames);
+		free(cache);
+		return NULL;
+	}
+	for (unsigned int i = 0; i < numFrames; i++)
+	{
+		cache->frames[i].data = (Rational *)((char *)cache->buffer + frameBytes * i);
+	}
+	return cache;
+}
+
+/**
+@fn TM_freeCache
+@brief Frees a TM_BufferCache. Every TiledMatrix using it must have been
+closed.
+@param cache Pointer to the TM_BufferCache to be freed.
+*/
+void TM_freeCache (TM_BufferCache *cache)
+{
+	if ( !cache )
+	{
+		return;
+	}
+	free(cache->buffer);
+	free(cache->frames);
+	free(cache);
+}
+
+/**
+@fn TM_describe
+@brief Fills in a TiledMatrix for an open file.
+@param m Pointer to the TiledMatrix.
+@param fd The file descriptor of the file.
+@param header Pointer to the file's header.
+@param cache Pointer to the TM_BufferCache.
+*/
+static void TM_describe (TiledMatrix *m, int fd, TM_FileHeader *header,
+	TM_BufferCache *cache)
+{
+	m->numRows = header->numRows;
+	m->numCols = header->numCols;
+	m->tileSize = header->tileSize;
+	m->numTileRows = (header->numRows + header->tileSize - 1) / header->tileSize;
+	m->numTileCols = (header->numCols + header->tileSize - 1) / header->tileSize;
+	m->fd = fd;
+	m->cache = cache;
+}
+
+/**
+@fn TM_create
+@brief Creates a file holding a TiledMatrix with every element equal to 0/1.
+The file is sparse, so tiles take no disk space until they are written.
+@param path The path of the file to create. Any existing file is replaced.
+@param numRows The number of rows in the matrix.
+@param numCols The number of columns in the matrix.
+@param cache Pointer to the TM_BufferCache the matrix's tiles will pass
+through.
+@param result Pointer to the TiledMatrix which will describe the matrix.
+@return An error code. 0 if no problems were encountered.
+*/
+int TM_create (const char *path, unsigned int numRows, unsigned int numCols,
+	TM_BufferCache *cache, TiledMatrix *result)
+{
+	int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if ( fd < 0 )
+	{
+		return ERR_TILE_IO;
+	}
+	TM_FileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TM_MAGIC, sizeof(header.magic));
+	header.byteOrderMark = TM_BYTE_ORDER_MARK;
+	header.numRows = numRows;
+	header.numCols = numCols;
+	header.tileSize = cache->tileSize;
+	TM_describe(result, fd, &header, cache);
+	uint64_t fileSize = TM_tileOffset(result, result->numTileRows, 0);
+	if ( pwrite(fd, &header, sizeof(header), 0) != sizeof(header) ||
+		ftruncate(fd, fileSize) )
+	{
+		close(fd);
+		return ERR_TILE_IO;
+	}
+	return 0;
+}
+
+/**
+@fn TM_open
+@brief Opens a file created by TM_create.
+@param path The path of the file.
+@param cache Pointer to the TM_BufferCache the matrix's tiles will pass
+through. Its tile size must match the file's.
+@param result Pointer to the TiledMatrix which will describe the matrix.
+@return An error code. 0 if no problems were encountered.
+*/
+int TM_open (const char *path, TM_BufferCache *cache, TiledMatrix *result)
+{
+	int fd = open(path, O_RDWR);
+	if ( fd < 0 )
+	{
+		return ERR_TILE_IO;
+	}
+	TM_FileHeader header;
+	if ( pread(fd, &header, sizeof(header), 0) != sizeof(header) )
+	{
+		close(fd);
+		return ERR_TILE_FORMAT;
+	}
+	if ( memcmp(header.magic, TM_MAGIC, sizeof(header.magic)) ||
+		header.byteOrderMark != TM_BYTE_ORDER_MARK ||
+		header.tileSize != cache->tileSize )
+	{
+		close(fd);
+		return ERR_TILE_FORMAT;
+	}
+	TM_describe(result, fd, &header, cache);
+	return 0;
+}
+
+/**
+@fn TM_flush
+@brief Writes every modified tile of a TiledMatrix back to its file.
+@param m Pointer to the TiledMatrix.
+@return An error code. 0 if no problems were encountered.
+*/
+int TM_flush (TiledMatrix *m)
+{
+	TM_BufferCache *cache = m->cache;
+	for (unsigned int i = 0; i < cache->numFrames; i++)
+	{
+		if ( cache->frames[i].isValid && cache->frames[i].fd == m->fd )
+		{
+			int error = TM_writeFrame(cache, &cache->frames[i]);
+			if ( error )
+			{
+				return error;
+			}
+		}
+	}
+	return 0;
+}
+
+/**
+@fn TM_close
+@brief Flushes a TiledMatrix, drops its tiles from the cache and closes its
+file. Every copy of the TiledMatrix becomes invalid.
+@param m Pointer to the TiledMatrix.
+@return An error code. 0 if no problems were encountered.
+*/
+int TM_close (TiledMatrix *m)
+{
+	int error = TM_flush(m);
+	TM_BufferCache *cache = m->cache;
+	for (unsigned int i = 0; i < cache->numFrames; i++)
+	{
+		if ( cache->frames[i].fd == m->fd )
+		{
+			cache->frames[i].isValid = false;
+			cache->frames[i].isDirty = false;
+			cache->frames[i].pinCount = 0;
+		}
+	}
+	if ( close(m->fd) && !error )
+	{
+		error = ERR_TILE_IO;
+	}
+	m->fd = -1;
+	return error;
+}
+
+/**
+@fn TM_pinTile
+@brief Loads a tile into the cache if it is not there already, and pins it so
+it stays in memory until TM_unpinTile is called.
+@param m Pointer to the TiledMatrix.
+@param tileRow The row of the tile in the grid.
+@param tileCol The column of the tile in the grid.
+@param access How the tile will be used. See definition of TileAccess above.
+@param tile Pointer to where a pointer to the tile's tileSize * tileSize
+elements, in row-major order, will be written.
+@return An error code. 0 if no problems were encountered. FAIL_CACHE_FULL if
+every frame is pinned.
+*/
+int TM_pinTile (TiledMatrix *m, unsigned int tileRow, unsigned int tileCol,
+	TileAccess access, Rational **tile)
+{
+	TM_BufferCache *cache = m->cache;
+	TM_Frame *frame = TM_findFrame(m, tileRow, tileCol);
+	if ( frame )
+	{
+		cache->hits++;
+	}
+	else
+	{
+		cache->misses++;
+		int error = TM_evict(cache, &frame);
+		if ( error )
+		{
+			return error;
+		}
+		frame->fd = m->fd;
+		frame->tileRow = tileRow;
+		frame->tileCol = tileCol;
+		frame->tileOffset = TM_tileOffset(m, tileRow, tileCol);
+		frame->isDirty = false;
+		if ( access != TA_OVERWRITE )
+		{
+			error = TM_readFrame(cache, frame);
+			if ( error )
+			{
+				return error;
+			}
+		}
+		frame->isValid = true;
+	}
+	if ( access == TA_OVERWRITE )
+	{
+		Rational zero = {0, 1};
+		for (size_t i = 0; i < TM_tileElements(cache); i++)
+		{
+			frame->data[i] = zero;
+		}
+	}
+	if ( access != TA_READ )
+	{
+		frame->isDirty = true;
+	}
+	frame->isReferenced = true;
+	frame->pinCount++;
+	*tile = frame->data;
+	return 0;
+}
+
+/**
+@fn TM_unpinTile
+@brief Releases a pin taken by TM_pinTile.
+@param m Pointer to the TiledMatrix.
+@param tile The pointer returned by TM_pinTile.
+*/
+void TM_unpinTile (TiledMatrix *m, Rational *tile)
+{
+	TM_BufferCache *cache = m->cache;
+	size_t index = ((char *)tile - (char *)cache->buffer) / TM_frameBytes(cache);
+	if ( index < cache->numFrames && cache->frames[index].pinCount > 0 )
+	{
+		cache->frames[index].pinCount--;
+	}
+}
+
+/**
+@fn TM_prefetchTile
+@brief Asks the operating system to start reading a tile which will be pinned
+soon, unless it is already cached or prefetching is off.
+@param m Pointer to the TiledMatrix.
+@param tileRow The row of the tile in the grid.
+@param tileCol The column of the tile in the grid.
+*/
+void TM_prefetchTile (TiledMatrix *m, unsigned int tileRow,
+	unsigned int tileCol)
+{
+	if ( !m->cache->usePrefetch || TM_findFrame(m, tileRow, tileCol) )
+	{
+		return;
+	}
+	posix_fadvise(m->fd, TM_tileOffset(m, tileRow, tileCol),
+		TM_tileElements(m->cache) * sizeof(Rational), POSIX_FADV_WILLNEED);
+	m->cache->prefetches++;
+}
+
+/**
+@fn TM_get
+@brief Reads one element of a TiledMatrix.
+@param m Pointer to the TiledMatrix.
+@param row The row (0-indexed) of the element.
+@param col The column (0-indexed) of the element.
+@param value Pointer to where the element will be written.
+@return An error code. 0 if no problems were encountered.
+*/
+int TM_get (TiledMatrix *m, unsigned int row, unsigned int col,
+	Rational *value)
+{
+	if ( row >= m->numRows || col >= m->numCols )
+	{
+		return ERR_DIMENSION_MISMATCH;
+	}
+	Rational *tile;
+	int error = TM_pinTile(m, row / m->tileSize, col / m->tileSize, TA_READ,
+		&tile);
+	if ( error )
+	{
+		return error;
+	}
+	*value = tile[(size_t)(row % m->tileSize) * m->tileSize + col % m->tileSize];
+	TM_unpinTile(m, tile);
+	return 0;
+}
+
+/**
+@fn TM_set
+@brief Writes one element of a TiledMatrix.
+@param m Pointer to the TiledMatrix.
+@param row The row (0-indexed) of the element.
+@param col The column (0-indexed) of the element.
+@param value The new value of the element.
+@return An error code. 0 if no problems were encountered.
+*/
+int TM_set (TiledMatrix *m, unsigned int row, unsigned int col,
+	Rational value)
+{
+	if ( row >= m->numRows || col >= m->numCols )
+	{
+		return ERR_DIMENSION_MISMATCH;
+	}
+	Rational *tile;
+	int error = TM_pinTile(m, row / m->tileSize, col / m->tileSize, TA_WRITE,
+		&tile);
+	if ( error )
+	{
+		return error;
+	}
+	tile[(size_t)(row % m->tileSize) * m->tileSize + col % m->tileSize] = value;
+	TM_unpinTile(m, tile);
+	return 0;
+}
+
+/**
+@fn TM_fromMatrix
+@brief Copies an in-memory Matrix into a TiledMatrix of the same dimensions.
+@param src Pointer to the Matrix.
+@param dest Pointer to the TiledMatrix.
+@return An error code. 0 if no problems were encountered.
+*/
+int TM_fromMatrix (Matrix *src, TiledMatrix *dest)
+{
+	if ( src->numRows != dest->numRows || src->numCols != dest->numCols )
+	{
+		return ERR_DIMENSION_MISMATCH;
+	}
+	unsigned int t = dest->tileSize;
+	for (unsigned int tr = 0; tr < dest->numTileRows; tr++)
+	{
+		for (unsigned int tc = 0; tc < dest->numTileCols; tc++)
+		{
+			Rational *tile;
+			int error = TM_pinTile(dest, tr, tc, TA_OVERWRITE, &tile);
+			if ( error )
+			{
+				return error;
+			}
+			unsigned int numRows = src->numRows - tr * t < t ? src->numRows - tr * t : t;
+			unsigned int numCols = src->numCols - tc * t < t ? src->numCols - tc * t : t;
+			for (unsigned int i = 0; i < numRows; i++)
+			{
+				memcpy(&tile[(size_t)i * t], &M_AT(src, tr * t + i, tc * t),
+					sizeof(Rational) * numCols);
+			}
+			TM_unpinTile(dest, tile);
+		}
+	}
+	return 0;
+}
+
+/**
+@fn TM_toMatrix
+@brief Copies a TiledMatrix into an in-memory Matrix of the same dimensions.
+@param src Pointer to the TiledMatrix.
+@param dest Pointer to the Matrix.
+@return An error code. 0 if no problems were encountered.
+*/
+int TM_toMatrix (TiledMatrix *src, Matrix *dest)
+{
+	if ( src->numRows != dest->numRows || src->numCols != dest->numCols )
+	{
+		return ERR_DIMENSION_MISMATCH;
+	}
+	unsigned int t = src->tileSize;
+	for (unsigned int tr = 0; tr < src->numTileRows; tr++)
+	{
+		for (unsigned int tc = 0; tc < src->numTileCols; tc++)
+		{
+			/* Tiles are visited in file order, so read one tile ahead. */
+			if ( tc + 1 < src->numTileCols )
+			{
+				TM_prefetchTile(src, tr, tc + 1);
+			}
+			else if ( tr + 1 < src->numTileRows )
+			{
+				TM_prefetchTile(src, tr + 1, 0);
+			}
+			Rational *tile;
+			int error = TM_pinTile(src, tr, tc, TA_READ, &tile);
+			if ( error )
+			{
+				return error;
+			}
+			unsigned int numRows = src->numRows - tr * t < t ? src->numRows - tr * t : t;
+			unsigned int numCols = src->numCols - tc * t < t ? src->numCols - tc * t : t;
+			for (unsigned int i = 0; i < numRows; i++)
+			{
+				memcpy(&M_AT(dest, tr * t + i, tc * t), &tile[(size_t)i * t],
+					sizeof(Rational) * numCols);
+			}
+			TM_unpinTile(src, tile);
+		}
+	}
+	M_rehash(dest);
+	return 0;
+}
+
+/**
+@fn TM_tileView
+@brief Builds a Matrix which refers to a pinned tile without copying it.
+@param tile The tile's elements.
+@param tileSize The number of rows and columns in the tile.
+@return The view of the tile.
+*/
+static Matrix TM_tileView (Rational *tile, unsigned int tileSize)
+{
+	Matrix view;
+	view.numRows = tileSize;
+	view.numCols = tileSize;
+	view.elements = tile;
+	view.isBorrowed = true;
+	M_rehash(&view);
+	return view;
+}
+
+/**
+@fn TM_multiply
+@brief Computes dest = a * b one tile at a time. Each tile of dest is
+accumulated from the products of a row of tiles of a and a column of tiles of
+b (see ME_evaluate), and the next pair of tiles is prefetched while the
+current pair is multiplied. At most three tiles are pinned at once.
+@param dest Pointer to the TiledMatrix which will hold the product. Must not
+share a file with a or b.
+@param a Pointer to the left operand.
+@param b Pointer to the right operand.
+@return An error code. 0 if no problems were encountered.
+*/
+int TM_multiply (TiledMatrix *dest, TiledMatrix *a, TiledMatrix *b)
+{
+	if ( a->numCols != b->numRows || dest->numRows != a->numRows ||
+		dest->numCols != b->numCols || a->tileSize != b->tileSize ||
+		dest->tileSize != a->tileSize )
+	{
+		return ERR_DIMENSION_MISMATCH;
+	}
+	Rational one = {1, 1};
+	unsigned int numSteps = a->numTileCols;
+	for (unsigned int i = 0; i < dest->numTileRows; i++)
+	{
+		for (unsigned int j = 0; j < dest->numTileCols; j++)
+		{
+			Rational *destTile;
+			int error = TM_pinTile(dest, i, j, TA_OVERWRITE, &destTile);
+			if ( error )
+			{
+				return error;
+			}
+			Matrix destView = TM_tileView(destTile, dest->tileSize);
+			for (unsigned int k = 0; k < numSteps && !error; k++)
+			{
+				/* Start reading the pair of tiles the next step will use. */
+				if ( k + 1 < numSteps )
+				{
+					TM_prefetchTile(a, i, k + 1);
+					TM_prefetchTile(b, k + 1, j);
+				}
+				else if ( j + 1 < dest->numTileCols )
+				{
+					TM_prefetchTile(a, i, 0);
+					TM_prefetchTile(b, 0, j + 1);
+				}
+				else if ( i + 1 < dest->numTileRows )
+				{
+					TM_prefetchTile(a, i + 1, 0);
+					TM_prefetchTile(b, 0, 0);
+				}
+				Rational *aTile;
+				Rational *bTile;
+				error = TM_pinTile(a, i, k, TA_READ, &aTile);
+				if ( error )
+				{
+					break;
+				}
+				error = TM_pinTile(b, k, j, TA_READ, &bTile);
+				if ( error )
+				{
+					TM_unpinTile(a, aTile);
+					break;
+				}
+				Matrix aView = TM_tileView(aTile, a->tileSize);
+				Matrix bView = TM_tileView(bTile, b->tileSize);
+				MatrixTerm terms[2];
+				terms[0] = ME_element(one, &destView);
+				terms[1] = ME_product(one, &aView, &bView);
+				error = ME_evaluate(&destView, terms, 2);
+				TM_unpinTile(b, bTile);
+				TM_unpinTile(a, aTile);
+			}
+			TM_unpinTile(dest, destTile);
+			if ( error )
+			{
+				return error;
+			}
+		}
+	}
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,305 @@
+/**
+@file TiledMatrix.h
+@author Rob Thomas
+@brief Contains the TiledMatrix struct and functions for matrices too large to
+hold in memory. A TiledMatrix lives in a file as a grid of square tiles of
+Rationals. Tiles are paged in and out through a TM_BufferCache holding a fixed
+number of them, and the blocked algorithms ask the operating system to read
+ahead the tiles they will touch next, so disk reads overlap with arithmetic.
+*/
+
+#ifndef TILEDMATRIX_H
+#define TILEDMATRIX_H
+
+/*** INCLUDES: ***/
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "Matrix.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define TM_MAGIC "MSTILED"
+#define TM_BYTE_ORDER_MARK 0x01020304
+#define TM_DATA_OFFSET 4096
+#define TM_MIN_FRAMES 4
+
+#define ERR_TILE_IO -120
+#define ERR_TILE_FORMAT -121
+#define FAIL_CACHE_FULL -122
+
+/*** STRUCTS: ***/
+
+/**
+@def TileAccess
+@brief An enumerated type representing how a pinned tile will be used.
+@var TA_READ The tile will only be read.
+@var TA_WRITE The tile will be read and modified.
+@var TA_OVERWRITE Every element of the tile will be written, so it is not read
+from disk. It starts out filled with 0/1.
+*/
+typedef enum
+{
+	TA_READ,
+	TA_WRITE,
+	TA_OVERWRITE
+} TileAccess;
+
+/**
+@def TM_FileHeader
+@brief A struct representing the header at the start of a TiledMatrix file.
+The tiles follow at TM_DATA_OFFSET, row of tiles by row of tiles, each tile
+stored as tileSize * tileSize Rationals in row-major order.
+@var magic The characters TM_MAGIC, identifying the file.
+@var byteOrderMark TM_BYTE_ORDER_MARK as written by the creating machine.
+@var numRows The number of rows in the matrix.
+@var numCols The number of columns in the matrix.
+@var tileSize The number of rows and columns in each tile.
+*/
+typedef struct
+{
+	char magic[8];
+	uint32_t byteOrderMark;
+	uint32_t numRows;
+	uint32_t numCols;
+	uint32_t tileSize;
+} TM_FileHeader;
+
+/**
+@def TM_Frame
+@brief A struct representing one slot of a TM_BufferCache, holding one tile.
+@var fd The file descriptor of the TiledMatrix the tile belongs to.
+@var tileRow The row of the tile in the grid.
+@var tileCol The column of the tile in the grid.
+@var tileOffset The offset of the tile in its file.
+@var data The tile's elements, in row-major order.
+@var pinCount The number of pins currently held on the tile. Pinned tiles are
+never evicted.
+@var isValid Whether the frame holds a tile.
+@var isDirty Whether the tile has been modified since it was last written.
+@var isReferenced Whether the tile was used since the clock hand last passed.
+*/
+typedef struct
+{
+	int fd;
+	unsigned int tileRow;
+	unsigned int tileCol;
+	uint64_t tileOffset;
+	Rational *data;
+	unsigned int pinCount;
+	bool isValid;
+	bool isDirty;
+	bool isReferenced;
+} TM_Frame;
+
+/**
+@def TM_BufferCache
+@brief A struct representing a bounded cache of tiles shared by any number of
+TiledMatrix variables with the same tile size. Tiles are evicted with the
+clock algorithm, and modified tiles are written back when evicted.
+NOTE: a cache and the matrices using it must only be used by one thread.
+@var frames The cache's frames.
+@var numFrames The number of frames.
+@var tileSize The number of rows and columns in each tile.
+@var buffer The memory holding every frame's tile.
+@var clockHand The next frame the clock algorithm will consider.
+@var usePrefetch Whether read-ahead hints are given for upcoming tiles.
+@var hits The number of pins satisfied from the cache.
+@var misses The number of pins which had to load a tile.
+@var writebacks The number of modified tiles written back to disk.
+@var prefetches The number of read-ahead hints given.
+*/
+typedef struct
+{
+	TM_Frame *frames;
+	unsigned int numFrames;
+	unsigned int tileSize;
+	Rational *buffer;
+	unsigned int clockHand;
+	bool usePrefetch;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t writebacks;
+	uint64_t prefetches;
+} TM_BufferCache;
+
+/**
+@def TiledMatrix
+@brief A struct representing a matrix of Rationals stored on disk in tiles.
+Like a Matrix, it can be copied freely: every copy refers to the same file.
+Adding one to a HashTable hands the file to the table, which closes it when
+the variable is overwritten or freed.
+@var numRows The number of rows in the matrix.
+@var numCols The number of columns in the matrix.
+@var tileSize The number of rows and columns in each tile. Tiles along the
+bottom and right edges are padded with zeros.
+@var numTileRows The number of rows of tiles.
+@var numTileCols The number of columns of tiles.
+@var fd The file descriptor of the matrix's file.
+@var cache Pointer to the TM_BufferCache the matrix's tiles pass through.
+*/
+typedef struct
+{
+	unsigned int numRows;
+	unsigned int numCols;
+	unsigned int tileSize;
+	unsigned int numTileRows;
+	unsigned int numTileCols;
+	int fd;
+	TM_BufferCache *cache;
+} TiledMatrix;
+
+/*** FUNCTION PROTOTYPES: ***/
+
+/**
+@fn TM_newCache
+@brief Allocates a TM_BufferCache.
+@param numFrames The number of tiles the cache holds. At least TM_MIN_FRAMES.
+@param tileSize The number of rows and columns in each tile.
+@return A pointer to the new TM_BufferCache, or NULL if allocation failed.
+*/
+TM_BufferCache *TM_newCache (unsigned int numFrames, unsigned int tileSize);
+
+/**
+@fn TM_freeCache
+@brief Frees a TM_BufferCache. Every TiledMatrix using it must have been
+closed.
+@param cache Pointer to the TM_BufferCache to be freed.
+*/
+void TM_freeCache (TM_BufferCache *cache);
+
+/**
+@fn TM_create
+@brief Creates a file holding a TiledMatrix with every element equal to 0/1.
+The file is sparse, so tiles take no disk space until they are written.
+@param path The path of the file to create. Any existing file is replaced.
+@param numRows The number of rows in the matrix.
+@param numCols The number of columns in the matrix.
+@param cache Pointer to the TM_BufferCache the matrix's tiles will pass
+through.
+@param result Pointer to the TiledMatrix which will describe the matrix.
+@return An error code. 0 if no problems were encountered.
+*/
+int TM_create (const char *path, unsigned int numRows, unsigned int numCols,
+	TM_BufferCache *cache, TiledMatrix *result);
+
+/**
+@fn TM_open
+@brief Opens a file created by TM_create.
+@param path The path of the file.
+@param cache Pointer to the TM_BufferCache the matrix's tiles will pass
+through. Its tile size must match the file's.
+@param result Pointer to the TiledMatrix which will describe the matrix.
+@return An error code. 0 if no problems were encountered.
+*/
+int TM_open (const char *path, TM_BufferCache *cache, TiledMatrix *result);
+
+/**
+@fn TM_flush
+@brief Writes every modified tile of a TiledMatrix back to its file.
+@param m Pointer to the TiledMatrix.
+@return An error code. 0 if no problems were encountered.
+*/
+int TM_flush (TiledMatrix *m);
+
+/**
+@fn TM_close
+@brief Flushes a TiledMatrix, drops its tiles from the cache and closes its
+file. Every copy of the TiledMatrix becomes invalid.
+@param m Pointer to the TiledMatrix.
+@return An error code. 0 if no problems were encountered.
+*/
+int TM_close (TiledMatrix *m);
+
+/**
+@fn TM_pinTile
+@brief Loads a tile into the cache if it is not there already, and pins it so
+it stays in memory until TM_unpinTile is called.
+@param m Pointer to the TiledMatrix.
+@param tileRow The row of the tile in the grid.
+@param tileCol The column of the tile in the grid.
+@param access How the tile will be used. See definition of TileAccess above.
+@param tile Pointer to where a pointer to the tile's tileSize * tileSize
+elements, in row-major order, will be written.
+@return An error code. 0 if no problems were encountered. FAIL_CACHE_FULL if
+every frame is pinned.
+*/
+int TM_pinTile (TiledMatrix *m, unsigned int tileRow, unsigned int tileCol,
+	TileAccess access, Rational **tile);
+
+/**
+@fn TM_unpinTile
+@brief Releases a pin taken by TM_pinTile.
+@param m Pointer to the TiledMatrix.
+@param tile The pointer returned by TM_pinTile.
+*/
+void TM_unpinTile (TiledMatrix *m, Rational *tile);
+
+/**
+@fn TM_prefetchTile
+@brief Asks the operating system to start reading a tile which will be pinned
+soon, unless it is already cached or prefetching is off.
+@param m Pointer to the TiledMatrix.
+@param tileRow The row of the tile in the grid.
+@param tileCol The column of the tile in the grid.
+*/
+void TM_prefetchTile (TiledMatrix *m, unsigned int tileRow,
+	unsigned int tileCol);
+
+/**
+@fn TM_get
+@brief Reads one element of a TiledMatrix.
+@param m Pointer to the TiledMatrix.
+@param row The row (0-indexed) of the element.
+@param col The column (0-indexed) of the element.
+@param value Pointer to where the element will be written.
+@return An error code. 0 if no problems were encountered.
+*/
+int TM_get (TiledMatrix *m, unsigned int row, unsigned int col,
+	Rational *value);
+
+/**
+@fn TM_set
+@brief Writes one element of a TiledMatrix.
+@param m Pointer to the TiledMatrix.
+@param row The row (0-indexed) of the element.
+@param col The column (0-indexed) of the element.
+@param value The new value of the element.
+@return An error code. 0 if no problems were encountered.
+*/
+int TM_set (TiledMatrix *m, unsigned int row, unsigned int col,
+	Rational value);
+
+/**
+@fn TM_fromMatrix
+@brief Copies an in-memory Matrix into a TiledMatrix of the same dimensions.
+@param src Pointer to the Matrix.
+@param dest Pointer to the TiledMatrix.
+@return An error code. 0 if no problems were encountered.
+*/
+int TM_fromMatrix (Matrix *src, TiledMatrix *dest);
+
+/**
+@fn TM_toMatrix
+@brief Copies a TiledMatrix into an in-memory Matrix of the same dimensions.
+@param src Pointer to the TiledMatrix.
+@param dest Pointer to the Matrix.
+@return An error code. 0 if no problems were encountered.
+*/
+int TM_toMatrix (TiledMatrix *src, Matrix *dest);
+
+/**
+@fn TM_multiply
+@brief Computes dest = a * b one tile at a time. Each tile of dest is
+accumulated from the products of a row of tiles of a and a column of tiles of
+b (see ME_evaluate), and the next pair of tiles is prefetched while the
+current pair is multiplied. At most three tiles are pinned at once.
+@param dest Pointer to the TiledMatrix which will hold the product. Must not
+share a file with a or b.
+@param a Pointer to the left operand.
+@param b Pointer to the right operand.
+@return An error code. 0 if no problems were encountered.
+*/
+int TM_multiply (TiledMatrix *dest, TiledMatrix *a, TiledMatrix *b);
+
+#endif /* TILEDMATRIX_H */
\ No newline at end of file
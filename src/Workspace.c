@@ -0,0 +1,335 @@
+/**
+@file Workspace.c
+@author Rob Thomas
+@brief Contains functions for saving the variables of a HashTable to a binary
+workspace file and loading them back. Matrix elements are stored at aligned
+offsets in the file, and loading maps the file into memory so that matrices
+are used in place and their pages are only read from disk when first touched.
+*/
+
+/*** INCLUDES: ***/
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "Workspace.h"
+#include "Matrix.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn WS_align
+@brief Rounds an offset up to the next multiple of WS_ALIGNMENT.
+@param offset The offset to round up.
+@return The aligned offset.
+*/
+static uint64_t WS_align (uint64_t offset)
+{
+	return (offset + WS_ALIGNMENT - 1) & ~(uint64_t)(WS_ALIGNMENT - 1);
+}
+
+/**
+@fn WS_dataSize
+@brief Returns the number of bytes a variable's value occupies in a workspace.
+@param space Pointer to the HashSpace holding the variable.
+@return The size of the value's data in bytes.
+*/
+static uint64_t WS_dataSize (HashSpace *space)
+{
+	if ( space->valueType == VT_MATRIX )
+	{
+		Matrix *m = (Matrix *)space->value;
+		return sizeof(Rational) * (uint64_t)m->numRows * m->numCols;
+	}
+	return sizeof(Rational);
+}
+
+/**
+@fn WS_isSaved
+@brief Checks whether a space holds a variable which is written to workspaces.
+Tiled matrices already live in their own files, so they are left out.
+@param space Pointer to the HashSpace.
+@return true if the space's variable is saved, false otherwise.
+*/
+static bool WS_isSaved (HashSpace *space)
+{
+	return space->key && space->value && space->valueType != VT_TILED_MATRIX;
+}
+
+/**
+@fn WS_pad
+@brief Writes zero bytes to a file until it reaches a given offset.
+@param file The file being written.
+@param offset The current offset in the file.
+@param target The offset to pad up to.
+@return An error code. 0 if no problems were encountered.
+*/
+static int WS_pad (FILE *file, uint64_t offset, uint64_t target)
+{
+	while ( offset < target )
+	{
+		if ( fputc(0, file) == EOF )
+		{
+			return ERR_WORKSPACE_IO;
+		}
+		offset++;
+	}
+	return 0;
+}
+
+/**
+@fn WS_save
+@brief Writes every variable in a HashTable to a workspace file, except for
+tiled matrices, which already live in their own files.
+@param table Pointer to the HashTable whose variables will be saved.
+@param path The path of the file to write.
+@return An error code. 0 if no problems were encountered.
+*/
+int WS_save (HashTable *table, const char *path)
+{
+	/* Count the variables to be saved. */
+	uint32_t numEntries = 0;
+	for (unsigned int i = 0; i < table->maxNumItems; i++)
+	{
+		if ( WS_isSaved(&table->pairs[i]) )
+		{
+			numEntries++;
+		}
+	}
+	WorkspaceEntry *entries =
+		(WorkspaceEntry *)calloc(numEntries ? numEntries : 1, sizeof(WorkspaceEntry));
+	HashSpace **spaces =
+		(HashSpace **)malloc(sizeof(HashSpace *) * (numEntries ? numEntries : 1));
+	if ( !entries || !spaces )
+	{
+		free(entries);
+		free(spaces);
+		return ERR_ALLOCATION_FAILED;
+	}
+	/* Lay out the file: header, entry list, keys, then the aligned data of
+	   each variable. */
+	uint64_t offset = sizeof(WorkspaceHeader) + sizeof(WorkspaceEntry) * numEntries;
+	uint32_t e = 0;
+	for (unsigned int i = 0; i < table->maxNumItems; i++)
+	{
+		if ( WS_isSaved(&table->pairs[i]) )
+		{
+			spaces[e] = &table->pairs[i];
+			entries[e].keyLength = strlen(table->pairs[i].key);
+			entries[e].keyOffset = offset;
+			offset += entries[e].keyLength + 1;
+			e++;
+		}
+	}
+	uint64_t keysEnd = offset;
+	for (e = 0; e < numEntries; e++)
+	{
+		entries[e].valueType = spaces[e]->valueType;
+		if ( spaces[e]->valueType == VT_MATRIX )
+		{
+			Matrix *m = (Matrix *)spaces[e]->value;
+			entries[e].numRows = m->numRows;
+			entries[e].numCols = m->numCols;
+			entries[e].contentHash = m->contentHash;
+			entries[e].flags = m->isInteger ? WS_FLAG_INTEGER : 0;
+		}
+		offset = WS_align(offset);
+		entries[e].dataOffset = offset;
+		offset += WS_dataSize(spaces[e]);
+	}
+	WorkspaceHeader header;
+	memcpy(header.magic, WS_MAGIC, sizeof(header.magic));
+	header.version = WS_VERSION;
+	header.byteOrderMark = WS_BYTE_ORDER_MARK;
+	header.numEntries = numEntries;
+	header.fileSize = offset;
+	/* Write everything out in the order it was laid out. */
+	int error = 0;
+	FILE *file = fopen(path, "wb");
+	if ( !file )
+	{
+		error = ERR_WORKSPACE_IO;
+	}
+	if ( !error && (fwrite(&header, sizeof(header), 1, file) != 1 ||
+		fwrite(entries, sizeof(WorkspaceEntry), numEntries, file) != numEntries) )
+	{
+		error = ERR_WORKSPACE_IO;
+	}
+	for (e = 0; !error && e < numEntries; e++)
+	{
+		if ( fwrite(spaces[e]->key, 1, entries[e].keyLength + 1, file) !=
+			entries[e].keyLength + 1 )
+		{
+			error = ERR_WORKSPACE_IO;
+		}
+	}
+	offset = keysEnd;
+	for (e = 0; !error && e < numEntries; e++)
+	{
+		error = WS_pad(file, offset, entries[e].dataOffset);
+		if ( error )
+		{
+			break;
+		}
+		uint64_t size = WS_dataSize(spaces[e]);
+		void *data = spaces[e]->value;
+		if ( spaces[e]->valueType == VT_MATRIX )
+		{
+			data = ((Matrix *)spaces[e]->value)->elements;
+		}
+		if ( size && fwrite(data, 1, size, file) != size )
+		{
+			error = ERR_WORKSPACE_IO;
+		}
+		offset = entries[e].dataOffset + size;
+	}
+	if ( file && fclose(file) )
+	{
+		error = ERR_WORKSPACE_IO;
+	}
+	free(entries);
+	free(spaces);
+	return error;
+}
+
+/**
+@fn WS_load
+@brief Maps a workspace file into memory and adds each of its variables to a
+HashTable. The element buffers of loaded matrices point directly into the
+mapping, which is private, so writes to them never reach the file.
+NOTE: the loaded matrices are only valid until WS_close is called, so the
+table must be freed (or those variables overwritten) first.
+@param table Pointer to the HashTable the variables will be added to.
+@param path The path of the file to load.
+@param workspace Pointer to a Workspace which will describe the mapping.
+@return An error code. 0 if no problems were encountered.
+*/
+int WS_load (HashTable *table, const char *path, Workspace *workspace)
+{
+	workspace->base = NULL;
+	workspace->length = 0;
+	int fd = open(path, O_RDONLY);
+	if ( fd < 0 )
+	{
+		return ERR_WORKSPACE_IO;
+	}
+	struct stat info;
+	if ( fstat(fd, &info) || (size_t)info.st_size < sizeof(WorkspaceHeader) )
+	{
+		close(fd);
+		return ERR_WORKSPACE_FORMAT;
+	}
+	/* Map the whole file. Nothing is read until a page is touched. */
+	size_t length = info.st_size;
+	char *base = (char *)mmap(NULL, length, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE, fd, 0);
+	close(fd);
+	if ( base == MAP_FAILED )
+	{
+		return ERR_WORKSPACE_IO;
+	}
+	workspace->base = base;
+	workspace->length = length;
+	/* Validate the header and the entry list before trusting any offsets. */
+	WorkspaceHeader *header = (WorkspaceHeader *)base;
+	if ( memcmp(header->magic, WS_MAGIC, sizeof(header->magic)) ||
+		header->byteOrderMark != WS_BYTE_ORDER_MARK ||
+		header->fileSize != length )
+	{
+		WS_close(workspace);
+		return ERR_WORKSPACE_FORMAT;
+	}
+	if ( header->version != WS_VERSION )
+	{
+		WS_close(workspace);
+		return ERR_WORKSPACE_VERSION;
+	}
+	if ( header->numEntries >
+		(length - sizeof(WorkspaceHeader)) / sizeof(WorkspaceEntry) )
+	{
+		WS_close(workspace);
+		return ERR_WORKSPACE_FORMAT;
+	}
+	WorkspaceEntry *entries = (WorkspaceEntry *)(base + sizeof(WorkspaceHeader));
+	for (uint32_t e = 0; e < header->numEntries; e++)
+	{
+		WorkspaceEntry *entry = &entries[e];
+		uint64_t dataSize = sizeof(Rational);
+		uint64_t keyEnd;
+		/* Sizes and offsets come from the file, so any of them may be large
+		   enough to wrap around. */
+		if ( entry->valueType == VT_MATRIX )
+		{
+			if ( __builtin_mul_overflow(dataSize, (uint64_t)entry->numRows,
+				&dataSize) ||
+				__builtin_mul_overflow(dataSize, (uint64_t)entry->numCols,
+				&dataSize) )
+			{
+				WS_close(workspace);
+				return ERR_WORKSPACE_FORMAT;
+			}
+		}
+		else if ( entry->valueType != VT_RATIONAL )
+		{
+			WS_close(workspace);
+			return ERR_WORKSPACE_FORMAT;
+		}
+		if ( __builtin_add_overflow(entry->keyOffset, (uint64_t)entry->keyLength,
+			&keyEnd) || keyEnd >= length || base[keyEnd] != '\0' ||
+			entry->dataOffset % WS_ALIGNMENT ||
+			entry->dataOffset > length || dataSize > length - entry->dataOffset )
+		{
+			WS_close(workspace);
+			return ERR_WORKSPACE_FORMAT;
+		}
+	}
+	/* Add each variable. Matrices are added as a Matrix struct whose elements
+	   point into the mapping, so nothing is copied. */
+	for (uint32_t e = 0; e < header->numEntries; e++)
+	{
+		WorkspaceEntry *entry = &entries[e];
+		char *key = base + entry->keyOffset;
+		int error;
+		if ( entry->valueType == VT_MATRIX )
+		{
+			Matrix m;
+			m.numRows = entry->numRows;
+			m.numCols = entry->numCols;
+			m.elements = (Rational *)(base + entry->dataOffset);
+			m.contentHash = entry->contentHash;
+			m.isInteger = (entry->flags & WS_FLAG_INTEGER) != 0;
+			m.isBorrowed = true;
+			error = HT_add(table, key, &m, VT_MATRIX);
+		}
+		else
+		{
+			error = HT_add(table, key, base + entry->dataOffset, VT_RATIONAL);
+		}
+		if ( error )
+		{
+			return error;
+		}
+	}
+	return 0;
+}
+
+/**
+@fn WS_close
+@brief Unmaps a workspace file loaded by WS_load.
+@param workspace Pointer to the Workspace to close.
+*/
+void WS_close (Workspace *workspace)
+{
+	if ( workspace->base )
+	{
+		munmap(workspace->base, workspace->length);
+	}
+	workspace->base = NULL;
+	workspace->length = 0;
+}
\ No newline at end of file
@@ -0,0 +1,127 @@
+/**
+@file Workspace.h
+@author Rob Thomas
+@brief Contains functions for saving the variables of a HashTable to a binary
+workspace file and loading them back. Matrix elements are stored at aligned
+offsets in the file, and loading maps the file into memory so that matrices
+are used in place and their pages are only read from disk when first touched.
+*/
+
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+/*** INCLUDES: ***/
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "HashTable.h"
+
+/*** DEFINES: ***/
+#define WS_MAGIC "MSWS"
+#define WS_VERSION 2
+#define WS_BYTE_ORDER_MARK 0x01020304
+#define WS_ALIGNMENT 64
+#define WS_FLAG_INTEGER 0x1
+
+#define ERR_WORKSPACE_IO -40
+#define ERR_WORKSPACE_FORMAT -41
+#define ERR_WORKSPACE_VERSION -42
+
+/*** STRUCTS: ***/
+
+/**
+@def WorkspaceHeader
+@brief A struct representing the header at the start of a workspace file.
+@var magic The characters WS_MAGIC, identifying the file as a workspace.
+@var version The version of the format the file was written in.
+@var byteOrderMark WS_BYTE_ORDER_MARK as written by the saving machine. Files
+written with a different byte order are rejected.
+@var numEntries The number of variables in the file.
+@var fileSize The total size of the file in bytes.
+*/
+typedef struct
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t byteOrderMark;
+	uint32_t numEntries;
+	uint64_t fileSize;
+} WorkspaceHeader;
+
+/**
+@def WorkspaceEntry
+@brief A struct representing one variable in a workspace file. The list of
+entries directly follows the header.
+@var keyOffset The offset in the file of the variable's null-terminated key.
+@var dataOffset The offset in the file of the variable's value. For a Matrix
+this is its element buffer, aligned to WS_ALIGNMENT bytes. For a Rational it is
+the Rational itself.
+@var contentHash The content hash of a Matrix, so that it does not have to be
+recomputed (and every page faulted in) on load.
+@var keyLength The length of the key, not including its null terminator.
+@var valueType The type of the variable. See definition of value_t.
+@var numRows The number of rows of a Matrix.
+@var numCols The number of columns of a Matrix.
+@var flags WS_FLAG_INTEGER if the Matrix's isInteger flag was set, which is
+likewise stored so that it does not have to be recomputed on load.
+@var reserved Unused. Written as 0.
+*/
+typedef struct
+{
+	uint64_t keyOffset;
+	uint64_t dataOffset;
+	uint64_t contentHash;
+	uint32_t keyLength;
+	uint32_t valueType;
+	uint32_t numRows;
+	uint32_t numCols;
+	uint32_t flags;
+	uint32_t reserved;
+} WorkspaceEntry;
+
+/**
+@def Workspace
+@brief A struct representing a loaded workspace file.
+@var base The address the file is mapped at.
+@var length The length of the mapping in bytes.
+*/
+typedef struct
+{
+	void *base;
+	size_t length;
+} Workspace;
+
+/*** FUNCTION PROTOTYPES: ***/
+
+/**
+@fn WS_save
+@brief Writes every variable in a HashTable to a workspace file, except for
+tiled matrices, which already live in their own files.
+@param table Pointer to the HashTable whose variables will be saved.
+@param path The path of the file to write.
+@return An error code. 0 if no problems were encountered.
+*/
+int WS_save (HashTable *table, const char *path);
+
+/**
+@fn WS_load
+@brief Maps a workspace file into memory and adds each of its variables to a
+HashTable. The element buffers of loaded matrices point directly into the
+mapping, which is private, so writes to them never reach the file.
+NOTE: the loaded matrices are only valid until WS_close is called, so the
+table must be freed (or those variables overwritten) first.
+@param table Pointer to the HashTable the variables will be added to.
+@param path The path of the file to load.
+@param workspace Pointer to a Workspace which will describe the mapping.
+@return An error code. 0 if no problems were encountered.
+*/
+int WS_load (HashTable *table, const char *path, Workspace *workspace);
+
+/**
+@fn WS_close
+@brief Unmaps a workspace file loaded by WS_load.
+@param workspace Pointer to the Workspace to close.
+*/
+void WS_close (Workspace *workspace);
+
+#endif /* WORKSPACE_H */
\ No newline at end of file
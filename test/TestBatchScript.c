@@ -0,0 +1,311 @@
+/**
+@file TestBatchScript.c
+@author Rob Thomas
+@brief Contains Unity functions for testing the functionality of BatchScript.c
+and OutputBuffer.c.
+*/
+
+/*** INCLUDES: ***/
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "unity.h"
+#include "BatchScript.h"
+#include "HashTable.h"
+#include "Matrix.h"
+#include "OutputBuffer.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define TEST_PATH_LENGTH 64
+#define TEST_OUTPUT_SIZE 4096
+
+/*** GLOBALS: ***/
+static char outputPath[TEST_PATH_LENGTH];
+static char scriptPaths[2][TEST_PATH_LENGTH];
+static int outputFd;
+static char output[TEST_OUTPUT_SIZE];
+
+/*** FUNCTION DEFINITIONS: ***/
+
+void setUp ()
+{
+	strcpy(outputPath, "/tmp/test_batchscript_XXXXXX");
+	outputFd = mkstemp(outputPath);
+	TEST_ASSERT_TRUE(outputFd >= 0);
+	for (int i = 0; i < 2; i++)
+	{
+		strcpy(scriptPaths[i], "/tmp/test_batchscript_XXXXXX");
+		int fd = mkstemp(scriptPaths[i]);
+		TEST_ASSERT_TRUE(fd >= 0);
+		close(fd);
+	}
+}
+
+void tearDown ()
+{
+	close(outputFd);
+	unlink(outputPath);
+	unlink(scriptPaths[0]);
+	unlink(scriptPaths[1]);
+}
+
+/**
+@fn readOutput
+@brief Reads everything written to the output file so far into output, as a
+null-terminated string.
+*/
+static void readOutput ()
+{
+	ssize_t length = pread(outputFd, output, TEST_OUTPUT_SIZE - 1, 0);
+	output[length > 0 ? length : 0] = '\0';
+}
+
+/**
+@fn runScript
+@brief Runs a null-terminated script in a session.
+@param session Pointer to the BatchSession.
+@param text The script.
+@return The error code returned by BS_runText().
+*/
+static int runScript (BatchSession *session, const char *text)
+{
+	return BS_runText(session, text, strlen(text));
+}
+
+/**
+@fn writeScript
+@brief Replaces the contents of a script file.
+@param path The path of the file.
+@param text The script.
+*/
+static void writeScript (const char *path, const char *text)
+{
+	FILE *file = fopen(path, "w");
+	TEST_ASSERT_NOT_NULL(file);
+	fputs(text, file);
+	fclose(file);
+}
+
+/**
+@fn test_BS_runText
+@brief Tests the functionality of BS_runText() on assignments and prints.
+@details Verifies Matrix literals, sums of Rational and Matrix terms, comments,
+blank lines and the text which print writes.
+*/
+void test_BS_runText ()
+{
+	BatchSession *session = BS_new(0, outputFd);
+	TEST_ASSERT_NOT_NULL(session);
+	TEST_ASSERT_EQUAL_INT(0, runScript(session,
+		"A = [1 2; 3 4]  # a comment\n"
+		"\n"
+		"B = [1, -1; 1/2 0]\n"
+		"c = 1/2 - 3 * 2/3\n"
+		"D = 2 * A * B - c * A\n"
+		"print c\n"
+		"print D"));
+	TEST_ASSERT_EQUAL_INT(0, OB_flush(&session->out));
+	readOutput();
+	/* c = -3/2 and D = 2AB + 3/2 A. */
+	TEST_ASSERT_EQUAL_STRING("c = -3/2\nD =\n11/2 1\n29/2 0\n", output);
+
+	/* Variables survive between scripts run in the same session. */
+	TEST_ASSERT_EQUAL_INT(0, runScript(session, "E = -D + D\nprint E\n"));
+	TEST_ASSERT_EQUAL_INT(0, OB_flush(&session->out));
+	readOutput();
+	TEST_ASSERT_NOT_NULL(strstr(output, "E =\n0 0\n0 0\n"));
+	TEST_ASSERT_EQUAL_INT(0, BS_free(session));
+}
+
+/**
+@fn test_BS_chain
+@brief Tests terms which multiply three or more matrices.
+@details Verifies the product of a chain against the same product taken two
+matrices at a time, with a coefficient and in a sum, and that chains whose
+shapes do not line up are rejected.
+*/
+void test_BS_chain ()
+{
+	BatchSession *session = BS_new(0, outputFd);
+	TEST_ASSERT_EQUAL_INT(0, runScript(session,
+		"A = [1 2 0; 0 1 -1]\n"
+		"B = [1 0; 2 1; 0 3]\n"
+		"C = [1 1 1; 0 -1 2]\n"
+		"v = [1; 1/2; -1]\n"
+		"AB = A * B\n"
+		"ABC = AB * C\n"
+		"X = A * B * C * v\n"
+		"Y = ABC * v\n"
+		"Z = 1/3 * A * 3 * B * C - 2 * ABC + A * B * C\n"
+		"print X"));
+	HashTable *table = session->table;
+	Matrix *x = (Matrix *)HT_get(table, "X", NULL);
+	Matrix *y = (Matrix *)HT_get(table, "Y", NULL);
+	Matrix *z = (Matrix *)HT_get(table, "Z", NULL);
+	TEST_ASSERT_NOT_NULL(x);
+	TEST_ASSERT_EQUAL_UINT(2, x->numRows);
+	TEST_ASSERT_EQUAL_UINT(1, x->numCols);
+	for (unsigned int i = 0; i < 2; i++)
+	{
+		TEST_ASSERT_EQUAL_INT32(M_AT(y, i, 0).top, M_AT(x, i, 0).top);
+		TEST_ASSERT_EQUAL_INT32(M_AT(y, i, 0).bottom, M_AT(x, i, 0).bottom);
+		for (unsigned int j = 0; j < 3; j++)
+		{
+			TEST_ASSERT_EQUAL_INT32(0, M_AT(z, i, j).top);
+		}
+	}
+	TEST_ASSERT_EQUAL_INT(0, OB_flush(&session->out));
+	readOutput();
+	/* ABC = [5 3 9; 2 4 -2], so X = [-5/2; 6]. */
+	TEST_ASSERT_EQUAL_STRING("X =\n-5/2\n6\n", output);
+
+	TEST_ASSERT_EQUAL_INT(ERR_DIMENSION_MISMATCH, runScript(session,
+		"W = A * B * v"));
+	TEST_ASSERT_EQUAL_INT(1, session->errorLine);
+	TEST_ASSERT_NULL(HT_get(table, "W", NULL));
+	TEST_ASSERT_EQUAL_INT(0, BS_free(session));
+}
+
+/**
+@fn test_BS_fullTable
+@brief Tests scripts which fill the session's table.
+@details The assignment which fills the table must succeed and keep its
+buffer, whether it is a literal or an expression, and the next new variable
+must be rejected without disturbing the others.
+*/
+void test_BS_fullTable ()
+{
+	BatchSession *session = BS_new(2, outputFd);
+	TEST_ASSERT_EQUAL_INT(0, runScript(session, "v0 = [1 2]\nv2 = [3 4]\n"));
+	TEST_ASSERT_EQUAL_INT(FAIL_TABLE_FULL, runScript(session, "v3 = [5 6]"));
+	TEST_ASSERT_EQUAL_INT(1, session->errorLine);
+	Matrix *reused = M_new(1, 2);
+	M_AT(reused, 0, 0) = (Rational){99, 1};
+	Matrix *v2 = (Matrix *)HT_get(session->table, "v2", NULL);
+	TEST_ASSERT_NOT_NULL(v2);
+	TEST_ASSERT_EQUAL_INT32(3, M_AT(v2, 0, 0).top);
+	TEST_ASSERT_EQUAL_INT32(4, M_AT(v2, 0, 1).top);
+	M_free(reused);
+	TEST_ASSERT_EQUAL_INT(0, BS_free(session));
+
+	session = BS_new(2, outputFd);
+	TEST_ASSERT_EQUAL_INT(0, runScript(session, "v0 = [1 2]\nv2 = 3 * v0\n"));
+	reused = M_new(1, 2);
+	M_AT(reused, 0, 0) = (Rational){99, 1};
+	v2 = (Matrix *)HT_get(session->table, "v2", NULL);
+	TEST_ASSERT_NOT_NULL(v2);
+	TEST_ASSERT_EQUAL_INT32(3, M_AT(v2, 0, 0).top);
+	M_free(reused);
+	TEST_ASSERT_EQUAL_INT(0, BS_free(session));
+}
+
+/**
+@fn test_BS_errors
+@brief Tests the errors reported by BS_runText() and the line they are
+reported on.
+*/
+void test_BS_errors ()
+{
+	BatchSession *session = BS_new(0, outputFd);
+	TEST_ASSERT_EQUAL_INT(0, runScript(session, "A = [1 2; 3 4]\nr = 5"));
+	TEST_ASSERT_EQUAL_INT(0, session->errorLine);
+
+	TEST_ASSERT_EQUAL_INT(ERR_SCRIPT_UNDEFINED, runScript(session,
+		"B = A\nC = A + missing\n"));
+	TEST_ASSERT_EQUAL_INT(2, session->errorLine);
+	TEST_ASSERT_NOT_NULL(HT_get(session->table, "B", NULL));
+	TEST_ASSERT_EQUAL_INT(ERR_SCRIPT_TYPE, runScript(session, "C = A + r"));
+	TEST_ASSERT_EQUAL_INT(ERR_SCRIPT_SYNTAX, runScript(session, "C = A +"));
+	TEST_ASSERT_EQUAL_INT(ERR_SCRIPT_SYNTAX, runScript(session, "C = 1/0"));
+	TEST_ASSERT_EQUAL_INT(ERR_SCRIPT_SYNTAX, runScript(session, "show A"));
+	TEST_ASSERT_EQUAL_INT(ERR_SCRIPT_SYNTAX, runScript(session,
+		"C = [1 2; 3"));
+	TEST_ASSERT_EQUAL_INT(ERR_DIMENSION_MISMATCH, runScript(session,
+		"C = [1 2; 3]"));
+	TEST_ASSERT_EQUAL_INT(ERR_SCRIPT_SYNTAX, runScript(session,
+		"C = [1 2 3] + A"));
+	TEST_ASSERT_EQUAL_INT(ERR_SCRIPT_UNDEFINED, runScript(session,
+		"print C"));
+	TEST_ASSERT_EQUAL_INT(0, BS_free(session));
+}
+
+/**
+@fn test_BS_runBatch
+@brief Tests the functionality of BS_runBatch().
+@details Verifies that each script starts from an empty table, that a failing
+script is counted without stopping the batch, and that the output of every
+script is written in order.
+*/
+void test_BS_runBatch ()
+{
+	writeScript(scriptPaths[0], "a = 2\nprint a\nprint missing\n");
+	writeScript(scriptPaths[1], "b = 3\nprint b\nprint a\n");
+	BatchSession *session = BS_new(0, outputFd);
+	char *paths[] = {scriptPaths[0], scriptPaths[1], "/nonexistent/script"};
+	unsigned int numFailed;
+	TEST_ASSERT_EQUAL_INT(0, BS_runBatch(session, paths, 3, &numFailed));
+	TEST_ASSERT_EQUAL_UINT(3, numFailed);
+	readOutput();
+	TEST_ASSERT_EQUAL_STRING("a = 2\nb = 3\n", output);
+
+	writeScript(scriptPaths[1], "b = a\n");
+	TEST_ASSERT_EQUAL_INT(ERR_SCRIPT_UNDEFINED, BS_runFile(session,
+		scriptPaths[1]));
+	TEST_ASSERT_EQUAL_INT(ERR_SCRIPT_FILE, BS_runFile(session,
+		"/nonexistent/script"));
+	TEST_ASSERT_EQUAL_INT(0, BS_free(session));
+}
+
+/**
+@fn test_OB_write
+@brief Tests the functionality of OutputBuffer.c.
+@details Uses the smallest buffer, so that matrices longer than it are written
+in several flushes, and verifies that nothing reaches the file before a flush.
+*/
+void test_OB_write ()
+{
+	OutputBuffer out;
+	TEST_ASSERT_EQUAL_INT(0, OB_init(&out, outputFd, 1));
+	TEST_ASSERT_EQUAL_size_t(R_FORMAT_MAX_LENGTH * 2, out.capacity);
+	OB_write(&out, "r = ", 4);
+	OB_writeRational(&out, (Rational){-7, 3});
+	OB_write(&out, "\n", 1);
+	readOutput();
+	TEST_ASSERT_EQUAL_STRING("", output);
+	TEST_ASSERT_EQUAL_INT(0, OB_flush(&out));
+	readOutput();
+	TEST_ASSERT_EQUAL_STRING("r = -7/3\n", output);
+
+	Matrix *m = M_new(4, 8);
+	char expected[TEST_OUTPUT_SIZE] = "r = -7/3\n";
+	for (unsigned int i = 0; i < m->numRows; i++)
+	{
+		for (unsigned int j = 0; j < m->numCols; j++)
+		{
+			M_AT(m, i, j) = (Rational){INT32_MIN + i, INT32_MAX - j};
+			char entry[64];
+			snprintf(entry, sizeof(entry), "%d/%d%c", INT32_MIN + (int)i,
+				INT32_MAX - (int)j, j + 1 < m->numCols ? ' ' : '\n');
+			strcat(expected, entry);
+		}
+	}
+	TEST_ASSERT_EQUAL_INT(0, OB_writeMatrix(&out, m));
+	TEST_ASSERT_EQUAL_INT(0, OB_close(&out));
+	readOutput();
+	TEST_ASSERT_EQUAL_STRING(expected, output);
+	M_free(m);
+}
+
+int main ()
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_BS_runText);
+	RUN_TEST(test_BS_chain);
+	RUN_TEST(test_BS_fullTable);
+	RUN_TEST(test_BS_errors);
+	RUN_TEST(test_BS_runBatch);
+	RUN_TEST(test_OB_write);
+	return UNITY_END();
+}
\ No newline at end of file
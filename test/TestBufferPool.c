@@ -0,0 +1,178 @@
+/**
+@file TestBufferPool.c
+@author Rob Thomas
+@brief Contains Unity functions for testing the functionality of BufferPool.c.
+*/
+
+/*** INCLUDES: ***/
+#include <string.h>
+#include <pthread.h>
+
+#include "unity.h"
+#include "BufferPool.h"
+
+/*** DEFINES: ***/
+#define TEST_NUM_BUFFERS 4
+#define TEST_BUFFER_SIZE 1000
+
+/*** GLOBALS: ***/
+static void *threadBuffers[TEST_NUM_BUFFERS];
+
+/*** FUNCTION DEFINITIONS: ***/
+
+void setUp ()
+{
+	BP_trim();
+	BP_resetStats();
+}
+
+void tearDown ()
+{
+	BP_trim();
+}
+
+/**
+@fn allocBuffers
+@brief A thread function which allocates TEST_NUM_BUFFERS buffers into
+threadBuffers, releases one and exits.
+@param unused Unused.
+@return NULL.
+*/
+static void *allocBuffers (void *unused)
+{
+	(void)unused;
+	for (int i = 0; i < TEST_NUM_BUFFERS; i++)
+	{
+		threadBuffers[i] = BP_alloc(TEST_BUFFER_SIZE);
+		memset(threadBuffers[i], i, TEST_BUFFER_SIZE);
+	}
+	BP_release(BP_alloc(TEST_BUFFER_SIZE));
+	return NULL;
+}
+
+/**
+@fn test_BP_alloc
+@brief Tests the functionality of BP_alloc(), BP_release() and BP_resize().
+@details Verifies alignment, capacities, reuse of released buffers, that
+resizing keeps the contents, and the statistics which follow.
+*/
+void test_BP_alloc ()
+{
+	TEST_ASSERT_NULL(BP_alloc(0));
+	char *a = (char *)BP_alloc(100);
+	TEST_ASSERT_NOT_NULL(a);
+	TEST_ASSERT_EQUAL_UINT(0, (uintptr_t)a % BP_ALIGNMENT);
+	TEST_ASSERT_EQUAL_size_t(128, BP_capacity(a));
+	memset(a, 7, 100);
+
+	char *b = (char *)BP_resize(a, 120);
+	TEST_ASSERT_EQUAL_PTR(a, b);
+	b = (char *)BP_resize(a, 300);
+	TEST_ASSERT_NOT_NULL(b);
+	TEST_ASSERT_EQUAL_size_t(512, BP_capacity(b));
+	for (int i = 0; i < 100; i++)
+	{
+		TEST_ASSERT_EQUAL_INT(7, b[i]);
+	}
+
+	/* The buffer given up by the resize is reused for the next of its size. */
+	char *c = (char *)BP_alloc(128);
+	TEST_ASSERT_EQUAL_PTR(a, c);
+	BP_Stats stats;
+	BP_getStats(&stats);
+	TEST_ASSERT_EQUAL_UINT64(3, stats.allocations);
+	TEST_ASSERT_EQUAL_UINT64(1, stats.reuses);
+	TEST_ASSERT_EQUAL_UINT64(1, stats.releases);
+	TEST_ASSERT_EQUAL_INT64(512 + 128, stats.bytesInUse);
+	TEST_ASSERT_EQUAL_INT64(0, stats.bytesCached);
+	TEST_ASSERT_EQUAL_INT64(512 + 128, stats.peakBytesInUse);
+
+	BP_release(b);
+	BP_release(c);
+	BP_release(NULL);
+	BP_getStats(&stats);
+	TEST_ASSERT_EQUAL_INT64(0, stats.bytesInUse);
+	TEST_ASSERT_EQUAL_INT64(512 + 128, stats.bytesCached);
+	BP_trim();
+	BP_getStats(&stats);
+	TEST_ASSERT_EQUAL_INT64(0, stats.bytesCached);
+}
+
+/**
+@fn test_BP_release_otherThread
+@brief Tests releasing buffers on a different thread than the one which
+allocated them.
+@details Buffers allocated by a thread which has since exited are released on
+this thread. The byte totals must return to where they started instead of
+going negative here, and the buffers must be reused by this thread.
+*/
+void test_BP_release_otherThread ()
+{
+	BP_Stats before;
+	BP_getStats(&before);
+	pthread_t thread;
+	TEST_ASSERT_EQUAL_INT(0, pthread_create(&thread, NULL, allocBuffers, NULL));
+	pthread_join(thread, NULL);
+
+	BP_Stats stats;
+	BP_getStats(&stats);
+	size_t capacity = BP_capacity(threadBuffers[0]);
+	TEST_ASSERT_EQUAL_INT64(before.bytesInUse + TEST_NUM_BUFFERS * capacity,
+		stats.bytesInUse);
+	/* The exiting thread trimmed the buffer it had cached. */
+	TEST_ASSERT_EQUAL_INT64(before.bytesCached, stats.bytesCached);
+	TEST_ASSERT_EQUAL_UINT64(0, stats.allocations);
+
+	for (int i = 0; i < TEST_NUM_BUFFERS; i++)
+	{
+		TEST_ASSERT_EQUAL_INT(i, ((unsigned char *)threadBuffers[i])[0]);
+		BP_release(threadBuffers[i]);
+	}
+	BP_getStats(&stats);
+	TEST_ASSERT_EQUAL_INT64(before.bytesInUse, stats.bytesInUse);
+	TEST_ASSERT_EQUAL_INT64(before.bytesCached + TEST_NUM_BUFFERS * capacity,
+		stats.bytesCached);
+	TEST_ASSERT_EQUAL_UINT64(TEST_NUM_BUFFERS, stats.releases);
+
+	void *reused = BP_alloc(TEST_BUFFER_SIZE);
+	TEST_ASSERT_EQUAL_PTR(threadBuffers[TEST_NUM_BUFFERS - 1], reused);
+	BP_release(reused);
+}
+
+/**
+@fn test_BP_alloc_hugePages
+@brief Tests buffers mapped with transparent huge pages.
+@details Each buffer must start on a huge page boundary and be writable up to
+its capacity, which for a class of n huge pages is exactly n huge pages, and
+must be unmapped cleanly when the pool is trimmed.
+*/
+void test_BP_alloc_hugePages ()
+{
+	BP_setHugePages(true);
+	for (size_t pages = 1; pages <= 2; pages++)
+	{
+		size_t size = pages * BP_HUGE_PAGE_SIZE;
+		char *buffer = (char *)BP_alloc(size);
+		TEST_ASSERT_NOT_NULL(buffer);
+		TEST_ASSERT_EQUAL_UINT64(0, (uintptr_t)buffer % BP_HUGE_PAGE_SIZE);
+		TEST_ASSERT_EQUAL_size_t(size, BP_capacity(buffer));
+		memset(buffer, (int)pages, size);
+		TEST_ASSERT_EQUAL_INT((int)pages, buffer[size - 1]);
+		BP_release(buffer);
+		BP_trim();
+	}
+	BP_setHugePages(false);
+	BP_Stats stats;
+	BP_getStats(&stats);
+	TEST_ASSERT_EQUAL_UINT64(2, stats.hugePageBuffers);
+	TEST_ASSERT_EQUAL_INT64(0, stats.bytesInUse);
+}
+
+int main ()
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_BP_alloc);
+	RUN_TEST(test_BP_release_otherThread);
+	RUN_TEST(test_BP_alloc_hugePages);
+	return UNITY_END();
+}
\ No newline at end of file
@@ -0,0 +1,269 @@
+/**
+@file TestCharPoly.c
+@author Rob Thomas
+@brief Contains Unity functions for testing the functionality of CharPoly.c.
+*/
+
+/*** INCLUDES: ***/
+#include "unity.h"
+#include "CharPoly.h"
+#include "LinearSolve.h"
+#include "Matrix.h"
+#include "Random.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define TEST_SIZE 12
+#define TEST_MAX_ENTRY 3
+#define TEST_THREADS 4
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn randomMatrix
+@brief Creates a square Matrix of small random integers.
+@param n The number of rows and columns.
+@return A pointer to the new Matrix.
+*/
+static Matrix *randomMatrix (unsigned int n)
+{
+	int error;
+	Matrix *m = M_new(n, n);
+	for (size_t i = 0; i < (size_t)n * n; i++)
+	{
+		m->elements[i].top = Random_in_range(-TEST_MAX_ENTRY, TEST_MAX_ENTRY,
+			&error);
+	}
+	M_rehash(m);
+	return m;
+}
+
+/**
+@fn fromIntegers
+@brief Creates a square Matrix from integer entries given row by row.
+@param n The number of rows and columns.
+@param entries The n * n entries.
+@return A pointer to the new Matrix.
+*/
+static Matrix *fromIntegers (unsigned int n, const int32_t *entries)
+{
+	Matrix *m = M_new(n, n);
+	for (size_t i = 0; i < (size_t)n * n; i++)
+	{
+		m->elements[i] = (Rational){entries[i], 1};
+	}
+	M_rehash(m);
+	return m;
+}
+
+/**
+@fn assertRational
+@brief Asserts that a Rational equals top/bottom.
+@param top The expected top.
+@param bottom The expected bottom.
+@param r The Rational to check.
+*/
+static void assertRational (int32_t top, int32_t bottom, Rational r)
+{
+	TEST_ASSERT_EQUAL_INT32(top, r.top);
+	TEST_ASSERT_EQUAL_INT32(bottom, r.bottom);
+}
+
+/**
+@fn test_CP_charPoly
+@brief Tests the functionality of CP_charPoly() on matrices whose polynomials
+are known.
+@details A triangular Matrix with fractions has the product of (x - d) over
+its diagonal d as its polynomial, whatever lies above the diagonal.
+*/
+void test_CP_charPoly ()
+{
+	int32_t entries[4] = {2, 1, 1, 3};
+	Matrix *a = fromIntegers(2, entries);
+	Rational coefficients[TEST_SIZE + 1];
+	TEST_ASSERT_EQUAL_INT(0, CP_charPoly(a, 1, coefficients));
+	assertRational(1, 1, coefficients[0]);
+	assertRational(-5, 1, coefficients[1]);
+	assertRational(5, 1, coefficients[2]);
+	M_free(a);
+
+	/* Diagonal 1/2, 2, -3 gives x^3 + 1/2 x^2 - 13/2 x + 3. */
+	a = M_new(3, 3);
+	M_AT(a, 0, 0) = (Rational){1, 2};
+	M_AT(a, 0, 1) = (Rational){5, 7};
+	M_AT(a, 0, 2) = (Rational){-4, 1};
+	M_AT(a, 1, 1) = (Rational){2, 1};
+	M_AT(a, 1, 2) = (Rational){1, 3};
+	M_AT(a, 2, 2) = (Rational){-3, 1};
+	M_rehash(a);
+	TEST_ASSERT_EQUAL_INT(0, CP_charPoly(a, TEST_THREADS, coefficients));
+	assertRational(1, 1, coefficients[0]);
+	assertRational(1, 2, coefficients[1]);
+	assertRational(-13, 2, coefficients[2]);
+	assertRational(3, 1, coefficients[3]);
+	M_free(a);
+}
+
+/**
+@fn test_CP_charPoly_random
+@brief Tests CP_charPoly() on random matrices.
+@details The result must not depend on the number of threads, the second
+coefficient must be minus the trace, and the last must be (-1)^n times the
+determinant found by LinearSolve.
+*/
+void test_CP_charPoly_random ()
+{
+	for (unsigned int n = 1; n <= TEST_SIZE; n++)
+	{
+		Matrix *a = randomMatrix(n);
+		Rational serial[TEST_SIZE + 1];
+		Rational parallel[TEST_SIZE + 1];
+		TEST_ASSERT_EQUAL_INT(0, CP_charPoly(a, 1, serial));
+		TEST_ASSERT_EQUAL_INT(0, CP_charPoly(a, TEST_THREADS, parallel));
+		for (unsigned int k = 0; k <= n; k++)
+		{
+			assertRational(serial[k].top, serial[k].bottom, parallel[k]);
+		}
+
+		int32_t trace = 0;
+		for (unsigned int i = 0; i < n; i++)
+		{
+			trace += M_AT(a, i, i).top;
+		}
+		assertRational(-trace, 1, serial[1]);
+
+		Rational det = {0, 1};
+		LS_Factorization *f;
+		if ( !LS_factor(a, &f) )
+		{
+			TEST_ASSERT_EQUAL_INT(0, LS_determinant(f, &det));
+			LS_free(f);
+		}
+		assertRational(n % 2 ? -det.top : det.top, det.bottom, serial[n]);
+		M_free(a);
+	}
+}
+
+/**
+@fn test_CP_charPoly_overflow
+@brief Tests that CP_charPoly() reports coefficients which do not fit in a
+Rational.
+*/
+void test_CP_charPoly_overflow ()
+{
+	Matrix *a = M_new(4, 4);
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		M_AT(a, i, i) = (Rational){1 << 20, 1};
+	}
+	M_rehash(a);
+	Rational coefficients[5];
+	TEST_ASSERT_EQUAL_INT(ERR_CHARPOLY_OVERFLOW, CP_charPoly(a, 1,
+		coefficients));
+	M_free(a);
+}
+
+/**
+@fn test_CP_tracePowers
+@brief Tests the functionality of CP_tracePowers().
+@details Compares the traces against powers of the Matrix formed directly.
+*/
+void test_CP_tracePowers ()
+{
+	unsigned int n = 5, count = 4;
+	Matrix *a = randomMatrix(n);
+	Rational traces[4];
+	TEST_ASSERT_EQUAL_INT(0, CP_tracePowers(a, count, TEST_THREADS, traces));
+
+	int64_t power[5][5], next[5][5];
+	for (unsigned int i = 0; i < n; i++)
+	{
+		for (unsigned int j = 0; j < n; j++)
+		{
+			power[i][j] = M_AT(a, i, j).top;
+		}
+	}
+	for (unsigned int k = 0; k < count; k++)
+	{
+		int64_t trace = 0;
+		for (unsigned int i = 0; i < n; i++)
+		{
+			trace += power[i][i];
+		}
+		assertRational((int32_t)trace, 1, traces[k]);
+		for (unsigned int i = 0; i < n; i++)
+		{
+			for (unsigned int j = 0; j < n; j++)
+			{
+				next[i][j] = 0;
+				for (unsigned int l = 0; l < n; l++)
+				{
+					next[i][j] += power[i][l] * M_AT(a, l, j).top;
+				}
+			}
+		}
+		for (unsigned int i = 0; i < n; i++)
+		{
+			for (unsigned int j = 0; j < n; j++)
+			{
+				power[i][j] = next[i][j];
+			}
+		}
+	}
+	M_free(a);
+}
+
+/**
+@fn test_CP_minPoly
+@brief Tests the functionality of CP_minPoly().
+@details A Matrix with a repeated eigenvalue and a full set of eigenvectors
+has a minimal polynomial of lower degree than its characteristic polynomial,
+while a Jordan block does not.
+*/
+void test_CP_minPoly ()
+{
+	Rational coefficients[5];
+	unsigned int degree;
+
+	/* diag(2, 2, 3) has minimal polynomial (x - 2)(x - 3). */
+	int32_t diagonal[9] = {2, 0, 0, 0, 2, 0, 0, 0, 3};
+	Matrix *a = fromIntegers(3, diagonal);
+	TEST_ASSERT_EQUAL_INT(0, CP_minPoly(a, TEST_THREADS, coefficients,
+		&degree));
+	TEST_ASSERT_EQUAL_UINT(2, degree);
+	assertRational(1, 1, coefficients[0]);
+	assertRational(-5, 1, coefficients[1]);
+	assertRational(6, 1, coefficients[2]);
+	M_free(a);
+
+	/* The identity has minimal polynomial x - 1. */
+	int32_t identity[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+	a = fromIntegers(4, identity);
+	TEST_ASSERT_EQUAL_INT(0, CP_minPoly(a, 1, coefficients, &degree));
+	TEST_ASSERT_EQUAL_UINT(1, degree);
+	assertRational(1, 1, coefficients[0]);
+	assertRational(-1, 1, coefficients[1]);
+	M_free(a);
+
+	/* A Jordan block for 2 has minimal polynomial (x - 2)^3. */
+	int32_t jordan[9] = {2, 1, 0, 0, 2, 1, 0, 0, 2};
+	a = fromIntegers(3, jordan);
+	TEST_ASSERT_EQUAL_INT(0, CP_minPoly(a, 1, coefficients, &degree));
+	TEST_ASSERT_EQUAL_UINT(3, degree);
+	assertRational(1, 1, coefficients[0]);
+	assertRational(-6, 1, coefficients[1]);
+	assertRational(12, 1, coefficients[2]);
+	assertRational(-8, 1, coefficients[3]);
+	M_free(a);
+}
+
+int main ()
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_CP_charPoly);
+	RUN_TEST(test_CP_charPoly_random);
+	RUN_TEST(test_CP_charPoly_overflow);
+	RUN_TEST(test_CP_tracePowers);
+	RUN_TEST(test_CP_minPoly);
+	return UNITY_END();
+}
\ No newline at end of file
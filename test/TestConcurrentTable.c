@@ -0,0 +1,244 @@
+/**
+@file TestConcurrentTable.c
+@author Rob Thomas
+@brief Contains Unity functions for testing the functionality of
+ConcurrentTable.c.
+*/
+
+/*** INCLUDES: ***/
+#include <stdio.h>
+#include <pthread.h>
+
+#include "unity.h"
+#include "BufferPool.h"
+#include "ConcurrentTable.h"
+#include "Matrix.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define TEST_KEYS 32
+#define TEST_WRITES 20000
+#define TEST_READERS 4
+
+/*** STRUCTS: ***/
+
+/**
+@def ReaderArgs
+@brief A struct representing the arguments of one reading thread.
+@var table Pointer to the shared ConcurrentTable.
+@var numErrors The number of reads which saw a value older than one already
+seen for the same key, or a torn value.
+*/
+typedef struct
+{
+	ConcurrentTable *table;
+	int numErrors;
+} ReaderArgs;
+
+/*** GLOBALS: ***/
+static char keys[TEST_KEYS][16];
+static atomic_bool stopReading;
+
+/*** FUNCTION DEFINITIONS: ***/
+
+void setUp ()
+{
+	for (int i = 0; i < TEST_KEYS; i++)
+	{
+		snprintf(keys[i], sizeof(keys[i]), "v%d", i);
+	}
+}
+
+void tearDown ()
+{
+}
+
+/**
+@fn bytesInUse
+@brief Returns the capacity of the pool buffers currently handed out.
+@return The number of bytes.
+*/
+static int64_t bytesInUse ()
+{
+	BP_Stats stats;
+	BP_getStats(&stats);
+	return stats.bytesInUse;
+}
+
+/**
+@fn readKeys
+@brief Repeatedly reads every key of the shared table until stopReading is
+set, checking that each key's value only moves forwards and is never torn.
+Values are written as {n, n + 1}.
+@param arg Pointer to the thread's ReaderArgs.
+@return NULL.
+*/
+static void *readKeys (void *arg)
+{
+	ReaderArgs *args = (ReaderArgs *)arg;
+	int reader = CT_registerReader(args->table);
+	int32_t latest[TEST_KEYS] = {0};
+	while ( !atomic_load(&stopReading) )
+	{
+		for (int i = 0; i < TEST_KEYS; i++)
+		{
+			Rational r;
+			if ( !CT_get(args->table, reader, keys[i], &r, NULL) )
+			{
+				continue;
+			}
+			if ( r.bottom != r.top + 1 || r.top < latest[i] )
+			{
+				args->numErrors++;
+			}
+			latest[i] = r.top;
+		}
+	}
+	CT_unregisterReader(args->table, reader);
+	return NULL;
+}
+
+/**
+@fn test_CT_put
+@brief Tests the functionality of CT_put(), CT_get(), CT_find() and
+CT_remove().
+*/
+void test_CT_put ()
+{
+	ConcurrentTable *table = CT_new(5);
+	TEST_ASSERT_NOT_NULL(table);
+	TEST_ASSERT_EQUAL_UINT(8, table->numBuckets);
+	int reader = CT_registerReader(table);
+	TEST_ASSERT_TRUE(reader >= 0);
+
+	for (int i = 0; i < TEST_KEYS; i++)
+	{
+		Rational r = {i, 1};
+		TEST_ASSERT_EQUAL_INT(0, CT_put(table, keys[i], &r, VT_RATIONAL));
+	}
+	Rational r = {-3, 4};
+	TEST_ASSERT_EQUAL_INT(0, CT_put(table, keys[7], &r, VT_RATIONAL));
+	TEST_ASSERT_EQUAL_UINT(TEST_KEYS, atomic_load(&table->numItems));
+
+	Rational found;
+	value_t type;
+	TEST_ASSERT_TRUE(CT_get(table, reader, keys[7], &found, &type));
+	TEST_ASSERT_EQUAL_INT(VT_RATIONAL, type);
+	TEST_ASSERT_EQUAL_INT32(-3, found.top);
+	TEST_ASSERT_EQUAL_INT32(4, found.bottom);
+	TEST_ASSERT_TRUE(CT_get(table, reader, keys[20], &found, NULL));
+	TEST_ASSERT_EQUAL_INT32(20, found.top);
+
+	TEST_ASSERT_EQUAL_INT(0, CT_remove(table, keys[20]));
+	TEST_ASSERT_EQUAL_INT(FAIL_KEY_NOT_FOUND, CT_remove(table, keys[20]));
+	TEST_ASSERT_FALSE(CT_get(table, reader, keys[20], &found, NULL));
+	TEST_ASSERT_EQUAL_UINT(TEST_KEYS - 1, atomic_load(&table->numItems));
+
+	CT_readBegin(table, reader);
+	Rational *value = (Rational *)CT_find(table, keys[3], NULL);
+	TEST_ASSERT_NOT_NULL(value);
+	TEST_ASSERT_EQUAL_INT32(3, value->top);
+	TEST_ASSERT_NULL(CT_find(table, "missing", NULL));
+	CT_readEnd(table, reader);
+
+	CT_unregisterReader(table, reader);
+	CT_free(table);
+}
+
+/**
+@fn test_CT_put_matrix
+@brief Tests that Matrix element buffers are owned by the table.
+@details Verifies that CT_get returns a copy which outlives the table's value,
+that putting the same buffer again keeps it alive, and that replaced, removed
+and remaining buffers are all released by the time the table is freed.
+*/
+void test_CT_put_matrix ()
+{
+	int64_t before = bytesInUse();
+	ConcurrentTable *table = CT_new(16);
+	int reader = CT_registerReader(table);
+
+	Matrix *m = M_new(3, 3);
+	M_AT(m, 1, 2) = (Rational){5, 1};
+	M_rehash(m);
+	TEST_ASSERT_EQUAL_INT(0, CT_put(table, "A", m, VT_MATRIX));
+	/* Putting the same buffer again must not release it when the old node
+	   is reclaimed. */
+	TEST_ASSERT_EQUAL_INT(0, CT_put(table, "A", m, VT_MATRIX));
+	free(m);
+
+	Matrix copy;
+	TEST_ASSERT_TRUE(CT_get(table, reader, "A", &copy, NULL));
+
+	/* Replace and remove enough values for the retired nodes to be
+	   reclaimed. */
+	for (int i = 0; i < 2 * CT_RECLAIM_INTERVAL; i++)
+	{
+		Matrix *other = M_new(3, 3);
+		M_AT(other, 0, 0) = (Rational){i, 1};
+		TEST_ASSERT_EQUAL_INT(0, CT_put(table, "B", other, VT_MATRIX));
+		free(other);
+	}
+	TEST_ASSERT_EQUAL_INT(0, CT_remove(table, "B"));
+
+	Matrix again;
+	TEST_ASSERT_TRUE(CT_get(table, reader, "A", &again, NULL));
+	TEST_ASSERT_TRUE(again.elements != copy.elements);
+	TEST_ASSERT_EQUAL_INT32(5, M_AT(&again, 1, 2).top);
+	TEST_ASSERT_EQUAL_UINT64(again.contentHash, copy.contentHash);
+	BP_release(again.elements);
+
+	CT_unregisterReader(table, reader);
+	CT_free(table);
+	/* The copy was not released with the table. */
+	TEST_ASSERT_EQUAL_INT32(5, M_AT(&copy, 1, 2).top);
+	BP_release(copy.elements);
+	TEST_ASSERT_EQUAL_INT64(before, bytesInUse());
+}
+
+/**
+@fn test_CT_concurrent
+@brief Tests reading a ConcurrentTable while a writer replaces and removes its
+values.
+@details Every reader must only see whole values, and each key's value must
+never go backwards.
+*/
+void test_CT_concurrent ()
+{
+	ConcurrentTable *table = CT_new(TEST_KEYS);
+	atomic_store(&stopReading, false);
+	pthread_t threads[TEST_READERS];
+	ReaderArgs args[TEST_READERS];
+	for (int t = 0; t < TEST_READERS; t++)
+	{
+		args[t].table = table;
+		args[t].numErrors = 0;
+		TEST_ASSERT_EQUAL_INT(0, pthread_create(&threads[t], NULL, readKeys,
+			&args[t]));
+	}
+	for (int i = 1; i <= TEST_WRITES; i++)
+	{
+		Rational r = {i, i + 1};
+		CT_put(table, keys[i % TEST_KEYS], &r, VT_RATIONAL);
+		if ( i % 7 == 0 )
+		{
+			CT_remove(table, keys[(i + 3) % TEST_KEYS]);
+		}
+	}
+	atomic_store(&stopReading, true);
+	for (int t = 0; t < TEST_READERS; t++)
+	{
+		pthread_join(threads[t], NULL);
+		TEST_ASSERT_EQUAL_INT(0, args[t].numErrors);
+	}
+	CT_free(table);
+}
+
+int main ()
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_CT_put);
+	RUN_TEST(test_CT_put_matrix);
+	RUN_TEST(test_CT_concurrent);
+	return UNITY_END();
+}
\ No newline at end of file
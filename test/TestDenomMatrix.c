@@ -0,0 +1,206 @@
+/**
+@file TestDenomMatrix.c
+@author Rob Thomas
+@brief Contains Unity functions for testing the functionality of DenomMatrix.c.
+*/
+
+/*** INCLUDES: ***/
+#include <string.h>
+
+#include "unity.h"
+#include "DenomMatrix.h"
+#include "Matrix.h"
+#include "Random.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn fromRationals
+@brief Creates a DenomMatrix from a list of Rationals in row-major order.
+@param numRows The number of rows.
+@param numCols The number of columns.
+@param values The numRows * numCols elements.
+@return A pointer to the new DenomMatrix.
+*/
+static DenomMatrix *fromRationals (unsigned int numRows, unsigned int numCols,
+	Rational *values)
+{
+	Matrix *m = M_new(numRows, numCols);
+	memcpy(m->elements, values, sizeof(Rational) * numRows * numCols);
+	M_rehash(m);
+	DenomMatrix *dm = NULL;
+	DM_fromMatrix(m, &dm);
+	M_free(m);
+	return dm;
+}
+
+/**
+@fn test_DM_fromMatrix
+@brief Tests the functionality of DM_fromMatrix() and DM_toMatrix().
+@details Verifies that each row's denominator is the least common multiple of
+its bottoms and that converting back gives the original Matrix.
+*/
+void test_DM_fromMatrix ()
+{
+	Rational values[] = {{1, 2}, {-1, 3}, {5, 1}, {0, 1}, {7, 1}, {-2, 1}};
+	DenomMatrix *dm = fromRationals(2, 3, values);
+	TEST_ASSERT_NOT_NULL(dm);
+	TEST_ASSERT_EQUAL_INT64(6, dm->denominators[0]);
+	TEST_ASSERT_EQUAL_INT64(1, dm->denominators[1]);
+	TEST_ASSERT_EQUAL_INT64(-2, DM_NUMERATOR(dm, 0, 1));
+	Matrix *m = M_new(2, 3);
+	TEST_ASSERT_EQUAL_INT(0, DM_toMatrix(dm, m));
+	TEST_ASSERT_EQUAL_MEMORY(values, m->elements, sizeof(values));
+	M_free(m);
+	DM_free(dm);
+}
+
+/**
+@fn test_DM_set
+@brief Tests the functionality of DM_set() and DM_get().
+@details Verifies that setting an element whose bottom does not divide the
+row's denominator rescales the row, and that the other elements keep their
+values.
+*/
+void test_DM_set ()
+{
+	Rational values[] = {{1, 2}, {3, 4}};
+	DenomMatrix *dm = fromRationals(1, 2, values);
+	TEST_ASSERT_EQUAL_INT(0, DM_set(dm, 0, 0, (Rational){-2, 3}));
+	TEST_ASSERT_EQUAL_INT64(12, dm->denominators[0]);
+	Rational r;
+	TEST_ASSERT_EQUAL_INT(0, DM_get(dm, 0, 0, &r));
+	TEST_ASSERT_EQUAL_INT32(-2, r.top);
+	TEST_ASSERT_EQUAL_INT32(3, r.bottom);
+	TEST_ASSERT_EQUAL_INT(0, DM_get(dm, 0, 1, &r));
+	TEST_ASSERT_EQUAL_INT32(3, r.top);
+	TEST_ASSERT_EQUAL_INT32(4, r.bottom);
+	TEST_ASSERT_EQUAL_INT(ERR_DENOM_ZERO, DM_set(dm, 0, 0, (Rational){1, 0}));
+	DM_free(dm);
+}
+
+/**
+@fn test_DM_set_overflow
+@brief Tests that DM_set() leaves a row unchanged when it fails.
+@details The row [1/1048576, 1/1048573] can be rescaled by 5, but the new
+element's numerator then overflows. Verifies that the error is reported before
+any numerator or the denominator is altered.
+*/
+void test_DM_set_overflow ()
+{
+	Rational values[] = {{1, 1048576}, {1, 1048573}};
+	DenomMatrix *dm = fromRationals(1, 2, values);
+	int64_t numerators[2] = {DM_NUMERATOR(dm, 0, 0), DM_NUMERATOR(dm, 0, 1)};
+	int64_t denominator = dm->denominators[0];
+	TEST_ASSERT_EQUAL_INT(ERR_DENOM_OVERFLOW,
+		DM_set(dm, 0, 0, (Rational){1073741824, 5}));
+	TEST_ASSERT_EQUAL_INT64(denominator, dm->denominators[0]);
+	TEST_ASSERT_EQUAL_INT64(numerators[0], DM_NUMERATOR(dm, 0, 0));
+	TEST_ASSERT_EQUAL_INT64(numerators[1], DM_NUMERATOR(dm, 0, 1));
+	Rational r;
+	TEST_ASSERT_EQUAL_INT(0, DM_get(dm, 0, 1, &r));
+	TEST_ASSERT_EQUAL_INT32(1, r.top);
+	TEST_ASSERT_EQUAL_INT32(1048573, r.bottom);
+	DM_free(dm);
+}
+
+/**
+@fn test_DM_addScaledRow
+@brief Tests the functionality of DM_scaleRow() and DM_addScaledRow().
+@details Runs random row operations on a DenomMatrix and on a Matrix of
+Rationals side by side and verifies that they stay equal.
+*/
+void test_DM_addScaledRow ()
+{
+	int32_t errorType;
+	Rational values[12];
+	for (unsigned int i = 0; i < 12; i++)
+	{
+		R_reduce64(&values[i], Random_in_range(-20, 20, &errorType),
+			Random_in_range(1, 12, &errorType));
+	}
+	DenomMatrix *dm = fromRationals(3, 4, values);
+	for (int step = 0; step < 20; step++)
+	{
+		unsigned int dest = step % 3, src = (step + 1) % 3;
+		Rational factor;
+		R_reduce64(&factor, Random_in_range(-5, 5, &errorType),
+			Random_in_range(1, 5, &errorType));
+		if ( step % 4 == 0 )
+		{
+			TEST_ASSERT_EQUAL_INT(0, DM_scaleRow(dm, dest, factor));
+			for (unsigned int j = 0; j < 4; j++)
+			{
+				R_multR(&values[dest * 4 + j], factor);
+			}
+		}
+		else
+		{
+			TEST_ASSERT_EQUAL_INT(0, DM_addScaledRow(dm, dest, src, factor));
+			for (unsigned int j = 0; j < 4; j++)
+			{
+				Rational product = values[src * 4 + j];
+				R_multR(&product, factor);
+				R_addR(&values[dest * 4 + j], product);
+			}
+		}
+	}
+	Matrix *m = M_new(3, 4);
+	TEST_ASSERT_EQUAL_INT(0, DM_toMatrix(dm, m));
+	for (unsigned int i = 0; i < 12; i++)
+	{
+		TEST_ASSERT_EQUAL_INT(0, R_compare(values[i], m->elements[i]));
+	}
+	M_free(m);
+	DM_free(dm);
+}
+
+/**
+@fn test_DM_toMatrix_overflow
+@brief Tests that DM_toMatrix() and DM_get() report elements which do not fit
+in a Rational.
+@details Row operations keep 64-bit numerators, so 2000000000 + 500000000 is
+held exactly, but cannot be read back as a Rational. The same holds for a
+fraction whose reduced denominator is too large.
+*/
+void test_DM_toMatrix_overflow ()
+{
+	Rational values[] = {{2000000000, 1}, {1, 1}, {500000000, 1}, {0, 1}};
+	DenomMatrix *dm = fromRationals(2, 2, values);
+	TEST_ASSERT_EQUAL_INT(0, DM_addScaledRow(dm, 0, 1, (Rational){1, 1}));
+	TEST_ASSERT_EQUAL_INT64(2500000000, DM_NUMERATOR(dm, 0, 0));
+	Rational r = {3, 7};
+	TEST_ASSERT_EQUAL_INT(ERR_DENOM_OVERFLOW, DM_get(dm, 0, 0, &r));
+	TEST_ASSERT_EQUAL_INT32(3, r.top);
+	TEST_ASSERT_EQUAL_INT32(7, r.bottom);
+	TEST_ASSERT_EQUAL_INT(0, DM_get(dm, 0, 1, &r));
+	TEST_ASSERT_EQUAL_INT32(1, r.top);
+	Matrix *m = M_new(2, 2);
+	TEST_ASSERT_EQUAL_INT(ERR_DENOM_OVERFLOW, DM_toMatrix(dm, m));
+
+	/* 1/65536 * 1/65537 needs a 33-bit denominator. */
+	TEST_ASSERT_EQUAL_INT(0, DM_addScaledRow(dm, 0, 1, (Rational){-1, 1}));
+	TEST_ASSERT_EQUAL_INT(0, DM_set(dm, 0, 0, (Rational){1, 65536}));
+	TEST_ASSERT_EQUAL_INT(0, DM_scaleRow(dm, 0, (Rational){1, 65537}));
+	TEST_ASSERT_EQUAL_INT(ERR_DENOM_OVERFLOW, DM_get(dm, 0, 0, &r));
+	TEST_ASSERT_EQUAL_INT(ERR_DENOM_OVERFLOW, DM_toMatrix(dm, m));
+	M_free(m);
+	DM_free(dm);
+}
+
+int main ()
+{
+	/* Initialize Unity. */
+	UNITY_BEGIN();
+	/* Call each test function using Unity's RUN_TEST() function. */
+	RUN_TEST(test_DM_fromMatrix);
+	RUN_TEST(test_DM_set);
+	RUN_TEST(test_DM_set_overflow);
+	RUN_TEST(test_DM_addScaledRow);
+	RUN_TEST(test_DM_toMatrix_overflow);
+	/* Once each test is complete, return Unity's result. */
+	return UNITY_END();
+}
\ No newline at end of file
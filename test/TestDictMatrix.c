@@ -0,0 +1,261 @@
+/**
+@file TestDictMatrix.c
+@author Rob Thomas
+@brief Contains Unity functions for testing the functionality of DictMatrix.c.
+*/
+
+/*** INCLUDES: ***/
+#include "unity.h"
+#include "DictMatrix.h"
+#include "Matrix.h"
+#include "Random.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define TEST_SIZE 24
+#define TEST_NUM_PRIMES 8
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn patternMatrix
+@brief Creates a Matrix whose elements are drawn from a few small fractions,
+like a block or incidence pattern.
+@param numRows The number of rows.
+@param numCols The number of columns.
+@param numValues The number of distinct values to draw from.
+@return A pointer to the new Matrix.
+*/
+static Matrix *patternMatrix (unsigned int numRows, unsigned int numCols,
+	int32_t numValues)
+{
+	int error;
+	Matrix *m = M_new(numRows, numCols);
+	for (size_t i = 0; i < (size_t)numRows * numCols; i++)
+	{
+		int32_t v = Random_in_range(0, numValues - 1, &error);
+		R_reduce64(&m->elements[i], v - numValues / 2, v % 3 + 1);
+	}
+	M_rehash(m);
+	return m;
+}
+
+/**
+@fn referenceProduct
+@brief Computes a * b one Rational operation at a time.
+@param a Pointer to the left operand.
+@param b Pointer to the right operand.
+@return A pointer to a new Matrix holding the product.
+*/
+static Matrix *referenceProduct (Matrix *a, Matrix *b)
+{
+	Matrix *product = M_new(a->numRows, b->numCols);
+	for (unsigned int i = 0; i < a->numRows; i++)
+	{
+		for (unsigned int j = 0; j < b->numCols; j++)
+		{
+			Rational sum = {0, 1};
+			for (unsigned int k = 0; k < a->numCols; k++)
+			{
+				Rational term = M_AT(a, i, k);
+				R_multR(&term, M_AT(b, k, j));
+				R_addR(&sum, term);
+			}
+			M_AT(product, i, j) = sum;
+		}
+	}
+	M_rehash(product);
+	return product;
+}
+
+/**
+@fn assertEqualMatrices
+@brief Asserts that two matrices have the same dimensions and reduced entries.
+@param expected Pointer to the expected Matrix.
+@param actual Pointer to the Matrix to check.
+*/
+static void assertEqualMatrices (Matrix *expected, Matrix *actual)
+{
+	TEST_ASSERT_EQUAL_UINT(expected->numRows, actual->numRows);
+	TEST_ASSERT_EQUAL_UINT(expected->numCols, actual->numCols);
+	for (size_t i = 0; i < (size_t)expected->numRows * expected->numCols; i++)
+	{
+		TEST_ASSERT_EQUAL_INT32(expected->elements[i].top,
+			actual->elements[i].top);
+		TEST_ASSERT_EQUAL_INT32(expected->elements[i].bottom,
+			actual->elements[i].bottom);
+	}
+	TEST_ASSERT_EQUAL_UINT64(expected->contentHash, actual->contentHash);
+}
+
+/**
+@fn test_DX_fromMatrix
+@brief Tests the functionality of DX_fromMatrix(), DX_get() and
+DX_toMatrix().
+@details Converts matrices with few and with many distinct values, verifying
+the table, the index size and that converting back gives the original.
+*/
+void test_DX_fromMatrix ()
+{
+	Matrix *m = patternMatrix(TEST_SIZE, TEST_SIZE + 3, 5);
+	DictMatrix *dx;
+	TEST_ASSERT_EQUAL_INT(0, DX_fromMatrix(m, &dx));
+	TEST_ASSERT_EQUAL_UINT(1, dx->indexSize);
+	TEST_ASSERT_TRUE(dx->numValues <= 5);
+	for (unsigned int i = 0; i < m->numRows; i++)
+	{
+		for (unsigned int j = 0; j < m->numCols; j++)
+		{
+			Rational r = DX_get(dx, i, j);
+			TEST_ASSERT_EQUAL_INT32(M_AT(m, i, j).top, r.top);
+			TEST_ASSERT_EQUAL_INT32(M_AT(m, i, j).bottom, r.bottom);
+		}
+	}
+	Matrix *back = M_new(m->numRows, m->numCols);
+	TEST_ASSERT_EQUAL_INT(0, DX_toMatrix(dx, back));
+	assertEqualMatrices(m, back);
+	TEST_ASSERT_TRUE(DX_storageSize(dx) < sizeof(Rational) * m->numRows *
+		m->numCols);
+	DX_free(dx);
+	M_free(m);
+	M_free(back);
+
+	/* More than DX_MAX_NARROW_VALUES values need 16-bit indices. */
+	m = M_new(TEST_SIZE, TEST_SIZE);
+	for (unsigned int i = 0; i < TEST_SIZE * TEST_SIZE; i++)
+	{
+		m->elements[i] = (Rational){(int32_t)i, 1};
+	}
+	M_rehash(m);
+	TEST_ASSERT_EQUAL_INT(0, DX_fromMatrix(m, &dx));
+	TEST_ASSERT_EQUAL_UINT(2, dx->indexSize);
+	TEST_ASSERT_EQUAL_UINT(TEST_SIZE * TEST_SIZE, dx->numValues);
+	back = M_new(TEST_SIZE, TEST_SIZE);
+	TEST_ASSERT_EQUAL_INT(0, DX_toMatrix(dx, back));
+	assertEqualMatrices(m, back);
+	DX_free(dx);
+	M_free(m);
+	M_free(back);
+}
+
+/**
+@fn test_DX_fromMatrix_tooManyValues
+@brief Tests that DX_fromMatrix() rejects a Matrix with more than
+DX_MAX_VALUES distinct values.
+*/
+void test_DX_fromMatrix_tooManyValues ()
+{
+	Matrix *m = M_new(257, 256);
+	for (unsigned int i = 0; i < 257 * 256; i++)
+	{
+		m->elements[i] = (Rational){(int32_t)i, 1};
+	}
+	M_rehash(m);
+	DictMatrix *dx = NULL;
+	TEST_ASSERT_EQUAL_INT(ERR_DICT_TOO_MANY_VALUES, DX_fromMatrix(m, &dx));
+	M_free(m);
+}
+
+/**
+@fn test_DX_scale
+@brief Tests the functionality of DX_scale().
+*/
+void test_DX_scale ()
+{
+	Matrix *m = patternMatrix(TEST_SIZE, TEST_SIZE, 7);
+	DictMatrix *dx;
+	TEST_ASSERT_EQUAL_INT(0, DX_fromMatrix(m, &dx));
+	Rational factor = {-2, 3};
+	DX_scale(dx, factor);
+	for (unsigned int i = 0; i < m->numRows; i++)
+	{
+		for (unsigned int j = 0; j < m->numCols; j++)
+		{
+			Rational expected = M_AT(m, i, j);
+			R_multR(&expected, factor);
+			Rational r = DX_get(dx, i, j);
+			TEST_ASSERT_EQUAL_INT32(expected.top, r.top);
+			TEST_ASSERT_EQUAL_INT32(expected.bottom, r.bottom);
+		}
+	}
+	DX_free(dx);
+	M_free(m);
+}
+
+/**
+@fn test_DX_multiply
+@brief Tests the functionality of DX_multiply().
+@details Compares products of pattern matrices against the reference, with
+narrow and wide indices.
+*/
+void test_DX_multiply ()
+{
+	int32_t numValues[] = {3, 9, 300};
+	for (int v = 0; v < 3; v++)
+	{
+		Matrix *a = patternMatrix(TEST_SIZE, TEST_SIZE + 5, numValues[v]);
+		Matrix *b = patternMatrix(TEST_SIZE + 5, TEST_SIZE - 2, numValues[v]);
+		DictMatrix *da, *db;
+		TEST_ASSERT_EQUAL_INT(0, DX_fromMatrix(a, &da));
+		TEST_ASSERT_EQUAL_INT(0, DX_fromMatrix(b, &db));
+		Matrix *expected = referenceProduct(a, b);
+		Matrix *dest = M_new(TEST_SIZE, TEST_SIZE - 2);
+		TEST_ASSERT_EQUAL_INT(0, DX_multiply(dest, da, db));
+		assertEqualMatrices(expected, dest);
+		DX_free(da);
+		DX_free(db);
+		M_free(a);
+		M_free(b);
+		M_free(expected);
+		M_free(dest);
+	}
+}
+
+/**
+@fn test_DX_multiply_noCommonDenominator
+@brief Tests DX_multiply() when the products of the table values have no
+64-bit common denominator, so every row falls back to Rational arithmetic.
+*/
+void test_DX_multiply_noCommonDenominator ()
+{
+	int32_t primes[TEST_NUM_PRIMES] = {40009, 40013, 40031, 40037, 40039, 40063,
+		40087, 40093};
+	Matrix *a = M_new(TEST_NUM_PRIMES, TEST_NUM_PRIMES);
+	Matrix *b = M_new(TEST_NUM_PRIMES, 3);
+	for (unsigned int i = 0; i < TEST_NUM_PRIMES; i++)
+	{
+		M_AT(a, i, i) = (Rational){1, primes[i]};
+		for (unsigned int j = 0; j < 3; j++)
+		{
+			M_AT(b, i, j) = (Rational){(int32_t)(i + j) - 4, 1};
+		}
+	}
+	M_rehash(a);
+	M_rehash(b);
+	DictMatrix *da, *db;
+	TEST_ASSERT_EQUAL_INT(0, DX_fromMatrix(a, &da));
+	TEST_ASSERT_EQUAL_INT(0, DX_fromMatrix(b, &db));
+	Matrix *expected = referenceProduct(a, b);
+	Matrix *dest = M_new(TEST_NUM_PRIMES, 3);
+	TEST_ASSERT_EQUAL_INT(0, DX_multiply(dest, da, db));
+	assertEqualMatrices(expected, dest);
+	TEST_ASSERT_EQUAL_INT32(-4, M_AT(dest, 0, 0).top);
+	TEST_ASSERT_EQUAL_INT32(primes[0], M_AT(dest, 0, 0).bottom);
+	DX_free(da);
+	DX_free(db);
+	M_free(a);
+	M_free(b);
+	M_free(expected);
+	M_free(dest);
+}
+
+int main ()
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_DX_fromMatrix);
+	RUN_TEST(test_DX_fromMatrix_tooManyValues);
+	RUN_TEST(test_DX_scale);
+	RUN_TEST(test_DX_multiply);
+	RUN_TEST(test_DX_multiply_noCommonDenominator);
+	return UNITY_END();
+}
\ No newline at end of file
@@ -0,0 +1,453 @@
+/**
+@file TestHashTable.c
+@author Rob Thomas
+@brief Contains Unity functions for testing the functionality of HashTable.c.
+*/
+
+/*** INCLUDES: ***/
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "unity.h"
+#include "HashTable.h"
+#include "Matrix.h"
+#include "Rational.h"
+#include "TiledMatrix.h"
+
+/*** DEFINES: ***/
+#define TEST_PATH_LENGTH 64
+#define TEST_TILE_SIZE 4
+#define TEST_SIZE 6
+
+/*** STRUCTS: ***/
+
+/**
+@def SumContext
+@brief A struct representing the context of a derived variable which is the
+sum of two Rational variables.
+@var table Pointer to the HashTable holding the variables.
+@var first The key of the first variable.
+@var second The key of the second variable.
+@var numCalls The number of times the variable has been recomputed.
+@var error The error code the next recomputation will return.
+*/
+typedef struct
+{
+	HashTable *table;
+	char *first;
+	char *second;
+	int numCalls;
+	int error;
+} SumContext;
+
+/*** GLOBALS: ***/
+static char testPath[TEST_PATH_LENGTH];
+static char otherPath[TEST_PATH_LENGTH];
+static TM_BufferCache *cache;
+
+/*** FUNCTION DEFINITIONS: ***/
+
+void setUp ()
+{
+	strcpy(testPath, "/tmp/test_hashtable_XXXXXX");
+	strcpy(otherPath, "/tmp/test_hashtable_XXXXXX");
+	int fd = mkstemp(testPath);
+	TEST_ASSERT_TRUE(fd >= 0);
+	close(fd);
+	fd = mkstemp(otherPath);
+	TEST_ASSERT_TRUE(fd >= 0);
+	close(fd);
+	cache = TM_newCache(TM_MIN_FRAMES, TEST_TILE_SIZE);
+	TEST_ASSERT_NOT_NULL(cache);
+}
+
+void tearDown ()
+{
+	TM_freeCache(cache);
+	unlink(testPath);
+	unlink(otherPath);
+}
+
+/**
+@fn isOpen
+@brief Checks whether a file descriptor is open.
+@param fd The file descriptor.
+@return Whether the file descriptor is open.
+*/
+static bool isOpen (int fd)
+{
+	return fcntl(fd, F_GETFD) != -1;
+}
+
+/**
+@fn readBack
+@brief Reopens a TiledMatrix file and reads one element of it.
+@param path The path of the file.
+@param row The row of the element.
+@param col The column of the element.
+@return The element.
+*/
+static Rational readBack (const char *path, unsigned int row, unsigned int col)
+{
+	TiledMatrix m;
+	Rational value = {0, 0};
+	if ( TM_open(path, cache, &m) )
+	{
+		return value;
+	}
+	TM_get(&m, row, col, &value);
+	TM_close(&m);
+	return value;
+}
+
+/**
+@fn recomputeSum
+@brief Recomputes a derived variable as the sum of two Rational variables.
+@param context Pointer to the variable's SumContext.
+@param dest Pointer to the Rational value to overwrite.
+@return An error code. 0 if no problems were encountered.
+*/
+static int recomputeSum (void *context, void *dest)
+{
+	SumContext *sum = (SumContext *)context;
+	sum->numCalls++;
+	if ( sum->error )
+	{
+		return sum->error;
+	}
+	Rational *first = (Rational *)HT_get(sum->table, sum->first, NULL);
+	Rational *second = (Rational *)HT_get(sum->table, sum->second, NULL);
+	if ( !first || !second )
+	{
+		return FAIL_KEY_NOT_FOUND;
+	}
+	*(Rational *)dest = *first;
+	R_addR((Rational *)dest, *second);
+	return 0;
+}
+
+/**
+@fn setRational
+@brief Assigns an integer to a Rational variable through HT_add.
+@param table Pointer to the HashTable.
+@param key The key of the variable.
+@param value The integer.
+*/
+static void setRational (HashTable *table, char *key, int32_t value)
+{
+	Rational r = {value, 1};
+	TEST_ASSERT_EQUAL_INT(0, HT_add(table, key, &r, VT_RATIONAL));
+}
+
+/**
+@fn getTop
+@brief Reads a Rational variable through HT_get.
+@param table Pointer to the HashTable.
+@param key The key of the variable.
+@return The top of the variable's value, or INT32_MIN if it could not be read.
+*/
+static int32_t getTop (HashTable *table, char *key)
+{
+	Rational *r = (Rational *)HT_get(table, key, NULL);
+	return r ? r->top : INT32_MIN;
+}
+
+/**
+@fn test_HT_add_matrix
+@brief Tests the functionality of HT_add() with Matrix values.
+@details Verifies that a Matrix is found again, that reassigning the same
+element buffer keeps it, and that a different buffer replaces it.
+*/
+void test_HT_add_matrix ()
+{
+	HashTable *table = HT_newTable(8);
+	Matrix *m = M_new(2, 2);
+	m->elements[3] = (Rational){5, 1};
+	TEST_ASSERT_EQUAL_INT(0, HT_add(table, "A", m, VT_MATRIX));
+
+	/* Reassigning the same buffer, e.g. after updating it in place, must not
+	   release it. */
+	Matrix *stored = (Matrix *)HT_get(table, "A", NULL);
+	stored->elements[0] = (Rational){3, 1};
+	TEST_ASSERT_EQUAL_INT(0, HT_add(table, "A", m, VT_MATRIX));
+	stored = (Matrix *)HT_get(table, "A", NULL);
+	TEST_ASSERT_EQUAL_INT32(3, stored->elements[0].top);
+	TEST_ASSERT_EQUAL_INT32(5, stored->elements[3].top);
+	free(m);
+
+	Matrix *other = M_new(1, 1);
+	other->elements[0] = (Rational){9, 1};
+	TEST_ASSERT_EQUAL_INT(0, HT_add(table, "A", other, VT_MATRIX));
+	free(other);
+	value_t type;
+	stored = (Matrix *)HT_get(table, "A", &type);
+	TEST_ASSERT_EQUAL_INT(VT_MATRIX, type);
+	TEST_ASSERT_EQUAL_UINT(1, stored->numRows);
+	TEST_ASSERT_EQUAL_INT32(9, stored->elements[0].top);
+	TEST_ASSERT_NULL(HT_get(table, "B", NULL));
+	HT_freeTable(table);
+}
+
+/**
+@fn test_HT_add_tiledOverwrite
+@brief Tests that overwriting a TiledMatrix variable closes its file.
+@details Verifies that the old file is flushed and closed when the variable is
+replaced by another file or by a Rational, and that reassigning the same file
+leaves it open.
+*/
+void test_HT_add_tiledOverwrite ()
+{
+	HashTable *table = HT_newTable(8);
+	TiledMatrix t;
+	TEST_ASSERT_EQUAL_INT(0, TM_create(testPath, TEST_SIZE, TEST_SIZE, cache,
+		&t));
+	TEST_ASSERT_EQUAL_INT(0, TM_set(&t, 5, 4, (Rational){7, 3}));
+	TEST_ASSERT_EQUAL_INT(0, HT_add(table, "T", &t, VT_TILED_MATRIX));
+
+	/* The same file on the same cache stays open. */
+	TEST_ASSERT_EQUAL_INT(0, HT_add(table, "T", &t, VT_TILED_MATRIX));
+	TEST_ASSERT_TRUE(isOpen(t.fd));
+
+	/* A different file closes the first one, writing its tiles back. */
+	TiledMatrix u;
+	TEST_ASSERT_EQUAL_INT(0, TM_create(otherPath, TEST_SIZE, TEST_SIZE, cache,
+		&u));
+	TEST_ASSERT_EQUAL_INT(0, HT_add(table, "T", &u, VT_TILED_MATRIX));
+	TEST_ASSERT_FALSE(isOpen(t.fd));
+	for (unsigned int i = 0; i < cache->numFrames; i++)
+	{
+		TEST_ASSERT_FALSE(cache->frames[i].isValid &&
+			cache->frames[i].fd == t.fd);
+	}
+	Rational value = readBack(testPath, 5, 4);
+	TEST_ASSERT_EQUAL_INT32(7, value.top);
+	TEST_ASSERT_EQUAL_INT32(3, value.bottom);
+
+	/* A value of another type closes it too. */
+	Rational r = {1, 2};
+	TEST_ASSERT_EQUAL_INT(0, HT_add(table, "T", &r, VT_RATIONAL));
+	TEST_ASSERT_FALSE(isOpen(u.fd));
+	HT_freeTable(table);
+}
+
+/**
+@fn test_HT_reset_tiled
+@brief Tests that HT_reset() and HT_freeTable() close TiledMatrix files.
+*/
+void test_HT_reset_tiled ()
+{
+	HashTable *table = HT_newTable(8);
+	TiledMatrix t;
+	TEST_ASSERT_EQUAL_INT(0, TM_create(testPath, TEST_SIZE, TEST_SIZE, cache,
+		&t));
+	TEST_ASSERT_EQUAL_INT(0, TM_set(&t, 0, 1, (Rational){2, 1}));
+	TEST_ASSERT_EQUAL_INT(0, HT_add(table, "T", &t, VT_TILED_MATRIX));
+	HT_reset(table);
+	TEST_ASSERT_FALSE(isOpen(t.fd));
+	TEST_ASSERT_NULL(HT_get(table, "T", NULL));
+	TEST_ASSERT_EQUAL_INT32(2, readBack(testPath, 0, 1).top);
+
+	TEST_ASSERT_EQUAL_INT(0, TM_open(testPath, cache, &t));
+	TEST_ASSERT_EQUAL_INT(0, HT_add(table, "T", &t, VT_TILED_MATRIX));
+	HT_freeTable(table);
+	TEST_ASSERT_FALSE(isOpen(t.fd));
+}
+
+/**
+@fn test_HT_add_full
+@brief Tests HT_add() on tables which fill up.
+@details Every pair added while there is room must be reported as stored, even
+the one which fills the table, and must keep its element buffer. The add after
+that must report that nothing was stored.
+*/
+void test_HT_add_full ()
+{
+	for (unsigned int size = 1; size <= 8; size++)
+	{
+		HashTable *table = HT_newTable(size);
+		char key[16];
+		for (unsigned int i = 0; i < size; i++)
+		{
+			Matrix *m = M_new(1, 2);
+			m->elements[0] = (Rational){(int32_t)i, 1};
+			snprintf(key, sizeof(key), "v%u", i * 2);
+			TEST_ASSERT_EQUAL_INT(0, HT_add(table, key, m, VT_MATRIX));
+			free(m);
+		}
+		TEST_ASSERT_EQUAL_UINT(size, table->numItems);
+		Matrix *m = M_new(1, 2);
+		TEST_ASSERT_TRUE(HT_add(table, "extra", m, VT_MATRIX) != 0);
+		TEST_ASSERT_NULL(HT_get(table, "extra", NULL));
+		M_free(m);
+
+		/* New buffers of the same size must not reuse the table's. */
+		Matrix *fresh[8];
+		for (unsigned int i = 0; i < size; i++)
+		{
+			fresh[i] = M_new(1, 2);
+			fresh[i]->elements[0] = (Rational){99, 1};
+		}
+		for (unsigned int i = 0; i < size; i++)
+		{
+			snprintf(key, sizeof(key), "v%u", i * 2);
+			Matrix *stored = (Matrix *)HT_get(table, key, NULL);
+			TEST_ASSERT_NOT_NULL(stored);
+			TEST_ASSERT_EQUAL_INT32((int32_t)i, stored->elements[0].top);
+		}
+		for (unsigned int i = 0; i < size; i++)
+		{
+			M_free(fresh[i]);
+		}
+		HT_freeTable(table);
+	}
+}
+
+/**
+@fn test_HT_addDerived
+@brief Tests the functionality of HT_addDerived() and the recomputation of
+derived variables by HT_get().
+@details Verifies that reading a derived variable whose dependencies are
+unchanged does no work, that reassigning a dependency through HT_add makes the
+next read recompute it exactly once, and that a variable derived from another
+derived variable is recomputed when a dependency two steps away changes.
+*/
+void test_HT_addDerived ()
+{
+	HashTable *table = HT_newTable(16);
+	setRational(table, "a", 1);
+	setRational(table, "b", 2);
+	SumContext sum = {table, "a", "b", 0, 0};
+	char *sumDependencies[] = {"a", "b"};
+	Rational r = {3, 1};
+	TEST_ASSERT_EQUAL_INT(0, HT_addDerived(table, "s", &r, VT_RATIONAL,
+		sumDependencies, 2, recomputeSum, &sum));
+	TEST_ASSERT_EQUAL_INT32(3, getTop(table, "s"));
+	TEST_ASSERT_EQUAL_INT32(3, getTop(table, "s"));
+	TEST_ASSERT_EQUAL_INT(0, sum.numCalls);
+
+	setRational(table, "a", 5);
+	TEST_ASSERT_EQUAL_INT32(7, getTop(table, "s"));
+	TEST_ASSERT_EQUAL_INT(1, sum.numCalls);
+	TEST_ASSERT_EQUAL_INT32(7, getTop(table, "s"));
+	TEST_ASSERT_EQUAL_INT(1, sum.numCalls);
+
+	/* t = s + a depends on a directly and through s. */
+	SumContext twice = {table, "s", "a", 0, 0};
+	char *twiceDependencies[] = {"s", "a"};
+	r = (Rational){12, 1};
+	TEST_ASSERT_EQUAL_INT(0, HT_addDerived(table, "t", &r, VT_RATIONAL,
+		twiceDependencies, 2, recomputeSum, &twice));
+	setRational(table, "b", 10);
+	TEST_ASSERT_EQUAL_INT32(20, getTop(table, "t"));
+	TEST_ASSERT_EQUAL_INT(2, sum.numCalls);
+	TEST_ASSERT_EQUAL_INT(1, twice.numCalls);
+	TEST_ASSERT_EQUAL_INT32(15, getTop(table, "s"));
+	TEST_ASSERT_EQUAL_INT(2, sum.numCalls);
+	TEST_ASSERT_EQUAL_INT32(20, getTop(table, "t"));
+	TEST_ASSERT_EQUAL_INT(1, twice.numCalls);
+
+	/* Assigning the same value again still counts as a change. */
+	setRational(table, "a", 5);
+	TEST_ASSERT_EQUAL_INT32(20, getTop(table, "t"));
+	TEST_ASSERT_EQUAL_INT(3, sum.numCalls);
+	TEST_ASSERT_EQUAL_INT(2, twice.numCalls);
+
+	char *missing[] = {"a", "nothing"};
+	TEST_ASSERT_EQUAL_INT(FAIL_KEY_NOT_FOUND, HT_addDerived(table, "u", &r,
+		VT_RATIONAL, missing, 2, recomputeSum, &sum));
+	TEST_ASSERT_NULL(HT_get(table, "u", NULL));
+	HT_freeTable(table);
+}
+
+/**
+@fn test_HT_addDerived_reassign
+@brief Tests reassigning a derived variable through HT_add(), which makes it a
+plain variable again, and a recomputation which fails.
+*/
+void test_HT_addDerived_reassign ()
+{
+	HashTable *table = HT_newTable(16);
+	setRational(table, "a", 1);
+	setRational(table, "b", 2);
+	SumContext sum = {table, "a", "b", 0, 0};
+	char *dependencies[] = {"a", "b"};
+	Rational r = {3, 1};
+	TEST_ASSERT_EQUAL_INT(0, HT_addDerived(table, "s", &r, VT_RATIONAL,
+		dependencies, 2, recomputeSum, &sum));
+
+	/* A failing recomputation makes HT_get fail, and is retried on the next
+	   read since the value is still stale. */
+	setRational(table, "a", 4);
+	sum.error = FAIL_KEY_NOT_FOUND;
+	TEST_ASSERT_NULL(HT_get(table, "s", NULL));
+	sum.error = 0;
+	TEST_ASSERT_EQUAL_INT32(6, getTop(table, "s"));
+	TEST_ASSERT_EQUAL_INT(2, sum.numCalls);
+
+	setRational(table, "s", 100);
+	setRational(table, "a", 50);
+	TEST_ASSERT_EQUAL_INT32(100, getTop(table, "s"));
+	TEST_ASSERT_EQUAL_INT(2, sum.numCalls);
+	HT_freeTable(table);
+}
+
+/**
+@fn test_HT_addDerived_cycle
+@brief Tests that reading a variable whose dependencies form a cycle fails
+with FAIL_CYCLIC_DEPENDENCY instead of recursing forever.
+@details Builds x = y + a and then redefines y = x + a, and separately a
+variable derived from itself. Reading any of them must fail every time, while
+variables outside the cycle can still be read.
+*/
+void test_HT_addDerived_cycle ()
+{
+	HashTable *table = HT_newTable(16);
+	setRational(table, "a", 1);
+	setRational(table, "y", 2);
+	SumContext xSum = {table, "y", "a", 0, 0};
+	SumContext ySum = {table, "x", "a", 0, 0};
+	char *xDependencies[] = {"y", "a"};
+	char *yDependencies[] = {"x", "a"};
+	Rational r = {3, 1};
+	TEST_ASSERT_EQUAL_INT(0, HT_addDerived(table, "x", &r, VT_RATIONAL,
+		xDependencies, 2, recomputeSum, &xSum));
+	TEST_ASSERT_EQUAL_INT(0, HT_addDerived(table, "y", &r, VT_RATIONAL,
+		yDependencies, 2, recomputeSum, &ySum));
+	for (int attempt = 0; attempt < 2; attempt++)
+	{
+		TEST_ASSERT_NULL(HT_get(table, "x", NULL));
+		TEST_ASSERT_NULL(HT_get(table, "y", NULL));
+		TEST_ASSERT_NULL(HT_getCache(table, "x"));
+	}
+	TEST_ASSERT_EQUAL_INT(0, xSum.numCalls);
+	TEST_ASSERT_EQUAL_INT(0, ySum.numCalls);
+	TEST_ASSERT_EQUAL_INT32(1, getTop(table, "a"));
+
+	char *selfDependencies[] = {"z"};
+	setRational(table, "z", 1);
+	SumContext zSum = {table, "z", "a", 0, 0};
+	TEST_ASSERT_EQUAL_INT(0, HT_addDerived(table, "z", &r, VT_RATIONAL,
+		selfDependencies, 1, recomputeSum, &zSum));
+	TEST_ASSERT_NULL(HT_get(table, "z", NULL));
+
+	/* Breaking the cycle with a plain assignment makes both readable. */
+	setRational(table, "y", 10);
+	TEST_ASSERT_EQUAL_INT32(11, getTop(table, "x"));
+	TEST_ASSERT_EQUAL_INT32(10, getTop(table, "y"));
+	HT_freeTable(table);
+}
+
+int main ()
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_HT_add_matrix);
+	RUN_TEST(test_HT_add_full);
+	RUN_TEST(test_HT_add_tiledOverwrite);
+	RUN_TEST(test_HT_reset_tiled);
+	RUN_TEST(test_HT_addDerived);
+	RUN_TEST(test_HT_addDerived_reassign);
+	RUN_TEST(test_HT_addDerived_cycle);
+	return UNITY_END();
+}
\ No newline at end of file
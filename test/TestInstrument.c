@@ -0,0 +1,107 @@
+/**
+@file TestInstrument.c
+@author Rob Thomas
+@brief Contains Unity functions for testing the functionality of Instrument.c.
+The counters are only checked when the tests are built with INSTRUMENT=1;
+otherwise they must all read zero.
+*/
+
+/*** INCLUDES: ***/
+#include <stdio.h>
+#include <pthread.h>
+
+#include "unity.h"
+#include "HashTable.h"
+#include "Instrument.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define TEST_NUM_THREADS 4
+#define TEST_NUM_ADDS 10
+#define TEST_NUM_REDUCES 100
+
+/*** FUNCTION DEFINITIONS: ***/
+
+void setUp ()
+{
+	INST_reset();
+}
+
+/**
+@fn countOperations
+@brief Performs TEST_NUM_ADDS calls to HT_add on a new table and
+TEST_NUM_REDUCES calls to R_reduce.
+@param unused Unused.
+@return NULL.
+*/
+static void *countOperations (void *unused)
+{
+	(void)unused;
+	HashTable *table = HT_newTable(2 * TEST_NUM_ADDS);
+	char key[16];
+	for (int i = 0; i < TEST_NUM_ADDS; i++)
+	{
+		Rational r = {i, 1};
+		snprintf(key, sizeof(key), "v%d", i);
+		HT_add(table, key, &r, VT_RATIONAL);
+	}
+	HT_freeTable(table);
+	for (int i = 0; i < TEST_NUM_REDUCES; i++)
+	{
+		Rational r = {2 * i, 4};
+		R_reduce(&r);
+	}
+	return NULL;
+}
+
+/**
+@fn test_INST_total
+@brief Tests the functionality of INST_total() and INST_reset().
+@details Runs the same operations on the calling thread and on several threads
+which then exit. The calling thread's own counters must only show its share,
+while the total must include every thread's, and resetting must clear both.
+*/
+void test_INST_total ()
+{
+	pthread_t threads[TEST_NUM_THREADS];
+	for (int i = 0; i < TEST_NUM_THREADS; i++)
+	{
+		TEST_ASSERT_EQUAL_INT(0, pthread_create(&threads[i], NULL,
+			countOperations, NULL));
+	}
+	for (int i = 0; i < TEST_NUM_THREADS; i++)
+	{
+		pthread_join(threads[i], NULL);
+	}
+	countOperations(NULL);
+
+	InstrumentCounters own = INST_snapshot();
+	InstrumentCounters total = INST_total();
+#ifdef MS_INSTRUMENT
+	TEST_ASSERT_EQUAL_UINT64(TEST_NUM_ADDS, own.tableAdds);
+	TEST_ASSERT_EQUAL_UINT64(TEST_NUM_REDUCES, own.reduceCalls);
+	TEST_ASSERT_EQUAL_UINT64((TEST_NUM_THREADS + 1) * TEST_NUM_ADDS,
+		total.tableAdds);
+	TEST_ASSERT_EQUAL_UINT64((TEST_NUM_THREADS + 1) * TEST_NUM_REDUCES,
+		total.reduceCalls);
+	TEST_ASSERT_EQUAL_UINT64((TEST_NUM_THREADS + 1) * own.gcdCalls,
+		total.gcdCalls);
+	TEST_ASSERT_EQUAL_UINT64(own.tableLongestChain, total.tableLongestChain);
+#else
+	TEST_ASSERT_EQUAL_UINT64(0, own.tableAdds);
+	TEST_ASSERT_EQUAL_UINT64(0, total.tableAdds);
+	TEST_ASSERT_EQUAL_UINT64(0, total.reduceCalls);
+#endif
+
+	INST_reset();
+	total = INST_total();
+	TEST_ASSERT_EQUAL_UINT64(0, total.tableAdds);
+	TEST_ASSERT_EQUAL_UINT64(0, total.reduceCalls);
+}
+
+int main ()
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_INST_total);
+	return UNITY_END();
+}
\ No newline at end of file
@@ -0,0 +1,256 @@
+/**
+@file TestJobPool.c
+@author Rob Thomas
+@brief Contains Unity functions for testing the functionality of JobPool.c.
+*/
+
+/*** INCLUDES: ***/
+#include <string.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#include "unity.h"
+#include "BufferPool.h"
+#include "HashTable.h"
+#include "JobPool.h"
+#include "Matrix.h"
+#include "MatrixExpr.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define TEST_SIZE 64
+
+/*** GLOBALS: ***/
+static atomic_bool isReleased;
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn filledMatrix
+@brief Creates a TEST_SIZE x TEST_SIZE Matrix with every element equal to one
+integer.
+@param value The value of every element.
+@return A pointer to the new Matrix.
+*/
+static Matrix *filledMatrix (int32_t value)
+{
+	Matrix *m = M_new(TEST_SIZE, TEST_SIZE);
+	for (size_t i = 0; i < (size_t)TEST_SIZE * TEST_SIZE; i++)
+	{
+		m->elements[i].top = value;
+	}
+	M_rehash(m);
+	return m;
+}
+
+/**
+@fn blockedJob
+@brief A job function which waits until isReleased is set or the job is
+cancelled, then produces a Rational.
+@param job Pointer to the running job.
+@param context Unused.
+@param result Pointer to the Rational the result is written to.
+@return An error code. 0 if no problems were encountered.
+*/
+static int blockedJob (JP_Job *job, void *context, void *result)
+{
+	(void)context;
+	while ( !atomic_load(&isReleased) )
+	{
+		if ( JP_isCancelled(job) )
+		{
+			return ERR_JOB_CANCELLED;
+		}
+		usleep(1000);
+	}
+	JP_setProgress(job, 1);
+	*(Rational *)result = (Rational){7, 2};
+	return 0;
+}
+
+/**
+@fn test_JP_submitExpression
+@brief Tests the functionality of JP_submitExpression(), JP_wait() and
+JP_get().
+@details Evaluates 2 * A * B + A in a job and verifies the result, its status,
+and that dimension errors are reported when the job is submitted.
+*/
+void test_JP_submitExpression ()
+{
+	HashTable *table = HT_newTable(16);
+	JobPool *pool = JP_new(table, 2);
+	Matrix *a = filledMatrix(1);
+	Matrix *b = filledMatrix(3);
+	MatrixTerm terms[2] = {ME_product((Rational){2, 1}, a, b),
+		ME_element((Rational){1, 1}, a)};
+	unsigned int id;
+	TEST_ASSERT_EQUAL_INT(ERR_DIMENSION_MISMATCH,
+		JP_submitExpression(pool, "c", terms, 2, TEST_SIZE, TEST_SIZE + 1, &id));
+	TEST_ASSERT_EQUAL_INT(0,
+		JP_submitExpression(pool, "c", terms, 2, TEST_SIZE, TEST_SIZE, &id));
+	/* JP_get waits for the job computing the variable. */
+	Matrix c;
+	value_t type;
+	TEST_ASSERT_EQUAL_INT(0, JP_get(pool, "c", &c, &type));
+	TEST_ASSERT_EQUAL_INT(VT_MATRIX, type);
+	TEST_ASSERT_EQUAL_INT(0, JP_wait(pool, id));
+	JobState state;
+	double progress;
+	TEST_ASSERT_EQUAL_INT(0, JP_status(pool, id, &state, &progress));
+	TEST_ASSERT_EQUAL_INT(JS_DONE, state);
+	TEST_ASSERT_TRUE(progress == 1);
+	for (size_t i = 0; i < (size_t)TEST_SIZE * TEST_SIZE; i++)
+	{
+		TEST_ASSERT_EQUAL_INT32(2 * 3 * TEST_SIZE + 1, c.elements[i].top);
+		TEST_ASSERT_EQUAL_INT32(1, c.elements[i].bottom);
+	}
+	BP_release(c.elements);
+	JP_free(pool);
+	HT_freeTable(table);
+	M_free(a);
+	M_free(b);
+}
+
+/**
+@fn test_JP_get_copy
+@brief Tests that JP_get() returns a copy of a Matrix which outlives the
+variable.
+@details Reads a variable, replaces it with JP_set, then allocates a Matrix of
+the same size, which would reuse the released buffer. Verifies that the copy
+still holds the old values.
+*/
+void test_JP_get_copy ()
+{
+	HashTable *table = HT_newTable(16);
+	JobPool *pool = JP_new(table, 1);
+	Matrix *m = filledMatrix(5);
+	TEST_ASSERT_EQUAL_INT(0, JP_set(pool, "a", m, VT_MATRIX));
+	free(m);
+	Matrix copy;
+	TEST_ASSERT_EQUAL_INT(0, JP_get(pool, "a", &copy, NULL));
+	m = filledMatrix(6);
+	TEST_ASSERT_EQUAL_INT(0, JP_set(pool, "a", m, VT_MATRIX));
+	free(m);
+	Matrix *reused = filledMatrix(9);
+	for (size_t i = 0; i < (size_t)TEST_SIZE * TEST_SIZE; i++)
+	{
+		TEST_ASSERT_EQUAL_INT32(5, copy.elements[i].top);
+	}
+	M_free(reused);
+	BP_release(copy.elements);
+	TEST_ASSERT_EQUAL_INT(FAIL_KEY_NOT_FOUND, JP_get(pool, "b", &copy, NULL));
+	JP_free(pool);
+	HT_freeTable(table);
+}
+
+/**
+@fn test_JP_cancel
+@brief Tests the functionality of JP_cancel().
+@details Cancels a running job and a job queued behind it, and verifies that
+neither adds its variable to the table.
+*/
+void test_JP_cancel ()
+{
+	HashTable *table = HT_newTable(16);
+	JobPool *pool = JP_new(table, 1);
+	atomic_store(&isReleased, false);
+	unsigned int running, queued;
+	TEST_ASSERT_EQUAL_INT(0, JP_submit(pool, "r", VT_RATIONAL, blockedJob, NULL,
+		NULL, &running));
+	TEST_ASSERT_EQUAL_INT(0, JP_submit(pool, "q", VT_RATIONAL, blockedJob, NULL,
+		NULL, &queued));
+	TEST_ASSERT_EQUAL_INT(0, JP_cancel(pool, queued));
+	TEST_ASSERT_EQUAL_INT(0, JP_cancel(pool, running));
+	TEST_ASSERT_EQUAL_INT(ERR_JOB_CANCELLED, JP_wait(pool, running));
+	TEST_ASSERT_EQUAL_INT(ERR_JOB_CANCELLED, JP_wait(pool, queued));
+	JobState state;
+	TEST_ASSERT_EQUAL_INT(0, JP_status(pool, queued, &state, NULL));
+	TEST_ASSERT_EQUAL_INT(JS_CANCELLED, state);
+	Rational r;
+	TEST_ASSERT_EQUAL_INT(FAIL_KEY_NOT_FOUND, JP_get(pool, "r", &r, NULL));
+	TEST_ASSERT_EQUAL_INT(FAIL_JOB_NOT_FOUND, JP_cancel(pool, 12345));
+	JP_free(pool);
+	HT_freeTable(table);
+}
+
+/**
+@fn test_JP_forget
+@brief Tests the functionality of JP_forget().
+@details Verifies that a pending job cannot be forgotten, that a finished one
+can, and that its id is unknown afterwards while its variable remains.
+*/
+void test_JP_forget ()
+{
+	HashTable *table = HT_newTable(16);
+	JobPool *pool = JP_new(table, 1);
+	atomic_store(&isReleased, false);
+	unsigned int id;
+	TEST_ASSERT_EQUAL_INT(0, JP_submit(pool, "r", VT_RATIONAL, blockedJob, NULL,
+		NULL, &id));
+	TEST_ASSERT_EQUAL_INT(FAIL_JOB_PENDING, JP_forget(pool, id));
+	atomic_store(&isReleased, true);
+	TEST_ASSERT_EQUAL_INT(0, JP_wait(pool, id));
+	TEST_ASSERT_EQUAL_INT(0, JP_forget(pool, id));
+	JobState state;
+	TEST_ASSERT_EQUAL_INT(FAIL_JOB_NOT_FOUND, JP_status(pool, id, &state, NULL));
+	TEST_ASSERT_EQUAL_INT(FAIL_JOB_NOT_FOUND, JP_wait(pool, id));
+	TEST_ASSERT_EQUAL_INT(FAIL_JOB_NOT_FOUND, JP_forget(pool, id));
+	TEST_ASSERT_NULL(pool->jobs);
+	Rational r;
+	TEST_ASSERT_EQUAL_INT(0, JP_get(pool, "r", &r, NULL));
+	TEST_ASSERT_EQUAL_INT32(7, r.top);
+	TEST_ASSERT_EQUAL_INT32(2, r.bottom);
+	JP_free(pool);
+	HT_freeTable(table);
+}
+
+/**
+@fn test_JP_fullTable
+@brief Tests jobs whose results fill the pool's table.
+@details The job which fills the table must succeed and leave its buffer with
+the table, and a job for another new variable must fail without adding it.
+*/
+void test_JP_fullTable ()
+{
+	HashTable *table = HT_newTable(2);
+	JobPool *pool = JP_new(table, 1);
+	Matrix *a = filledMatrix(1);
+	TEST_ASSERT_EQUAL_INT(0, JP_set(pool, "v0", a, VT_MATRIX));
+	free(a);
+	a = (Matrix *)HT_get(table, "v0", NULL);
+	MatrixTerm term = ME_element((Rational){2, 1}, a);
+	unsigned int id;
+	TEST_ASSERT_EQUAL_INT(0,
+		JP_submitExpression(pool, "v2", &term, 1, TEST_SIZE, TEST_SIZE, &id));
+	TEST_ASSERT_EQUAL_INT(0, JP_wait(pool, id));
+	TEST_ASSERT_EQUAL_INT(0,
+		JP_submitExpression(pool, "v3", &term, 1, TEST_SIZE, TEST_SIZE, &id));
+	TEST_ASSERT_EQUAL_INT(FAIL_TABLE_FULL, JP_wait(pool, id));
+	TEST_ASSERT_NULL(HT_get(table, "v3", NULL));
+
+	/* New buffers of the same size must not reuse the result's. */
+	Matrix *reused = filledMatrix(99);
+	Matrix *v2 = (Matrix *)HT_get(table, "v2", NULL);
+	TEST_ASSERT_NOT_NULL(v2);
+	for (size_t i = 0; i < (size_t)TEST_SIZE * TEST_SIZE; i++)
+	{
+		TEST_ASSERT_EQUAL_INT32(2, v2->elements[i].top);
+	}
+	M_free(reused);
+	JP_free(pool);
+	HT_freeTable(table);
+}
+
+int main ()
+{
+	/* Initialize Unity. */
+	UNITY_BEGIN();
+	/* Call each test function using Unity's RUN_TEST() function. */
+	RUN_TEST(test_JP_submitExpression);
+	RUN_TEST(test_JP_get_copy);
+	RUN_TEST(test_JP_cancel);
+	RUN_TEST(test_JP_forget);
+	RUN_TEST(test_JP_fullTable);
+	/* Once each test is complete, return Unity's result. */
+	return UNITY_END();
+}
\ No newline at end of file
@@ -0,0 +1,285 @@
+/**
+@file TestLinearSolve.c
+@author Rob Thomas
+@brief Contains Unity functions for testing the functionality of
+LinearSolve.c.
+*/
+
+/*** INCLUDES: ***/
+#include <string.h>
+
+#include "unity.h"
+#include "LinearSolve.h"
+#include "Matrix.h"
+#include "MatrixExpr.h"
+#include "Random.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define TEST_PRIME_1 2147483647
+#define TEST_PRIME_2 2147483629
+#define TEST_PRIME_3 2147483587
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn diagonal
+@brief Creates a square Matrix with the given values on its diagonal.
+@param n The number of rows (and columns).
+@param values The n diagonal values.
+@return A pointer to the new Matrix.
+*/
+static Matrix *diagonal (unsigned int n, const int32_t *values)
+{
+	Matrix *m = M_new(n, n);
+	memset(m->elements, 0, sizeof(Rational) * n * n);
+	for (unsigned int i = 0; i < n; i++)
+	{
+		for (unsigned int j = 0; j < n; j++)
+		{
+			M_AT(m, i, j).bottom = 1;
+		}
+		M_AT(m, i, i).top = values[i];
+	}
+	M_rehash(m);
+	return m;
+}
+
+/**
+@fn test_LS_solve
+@brief Tests the functionality of LS_factor() and LS_solve().
+@details Builds random systems with known fractional solutions and verifies
+that they are recovered exactly, for several sizes and right-hand sides.
+*/
+void test_LS_solve ()
+{
+	int32_t errorType;
+	for (unsigned int n = 1; n <= 24; n += 23)
+	{
+		Matrix *a = M_new(n, n);
+		Matrix *expected = M_new(n, 3);
+		Matrix *b = M_new(n, 3);
+		Matrix *x = M_new(n, 3);
+		for (size_t i = 0; i < (size_t)n * n; i++)
+		{
+			R_reduce64(&a->elements[i], Random_in_range(-9, 9, &errorType),
+				Random_in_range(1, 2, &errorType));
+		}
+		for (size_t i = 0; i < (size_t)n * 3; i++)
+		{
+			R_reduce64(&expected->elements[i], Random_in_range(-100, 100,
+				&errorType), Random_in_range(1, 4, &errorType));
+		}
+		/* Make a diagonally dominant, so that it is non-singular. The values
+		   are kept small so that B = A * X fits in Rationals. */
+		for (unsigned int i = 0; i < n; i++)
+		{
+			M_AT(a, i, i).top = 250;
+			M_AT(a, i, i).bottom = 1;
+		}
+		M_rehash(a);
+		M_rehash(expected);
+		MatrixTerm term = ME_product((Rational){1, 1}, a, expected);
+		TEST_ASSERT_EQUAL_INT(0, ME_evaluate(b, &term, 1));
+		LS_Factorization *f;
+		TEST_ASSERT_EQUAL_INT(0, LS_factor(a, &f));
+		TEST_ASSERT_EQUAL_INT(0, LS_solve(f, b, x));
+		TEST_ASSERT_EQUAL_MEMORY(expected->elements, x->elements,
+			sizeof(Rational) * n * 3);
+		LS_free(f);
+		M_free(a);
+		M_free(expected);
+		M_free(b);
+		M_free(x);
+	}
+}
+
+/**
+@fn test_LS_factor_unluckyPrimes
+@brief Tests that LS_factor() and LS_rank() are not fooled by a Matrix whose
+determinant is divisible by every prime tried first.
+@details diag(p1, p2, p3, 1, 1) is non-singular, but singular modulo each of
+the first primes LS_factor tries. Verifies that it is factored and solved,
+that its rank is 5, and that replacing a 1 with a 0 gives rank 4 and
+ERR_SINGULAR.
+*/
+void test_LS_factor_unluckyPrimes ()
+{
+	int32_t values[5] = {TEST_PRIME_1, TEST_PRIME_2, TEST_PRIME_3, 1, 1};
+	Matrix *a = diagonal(5, values);
+	LS_Factorization *f;
+	TEST_ASSERT_EQUAL_INT(0, LS_factor(a, &f));
+	unsigned int rank;
+	TEST_ASSERT_EQUAL_INT(0, LS_rank(a, &rank));
+	TEST_ASSERT_EQUAL_UINT(5, rank);
+	/* Solve for x = (1, -2/p2, 3/p3, 4, 1/2). */
+	Rational b[5] = {{TEST_PRIME_1, 1}, {-2, 1}, {3, 1}, {4, 1}, {1, 2}};
+	Matrix *rhs = M_new(5, 1);
+	Matrix *x = M_new(5, 1);
+	memcpy(rhs->elements, b, sizeof(b));
+	M_rehash(rhs);
+	TEST_ASSERT_EQUAL_INT(0, LS_solve(f, rhs, x));
+	TEST_ASSERT_EQUAL_INT32(1, M_AT(x, 0, 0).top);
+	TEST_ASSERT_EQUAL_INT32(-2, M_AT(x, 1, 0).top);
+	TEST_ASSERT_EQUAL_INT32(TEST_PRIME_2, M_AT(x, 1, 0).bottom);
+	TEST_ASSERT_EQUAL_INT32(3, M_AT(x, 2, 0).top);
+	TEST_ASSERT_EQUAL_INT32(TEST_PRIME_3, M_AT(x, 2, 0).bottom);
+	TEST_ASSERT_EQUAL_INT32(4, M_AT(x, 3, 0).top);
+	TEST_ASSERT_EQUAL_INT32(1, M_AT(x, 4, 0).top);
+	TEST_ASSERT_EQUAL_INT32(2, M_AT(x, 4, 0).bottom);
+	LS_free(f);
+	M_free(a);
+	/* With a zero on the diagonal it really is singular. */
+	values[3] = 0;
+	a = diagonal(5, values);
+	TEST_ASSERT_EQUAL_INT(ERR_SINGULAR, LS_factor(a, &f));
+	TEST_ASSERT_EQUAL_INT(0, LS_rank(a, &rank));
+	TEST_ASSERT_EQUAL_UINT(4, rank);
+	M_free(a);
+	M_free(rhs);
+	M_free(x);
+}
+
+/**
+@fn test_LS_rank
+@brief Tests the functionality of LS_rank().
+@details Builds matrices of known rank as sums of outer products and verifies
+their rank, and that LS_factor() reports the rank-deficient ones as singular.
+*/
+void test_LS_rank ()
+{
+	int32_t errorType;
+	unsigned int n = 8;
+	for (unsigned int expected = 0; expected <= n; expected += 2)
+	{
+		Matrix *left = M_new(n, expected ? expected : 1);
+		Matrix *right = M_new(expected ? expected : 1, n);
+		Matrix *a = M_new(n, n);
+		for (size_t i = 0; i < (size_t)n * left->numCols; i++)
+		{
+			left->elements[i] = (Rational){Random_in_range(-9, 9, &errorType), 1};
+			right->elements[i] = (Rational){Random_in_range(-9, 9, &errorType), 1};
+		}
+		/* Make the leading block of left the identity so its rank is full. */
+		for (unsigned int i = 0; i < expected; i++)
+		{
+			for (unsigned int j = 0; j < expected; j++)
+			{
+				M_AT(left, i, j).top = i == j;
+				M_AT(right, i, j).top = i == j;
+			}
+		}
+		M_rehash(left);
+		M_rehash(right);
+		MatrixTerm term = ME_product((Rational){expected ? 1 : 0, 1}, left,
+			right);
+		TEST_ASSERT_EQUAL_INT(0, ME_evaluate(a, &term, 1));
+		unsigned int rank;
+		TEST_ASSERT_EQUAL_INT(0, LS_rank(a, &rank));
+		TEST_ASSERT_EQUAL_UINT(expected, rank);
+		LS_Factorization *f;
+		int error = LS_factor(a, &f);
+		TEST_ASSERT_EQUAL_INT(expected == n ? 0 : ERR_SINGULAR, error);
+		if ( !error )
+		{
+			LS_free(f);
+		}
+		M_free(left);
+		M_free(right);
+		M_free(a);
+	}
+}
+
+/**
+@fn test_LS_determinant
+@brief Tests the functionality of LS_determinant().
+@details Builds a Matrix of known determinant from a triangular one by adding
+multiples of rows to other rows and swapping two rows, then verifies its
+determinant.
+*/
+void test_LS_determinant ()
+{
+	int32_t errorType;
+	unsigned int n = 6;
+	Rational diagonalValues[6] = {{2, 1}, {-3, 1}, {1, 2}, {5, 1}, {7, 3}, {1, 1}};
+	Matrix *a = M_new(n, n);
+	for (unsigned int i = 0; i < n; i++)
+	{
+		for (unsigned int j = 0; j < n; j++)
+		{
+			M_AT(a, i, j) = (Rational){j > i ? Random_in_range(-9, 9, &errorType) :
+				0, 1};
+		}
+		M_AT(a, i, i) = diagonalValues[i];
+	}
+	for (unsigned int step = 0; step < 10; step++)
+	{
+		unsigned int dest = step % n, src = (step * 5 + 1) % n;
+		Rational factor = {Random_in_range(-4, 4, &errorType), 1};
+		for (unsigned int j = 0; j < n && dest != src; j++)
+		{
+			Rational product = M_AT(a, src, j);
+			R_multR(&product, factor);
+			R_addR(&M_AT(a, dest, j), product);
+		}
+	}
+	for (unsigned int j = 0; j < n; j++)
+	{
+		Rational swap = M_AT(a, 0, j);
+		M_AT(a, 0, j) = M_AT(a, 3, j);
+		M_AT(a, 3, j) = swap;
+	}
+	M_rehash(a);
+	LS_Factorization *f;
+	TEST_ASSERT_EQUAL_INT(0, LS_factor(a, &f));
+	Rational determinant;
+	TEST_ASSERT_EQUAL_INT(0, LS_determinant(f, &determinant));
+	/* -(2 * -3 * 1/2 * 5 * 7/3 * 1) = 35 */
+	TEST_ASSERT_EQUAL_INT32(35, determinant.top);
+	TEST_ASSERT_EQUAL_INT32(1, determinant.bottom);
+	LS_free(f);
+	M_free(a);
+}
+
+/**
+@fn test_LS_solve_overflow
+@brief Tests that LS_solve() reports a right-hand side it cannot scale.
+@details The first row's bottoms are two large primes, so its scale is near
+2^62 and scaling a large top by it overflows 64 bits. Verifies that this is
+reported as ERR_SOLVE_OVERFLOW.
+*/
+void test_LS_solve_overflow ()
+{
+	Matrix *a = M_new(2, 2);
+	M_AT(a, 0, 0) = (Rational){1, TEST_PRIME_1};
+	M_AT(a, 0, 1) = (Rational){1, TEST_PRIME_2};
+	M_AT(a, 1, 0) = (Rational){1, 1};
+	M_AT(a, 1, 1) = (Rational){2, 1};
+	M_rehash(a);
+	Matrix *b = M_new(2, 1);
+	M_AT(b, 0, 0) = (Rational){1000000, 1};
+	M_AT(b, 1, 0) = (Rational){1, 1};
+	M_rehash(b);
+	Matrix *x = M_new(2, 1);
+	LS_Factorization *f;
+	TEST_ASSERT_EQUAL_INT(0, LS_factor(a, &f));
+	TEST_ASSERT_EQUAL_INT(ERR_SOLVE_OVERFLOW, LS_solve(f, b, x));
+	LS_free(f);
+	M_free(a);
+	M_free(b);
+	M_free(x);
+}
+
+int main ()
+{
+	/* Initialize Unity. */
+	UNITY_BEGIN();
+	/* Call each test function using Unity's RUN_TEST() function. */
+	RUN_TEST(test_LS_solve);
+	RUN_TEST(test_LS_factor_unluckyPrimes);
+	RUN_TEST(test_LS_rank);
+	RUN_TEST(test_LS_determinant);
+	RUN_TEST(test_LS_solve_overflow);
+	/* Once each test is complete, return Unity's result. */
+	return UNITY_END();
+}
\ No newline at end of file
@@ -0,0 +1,390 @@
+/**
+@file TestMatrixExpr.c
+@author Rob Thomas
+@brief Contains Unity functions for testing the functionality of MatrixExpr.c.
+*/
+
+/*** INCLUDES: ***/
+#include "unity.h"
+#include "Matrix.h"
+#include "MatrixExpr.h"
+#include "Random.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define TEST_MAX_ENTRY 9
+#define TEST_MAX_TERMS 4
+
+/*** FUNCTION DEFINITIONS: ***/
+
+void setUp ()
+{
+}
+
+void tearDown ()
+{
+}
+
+/**
+@fn randomMatrix
+@brief Creates a Matrix of small random integers or fractions.
+@param numRows The number of rows.
+@param numCols The number of columns.
+@param isInteger Whether every element should be an integer.
+@return A pointer to the new Matrix.
+*/
+static Matrix *randomMatrix (unsigned int numRows, unsigned int numCols,
+	bool isInteger)
+{
+	int error;
+	Matrix *m = M_new(numRows, numCols);
+	for (size_t i = 0; i < (size_t)numRows * numCols; i++)
+	{
+		R_reduce64(&m->elements[i],
+			Random_in_range(-TEST_MAX_ENTRY, TEST_MAX_ENTRY, &error),
+			isInteger ? 1 : Random_in_range(1, TEST_MAX_ENTRY, &error));
+	}
+	M_rehash(m);
+	return m;
+}
+
+/**
+@fn referenceEvaluate
+@brief Evaluates a list of terms one Rational operation at a time, reading
+copies of the operands taken before the call, so that the result is not
+affected by any operand aliasing the destination.
+@param terms The list of terms.
+@param numTerms The number of terms in the list.
+@param numRows The number of rows of the result.
+@param numCols The number of columns of the result.
+@return A pointer to a new Matrix holding the result.
+*/
+static Matrix *referenceEvaluate (MatrixTerm *terms, unsigned int numTerms,
+	unsigned int numRows, unsigned int numCols)
+{
+	Matrix *result = M_new(numRows, numCols);
+	for (unsigned int t = 0; t < numTerms; t++)
+	{
+		Matrix *left = M_copy(terms[t].left);
+		Matrix *right = terms[t].type == MT_PRODUCT ? M_copy(terms[t].right) :
+			NULL;
+		for (unsigned int i = 0; i < numRows; i++)
+		{
+			for (unsigned int j = 0; j < numCols; j++)
+			{
+				Rational value = {0, 1};
+				if ( !right )
+				{
+					value = M_AT(left, i, j);
+				}
+				else
+				{
+					for (unsigned int k = 0; k < left->numCols; k++)
+					{
+						Rational product = M_AT(left, i, k);
+						R_multR(&product, M_AT(right, k, j));
+						R_addR(&value, product);
+					}
+				}
+				R_multR(&value, terms[t].coefficient);
+				R_addR(&M_AT(result, i, j), value);
+			}
+		}
+		M_free(left);
+		M_free(right);
+	}
+	M_rehash(result);
+	return result;
+}
+
+/**
+@fn assertEqualMatrices
+@brief Asserts that two matrices have the same dimensions, reduced entries,
+content hash and integer flag.
+@param expected Pointer to the expected Matrix.
+@param actual Pointer to the Matrix to check.
+*/
+static void assertEqualMatrices (Matrix *expected, Matrix *actual)
+{
+	TEST_ASSERT_EQUAL_UINT(expected->numRows, actual->numRows);
+	TEST_ASSERT_EQUAL_UINT(expected->numCols, actual->numCols);
+	for (size_t i = 0; i < (size_t)expected->numRows * expected->numCols; i++)
+	{
+		TEST_ASSERT_EQUAL_INT32(expected->elements[i].top,
+			actual->elements[i].top);
+		TEST_ASSERT_EQUAL_INT32(expected->elements[i].bottom,
+			actual->elements[i].bottom);
+	}
+	TEST_ASSERT_EQUAL_UINT64(expected->contentHash, actual->contentHash);
+	TEST_ASSERT_EQUAL_INT(expected->isInteger, actual->isInteger);
+}
+
+/**
+@fn checkEvaluate
+@brief Evaluates a list of terms into dest and compares the result against
+referenceEvaluate().
+@param dest Pointer to the destination Matrix. May alias an operand.
+@param terms The list of terms.
+@param numTerms The number of terms in the list.
+*/
+static void checkEvaluate (Matrix *dest, MatrixTerm *terms,
+	unsigned int numTerms)
+{
+	Matrix *expected = referenceEvaluate(terms, numTerms, dest->numRows,
+		dest->numCols);
+	TEST_ASSERT_EQUAL_INT(0, ME_evaluate(dest, terms, numTerms));
+	assertEqualMatrices(expected, dest);
+	M_free(expected);
+}
+
+/**
+@fn test_ME_terms
+@brief Tests the functionality of ME_element() and ME_product().
+*/
+void test_ME_terms ()
+{
+	Matrix *a = M_new(2, 3);
+	Matrix *b = M_new(3, 2);
+	MatrixTerm term = ME_element((Rational){-1, 2}, a);
+	TEST_ASSERT_EQUAL_INT(MT_ELEMENT, term.type);
+	TEST_ASSERT_EQUAL_INT32(-1, term.coefficient.top);
+	TEST_ASSERT_EQUAL_INT32(2, term.coefficient.bottom);
+	TEST_ASSERT_EQUAL_PTR(a, term.left);
+	TEST_ASSERT_NULL(term.right);
+	term = ME_product((Rational){3, 1}, a, b);
+	TEST_ASSERT_EQUAL_INT(MT_PRODUCT, term.type);
+	TEST_ASSERT_EQUAL_INT32(3, term.coefficient.top);
+	TEST_ASSERT_EQUAL_PTR(a, term.left);
+	TEST_ASSERT_EQUAL_PTR(b, term.right);
+	M_free(a);
+	M_free(b);
+}
+
+/**
+@fn test_ME_evaluate
+@brief Tests ME_evaluate() on expressions which mix element and product terms.
+@details Covers all-integer expressions, which take the 64-bit integer path,
+and expressions with a fractional operand or coefficient, which take the
+Rational path, on shapes too large for the small-matrix kernels.
+*/
+void test_ME_evaluate ()
+{
+	for (int isInteger = 0; isInteger < 2; isInteger++)
+	{
+		Matrix *a = randomMatrix(6, 9, isInteger);
+		Matrix *b = randomMatrix(9, 7, isInteger);
+		Matrix *c = randomMatrix(6, 7, isInteger);
+		Matrix *dest = M_new(6, 7);
+		MatrixTerm terms[TEST_MAX_TERMS] = {
+			ME_product((Rational){2, 1}, a, b),
+			ME_element((Rational){1, 1}, c),
+			ME_element((Rational){-3, 1}, c),
+			ME_product((Rational){0, 1}, a, b)};
+		checkEvaluate(dest, terms, TEST_MAX_TERMS);
+		TEST_ASSERT_EQUAL_INT(isInteger, dest->isInteger);
+
+		/* A fractional coefficient moves an integer expression onto the
+		   Rational path. */
+		terms[1].coefficient = (Rational){1, 3};
+		checkEvaluate(dest, terms, 2);
+		M_free(a);
+		M_free(b);
+		M_free(c);
+		M_free(dest);
+	}
+}
+
+/**
+@fn test_ME_evaluate_integerPath
+@brief Tests that all-integer expressions are evaluated in 64 bits.
+@details Each product of 50000 * 50000 exceeds 32 bits, so the result is only
+exact if the products are accumulated in 64 bits before being narrowed. The
+difference of two such products is small again.
+*/
+void test_ME_evaluate_integerPath ()
+{
+	Matrix *a = M_new(5, 5);
+	Matrix *b = M_new(5, 5);
+	for (unsigned int i = 0; i < 5; i++)
+	{
+		for (unsigned int j = 0; j < 5; j++)
+		{
+			M_AT(a, i, j) = (Rational){50000, 1};
+			M_AT(b, i, j) = (Rational){i == j ? 50001 : 50000, 1};
+		}
+	}
+	M_rehash(a);
+	M_rehash(b);
+	Matrix *dest = M_new(5, 5);
+	MatrixTerm terms[2] = {ME_product((Rational){1, 1}, a, b),
+		ME_product((Rational){-1, 1}, a, a)};
+	TEST_ASSERT_EQUAL_INT(0, ME_evaluate(dest, terms, 2));
+	for (unsigned int i = 0; i < 5; i++)
+	{
+		for (unsigned int j = 0; j < 5; j++)
+		{
+			TEST_ASSERT_EQUAL_INT32(50000, M_AT(dest, i, j).top);
+			TEST_ASSERT_EQUAL_INT32(1, M_AT(dest, i, j).bottom);
+		}
+	}
+	TEST_ASSERT_TRUE(dest->isInteger);
+	M_free(a);
+	M_free(b);
+	M_free(dest);
+}
+
+/**
+@fn test_ME_evaluate_aliasElement
+@brief Tests ME_evaluate() when dest is the Matrix of an element term, as in
+C = A*B + C.
+*/
+void test_ME_evaluate_aliasElement ()
+{
+	unsigned int sizes[] = {3, 7};
+	for (int isInteger = 0; isInteger < 2; isInteger++)
+	{
+		for (int s = 0; s < 2; s++)
+		{
+			unsigned int n = sizes[s];
+			Matrix *a = randomMatrix(n, n + 2, isInteger);
+			Matrix *b = randomMatrix(n + 2, n, isInteger);
+			Matrix *c = randomMatrix(n, n, isInteger);
+			MatrixTerm terms[2] = {ME_product((Rational){1, 1}, a, b),
+				ME_element((Rational){-2, 1}, c)};
+			checkEvaluate(c, terms, 2);
+			M_free(a);
+			M_free(b);
+			M_free(c);
+		}
+	}
+}
+
+/**
+@fn test_ME_evaluate_aliasLeft
+@brief Tests ME_evaluate() when dest is the left operand of a product, as in
+X = X*B + X, and as a lone product, X = X*B.
+*/
+void test_ME_evaluate_aliasLeft ()
+{
+	unsigned int sizes[] = {3, 7};
+	for (int isInteger = 0; isInteger < 2; isInteger++)
+	{
+		for (int s = 0; s < 2; s++)
+		{
+			unsigned int n = sizes[s];
+			Matrix *x = randomMatrix(n + 1, n, isInteger);
+			Matrix *b = randomMatrix(n, n, isInteger);
+			MatrixTerm terms[2] = {ME_product((Rational){3, 1}, x, b),
+				ME_element((Rational){1, 1}, x)};
+			checkEvaluate(x, terms, 2);
+			checkEvaluate(x, terms, 1);
+			M_free(x);
+			M_free(b);
+		}
+	}
+}
+
+/**
+@fn test_ME_evaluate_aliasRight
+@brief Tests ME_evaluate() when dest is the right operand of a product, which
+has to be copied, as in X = A*X - X, X = X*X and X = A*X.
+*/
+void test_ME_evaluate_aliasRight ()
+{
+	unsigned int sizes[] = {3, 7};
+	for (int isInteger = 0; isInteger < 2; isInteger++)
+	{
+		for (int s = 0; s < 2; s++)
+		{
+			unsigned int n = sizes[s];
+			Matrix *a = randomMatrix(n, n, isInteger);
+			Matrix *x = randomMatrix(n, n + 1, isInteger);
+			MatrixTerm terms[2] = {ME_product((Rational){1, 1}, a, x),
+				ME_element((Rational){-1, 1}, x)};
+			checkEvaluate(x, terms, 2);
+			checkEvaluate(x, terms, 1);
+			M_free(x);
+
+			/* Both operands of the product alias dest. */
+			x = randomMatrix(n, n, isInteger);
+			terms[0] = ME_product((Rational){1, 2}, x, x);
+			checkEvaluate(x, terms, 1);
+			M_free(a);
+			M_free(x);
+		}
+	}
+}
+
+/**
+@fn test_ME_evaluate_overflow
+@brief Tests that an all-integer expression whose result does not fit in a
+Rational is reported instead of being truncated.
+@details Every element of A*A is n * 50000^2, which needs more than 32 bits,
+for the small-matrix kernels and for the general path alike.
+*/
+void test_ME_evaluate_overflow ()
+{
+	unsigned int sizes[] = {3, 6};
+	for (int s = 0; s < 2; s++)
+	{
+		unsigned int n = sizes[s];
+		Matrix *a = M_new(n, n);
+		for (size_t i = 0; i < (size_t)n * n; i++)
+		{
+			a->elements[i] = (Rational){50000, 1};
+		}
+		M_rehash(a);
+		Matrix *dest = M_new(n, n);
+		MatrixTerm terms[2] = {ME_product((Rational){1, 1}, a, a),
+			ME_element((Rational){1, 1}, a)};
+		TEST_ASSERT_EQUAL_INT(ERR_EXPR_OVERFLOW, ME_evaluate(dest, terms, 1));
+		TEST_ASSERT_EQUAL_INT(ERR_EXPR_OVERFLOW, ME_evaluate(dest, terms, 2));
+
+		/* Summing to more than 32 bits without any product overflows too. */
+		terms[0] = ME_element((Rational){INT32_MAX, 1}, a);
+		TEST_ASSERT_EQUAL_INT(ERR_EXPR_OVERFLOW, ME_evaluate(dest, terms, 1));
+		M_free(a);
+		M_free(dest);
+	}
+}
+
+/**
+@fn test_ME_evaluate_errors
+@brief Tests the errors reported by ME_evaluate(), and that dest is left
+unchanged by them.
+*/
+void test_ME_evaluate_errors ()
+{
+	Matrix *a = randomMatrix(4, 5, true);
+	Matrix *b = randomMatrix(4, 5, true);
+	Matrix *dest = randomMatrix(4, 5, false);
+	Matrix *before = M_copy(dest);
+	MatrixTerm terms[2] = {ME_element((Rational){1, 1}, a),
+		ME_product((Rational){1, 1}, a, b)};
+	TEST_ASSERT_EQUAL_INT(ERR_NO_TERMS, ME_evaluate(dest, terms, 0));
+	TEST_ASSERT_EQUAL_INT(ERR_DIMENSION_MISMATCH, ME_evaluate(dest, terms, 2));
+	terms[0] = ME_element((Rational){1, 1}, dest);
+	terms[1] = ME_element((Rational){1, 1}, a);
+	Matrix *wrong = M_new(5, 4);
+	TEST_ASSERT_EQUAL_INT(ERR_DIMENSION_MISMATCH, ME_evaluate(wrong, terms, 2));
+	assertEqualMatrices(before, dest);
+	M_free(a);
+	M_free(b);
+	M_free(dest);
+	M_free(before);
+	M_free(wrong);
+}
+
+int main ()
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_ME_terms);
+	RUN_TEST(test_ME_evaluate);
+	RUN_TEST(test_ME_evaluate_integerPath);
+	RUN_TEST(test_ME_evaluate_aliasElement);
+	RUN_TEST(test_ME_evaluate_aliasLeft);
+	RUN_TEST(test_ME_evaluate_aliasRight);
+	RUN_TEST(test_ME_evaluate_overflow);
+	RUN_TEST(test_ME_evaluate_errors);
+	return UNITY_END();
+}
\ No newline at end of file
@@ -0,0 +1,178 @@
+/**
+@file TestMatrixFactor.c
+@author Rob Thomas
+@brief Contains Unity functions for testing the functionality of
+MatrixFactor.c.
+*/
+
+/*** INCLUDES: ***/
+#include <string.h>
+
+#include "unity.h"
+#include "HashTable.h"
+#include "LinearSolve.h"
+#include "Matrix.h"
+#include "MatrixFactor.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define TEST_PRIME_1 2147483647
+#define TEST_PRIME_2 2147483629
+#define TEST_PRIME_3 2147483587
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn addDiagonal
+@brief Adds a square Matrix with the given values on its diagonal to a
+HashTable.
+@param table Pointer to the HashTable.
+@param key The key of the new variable.
+@param n The number of rows (and columns).
+@param values The n diagonal values.
+*/
+static void addDiagonal (HashTable *table, char *key, unsigned int n,
+	const Rational *values)
+{
+	Matrix *m = M_new(n, n);
+	for (unsigned int i = 0; i < n; i++)
+	{
+		for (unsigned int j = 0; j < n; j++)
+		{
+			M_AT(m, i, j) = i == j ? values[i] : (Rational){0, 1};
+		}
+	}
+	M_rehash(m);
+	TEST_ASSERT_EQUAL_INT(0, HT_add(table, key, m, VT_MATRIX));
+	/* The table now owns the elements. */
+	free(m);
+}
+
+/**
+@fn test_MF_unluckyPrimes
+@brief Tests MF_determinant() and MF_rank() on matrices whose determinants are
+divisible by every prime LS_factor tries first.
+@details diag(p1, p2, p3, 1, 1) is non-singular, so its rank is 5 and its
+determinant, which does not fit in a Rational, is an overflow rather than 0.
+diag(p1, p2, p3, 1/p1, 1/p2, 1) has determinant p3. Verifies both, and that
+the results are the same once they come from the cache.
+*/
+void test_MF_unluckyPrimes ()
+{
+	HashTable *table = HT_newTable(16);
+	Rational first[5] = {{TEST_PRIME_1, 1}, {TEST_PRIME_2, 1},
+		{TEST_PRIME_3, 1}, {1, 1}, {1, 1}};
+	Rational second[6] = {{TEST_PRIME_1, 1}, {TEST_PRIME_2, 1},
+		{TEST_PRIME_3, 1}, {1, TEST_PRIME_1}, {1, TEST_PRIME_2}, {1, 1}};
+	addDiagonal(table, "a", 5, first);
+	addDiagonal(table, "b", 6, second);
+	for (int pass = 0; pass < 2; pass++)
+	{
+		unsigned int rank;
+		Rational determinant;
+		TEST_ASSERT_EQUAL_INT(0, MF_rank(table, "a", &rank));
+		TEST_ASSERT_EQUAL_UINT(5, rank);
+		TEST_ASSERT_EQUAL_INT(ERR_SOLVE_OVERFLOW,
+			MF_determinant(table, "a", &determinant));
+		TEST_ASSERT_EQUAL_INT(0, MF_rank(table, "b", &rank));
+		TEST_ASSERT_EQUAL_UINT(6, rank);
+		TEST_ASSERT_EQUAL_INT(0, MF_determinant(table, "b", &determinant));
+		TEST_ASSERT_EQUAL_INT32(TEST_PRIME_3, determinant.top);
+		TEST_ASSERT_EQUAL_INT32(1, determinant.bottom);
+	}
+	HT_freeTable(table);
+}
+
+/**
+@fn test_MF_singular
+@brief Tests the functions of MatrixFactor.c on a singular Matrix.
+@details Verifies that the determinant is 0, the rank is right, and solving
+and inverting report ERR_SINGULAR.
+*/
+void test_MF_singular ()
+{
+	HashTable *table = HT_newTable(16);
+	Rational values[6] = {{3, 1}, {0, 1}, {1, 2}, {0, 1}, {-4, 1}, {1, 1}};
+	addDiagonal(table, "a", 6, values);
+	unsigned int rank;
+	Rational determinant;
+	TEST_ASSERT_EQUAL_INT(0, MF_rank(table, "a", &rank));
+	TEST_ASSERT_EQUAL_UINT(4, rank);
+	TEST_ASSERT_EQUAL_INT(0, MF_determinant(table, "a", &determinant));
+	TEST_ASSERT_EQUAL_INT32(0, determinant.top);
+	Matrix *b = M_new(6, 1);
+	Matrix *x = M_new(6, 1);
+	for (unsigned int i = 0; i < 6; i++)
+	{
+		M_AT(b, i, 0) = (Rational){1, 1};
+	}
+	M_rehash(b);
+	TEST_ASSERT_EQUAL_INT(ERR_SINGULAR, MF_solve(table, "a", b, x));
+	Matrix *inverse = M_new(6, 6);
+	TEST_ASSERT_EQUAL_INT(ERR_SINGULAR, MF_inverse(table, "a", inverse));
+	TEST_ASSERT_EQUAL_INT(FAIL_KEY_NOT_FOUND, MF_rank(table, "missing", &rank));
+	M_free(b);
+	M_free(x);
+	M_free(inverse);
+	HT_freeTable(table);
+}
+
+/**
+@fn test_MF_inverse
+@brief Tests the functionality of MF_solve(), MF_inverse() and
+MF_determinant() on a non-singular Matrix.
+@details Uses a 5x5 Matrix with 2 on the diagonal and 1 just above it, whose
+inverse is known. Verifies the determinant, one solution and the inverse, and
+that reassigning the variable discards the cached factorization.
+*/
+void test_MF_inverse ()
+{
+	HashTable *table = HT_newTable(16);
+	unsigned int n = 5;
+	Matrix *m = M_new(n, n);
+	for (unsigned int i = 0; i < n; i++)
+	{
+		for (unsigned int j = 0; j < n; j++)
+		{
+			M_AT(m, i, j) = (Rational){i == j ? 2 : j == i + 1 ? 1 : 0, 1};
+		}
+	}
+	M_rehash(m);
+	TEST_ASSERT_EQUAL_INT(0, HT_add(table, "a", m, VT_MATRIX));
+	free(m);
+	Rational determinant;
+	TEST_ASSERT_EQUAL_INT(0, MF_determinant(table, "a", &determinant));
+	TEST_ASSERT_EQUAL_INT32(32, determinant.top);
+	/* The inverse has (-1)^(j-i) / 2^(j-i+1) on and above the diagonal. */
+	Matrix *inverse = M_new(n, n);
+	TEST_ASSERT_EQUAL_INT(0, MF_inverse(table, "a", inverse));
+	for (unsigned int i = 0; i < n; i++)
+	{
+		for (unsigned int j = 0; j < n; j++)
+		{
+			int32_t top = j < i ? 0 : (j - i) % 2 ? -1 : 1;
+			int32_t bottom = j < i ? 1 : 1 << (j - i + 1);
+			TEST_ASSERT_EQUAL_INT32(top, M_AT(inverse, i, j).top);
+			TEST_ASSERT_EQUAL_INT32(bottom, M_AT(inverse, i, j).bottom);
+		}
+	}
+	/* Reassigning the variable must not reuse the old factorization. */
+	Rational values[5] = {{1, 1}, {2, 1}, {3, 1}, {4, 1}, {5, 1}};
+	addDiagonal(table, "a", n, values);
+	TEST_ASSERT_EQUAL_INT(0, MF_determinant(table, "a", &determinant));
+	TEST_ASSERT_EQUAL_INT32(120, determinant.top);
+	M_free(inverse);
+	HT_freeTable(table);
+}
+
+int main ()
+{
+	/* Initialize Unity. */
+	UNITY_BEGIN();
+	/* Call each test function using Unity's RUN_TEST() function. */
+	RUN_TEST(test_MF_unluckyPrimes);
+	RUN_TEST(test_MF_singular);
+	RUN_TEST(test_MF_inverse);
+	/* Once each test is complete, return Unity's result. */
+	return UNITY_END();
+}
\ No newline at end of file
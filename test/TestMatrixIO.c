@@ -0,0 +1,155 @@
+/**
+@file TestMatrixIO.c
+@author Rob Thomas
+@brief Contains Unity functions for testing the functionality of MatrixIO.c.
+*/
+
+/*** INCLUDES: ***/
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include "unity.h"
+#include "Matrix.h"
+#include "MatrixIO.h"
+#include "Rational.h"
+
+/*** DEFINES: ***/
+#define TEST_PATH_LENGTH 64
+
+/*** GLOBALS: ***/
+static char testPath[TEST_PATH_LENGTH];
+
+/*** FUNCTION DEFINITIONS: ***/
+
+void setUp ()
+{
+	strcpy(testPath, "/tmp/test_matrixio_XXXXXX");
+	int fd = mkstemp(testPath);
+	TEST_ASSERT_TRUE(fd >= 0);
+	close(fd);
+}
+
+void tearDown ()
+{
+	unlink(testPath);
+}
+
+/**
+@fn writeText
+@brief Replaces the contents of the test file with some text.
+@param text The text to write.
+*/
+static void writeText (const char *text)
+{
+	FILE *file = fopen(testPath, "w");
+	TEST_ASSERT_NOT_NULL(file);
+	fputs(text, file);
+	fclose(file);
+}
+
+/**
+@fn test_MIO_read
+@brief Tests the functionality of MIO_read().
+@details Verifies that integers, fractions, signs and both kinds of separator
+are parsed and reduced, with one thread and with several.
+*/
+void test_MIO_read ()
+{
+	writeText("1 2/4, -3\n+4/-0x\n");
+	Matrix *m = NULL;
+	TEST_ASSERT_EQUAL_INT(ERR_IO_PARSE, MIO_read(testPath, 1, &m));
+	writeText("1 2/4, -3\n\n+4\t-6/8 0\n");
+	for (unsigned int numThreads = 1; numThreads <= 4; numThreads += 3)
+	{
+		TEST_ASSERT_EQUAL_INT(0, MIO_read(testPath, numThreads, &m));
+		TEST_ASSERT_EQUAL_UINT(2, m->numRows);
+		TEST_ASSERT_EQUAL_UINT(3, m->numCols);
+		int32_t expected[] = {1, 1, 1, 2, -3, 1, 4, 1, -3, 4, 0, 1};
+		for (unsigned int i = 0; i < 6; i++)
+		{
+			TEST_ASSERT_EQUAL_INT32(expected[2 * i], m->elements[i].top);
+			TEST_ASSERT_EQUAL_INT32(expected[2 * i + 1], m->elements[i].bottom);
+		}
+		M_free(m);
+	}
+}
+
+/**
+@fn test_MIO_read_errors
+@brief Tests the errors reported by MIO_read().
+@details Verifies that ragged rows, zero denominators and entries which do not
+fit in a Rational are rejected.
+*/
+void test_MIO_read_errors ()
+{
+	Matrix *m = NULL;
+	writeText("1 2\n3\n");
+	TEST_ASSERT_EQUAL_INT(ERR_IO_ROW_LENGTH, MIO_read(testPath, 1, &m));
+	writeText("1/0\n");
+	TEST_ASSERT_EQUAL_INT(ERR_IO_ZERO_DENOMINATOR, MIO_read(testPath, 1, &m));
+	writeText("2147483648\n");
+	TEST_ASSERT_EQUAL_INT(ERR_IO_OVERFLOW, MIO_read(testPath, 1, &m));
+	writeText("-2147483649\n");
+	TEST_ASSERT_EQUAL_INT(ERR_IO_OVERFLOW, MIO_read(testPath, 1, &m));
+	writeText("1/2147483648\n");
+	TEST_ASSERT_EQUAL_INT(ERR_IO_OVERFLOW, MIO_read(testPath, 1, &m));
+	TEST_ASSERT_EQUAL_INT(ERR_IO_FILE, MIO_read("/nonexistent/matrix", 1, &m));
+}
+
+/**
+@fn test_MIO_read_limits
+@brief Tests that MIO_read() accepts the extreme values of a Rational.
+@details Verifies that INT32_MIN and INT32_MAX are read as they are, and that
+large fractions which reduce down to 32 bits are accepted.
+*/
+void test_MIO_read_limits ()
+{
+	Matrix *m = NULL;
+	writeText("-2147483648 2147483647 -4294967296/2 1/2147483647 6442450941/3\n");
+	TEST_ASSERT_EQUAL_INT(0, MIO_read(testPath, 1, &m));
+	TEST_ASSERT_EQUAL_INT32(INT32_MIN, m->elements[0].top);
+	TEST_ASSERT_EQUAL_INT32(1, m->elements[0].bottom);
+	TEST_ASSERT_EQUAL_INT32(INT32_MAX, m->elements[1].top);
+	TEST_ASSERT_EQUAL_INT32(INT32_MIN, m->elements[2].top);
+	TEST_ASSERT_EQUAL_INT32(INT32_MAX, m->elements[3].bottom);
+	TEST_ASSERT_EQUAL_INT32(INT32_MAX, m->elements[4].top);
+	M_free(m);
+}
+
+/**
+@fn test_MIO_write
+@brief Tests the functionality of MIO_write().
+@details Verifies that a written Matrix reads back unchanged, including its
+extreme values.
+*/
+void test_MIO_write ()
+{
+	Matrix *m = M_new(3, 2);
+	Rational values[] = {{INT32_MIN, 1}, {INT32_MAX, 1}, {-1, INT32_MAX},
+		{0, 1}, {22, 7}, {-5, 1}};
+	memcpy(m->elements, values, sizeof(values));
+	M_rehash(m);
+	TEST_ASSERT_EQUAL_INT(0, MIO_write(testPath, m));
+	Matrix *read = NULL;
+	TEST_ASSERT_EQUAL_INT(0, MIO_read(testPath, 2, &read));
+	TEST_ASSERT_EQUAL_UINT(3, read->numRows);
+	TEST_ASSERT_EQUAL_UINT(2, read->numCols);
+	TEST_ASSERT_EQUAL_MEMORY(m->elements, read->elements, sizeof(values));
+	M_free(read);
+	M_free(m);
+}
+
+int main ()
+{
+	/* Initialize Unity. */
+	UNITY_BEGIN();
+	/* Call each test function using Unity's RUN_TEST() function. */
+	RUN_TEST(test_MIO_read);
+	RUN_TEST(test_MIO_read_errors);
+	RUN_TEST(test_MIO_read_limits);
+	RUN_TEST(test_MIO_write);
+	/* Once each test is complete, return Unity's result. */
+	return UNITY_END();
+}
\ No newline at end of file
@@ -49,35 +49,37 @@ void test_R_copy ()
 	free(second);
 	first->top = 0;
 	first->bottom = 0;
-	second = R_copy(first);
+	second = R_copy(*first);
 	TEST_ASSERT_EQUAL_INT32(0, second->top);
 	TEST_ASSERT_EQUAL_INT32(0, second->bottom);
 	/* Copy INT_MIN/INT_MIN and INT_MAX/INT_MAX. */
 	free(second);
 	first->top = INT_MIN;
 	first->bottom = INT_MIN;
-	second = R_copy(first);
+	second = R_copy(*first);
 	TEST_ASSERT_EQUAL_INT32(INT_MIN, second->top);
 	TEST_ASSERT_EQUAL_INT32(INT_MIN, second->bottom);
 	free(second);
 	first->top = INT_MAX;
 	first->bottom = INT_MAX;
-	second = R_copy(first);
+	second = R_copy(*first);
 	TEST_ASSERT_EQUAL_INT32(INT_MAX, second->top);
 	TEST_ASSERT_EQUAL_INT32(INT_MAX, second->bottom);
 	/* Test ten different random Rationals. */
 	int32_t top, bottom;
+	int errorType;
 	for (int i = 0; i < 10; i++)
 	{
 		top = Random_in_range(INT_MIN, INT_MAX, &errorType);
 		bottom = Random_in_range(INT_MIN, INT_MAX, &errorType);
 		first->top = top;
 		first->bottom = bottom;
-		second = R_copy(first);
+		second = R_copy(*first);
 		TEST_ASSERT_EQUAL_INT32(top, second->top);
 		TEST_ASSERT_EQUAL_INT32(bottom, second->bottom);
 		free(second);
 	}
+	free(first);
 }
 
 /**
@@ -130,8 +132,7 @@ void test_R_GCD ()
 	gcd++;
 	while ( gcd < top && gcd < bottom )
 	{
-		TEST_ASSERT(top % gcd != 0);
-		TEST_ASSERT(bottom % gcd != 0);
+		TEST_ASSERT(top % gcd != 0 || bottom % gcd != 0);
 		gcd++;
 	}
 }
@@ -154,7 +155,7 @@ void test_R_reduce ()
 	TEST_ASSERT_EQUAL_INT32(0, r.top);
 	TEST_ASSERT_EQUAL_INT32(1, r.bottom);
 	/* Test that 0/-x is reduced to 0/1. */
-	r.bottom = Random_in_range(-2, INT_MIN, &errorType);
+	r.bottom = Random_in_range(INT_MIN + 1, -2, &errorType);
 	R_reduce(&r);
 	TEST_ASSERT_EQUAL_INT32(0, r.top);
 	TEST_ASSERT_EQUAL_INT32(1, r.bottom);
@@ -181,11 +182,174 @@ void test_R_reduce ()
 	TEST_ASSERT_EQUAL_INT32(newBottom, r.bottom);
 }
 
+/**
+@fn test_R_divPrepared
+@brief Tests the functionality of R_prepareDivisor(), R_divPrepared() and
+R_divRowPrepared().
+@details Verifies that dividing by a prepared divisor gives exactly the same
+result as R_divR(), including for negative divisors, integer divisors and a
+zero divisor.
+*/
+void test_R_divPrepared ()
+{
+	int32_t errorType;
+	Rational row[64];
+	Rational expected[64];
+	RationalDivisor prepared;
+	for (int trial = 0; trial < 100; trial++)
+	{
+		/* Pick a random divisor. Every few trials, use an integer. */
+		Rational d;
+		R_reduce64(&d, Random_in_range(-1000, 1000, &errorType),
+			trial % 4 == 0 ? 1 : Random_in_range(1, 1000, &errorType));
+		R_prepareDivisor(&prepared, d);
+		for (int i = 0; i < 64; i++)
+		{
+			R_reduce64(&row[i], Random_in_range(-1000, 1000, &errorType),
+				Random_in_range(1, 1000, &errorType));
+			expected[i] = row[i];
+			R_divR(&expected[i], d);
+		}
+		/* Divide one element on its own, then the whole row. */
+		Rational single = row[0];
+		TEST_ASSERT_TRUE(R_divPrepared(&single, &prepared));
+		TEST_ASSERT_EQUAL_INT32(expected[0].top, single.top);
+		TEST_ASSERT_EQUAL_INT32(expected[0].bottom, single.bottom);
+		TEST_ASSERT_TRUE(R_divRowPrepared(row, 64, &prepared));
+		for (int i = 0; i < 64; i++)
+		{
+			TEST_ASSERT_EQUAL_INT32(expected[i].top, row[i].top);
+			TEST_ASSERT_EQUAL_INT32(expected[i].bottom, row[i].bottom);
+		}
+	}
+	/* Dividing by zero should leave a bottom of 0, as R_divR() does. */
+	Rational zero = {0, 1};
+	Rational r = {-3, 7};
+	R_prepareDivisor(&prepared, zero);
+	R_divPrepared(&r, &prepared);
+	TEST_ASSERT_EQUAL_INT32(-1, r.top);
+	TEST_ASSERT_EQUAL_INT32(0, r.bottom);
+
+	/* Quotients too large for a Rational are reported, both when dividing by
+	   an integer's reciprocal and in general. */
+	Rational divisors[2] = {{1, 4}, {3, 4}};
+	for (int k = 0; k < 2; k++)
+	{
+		R_prepareDivisor(&prepared, divisors[k]);
+		for (int i = 0; i < 64; i++)
+		{
+			R_reduce64(&row[i], i, 3);
+		}
+		TEST_ASSERT_TRUE(R_divRowPrepared(row, 64, &prepared));
+		row[17] = (Rational){INT32_MAX, 1};
+		TEST_ASSERT_FALSE(R_divRowPrepared(row, 64, &prepared));
+		r = (Rational){INT32_MAX, 1};
+		TEST_ASSERT_FALSE(R_divPrepared(&r, &prepared));
+	}
+}
+
+/**
+@fn test_R_compare
+@brief Tests the functionality of R_compare(), R_sign() and R_abs().
+@details Verifies that R_compare() agrees with the sign of the difference found
+by R_subtractR() for small Rationals, and that it orders Rationals correctly at
+the extremes of int32, where a 32-bit cross-multiply would overflow.
+*/
+void test_R_compare ()
+{
+	int32_t errorType;
+	for (int trial = 0; trial < 1000; trial++)
+	{
+		Rational a, b;
+		R_reduce64(&a, Random_in_range(-1000, 1000, &errorType),
+			Random_in_range(1, 1000, &errorType));
+		R_reduce64(&b, Random_in_range(-1000, 1000, &errorType),
+			Random_in_range(1, 1000, &errorType));
+		Rational difference = a;
+		R_subtractR(&difference, b);
+		TEST_ASSERT_EQUAL_INT(R_sign(difference), R_compare(a, b));
+		TEST_ASSERT_EQUAL_INT(-R_compare(a, b), R_compare(b, a));
+		/* The magnitude of a is at least a and at least -a. */
+		Rational magnitude = R_abs(a);
+		Rational negated = {-a.top, a.bottom};
+		TEST_ASSERT(R_sign(magnitude) >= 0);
+		TEST_ASSERT(R_compare(magnitude, a) >= 0);
+		TEST_ASSERT_EQUAL_INT(0, R_compare(magnitude, R_abs(negated)));
+	}
+	/* Unreduced forms of the same value compare equal. */
+	Rational half = {1, 2};
+	Rational twoQuarters = {2, 4};
+	TEST_ASSERT_EQUAL_INT(0, R_compare(half, twoQuarters));
+	/* Values near the limits of int32. */
+	Rational largest = {INT_MAX, 1};
+	Rational nextLargest = {INT_MAX - 1, 1};
+	Rational smallest = {INT_MIN, 1};
+	TEST_ASSERT_EQUAL_INT(1, R_compare(largest, nextLargest));
+	TEST_ASSERT_EQUAL_INT(-1, R_compare(smallest, largest));
+	Rational tiny = {1, INT_MAX};
+	Rational lessTiny = {1, INT_MAX - 1};
+	TEST_ASSERT_EQUAL_INT(-1, R_compare(tiny, lessTiny));
+	Rational almostOne = {INT_MAX - 1, INT_MAX};
+	Rational one = {1, 1};
+	TEST_ASSERT_EQUAL_INT(-1, R_compare(almostOne, one));
+	TEST_ASSERT_EQUAL_INT(-1, R_sign(smallest));
+	TEST_ASSERT_EQUAL_INT(0, R_sign((Rational){0, 1}));
+	TEST_ASSERT_EQUAL_INT32(7, R_abs((Rational){-7, 3}).top);
+	TEST_ASSERT_EQUAL_INT32(3, R_abs((Rational){-7, 3}).bottom);
+}
+
+/**
+@fn test_R_argmaxAbs
+@brief Tests the functionality of R_argmaxAbs().
+@details Verifies that R_argmaxAbs() finds the same position as a simple loop
+over R_compare() of R_abs() values, for columns of several lengths and strides,
+and that ties go to the first position.
+*/
+void test_R_argmaxAbs ()
+{
+	int32_t errorType;
+	Rational values[300];
+	for (int trial = 0; trial < 200; trial++)
+	{
+		size_t count = Random_in_range(1, 100, &errorType);
+		size_t stride = Random_in_range(1, 3, &errorType);
+		/* Small ranges make repeated magnitudes likely. */
+		int32_t range = trial % 2 ? 5 : 1000000;
+		for (size_t i = 0; i < count * stride; i++)
+		{
+			R_reduce64(&values[i], Random_in_range(-range, range, &errorType),
+				Random_in_range(1, range, &errorType));
+		}
+		size_t expected = 0;
+		for (size_t i = 1; i < count; i++)
+		{
+			if ( R_compare(R_abs(values[i * stride]),
+				R_abs(values[expected * stride])) > 0 )
+			{
+				expected = i;
+			}
+		}
+		TEST_ASSERT_EQUAL_UINT32(expected, R_argmaxAbs(values, count, stride));
+	}
+	/* INT32_MIN has the largest magnitude of all. */
+	Rational column[6] = {{3, 1}, {INT_MAX, 1}, {INT_MIN, 1}, {-5, 2}, {INT_MIN, 1},
+		{INT_MAX, 2}};
+	TEST_ASSERT_EQUAL_UINT32(2, R_argmaxAbs(column, 6, 1));
+	TEST_ASSERT_EQUAL_UINT32(0, R_argmaxAbs(column, 0, 1));
+}
+
 int main ()
 {
 	/* Initialize Unity. */
 	UNITY_BEGIN();
 	/* Call each test function using Unity's RUN_TEST() function. */
+	RUN_TEST(test_R_new);
+	RUN_TEST(test_R_copy);
+	RUN_TEST(test_R_GCD);
+	RUN_TEST(test_R_reduce);
+	RUN_TEST(test_R_divPrepared);
+	RUN_TEST(test_R_compare);
+	RUN_TEST(test_R_argmaxAbs);
 	/* Once each test is complete, return Unity's result. */
 	return UNITY_END();
 }
\ No newline at end of file
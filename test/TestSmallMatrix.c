@@ -0,0 +1,328 @@
+/**
+@file TestSmallMatrix.c
+@author Rob Thomas
+@brief Contains Unity functions for testing the functionality of SmallMatrix.c.
+*/
+
+/*** INCLUDES: ***/
+#include <string.h>
+
+#include "unity.h"
+#include "LinearSolve.h"
+#include "Matrix.h"
+#include "Random.h"
+#include "Rational.h"
+#include "SmallMatrix.h"
+
+/*** DEFINES: ***/
+#define TEST_REPEATS 20
+#define TEST_MAX_ENTRY 9
+
+/*** FUNCTION DEFINITIONS: ***/
+
+/**
+@fn randomMatrix
+@brief Creates a Matrix of small random fractions.
+@param numRows The number of rows.
+@param numCols The number of columns.
+@return A pointer to the new Matrix.
+*/
+static Matrix *randomMatrix (unsigned int numRows, unsigned int numCols)
+{
+	int error;
+	Matrix *m = M_new(numRows, numCols);
+	for (size_t i = 0; i < (size_t)numRows * numCols; i++)
+	{
+		R_reduce64(&m->elements[i],
+			Random_in_range(-TEST_MAX_ENTRY, TEST_MAX_ENTRY, &error),
+			Random_in_range(1, TEST_MAX_ENTRY, &error));
+	}
+	M_rehash(m);
+	return m;
+}
+
+/**
+@fn referenceProduct
+@brief Computes coefficient * a * b one Rational operation at a time, as a
+reference for the kernels.
+@param coefficient The Rational the product is scaled by.
+@param a Pointer to the left operand.
+@param b Pointer to the right operand.
+@return A pointer to a new Matrix holding the product.
+*/
+static Matrix *referenceProduct (Rational coefficient, Matrix *a, Matrix *b)
+{
+	Matrix *product = M_new(a->numRows, b->numCols);
+	for (unsigned int i = 0; i < a->numRows; i++)
+	{
+		for (unsigned int j = 0; j < b->numCols; j++)
+		{
+			Rational sum = {0, 1};
+			for (unsigned int k = 0; k < a->numCols; k++)
+			{
+				Rational term = M_AT(a, i, k);
+				R_multR(&term, M_AT(b, k, j));
+				R_addR(&sum, term);
+			}
+			R_multR(&sum, coefficient);
+			M_AT(product, i, j) = sum;
+		}
+	}
+	return product;
+}
+
+/**
+@fn assertEqualMatrices
+@brief Asserts that two matrices have the same dimensions and reduced entries.
+@param expected Pointer to the expected Matrix.
+@param actual Pointer to the Matrix to check.
+*/
+static void assertEqualMatrices (Matrix *expected, Matrix *actual)
+{
+	TEST_ASSERT_EQUAL_UINT(expected->numRows, actual->numRows);
+	TEST_ASSERT_EQUAL_UINT(expected->numCols, actual->numCols);
+	for (size_t i = 0; i < (size_t)expected->numRows * expected->numCols; i++)
+	{
+		TEST_ASSERT_EQUAL_INT32(expected->elements[i].top,
+			actual->elements[i].top);
+		TEST_ASSERT_EQUAL_INT32(expected->elements[i].bottom,
+			actual->elements[i].bottom);
+	}
+}
+
+/**
+@fn test_SM_isSmall
+@brief Tests the functionality of SM_isSmall().
+*/
+void test_SM_isSmall ()
+{
+	unsigned int sizes[][2] = {{1, 1}, {2, 2}, {3, 3}, {4, 4}, {5, 5}, {2, 3}};
+	bool expected[] = {false, true, true, true, false, false};
+	for (int i = 0; i < 6; i++)
+	{
+		Matrix *m = M_new(sizes[i][0], sizes[i][1]);
+		TEST_ASSERT_EQUAL_INT(expected[i], SM_isSmall(m));
+		M_free(m);
+	}
+}
+
+/**
+@fn test_SM_multiply
+@brief Tests the functionality of SM_multiply().
+@details Compares random products of every size against the reference, both
+into a separate Matrix and into one of the operands.
+*/
+void test_SM_multiply ()
+{
+	Rational coefficient = {-3, 2};
+	for (unsigned int n = SM_MIN_SIZE; n <= SM_MAX_SIZE; n++)
+	{
+		for (int r = 0; r < TEST_REPEATS; r++)
+		{
+			Matrix *a = randomMatrix(n, n);
+			Matrix *b = randomMatrix(n, n);
+			Matrix *expected = referenceProduct(coefficient, a, b);
+			Matrix *dest = M_new(n, n);
+			TEST_ASSERT_EQUAL_INT(0, SM_multiply(dest, coefficient, a, b));
+			assertEqualMatrices(expected, dest);
+			M_rehash(expected);
+			TEST_ASSERT_EQUAL_UINT64(expected->contentHash, dest->contentHash);
+			TEST_ASSERT_EQUAL_INT(0, SM_multiply(b, coefficient, a, b));
+			assertEqualMatrices(expected, b);
+			M_free(a);
+			M_free(b);
+			M_free(expected);
+			M_free(dest);
+		}
+	}
+}
+
+/**
+@fn test_SM_multiply_unsupported
+@brief Tests that SM_multiply() leaves dest unchanged when it cannot handle
+its operands.
+*/
+void test_SM_multiply_unsupported ()
+{
+	Rational one = {1, 1};
+	Matrix *a = randomMatrix(3, 3);
+	Matrix *b = randomMatrix(2, 2);
+	Matrix *dest = randomMatrix(3, 3);
+	Matrix *before = M_copy(dest);
+	TEST_ASSERT_EQUAL_INT(FAIL_SMALL_UNSUPPORTED, SM_multiply(dest, one, a, b));
+	assertEqualMatrices(before, dest);
+
+	/* Denominators whose product exceeds SM_MAX_SCALED cannot be scaled. */
+	M_AT(a, 0, 0) = (Rational){1, 65521};
+	M_AT(a, 1, 1) = (Rational){1, 65519};
+	M_rehash(a);
+	TEST_ASSERT_EQUAL_INT(FAIL_SMALL_UNSUPPORTED, SM_multiply(dest, one, a,
+		a));
+	assertEqualMatrices(before, dest);
+	M_free(a);
+	M_free(b);
+	M_free(dest);
+	M_free(before);
+}
+
+/**
+@fn test_SM_determinant
+@brief Tests the functionality of SM_determinant().
+@details Checks known determinants, then compares random ones against
+LS_determinant().
+*/
+void test_SM_determinant ()
+{
+	Matrix *a = M_new(2, 2);
+	M_AT(a, 0, 0) = (Rational){1, 2};
+	M_AT(a, 0, 1) = (Rational){1, 1};
+	M_AT(a, 1, 0) = (Rational){3, 1};
+	M_AT(a, 1, 1) = (Rational){4, 1};
+	M_rehash(a);
+	Rational det;
+	TEST_ASSERT_EQUAL_INT(0, SM_determinant(a, &det));
+	TEST_ASSERT_EQUAL_INT32(-1, det.top);
+	TEST_ASSERT_EQUAL_INT32(1, det.bottom);
+	M_free(a);
+
+	/* The third row is the difference of the first two. */
+	a = M_new(3, 3);
+	int32_t singular[9] = {2, 0, 1, 1, 3, 2, 1, -3, -1};
+	for (int i = 0; i < 9; i++)
+	{
+		a->elements[i] = (Rational){singular[i], 1};
+	}
+	M_rehash(a);
+	TEST_ASSERT_EQUAL_INT(0, SM_determinant(a, &det));
+	TEST_ASSERT_EQUAL_INT32(0, det.top);
+	M_free(a);
+
+	for (unsigned int n = SM_MIN_SIZE; n <= SM_MAX_SIZE; n++)
+	{
+		for (int r = 0; r < TEST_REPEATS; r++)
+		{
+			a = randomMatrix(n, n);
+			TEST_ASSERT_EQUAL_INT(0, SM_determinant(a, &det));
+			LS_Factorization *f;
+			Rational expected = {0, 1};
+			if ( !LS_factor(a, &f) )
+			{
+				TEST_ASSERT_EQUAL_INT(0, LS_determinant(f, &expected));
+				LS_free(f);
+			}
+			TEST_ASSERT_EQUAL_INT32(expected.top, det.top);
+			TEST_ASSERT_EQUAL_INT32(expected.bottom, det.bottom);
+			M_free(a);
+		}
+	}
+}
+
+/**
+@fn test_SM_inverse
+@brief Tests the functionality of SM_inverse().
+@details Verifies that A times its inverse is the identity for random
+matrices of every size, and that a singular Matrix is reported and left as it
+was.
+*/
+void test_SM_inverse ()
+{
+	Rational one = {1, 1};
+	for (unsigned int n = SM_MIN_SIZE; n <= SM_MAX_SIZE; n++)
+	{
+		for (int r = 0; r < TEST_REPEATS; r++)
+		{
+			Matrix *a = randomMatrix(n, n);
+			Matrix *inverse = M_new(n, n);
+			Rational det;
+			SM_determinant(a, &det);
+			int error = SM_inverse(a, inverse);
+			if ( det.top == 0 )
+			{
+				TEST_ASSERT_EQUAL_INT(ERR_SINGULAR, error);
+			}
+			else
+			{
+				TEST_ASSERT_EQUAL_INT(0, error);
+				Matrix *product = referenceProduct(one, a, inverse);
+				for (unsigned int i = 0; i < n; i++)
+				{
+					for (unsigned int j = 0; j < n; j++)
+					{
+						TEST_ASSERT_EQUAL_INT32(i == j, M_AT(product, i, j).top);
+						TEST_ASSERT_EQUAL_INT32(1, M_AT(product, i, j).bottom);
+					}
+				}
+				M_free(product);
+				/* Inverting in place gives the same result. */
+				TEST_ASSERT_EQUAL_INT(0, SM_inverse(a, a));
+				assertEqualMatrices(inverse, a);
+			}
+			M_free(a);
+			M_free(inverse);
+		}
+	}
+
+	Matrix *a = M_new(2, 2);
+	int32_t singular[4] = {2, 4, 1, 2};
+	for (int i = 0; i < 4; i++)
+	{
+		a->elements[i] = (Rational){singular[i], 1};
+	}
+	M_rehash(a);
+	Matrix *before = M_copy(a);
+	TEST_ASSERT_EQUAL_INT(ERR_SINGULAR, SM_inverse(a, a));
+	assertEqualMatrices(before, a);
+	M_free(a);
+	M_free(before);
+}
+
+/**
+@fn test_SM_solve
+@brief Tests the functionality of SM_solve().
+@details Verifies that A*X = B holds for the solutions of random systems with
+one to SM_MAX_SIZE right-hand sides, including when x aliases b.
+*/
+void test_SM_solve ()
+{
+	Rational one = {1, 1};
+	for (unsigned int n = SM_MIN_SIZE; n <= SM_MAX_SIZE; n++)
+	{
+		for (unsigned int numCols = 1; numCols <= SM_MAX_SIZE; numCols++)
+		{
+			Matrix *a = randomMatrix(n, n);
+			Matrix *b = randomMatrix(n, numCols);
+			Matrix *x = M_new(n, numCols);
+			Rational det;
+			SM_determinant(a, &det);
+			int error = SM_solve(a, b, x);
+			if ( det.top == 0 )
+			{
+				TEST_ASSERT_EQUAL_INT(ERR_SINGULAR, error);
+			}
+			else
+			{
+				TEST_ASSERT_EQUAL_INT(0, error);
+				Matrix *product = referenceProduct(one, a, x);
+				assertEqualMatrices(b, product);
+				M_free(product);
+				TEST_ASSERT_EQUAL_INT(0, SM_solve(a, b, b));
+				assertEqualMatrices(x, b);
+			}
+			M_free(a);
+			M_free(b);
+			M_free(x);
+		}
+	}
+}
+
+int main ()
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_SM_isSmall);
+	RUN_TEST(test_SM_multiply);
+	RUN_TEST(test_SM_multiply_unsupported);
+	RUN_TEST(test_SM_determinant);
+	RUN_TEST(test_SM_inverse);
+	RUN_TEST(test_SM_solve);
+	return UNITY_END();
+}
\ No newline at end of file
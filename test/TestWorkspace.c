@@ -0,0 +1,309 @@
+/**
+@file TestWorkspace.c
+@author Rob Thomas
+@brief Contains Unity functions for testing the functionality of Workspace.c.
+*/
+
+/*** INCLUDES: ***/
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "unity.h"
+#include "HashTable.h"
+#include "Matrix.h"
+#include "Rational.h"
+#include "Workspace.h"
+
+/*** DEFINES: ***/
+#define TEST_PATH_LENGTH 64
+#define TEST_TABLE_SIZE 16
+
+/*** GLOBALS: ***/
+static char path[TEST_PATH_LENGTH];
+
+/*** FUNCTION DEFINITIONS: ***/
+
+void setUp ()
+{
+	strcpy(path, "/tmp/test_workspace_XXXXXX");
+	int fd = mkstemp(path);
+	TEST_ASSERT_TRUE(fd >= 0);
+	close(fd);
+}
+
+void tearDown ()
+{
+	unlink(path);
+}
+
+/**
+@fn fillTable
+@brief Adds a Rational, a fractional Matrix and an integer Matrix to a table.
+@param table Pointer to the HashTable.
+*/
+static void fillTable (HashTable *table)
+{
+	Rational r = {-7, 3};
+	TEST_ASSERT_EQUAL_INT(0, HT_add(table, "r", &r, VT_RATIONAL));
+
+	Matrix *a = M_new(3, 5);
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		for (unsigned int j = 0; j < 5; j++)
+		{
+			M_AT(a, i, j) = (Rational){(int32_t)(i * 5 + j) - 6, (int32_t)j + 1};
+			R_reduce(&M_AT(a, i, j));
+		}
+	}
+	M_rehash(a);
+	TEST_ASSERT_EQUAL_INT(0, HT_add(table, "A", a, VT_MATRIX));
+	free(a);
+
+	Matrix *b = M_new(2, 2);
+	M_AT(b, 0, 1) = (Rational){4, 1};
+	M_AT(b, 1, 0) = (Rational){-9, 1};
+	M_rehash(b);
+	TEST_ASSERT_EQUAL_INT(0, HT_add(table, "B", b, VT_MATRIX));
+	free(b);
+}
+
+/**
+@fn assertSameMatrix
+@brief Asserts that two matrices have the same dimensions, elements, hash and
+integer flag.
+@param expected Pointer to the expected Matrix.
+@param actual Pointer to the Matrix to check.
+*/
+static void assertSameMatrix (Matrix *expected, Matrix *actual)
+{
+	TEST_ASSERT_EQUAL_UINT(expected->numRows, actual->numRows);
+	TEST_ASSERT_EQUAL_UINT(expected->numCols, actual->numCols);
+	TEST_ASSERT_EQUAL_MEMORY(expected->elements, actual->elements,
+		sizeof(Rational) * expected->numRows * expected->numCols);
+	TEST_ASSERT_EQUAL_UINT64(expected->contentHash, actual->contentHash);
+	TEST_ASSERT_EQUAL_INT(expected->isInteger, actual->isInteger);
+}
+
+/**
+@fn rewriteMatrixEntry
+@brief Overwrites fields of the first Matrix entry of a saved workspace file.
+@param numRows The number of rows to write.
+@param numCols The number of columns to write.
+@param keyOffset The key offset to write, or 0 to keep it.
+@param keyLength The key length to write, or 0 to keep it.
+*/
+static void rewriteMatrixEntry (uint32_t numRows, uint32_t numCols,
+	uint64_t keyOffset, uint32_t keyLength)
+{
+	FILE *file = fopen(path, "r+");
+	TEST_ASSERT_NOT_NULL(file);
+	WorkspaceHeader header;
+	TEST_ASSERT_EQUAL_size_t(1, fread(&header, sizeof(header), 1, file));
+	for (uint32_t e = 0; e < header.numEntries; e++)
+	{
+		WorkspaceEntry entry;
+		long position = ftell(file);
+		TEST_ASSERT_EQUAL_size_t(1, fread(&entry, sizeof(entry), 1, file));
+		if ( entry.valueType != VT_MATRIX )
+		{
+			continue;
+		}
+		entry.numRows = numRows;
+		entry.numCols = numCols;
+		if ( keyOffset )
+		{
+			entry.keyOffset = keyOffset;
+			entry.keyLength = keyLength;
+		}
+		fseek(file, position, SEEK_SET);
+		fwrite(&entry, sizeof(entry), 1, file);
+		break;
+	}
+	fclose(file);
+}
+
+/**
+@fn test_WS_save
+@brief Tests the functionality of WS_save(), WS_load() and WS_close().
+@details Saves a table, loads it into a fresh one and verifies every value,
+that loaded matrices borrow their elements from the mapping, and that writing
+to a loaded Matrix does not change the file.
+*/
+void test_WS_save ()
+{
+	HashTable *saved = HT_newTable(TEST_TABLE_SIZE);
+	fillTable(saved);
+	TEST_ASSERT_EQUAL_INT(0, WS_save(saved, path));
+
+	HashTable *loaded = HT_newTable(TEST_TABLE_SIZE);
+	Workspace workspace;
+	TEST_ASSERT_EQUAL_INT(0, WS_load(loaded, path, &workspace));
+	TEST_ASSERT_NOT_NULL(workspace.base);
+
+	value_t type;
+	Rational *r = (Rational *)HT_get(loaded, "r", &type);
+	TEST_ASSERT_NOT_NULL(r);
+	TEST_ASSERT_EQUAL_INT(VT_RATIONAL, type);
+	TEST_ASSERT_EQUAL_INT32(-7, r->top);
+	TEST_ASSERT_EQUAL_INT32(3, r->bottom);
+
+	char *names[] = {"A", "B"};
+	for (int v = 0; v < 2; v++)
+	{
+		Matrix *expected = (Matrix *)HT_get(saved, names[v], NULL);
+		Matrix *m = (Matrix *)HT_get(loaded, names[v], &type);
+		TEST_ASSERT_NOT_NULL(m);
+		TEST_ASSERT_EQUAL_INT(VT_MATRIX, type);
+		assertSameMatrix(expected, m);
+		TEST_ASSERT_TRUE(m->isBorrowed);
+		TEST_ASSERT_TRUE((char *)m->elements >= (char *)workspace.base &&
+			(char *)m->elements < (char *)workspace.base + workspace.length);
+	}
+	TEST_ASSERT_FALSE(((Matrix *)HT_get(loaded, "A", NULL))->isInteger);
+	TEST_ASSERT_TRUE(((Matrix *)HT_get(loaded, "B", NULL))->isInteger);
+
+	/* The mapping is private, so this write never reaches the file. */
+	M_AT((Matrix *)HT_get(loaded, "B", NULL), 0, 0) = (Rational){1, 1};
+	HT_freeTable(loaded);
+	WS_close(&workspace);
+	TEST_ASSERT_NULL(workspace.base);
+
+	loaded = HT_newTable(TEST_TABLE_SIZE);
+	TEST_ASSERT_EQUAL_INT(0, WS_load(loaded, path, &workspace));
+	assertSameMatrix((Matrix *)HT_get(saved, "B", NULL),
+		(Matrix *)HT_get(loaded, "B", NULL));
+	HT_freeTable(loaded);
+	WS_close(&workspace);
+	HT_freeTable(saved);
+}
+
+/**
+@fn test_WS_load_overwrite
+@brief Tests that a loaded Matrix overwritten in the table does not need the
+mapping, so the workspace can be closed before the table is freed.
+*/
+void test_WS_load_overwrite ()
+{
+	HashTable *table = HT_newTable(TEST_TABLE_SIZE);
+	fillTable(table);
+	TEST_ASSERT_EQUAL_INT(0, WS_save(table, path));
+	HT_freeTable(table);
+
+	table = HT_newTable(TEST_TABLE_SIZE);
+	Workspace workspace;
+	TEST_ASSERT_EQUAL_INT(0, WS_load(table, path, &workspace));
+	Matrix *copyA = M_copy((Matrix *)HT_get(table, "A", NULL));
+	Matrix *copyB = M_copy((Matrix *)HT_get(table, "B", NULL));
+	TEST_ASSERT_EQUAL_INT(0, HT_add(table, "A", copyA, VT_MATRIX));
+	TEST_ASSERT_EQUAL_INT(0, HT_add(table, "B", copyB, VT_MATRIX));
+	WS_close(&workspace);
+
+	Matrix *a = (Matrix *)HT_get(table, "A", NULL);
+	TEST_ASSERT_FALSE(a->isBorrowed);
+	TEST_ASSERT_EQUAL_INT32(-6, M_AT(a, 0, 0).top);
+	TEST_ASSERT_EQUAL_INT32(1, M_AT(a, 0, 0).bottom);
+	TEST_ASSERT_EQUAL_INT32(-9, M_AT((Matrix *)HT_get(table, "B", NULL), 1,
+		0).top);
+	free(copyA);
+	free(copyB);
+	HT_freeTable(table);
+}
+
+/**
+@fn test_WS_load_errors
+@brief Tests the errors reported by WS_load() for missing, short, corrupt and
+newer files.
+*/
+void test_WS_load_errors ()
+{
+	HashTable *table = HT_newTable(TEST_TABLE_SIZE);
+	Workspace workspace;
+	TEST_ASSERT_EQUAL_INT(ERR_WORKSPACE_IO, WS_load(table,
+		"/nonexistent/workspace", &workspace));
+	TEST_ASSERT_EQUAL_INT(ERR_WORKSPACE_FORMAT, WS_load(table, path,
+		&workspace));
+
+	FILE *file = fopen(path, "w");
+	TEST_ASSERT_NOT_NULL(file);
+	for (int i = 0; i < 256; i++)
+	{
+		fputc(i, file);
+	}
+	fclose(file);
+	TEST_ASSERT_EQUAL_INT(ERR_WORKSPACE_FORMAT, WS_load(table, path,
+		&workspace));
+	TEST_ASSERT_NULL(workspace.base);
+
+	/* A valid file with a later version number. */
+	HashTable *saved = HT_newTable(TEST_TABLE_SIZE);
+	fillTable(saved);
+	TEST_ASSERT_EQUAL_INT(0, WS_save(saved, path));
+	HT_freeTable(saved);
+	file = fopen(path, "r+");
+	TEST_ASSERT_NOT_NULL(file);
+	WorkspaceHeader header;
+	TEST_ASSERT_EQUAL_size_t(1, fread(&header, sizeof(header), 1, file));
+	header.version = WS_VERSION + 1;
+	rewind(file);
+	fwrite(&header, sizeof(header), 1, file);
+	fclose(file);
+	TEST_ASSERT_EQUAL_INT(ERR_WORKSPACE_VERSION, WS_load(table, path,
+		&workspace));
+
+	/* A truncated file no longer matches the size in its header. */
+	header.version = WS_VERSION;
+	file = fopen(path, "r+");
+	fwrite(&header, sizeof(header), 1, file);
+	fclose(file);
+	TEST_ASSERT_EQUAL_INT(0, truncate(path, header.fileSize - 8));
+	TEST_ASSERT_EQUAL_INT(ERR_WORKSPACE_FORMAT, WS_load(table, path,
+		&workspace));
+	TEST_ASSERT_NULL(HT_get(table, "A", NULL));
+	HT_freeTable(table);
+}
+
+/**
+@fn test_WS_load_overflow
+@brief Tests that WS_load() rejects entries whose sizes or offsets only pass
+the bounds checks by wrapping around.
+*/
+void test_WS_load_overflow ()
+{
+	HashTable *table = HT_newTable(TEST_TABLE_SIZE);
+	fillTable(table);
+	TEST_ASSERT_EQUAL_INT(0, WS_save(table, path));
+	HT_freeTable(table);
+
+	/* 8 * 2^31 * 2^31 bytes wraps to 0. */
+	rewriteMatrixEntry(0x80000000u, 0x80000000u, 0, 0);
+	table = HT_newTable(TEST_TABLE_SIZE);
+	Workspace workspace;
+	TEST_ASSERT_EQUAL_INT(ERR_WORKSPACE_FORMAT, WS_load(table, path,
+		&workspace));
+	TEST_ASSERT_NULL(workspace.base);
+
+	/* A key offset which wraps back onto the end of the real key. */
+	FILE *file = fopen(path, "r");
+	WorkspaceHeader header;
+	WorkspaceEntry entry;
+	TEST_ASSERT_EQUAL_size_t(1, fread(&header, sizeof(header), 1, file));
+	TEST_ASSERT_EQUAL_size_t(1, fread(&entry, sizeof(entry), 1, file));
+	fclose(file);
+	rewriteMatrixEntry(1, 1, UINT64_MAX, (uint32_t)(entry.keyOffset +
+		entry.keyLength + 1));
+	TEST_ASSERT_EQUAL_INT(ERR_WORKSPACE_FORMAT, WS_load(table, path,
+		&workspace));
+	TEST_ASSERT_NULL(HT_get(table, "A", NULL));
+	HT_freeTable(table);
+}
+
+int main ()
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_WS_save);
+	RUN_TEST(test_WS_load_overwrite);
+	RUN_TEST(test_WS_load_errors);
+	RUN_TEST(test_WS_load_overflow);
+	return UNITY_END();
+}
\ No newline at end of file